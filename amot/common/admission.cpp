@@ -0,0 +1,139 @@
+#include "admission.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace amot {
+
+namespace {
+constexpr double kLagAlpha = 0.2;
+/* 每隔若干窗口放开最小延迟，跟上后端真实基线的变化 */
+constexpr size_t kProbeWindows = 256;
+
+constexpr char kBusyResponse[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Length: 0\r\n"
+    "Retry-After: 1\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+}  // namespace
+
+AdmissionController::AdmissionController(const AdmissionOptions& options)
+    : options_(options),
+      limit_(std::clamp(options.initialLimit, options.minLimit, options.maxLimit)),
+      inflight_(0), loopLagMS_(0), pausedUntilMS_(0),
+      windowSumUS_(0), windowCount_(0), windowMaxInflight_(0),
+      minLatencyUS_(0), windowsSinceProbe_(0),
+      limitF_(static_cast<double>(limit_.load())),
+      admitted_(0), rejectedRequests_(0), rejectedConns_(0), pauses_(0) {}
+
+std::string_view AdmissionController::BusyResponse() {
+    return std::string_view(kBusyResponse, sizeof(kBusyResponse) - 1);
+}
+
+void AdmissionController::OnLoop(uint64_t busyUS) {
+    double lag = loopLagMS_.load(std::memory_order_relaxed);
+    lag += kLagAlpha * (busyUS / 1000.0 - lag);
+    loopLagMS_.store(lag, std::memory_order_relaxed);
+}
+
+bool AdmissionController::Overloaded(size_t queueDepth) const {
+    return queueDepth >= options_.maxQueueDepth
+        || loopLagMS_.load(std::memory_order_relaxed) >= options_.maxLoopLagMS;
+}
+
+AdmissionController::Decision AdmissionController::OnAccept(size_t queueDepth, uint64_t nowMS) {
+    if(nowMS < pausedUntilMS_) { return Decision::PAUSE; }
+    /* 积压或延迟达到两倍阈值：连 503 都不回，暂停 accept */
+    if(queueDepth >= 2 * options_.maxQueueDepth
+            || loopLagMS_.load(std::memory_order_relaxed) >= 2.0 * options_.maxLoopLagMS) {
+        pausedUntilMS_ = nowMS + options_.pauseAcceptMS;
+        pauses_.fetch_add(1, std::memory_order_relaxed);
+        return Decision::PAUSE;
+    }
+    if(Overloaded(queueDepth)) {
+        rejectedConns_.fetch_add(1, std::memory_order_relaxed);
+        return Decision::REJECT;
+    }
+    return Decision::ACCEPT;
+}
+
+bool AdmissionController::CanResumeAccept(size_t queueDepth, uint64_t nowMS) const {
+    return nowMS >= pausedUntilMS_ && !Overloaded(queueDepth);
+}
+
+bool AdmissionController::TryAcquire() {
+    size_t cur = inflight_.load(std::memory_order_relaxed);
+    do {
+        if(cur >= limit_.load(std::memory_order_relaxed)) {
+            rejectedRequests_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while(!inflight_.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed));
+    admitted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AdmissionController::Release(uint64_t latencyUS) {
+    size_t inflight = inflight_.fetch_sub(1, std::memory_order_relaxed);
+    if(options_.algorithm == LimitAlgorithm::FIXED) { return; }
+    std::lock_guard<std::mutex> locker(mtx_);
+    windowSumUS_ += latencyUS;
+    windowCount_++;
+    windowMaxInflight_ = std::max(windowMaxInflight_, inflight);
+    if(windowCount_ < options_.windowSize) { return; }
+    double avg = static_cast<double>(windowSumUS_) / windowCount_;
+    size_t maxInflight = windowMaxInflight_;
+    windowSumUS_ = 0;
+    windowCount_ = 0;
+    windowMaxInflight_ = 0;
+    UpdateLimit_(avg, maxInflight);
+}
+
+void AdmissionController::UpdateLimit_(double avgUS, size_t maxInflight) {
+    double limit = limitF_;
+    /* 名额没用到一半时延迟样本不反映容量，不放大上限 */
+    const bool saturated = maxInflight * 2 >= static_cast<size_t>(limit);
+    const bool lagging = loopLagMS_.load(std::memory_order_relaxed) >= options_.maxLoopLagMS;
+
+    if(options_.algorithm == LimitAlgorithm::AIMD) {
+        if(lagging || avgUS > options_.targetLatencyMS * 1000.0) {
+            limit *= options_.backoff;
+        } else if(saturated) {
+            limit += 1;
+        }
+    } else {
+        /* 缓存命中、503 等窗口的平均延迟可能为 0，按 1us 计，避免 0/0 */
+        avgUS = std::max(avgUS, 1.0);
+        if(minLatencyUS_ == 0 || avgUS < minLatencyUS_ || ++windowsSinceProbe_ >= kProbeWindows) {
+            minLatencyUS_ = avgUS;
+            windowsSinceProbe_ = 0;
+        }
+        double gradient = std::clamp(options_.tolerance * minLatencyUS_ / avgUS, 0.5, 1.0);
+        if(lagging) { gradient = 0.5; }
+        /* sqrt(limit) 作为允许的排队余量，延迟平稳时上限缓慢增长 */
+        double target = limit * gradient + (saturated ? std::sqrt(limit) : 0.0);
+        if(!saturated) { target = std::min(target, limit); }
+        limit = limit * (1 - options_.smoothing) + target * options_.smoothing;
+    }
+    limit = std::clamp(limit, static_cast<double>(options_.minLimit),
+                       static_cast<double>(options_.maxLimit));
+    limitF_ = limit;
+    limit_.store(static_cast<size_t>(limit), std::memory_order_relaxed);
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const {
+    Stats stats;
+    stats.admitted = admitted_.load(std::memory_order_relaxed);
+    stats.rejectedRequests = rejectedRequests_.load(std::memory_order_relaxed);
+    stats.rejectedConns = rejectedConns_.load(std::memory_order_relaxed);
+    stats.pauses = pauses_.load(std::memory_order_relaxed);
+    stats.limit = Limit();
+    stats.inflight = Inflight();
+    stats.loopLagMS = loopLagMS_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> locker(mtx_);
+    stats.minLatencyUS = minLatencyUS_;
+    return stats;
+}
+
+}  // namespace amot
@@ -0,0 +1,142 @@
+/**
+ * @file admission.h
+ * @brief 过载准入控制：按任务队列深度、事件循环延迟与自适应并发上限提前拒绝
+ * @version 0.1
+ * @date 2024-04-13
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string_view>
+
+namespace amot {
+
+/**
+ * @brief 并发上限的调整算法
+ */
+enum class LimitAlgorithm {
+    FIXED,      // 固定为 initialLimit
+    AIMD,       // 延迟超过目标或过载时乘性减小，否则加性增加
+    GRADIENT,   // 按 最小延迟/当前延迟 的梯度调整，排队延迟一出现就收缩
+};
+
+struct AdmissionOptions {
+    LimitAlgorithm algorithm = LimitAlgorithm::GRADIENT;
+    size_t initialLimit = 64;
+    size_t minLimit = 4;
+    size_t maxLimit = 4096;
+    size_t windowSize = 64;         // 每累计多少个完成请求调整一次上限
+
+    int targetLatencyMS = 50;       // AIMD：窗口平均延迟超过该值即收缩
+    double backoff = 0.9;           // AIMD：乘性减小系数
+    double tolerance = 2.0;         // GRADIENT：允许相对最小延迟放大的倍数
+    double smoothing = 0.2;         // GRADIENT：新旧上限的平滑系数
+
+    size_t maxQueueDepth = 1024;    // 线程池积压任务数上限
+    int maxLoopLagMS = 100;         // 事件循环单轮处理耗时上限(EWMA)
+    int pauseAcceptMS = 200;        // 严重过载时暂停 accept 的时长
+};
+
+/**
+ * @brief 准入控制器
+ * @details 事件循环线程调用 OnLoop/OnAccept，工作线程调用 TryAcquire/Release。
+ *          新连接在过载时直接回预先序列化好的 503 并关闭，严重过载时暂停 accept
+ *          让连接留在内核队列里；已建立连接上的请求受并发上限约束，被拒绝的请求
+ *          不进入线程池，保证已接收请求的排队延迟有界。
+ */
+class AdmissionController {
+public:
+    enum class Decision {
+        ACCEPT,
+        REJECT,     // 回 503 后关闭
+        PAUSE,      // 暂停 accept
+    };
+
+    struct Stats {
+        uint64_t admitted = 0;
+        uint64_t rejectedRequests = 0;
+        uint64_t rejectedConns = 0;
+        uint64_t pauses = 0;
+        size_t limit = 0;
+        size_t inflight = 0;
+        double loopLagMS = 0;
+        double minLatencyUS = 0;
+    };
+
+    explicit AdmissionController(const AdmissionOptions& options = AdmissionOptions());
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    /**
+     * @brief 事件循环每轮结束时调用，busyUS 为本轮处理事件的耗时
+     */
+    void OnLoop(uint64_t busyUS);
+
+    /**
+     * @brief 是否接收新连接
+     *
+     * @param queueDepth    线程池当前积压的任务数
+     * @param nowMS         单调时钟毫秒
+     */
+    Decision OnAccept(size_t queueDepth, uint64_t nowMS);
+
+    /**
+     * @brief 暂停期是否已结束，事件循环据此恢复监听
+     */
+    bool CanResumeAccept(size_t queueDepth, uint64_t nowMS) const;
+
+    /**
+     * @brief 为一个请求申请并发名额，失败表示应当拒绝
+     */
+    bool TryAcquire();
+
+    /**
+     * @brief 请求完成，归还名额并提交延迟样本(从准入到完成，含排队时间)
+     */
+    void Release(uint64_t latencyUS);
+
+    size_t Limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    size_t Inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+    bool Overloaded(size_t queueDepth) const;
+
+    Stats GetStats() const;
+
+    /**
+     * @brief 预先序列化的 503 响应，拒绝时只需一次 send
+     */
+    static std::string_view BusyResponse();
+
+private:
+    void UpdateLimit_(double avgUS, size_t maxInflight);
+
+    const AdmissionOptions options_;
+
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> inflight_;
+    std::atomic<double> loopLagMS_;
+    uint64_t pausedUntilMS_;
+
+    /* 延迟窗口，受 mtx_ 保护 */
+    mutable std::mutex mtx_;
+    uint64_t windowSumUS_;
+    size_t windowCount_;
+    size_t windowMaxInflight_;
+    double minLatencyUS_;
+    size_t windowsSinceProbe_;
+    double limitF_;
+
+    std::atomic<uint64_t> admitted_;
+    std::atomic<uint64_t> rejectedRequests_;
+    std::atomic<uint64_t> rejectedConns_;
+    std::atomic<uint64_t> pauses_;
+};
+
+}  // namespace amot
@@ -0,0 +1,749 @@
+/**
+ * @file binlog.h
+ * @brief 延迟格式化的二进制日志：调用点只记录格式串编号和原始参数，由后台线程或离线工具格式化
+ * @version 0.1
+ * @date 2024-05-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fmt/args.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "log.h"
+
+/**
+ * @brief 记录一条二进制日志，format 为 fmt 风格(与 spdlog 相同)
+ * @details 每个调用点的格式串、级别和参数类型只登记一次；之后每次调用只写入
+ *          调用点编号、时间戳和参数的原始字节。字符串参数按值拷贝。
+ *          例：AMOT_BINLOG(binlog, spdlog::level::info, "Client[{}] in!", fd);
+ */
+#define AMOT_BINLOG(binlog, level, format, ...)                                                     \
+	do {                                                                                            \
+		static const ::amot::LogSite amot_binlog_site(                                              \
+			level, format, __FILE__, __LINE__,                                                      \
+			::amot::BinlogArgTypes(static_cast<decltype(::amot::BinlogTypeList(__VA_ARGS__)) *>(nullptr))); \
+		(binlog).Log(amot_binlog_site __VA_OPT__(,) __VA_ARGS__);                                   \
+	} while(0)
+
+namespace amot {
+
+// 参数在记录中的编码
+enum class BinlogArg : uint8_t {
+	I64 = 1,	// 有符号整数，8 字节
+	U64,		// 无符号整数，8 字节
+	F64,		// 浮点数，8 字节
+	BOOL,		// 1 字节
+	CHAR,		// 1 字节
+	STR,		// 4 字节长度 + 内容
+	PTR,		// 8 字节
+};
+
+template<typename T, typename = void>
+struct BinlogArgOf;
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_same_v<T, bool>>> {
+	static constexpr BinlogArg value = BinlogArg::BOOL;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_same_v<T, char>>> {
+	static constexpr BinlogArg value = BinlogArg::CHAR;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+									   !std::is_same_v<T, char>>> {
+	static constexpr BinlogArg value = std::is_signed_v<T> ? BinlogArg::I64 : BinlogArg::U64;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_enum_v<T>>> {
+	static constexpr BinlogArg value = BinlogArg::I64;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+	static constexpr BinlogArg value = BinlogArg::F64;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+									   std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>>> {
+	static constexpr BinlogArg value = BinlogArg::STR;
+};
+
+template<typename T>
+struct BinlogArgOf<T, std::enable_if_t<std::is_pointer_v<T> && !std::is_same_v<T, const char*> &&
+									   !std::is_same_v<T, char*>>> {
+	static constexpr BinlogArg value = BinlogArg::PTR;
+};
+
+template<typename... Args>
+struct BinlogTypes {};
+
+// 仅用于 decltype，不求值
+template<typename... Args>
+BinlogTypes<std::decay_t<Args>...> BinlogTypeList(const Args&...);
+
+template<typename... Args>
+std::vector<BinlogArg> BinlogArgTypes(BinlogTypes<Args...>*) {
+	return {BinlogArgOf<Args>::value...};
+}
+
+/**
+ * @brief 一个日志调用点，进程内按首次执行的顺序编号
+ */
+struct LogSite {
+	LogSite(spdlog::level::level_enum level, const char* format, const char* file, int line,
+			std::vector<BinlogArg> types)
+		: level(level), format(format), file(file), line(line), types(std::move(types)) {
+		std::lock_guard<std::mutex> locker(Mutex());
+		id = static_cast<uint32_t>(Sites().size());
+		Sites().push_back(this);
+	}
+
+	static const LogSite* Find(uint32_t id) {
+		std::lock_guard<std::mutex> locker(Mutex());
+		return id < Sites().size() ? Sites()[id] : nullptr;
+	}
+
+	spdlog::level::level_enum level;
+	const char* format;
+	const char* file;
+	int line;
+	std::vector<BinlogArg> types;
+	uint32_t id;
+
+private:
+	static std::mutex& Mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<const LogSite*>& Sites() {
+		static std::vector<const LogSite*> sites;
+		return sites;
+	}
+};
+
+/**
+ * @brief 把记录中的参数按调用点的格式串格式化，进程内和离线解码共用
+ * @return 参数与类型表不符或格式串错误时返回带说明的文本，不抛异常
+ */
+inline std::string BinlogFormat(const char* format, const std::vector<BinlogArg>& types,
+								const uint8_t* data, size_t size) {
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+	const uint8_t* end = data + size;
+	auto take = [&](void* out, size_t n) {
+		if(static_cast<size_t>(end - data) < n) { return false; }
+		memcpy(out, data, n);
+		data += n;
+		return true;
+	};
+	for(BinlogArg type : types) {
+		bool ok = true;
+		switch(type) {
+		case BinlogArg::I64: { int64_t v = 0; ok = take(&v, 8); store.push_back(v); break; }
+		case BinlogArg::U64: { uint64_t v = 0; ok = take(&v, 8); store.push_back(v); break; }
+		case BinlogArg::F64: { double v = 0; ok = take(&v, 8); store.push_back(v); break; }
+		case BinlogArg::BOOL: { uint8_t v = 0; ok = take(&v, 1); store.push_back(v != 0); break; }
+		case BinlogArg::CHAR: { char v = 0; ok = take(&v, 1); store.push_back(v); break; }
+		case BinlogArg::PTR: {
+			uint64_t v = 0;
+			ok = take(&v, 8);
+			store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(v)));
+			break;
+		}
+		case BinlogArg::STR: {
+			uint32_t n = 0;
+			ok = take(&n, 4) && static_cast<size_t>(end - data) >= n;
+			if(ok) {
+				store.push_back(std::string(reinterpret_cast<const char*>(data), n));
+				data += n;
+			}
+			break;
+		}
+		default: ok = false;
+		}
+		if(!ok) { return std::string("[binlog: corrupt record] ") + format; }
+	}
+	try {
+		return fmt::vformat(format, store);
+	} catch(const std::exception& ex) {
+		return std::string("[binlog: ") + ex.what() + "] " + format;
+	}
+}
+
+/**
+ * @brief 时间戳时钟：x86 上读 TSC，其余平台用单调时钟纳秒
+ */
+struct BinlogClock {
+	static uint64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	static int64_t WallNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				   std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+};
+
+/**
+ * @brief 由 (ticks, 墙上时间) 采样点把 ticks 换算为墙上时间
+ */
+class BinlogCalibration {
+public:
+	void Sample(uint64_t ticks, int64_t wallNs) {
+		if(m_samples == 0) {
+			m_baseTicks = ticks;
+			m_baseNs = wallNs;
+		} else if(ticks > m_baseTicks && wallNs > m_baseNs) {
+			m_nsPerTick = double(wallNs - m_baseNs) / double(ticks - m_baseTicks);
+		}
+		m_samples++;
+	}
+
+	int64_t ToWallNs(uint64_t ticks) const {
+		return m_baseNs + static_cast<int64_t>((double(ticks) - double(m_baseTicks)) * m_nsPerTick);
+	}
+
+private:
+	uint64_t m_baseTicks = 0;
+	int64_t m_baseNs = 0;
+	double m_nsPerTick = 1.0;
+	uint64_t m_samples = 0;
+};
+
+struct BinaryLogOptions {
+	size_t bufferSize = 256 * 1024;		// 每个线程的字节环大小，超过一半的记录直接丢弃
+	LogOverflow overflow = LogOverflow::DROP;
+	std::chrono::milliseconds pollInterval{5};	// 后台线程空闲时的轮询间隔
+};
+
+/**
+ * @brief 二进制日志
+ * @details 每个线程一个单生产者字节环，记录为 [长度][调用点][ticks][参数]，
+ *          调用线程只做一次 TSC 读取和若干 memcpy。后台线程定期取出记录：
+ *          - 目标为日志器时，格式化后以原时间戳和线程号写入其 sink；
+ *          - 目标为文件时，原样写出，并在首次出现时写入调用点定义和时钟采样，
+ *            文件自描述，用 BinlogReader 或 amot_binlog_decode 离线解码。
+ *          缓冲满时按 overflow 策略阻塞或丢弃(OVERRUN 按 DROP 处理)。
+ */
+class BinaryLog {
+public:
+	// 文件中的记录类型
+	enum Kind : uint8_t {
+		KIND_SITE = 1,
+		KIND_CLOCK = 2,
+		KIND_EVENT = 3,
+	};
+
+	explicit BinaryLog(std::shared_ptr<spdlog::logger> target, const BinaryLogOptions& options = BinaryLogOptions())
+		: m_options(options), m_id(NextId()), m_target(std::move(target)) {
+		Start();
+	}
+
+	explicit BinaryLog(const std::string& path, const BinaryLogOptions& options = BinaryLogOptions())
+		: m_options(options), m_id(NextId()), m_file(fopen(path.c_str(), "ab")) {
+		if(!m_file) { throw spdlog::spdlog_ex("binlog: failed to open " + path, errno); }
+		Start();
+	}
+
+	~BinaryLog() {
+		{
+			std::lock_guard<std::mutex> locker(m_mutex);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		m_thread.join();
+		if(m_file) { fclose(m_file); }
+	}
+
+	BinaryLog(const BinaryLog&) = delete;
+	BinaryLog& operator=(const BinaryLog&) = delete;
+
+	template<typename... Args>
+	void Log(const LogSite& site, const Args&... args) {
+		if(m_target && !m_target->should_log(site.level)) { return; }
+		uint64_t total = 4 + 4 + 8 + (ArgSize(args) + ... + 0);
+		Ring& ring = Local();
+		// 超过环的一半永远放不下，无论哪种策略都丢弃，否则 BLOCK 会一直等
+		if(total > ring.MaxRecord()) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		uint32_t size = static_cast<uint32_t>(total);
+		uint8_t* p = ring.Reserve(size);
+		while(!p) {
+			if(m_options.overflow != LogOverflow::BLOCK) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			std::this_thread::yield();
+			p = ring.Reserve(size);
+		}
+		uint64_t ticks = BinlogClock::Ticks();
+		memcpy(p, &size, 4);
+		memcpy(p + 4, &site.id, 4);
+		memcpy(p + 8, &ticks, 8);
+		p += 16;
+		(Encode(p, args), ...);
+		ring.Commit(size);
+	}
+
+	/**
+	 * @brief 等待调用前记录的日志全部写出
+	 */
+	void Flush() {
+		std::unique_lock<std::mutex> locker(m_mutex);
+		uint64_t ticket = ++m_flushRequested;
+		m_cond.notify_all();
+		m_flushed.wait(locker, [&]() { return m_flushDone >= ticket; });
+	}
+
+	uint64_t DroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	/**
+	 * @brief 单生产者单消费者字节环，记录不跨越环尾，尾部不够时写一个跳转标记
+	 */
+	class Ring {
+	public:
+		static constexpr uint32_t kWrap = 0xFFFFFFFF;
+
+		explicit Ring(size_t capacity, uint32_t tid)
+			: m_capacity(RoundUp(capacity)), m_data(new uint8_t[m_capacity]), m_tid(tid) {}
+
+		uint8_t* Reserve(uint32_t size) {
+			uint64_t tail = m_tail.load(std::memory_order_relaxed);
+			size_t offset = tail & (m_capacity - 1);
+			size_t contiguous = m_capacity - offset;
+			// 尾部放不下时需额外占用剩余部分
+			uint64_t need = size <= contiguous ? size : contiguous + size;
+			if(tail + need - m_headCache > m_capacity) {
+				m_headCache = m_head.load(std::memory_order_acquire);
+				if(tail + need - m_headCache > m_capacity) { return nullptr; }
+			}
+			if(size > contiguous) {
+				if(contiguous >= 4) { memcpy(m_data.get() + offset, &kWrap, 4); }
+				m_tail.store(tail + contiguous, std::memory_order_release);
+				offset = 0;
+			}
+			return m_data.get() + offset;
+		}
+
+		// 单条记录的上限，Reserve 的 size 不能超过它
+		size_t MaxRecord() const { return m_capacity / 2; }
+
+		void Commit(uint32_t size) {
+			m_tail.store(m_tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+		}
+
+		// 消费者：取出一条记录，返回指向 [长度] 开头的指针，长度为 0 表示为空
+		const uint8_t* Peek(uint32_t& size) {
+			while(true) {
+				uint64_t head = m_head.load(std::memory_order_relaxed);
+				uint64_t tail = m_tail.load(std::memory_order_acquire);
+				if(head == tail) {
+					size = 0;
+					return nullptr;
+				}
+				size_t offset = head & (m_capacity - 1);
+				size_t contiguous = m_capacity - offset;
+				uint32_t len = kWrap;
+				if(contiguous >= 4) { memcpy(&len, m_data.get() + offset, 4); }
+				if(len == kWrap) {
+					m_head.store(head + contiguous, std::memory_order_release);
+					continue;
+				}
+				size = len;
+				return m_data.get() + offset;
+			}
+		}
+
+		void Pop(uint32_t size) {
+			m_head.store(m_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+		}
+
+		bool Empty() const {
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+		}
+
+		uint32_t Tid() const { return m_tid; }
+
+		std::atomic<bool> orphaned{false};
+
+	private:
+		static size_t RoundUp(size_t capacity) {
+			size_t cap = 64;
+			while(cap < capacity) { cap <<= 1; }
+			return cap;
+		}
+
+		const size_t m_capacity;
+		std::unique_ptr<uint8_t[]> m_data;
+		uint32_t m_tid;
+		alignas(64) std::atomic<uint64_t> m_tail{0};
+		uint64_t m_headCache = 0;	// 生产者私有
+		alignas(64) std::atomic<uint64_t> m_head{0};
+	};
+
+	template<typename T>
+	static uint64_t ArgSize(const T& arg) {
+		constexpr BinlogArg type = BinlogArgOf<std::decay_t<T>>::value;
+		if constexpr(type == BinlogArg::STR) {
+			return 4 + std::string_view(arg).size();
+		} else if constexpr(type == BinlogArg::BOOL || type == BinlogArg::CHAR) {
+			return 1;
+		} else {
+			return 8;
+		}
+	}
+
+	template<typename T>
+	static void Encode(uint8_t*& p, const T& arg) {
+		constexpr BinlogArg type = BinlogArgOf<std::decay_t<T>>::value;
+		if constexpr(type == BinlogArg::STR) {
+			std::string_view text(arg);
+			uint32_t n = static_cast<uint32_t>(text.size());
+			memcpy(p, &n, 4);
+			memcpy(p + 4, text.data(), n);
+			p += 4 + n;
+		} else if constexpr(type == BinlogArg::BOOL || type == BinlogArg::CHAR) {
+			*p++ = static_cast<uint8_t>(arg);
+		} else if constexpr(type == BinlogArg::F64) {
+			double v = static_cast<double>(arg);
+			memcpy(p, &v, 8);
+			p += 8;
+		} else if constexpr(type == BinlogArg::PTR) {
+			uint64_t v = reinterpret_cast<uintptr_t>(arg);
+			memcpy(p, &v, 8);
+			p += 8;
+		} else if constexpr(type == BinlogArg::I64) {
+			int64_t v = static_cast<int64_t>(arg);
+			memcpy(p, &v, 8);
+			p += 8;
+		} else {
+			uint64_t v = static_cast<uint64_t>(arg);
+			memcpy(p, &v, 8);
+			p += 8;
+		}
+	}
+
+	static uint64_t NextId() {
+		static std::atomic<uint64_t> id{0};
+		return ++id;
+	}
+
+	void Start() {
+		m_calibration.Sample(BinlogClock::Ticks(), BinlogClock::WallNs());
+		m_thread = std::thread([this]() { Run(); });
+	}
+
+	Ring& Local() {
+		struct Slot {
+			uint64_t owner = 0;
+			std::shared_ptr<Ring> ring;
+			~Slot() { if(ring) { ring->orphaned.store(true, std::memory_order_release); } }
+		};
+		thread_local Slot slot;
+		if(slot.owner != m_id) {
+			if(slot.ring) { slot.ring->orphaned.store(true, std::memory_order_release); }
+			slot.ring = std::make_shared<Ring>(m_options.bufferSize, static_cast<uint32_t>(syscall(SYS_gettid)));
+			slot.owner = m_id;
+			std::lock_guard<std::mutex> locker(m_ringsMutex);
+			m_rings.push_back(slot.ring);
+		}
+		return *slot.ring;
+	}
+
+	void Run() {
+		std::vector<std::shared_ptr<Ring>> rings;
+		std::vector<bool> written;		// 文件模式下已写出定义的调用点
+		while(true) {
+			uint64_t requested;
+			bool stopping;
+			{
+				std::lock_guard<std::mutex> locker(m_mutex);
+				requested = m_flushRequested;
+				stopping = m_stop;
+			}
+			{
+				std::lock_guard<std::mutex> locker(m_ringsMutex);
+				m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](auto& ring) {
+					return ring->orphaned.load(std::memory_order_acquire) && ring->Empty();
+				}), m_rings.end());
+				rings = m_rings;
+			}
+
+			m_calibration.Sample(BinlogClock::Ticks(), BinlogClock::WallNs());
+			if(m_file) { WriteClock(); }
+			size_t count = 0;
+			for(auto& ring : rings) { count += Drain(*ring, written); }
+			if(m_file) {
+				if(count > 0 || requested > m_flushDone) { fflush(m_file); }
+			} else if(requested > m_flushDone || stopping) {
+				FlushTarget();
+			}
+
+			std::unique_lock<std::mutex> locker(m_mutex);
+			if(requested > m_flushDone) {
+				m_flushDone = requested;
+				m_flushed.notify_all();
+			}
+			if(stopping) {
+				bool empty = true;
+				for(auto& ring : rings) { empty = empty && ring->Empty(); }
+				if(empty) { break; }
+				continue;
+			}
+			if(count == 0 && m_flushRequested == requested && !m_stop) {
+				m_cond.wait_for(locker, m_options.pollInterval);
+			}
+		}
+	}
+
+	size_t Drain(Ring& ring, std::vector<bool>& written) {
+		size_t count = 0;
+		uint32_t size;
+		while(const uint8_t* p = ring.Peek(size)) {
+			uint32_t siteId;
+			uint64_t ticks;
+			memcpy(&siteId, p + 4, 4);
+			memcpy(&ticks, p + 8, 8);
+			const LogSite* site = LogSite::Find(siteId);
+			if(m_file) {
+				if(site && (siteId >= written.size() || !written[siteId])) {
+					WriteSite(*site);
+					if(siteId >= written.size()) { written.resize(siteId + 1); }
+					written[siteId] = true;
+				}
+				uint8_t kind = KIND_EVENT;
+				uint32_t tid = ring.Tid();
+				fwrite(&kind, 1, 1, m_file);
+				fwrite(&tid, 4, 1, m_file);
+				fwrite(p, size, 1, m_file);
+			} else if(site) {
+				Emit(*site, ring.Tid(), ticks, p + 16, size - 16);
+			}
+			ring.Pop(size);
+			count++;
+		}
+		return count;
+	}
+
+	void Emit(const LogSite& site, uint32_t tid, uint64_t ticks, const uint8_t* args, size_t size) {
+		std::string text = BinlogFormat(site.format, site.types, args, size);
+		auto time = spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+			std::chrono::nanoseconds(m_calibration.ToWallNs(ticks))));
+		spdlog::details::log_msg msg(time, spdlog::source_loc{site.file, site.line, ""}, m_target->name(),
+									 site.level, text);
+		msg.thread_id = tid;
+		// 保留原线程号，只有 amot::Logger 能直接写 sink
+		if(auto* logger = dynamic_cast<Logger*>(m_target.get())) {
+			logger->Write(msg);
+		} else {
+			m_target->log(time, msg.source, site.level, text);
+		}
+	}
+
+	void FlushTarget() {
+		if(auto* logger = dynamic_cast<Logger*>(m_target.get())) {
+			logger->FlushSinks();
+		} else {
+			m_target->flush();
+		}
+	}
+
+	void WriteSite(const LogSite& site) {
+		uint8_t kind = KIND_SITE;
+		uint8_t level = static_cast<uint8_t>(site.level);
+		int32_t line = site.line;
+		uint16_t nargs = static_cast<uint16_t>(site.types.size());
+		uint32_t formatLen = static_cast<uint32_t>(strlen(site.format));
+		uint32_t fileLen = static_cast<uint32_t>(strlen(site.file));
+		fwrite(&kind, 1, 1, m_file);
+		fwrite(&site.id, 4, 1, m_file);
+		fwrite(&level, 1, 1, m_file);
+		fwrite(&line, 4, 1, m_file);
+		fwrite(&nargs, 2, 1, m_file);
+		fwrite(site.types.data(), 1, nargs, m_file);
+		fwrite(&formatLen, 4, 1, m_file);
+		fwrite(site.format, 1, formatLen, m_file);
+		fwrite(&fileLen, 4, 1, m_file);
+		fwrite(site.file, 1, fileLen, m_file);
+	}
+
+	void WriteClock() {
+		uint8_t kind = KIND_CLOCK;
+		uint64_t ticks = BinlogClock::Ticks();
+		int64_t wall = BinlogClock::WallNs();
+		fwrite(&kind, 1, 1, m_file);
+		fwrite(&ticks, 8, 1, m_file);
+		fwrite(&wall, 8, 1, m_file);
+	}
+
+	const BinaryLogOptions m_options;
+	const uint64_t m_id;
+	std::shared_ptr<spdlog::logger> m_target;
+	FILE* m_file = nullptr;
+	BinlogCalibration m_calibration;	// 后台线程私有
+
+	std::mutex m_ringsMutex;
+	std::vector<std::shared_ptr<Ring>> m_rings;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::condition_variable m_flushed;
+	uint64_t m_flushRequested = 0;
+	uint64_t m_flushDone = 0;
+	bool m_stop = false;
+
+	std::atomic<uint64_t> m_dropped{0};
+	std::thread m_thread;
+};
+
+/**
+ * @brief 离线解码 BinaryLog 写出的文件
+ */
+class BinlogReader {
+public:
+	struct Entry {
+		int64_t wallNs;
+		uint32_t tid;
+		spdlog::level::level_enum level;
+		std::string file;
+		int line;
+		std::string text;
+	};
+
+	explicit BinlogReader(const std::string& path) : m_file(fopen(path.c_str(), "rb")) {}
+
+	~BinlogReader() {
+		if(m_file) { fclose(m_file); }
+	}
+
+	bool IsOpen() const { return m_file != nullptr; }
+
+	/**
+	 * @brief 读下一条日志，文件结束或损坏时返回 false
+	 */
+	bool Next(Entry& entry) {
+		if(!m_file) { return false; }
+		uint8_t kind;
+		while(Read(&kind, 1)) {
+			if(kind == BinaryLog::KIND_CLOCK) {
+				uint64_t ticks;
+				int64_t wall;
+				if(!Read(&ticks, 8) || !Read(&wall, 8)) { return false; }
+				m_calibration.Sample(ticks, wall);
+			} else if(kind == BinaryLog::KIND_SITE) {
+				if(!ReadSite()) { return false; }
+			} else if(kind == BinaryLog::KIND_EVENT) {
+				return ReadEvent(entry);
+			} else {
+				return false;
+			}
+		}
+		return false;
+	}
+
+private:
+	struct Site {
+		bool defined = false;
+		spdlog::level::level_enum level;
+		int line;
+		std::vector<BinlogArg> types;
+		std::string format;
+		std::string file;
+	};
+
+	bool Read(void* out, size_t n) { return n == 0 || fread(out, 1, n, m_file) == n; }
+
+	bool ReadString(std::string& out) {
+		uint32_t n;
+		if(!Read(&n, 4)) { return false; }
+		out.resize(n);
+		return Read(out.data(), n);
+	}
+
+	bool ReadSite() {
+		uint32_t id;
+		uint8_t level;
+		int32_t line;
+		uint16_t nargs;
+		if(!Read(&id, 4) || !Read(&level, 1) || !Read(&line, 4) || !Read(&nargs, 2)) { return false; }
+		if(id >= m_sites.size()) { m_sites.resize(id + 1); }
+		Site& site = m_sites[id];
+		site.types.resize(nargs);
+		if(!Read(site.types.data(), nargs) || !ReadString(site.format) || !ReadString(site.file)) {
+			return false;
+		}
+		site.level = static_cast<spdlog::level::level_enum>(level);
+		site.line = line;
+		site.defined = true;
+		return true;
+	}
+
+	bool ReadEvent(Entry& entry) {
+		uint32_t tid, size, siteId;
+		uint64_t ticks;
+		if(!Read(&tid, 4) || !Read(&size, 4) || size < 16 || !Read(&siteId, 4) || !Read(&ticks, 8)) {
+			return false;
+		}
+		m_args.resize(size - 16);
+		if(!Read(m_args.data(), m_args.size())) { return false; }
+		entry.wallNs = m_calibration.ToWallNs(ticks);
+		entry.tid = tid;
+		if(siteId >= m_sites.size() || !m_sites[siteId].defined) {
+			entry.level = spdlog::level::info;
+			entry.file.clear();
+			entry.line = 0;
+			entry.text = "[binlog: unknown site " + std::to_string(siteId) + "]";
+			return true;
+		}
+		const Site& site = m_sites[siteId];
+		entry.level = site.level;
+		entry.file = site.file;
+		entry.line = site.line;
+		entry.text = BinlogFormat(site.format.c_str(), site.types, m_args.data(), m_args.size());
+		return true;
+	}
+
+	FILE* m_file;
+	std::vector<Site> m_sites;
+	std::vector<uint8_t> m_args;
+	BinlogCalibration m_calibration;
+};
+
+}  // namespace amot
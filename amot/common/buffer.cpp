@@ -0,0 +1,379 @@
+#include "buffer.h"
+
+#include <limits.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <utility>
+
+namespace amot {
+
+namespace {
+/* 线程本地缓存的容量，以及与全局空闲表交换的批量大小 */
+constexpr size_t kLocalCacheMax = 64;
+constexpr size_t kLocalCacheBatch = 32;
+/* 单次 readv 最多准备的新分片数(64KB) */
+constexpr size_t kReadSlices = 16;
+/* 单次 writev 的最大 iovec 数 */
+constexpr size_t kWriteIovMax = 64;
+}  // namespace
+
+struct BufferPoolLocalCache {
+    std::vector<char*> slices;
+
+    ~BufferPoolLocalCache() {
+        if(!slices.empty()) {
+            BufferPoolMgr::GetInstance()->ReleaseBatch_(slices, slices.size());
+        }
+    }
+};
+
+static BufferPoolLocalCache& LocalCache() {
+    static thread_local BufferPoolLocalCache cache;
+    return cache;
+}
+
+BufferPool::~BufferPool() {
+    for(char* slice : free_) {
+        free(slice);
+    }
+}
+
+char* BufferPool::Acquire() {
+    auto& cache = LocalCache().slices;
+    if(cache.empty()) {
+        AcquireBatch_(cache, kLocalCacheBatch);
+    }
+    char* slice = cache.back();
+    cache.pop_back();
+    return slice;
+}
+
+void BufferPool::Release(char* slice) {
+    assert(slice);
+    auto& cache = LocalCache().slices;
+    cache.push_back(slice);
+    if(cache.size() > kLocalCacheMax) {
+        ReleaseBatch_(cache, kLocalCacheBatch);
+    }
+}
+
+void BufferPool::AcquireBatch_(std::vector<char*>& out, size_t n) {
+    size_t got = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        got = std::min(n, free_.size());
+        out.insert(out.end(), free_.end() - got, free_.end());
+        free_.resize(free_.size() - got);
+        allocated_ += n - got;
+    }
+    for(; got < n; got++) {
+        out.push_back(static_cast<char*>(malloc(kSliceSize)));
+    }
+}
+
+void BufferPool::ReleaseBatch_(std::vector<char*>& in, size_t n) {
+    assert(n <= in.size());
+    std::vector<char*> drop;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for(size_t i = in.size() - n; i < in.size(); i++) {
+            if(free_.size() < maxFree_) {
+                free_.push_back(in[i]);
+            } else {
+                drop.push_back(in[i]);
+                allocated_--;
+            }
+        }
+    }
+    in.resize(in.size() - n);
+    for(char* slice : drop) {
+        free(slice);
+    }
+}
+
+size_t BufferPool::FreeCount() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return free_.size();
+}
+
+size_t BufferPool::AllocatedCount() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return allocated_;
+}
+
+void BufferPool::SetMaxFree(size_t maxFree) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    maxFree_ = maxFree;
+}
+
+BufferChain::Node BufferChain::NewPoolNode_() {
+    Node node;
+    node.base = BufferPoolMgr::GetInstance()->Acquire();
+    node.cap = BufferPool::kSliceSize;
+    node.kind = Kind::POOL;
+    return node;
+}
+
+void BufferChain::FreeNode_(Node& node) {
+    switch(node.kind) {
+    case Kind::POOL:
+        BufferPoolMgr::GetInstance()->Release(node.base);
+        break;
+    case Kind::HEAP:
+        free(node.base);
+        break;
+    case Kind::REF:
+        node.owner.reset();
+        break;
+    }
+    node.base = nullptr;
+}
+
+BufferChain::~BufferChain() {
+    RetrieveAll();
+}
+
+BufferChain::BufferChain(BufferChain&& other) noexcept
+    : nodes_(std::move(other.nodes_)), readable_(std::exchange(other.readable_, 0)) {
+    other.nodes_.clear();
+}
+
+BufferChain& BufferChain::operator=(BufferChain&& other) noexcept {
+    if(this != &other) {
+        RetrieveAll();
+        nodes_ = std::move(other.nodes_);
+        readable_ = std::exchange(other.readable_, 0);
+        other.nodes_.clear();
+    }
+    return *this;
+}
+
+void BufferChain::Append(const char* data, size_t len) {
+    readable_ += len;
+    while(len > 0) {
+        if(nodes_.empty() || nodes_.back().Writable() == 0) {
+            nodes_.push_back(NewPoolNode_());
+        }
+        Node& tail = nodes_.back();
+        size_t n = std::min(len, tail.Writable());
+        memcpy(tail.base + tail.wpos, data, n);
+        tail.wpos += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void BufferChain::Append(BufferChain&& other) {
+    if(&other == this || other.nodes_.empty()) { return; }
+    for(auto& node : other.nodes_) {
+        nodes_.push_back(std::move(node));
+    }
+    readable_ += other.readable_;
+    other.nodes_.clear();
+    other.readable_ = 0;
+}
+
+void BufferChain::AppendRef(const char* data, size_t len, std::shared_ptr<const void> owner) {
+    if(len == 0) { return; }
+    Node node;
+    node.base = const_cast<char*>(data);
+    node.cap = len;
+    node.wpos = len;
+    node.kind = Kind::REF;
+    node.owner = std::move(owner);
+    nodes_.push_back(std::move(node));
+    readable_ += len;
+}
+
+void BufferChain::Prepend(const char* data, size_t len) {
+    if(len == 0) { return; }
+    readable_ += len;
+    /* 头部分片前面还有已读空间时直接复用 */
+    if(!nodes_.empty() && nodes_.front().kind != Kind::REF && nodes_.front().rpos >= len) {
+        Node& head = nodes_.front();
+        head.rpos -= len;
+        memcpy(head.base + head.rpos, data, len);
+        return;
+    }
+    Node node;
+    if(len <= BufferPool::kSliceSize) {
+        node = NewPoolNode_();
+    } else {
+        node.base = static_cast<char*>(malloc(len));
+        node.cap = len;
+        node.kind = Kind::HEAP;
+    }
+    /* 数据放在分片尾部，给后续的前插留出空间 */
+    node.rpos = node.cap - len;
+    node.wpos = node.cap;
+    memcpy(node.base + node.rpos, data, len);
+    nodes_.push_front(std::move(node));
+}
+
+void BufferChain::Retrieve(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    while(len > 0) {
+        Node& head = nodes_.front();
+        size_t n = std::min(len, head.Readable());
+        head.rpos += n;
+        len -= n;
+        if(head.Readable() == 0 && (nodes_.size() > 1 || head.kind != Kind::POOL)) {
+            FreeNode_(head);
+            nodes_.pop_front();
+        }
+    }
+    /* 读空后归还最后一个分片，空闲连接不占内存 */
+    if(readable_ == 0 && !nodes_.empty()) {
+        RetrieveAll();
+    }
+}
+
+void BufferChain::RetrieveAll() {
+    for(auto& node : nodes_) {
+        FreeNode_(node);
+    }
+    nodes_.clear();
+    readable_ = 0;
+}
+
+std::string BufferChain::RetrieveAllToStr() {
+    std::string str;
+    str.reserve(readable_);
+    for(auto& node : nodes_) {
+        str.append(node.base + node.rpos, node.Readable());
+    }
+    RetrieveAll();
+    return str;
+}
+
+std::vector<std::string_view> BufferChain::Spans() const {
+    std::vector<std::string_view> spans;
+    spans.reserve(nodes_.size());
+    for(const auto& node : nodes_) {
+        if(node.Readable() > 0) {
+            spans.emplace_back(node.base + node.rpos, node.Readable());
+        }
+    }
+    return spans;
+}
+
+std::string_view BufferChain::Front() const {
+    for(const auto& node : nodes_) {
+        if(node.Readable() > 0) {
+            return std::string_view(node.base + node.rpos, node.Readable());
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view BufferChain::Contiguous(size_t len) {
+    len = std::min(len, readable_);
+    if(len == 0) { return std::string_view(); }
+    while(nodes_.front().Readable() == 0) {
+        FreeNode_(nodes_.front());
+        nodes_.pop_front();
+    }
+    if(nodes_.front().Readable() >= len) {
+        return std::string_view(nodes_.front().base + nodes_.front().rpos, len);
+    }
+    Node merged;
+    if(len <= BufferPool::kSliceSize) {
+        merged = NewPoolNode_();
+    } else {
+        merged.base = static_cast<char*>(malloc(len));
+        merged.cap = len;
+        merged.kind = Kind::HEAP;
+    }
+    size_t remain = len;
+    while(remain > 0) {
+        Node& head = nodes_.front();
+        size_t n = std::min(remain, head.Readable());
+        memcpy(merged.base + merged.wpos, head.base + head.rpos, n);
+        merged.wpos += n;
+        head.rpos += n;
+        remain -= n;
+        if(head.Readable() == 0) {
+            FreeNode_(head);
+            nodes_.pop_front();
+        }
+    }
+    nodes_.push_front(std::move(merged));
+    return std::string_view(nodes_.front().base, len);
+}
+
+ssize_t BufferChain::ReadFd(int fd, int* saveErrno) {
+    struct iovec iov[kReadSlices + 1];
+    char* slices[kReadSlices];
+    int iovCnt = 0;
+    bool useTail = !nodes_.empty() && nodes_.back().Writable() > 0;
+    if(useTail) {
+        Node& tail = nodes_.back();
+        iov[iovCnt].iov_base = tail.base + tail.wpos;
+        iov[iovCnt].iov_len = tail.Writable();
+        iovCnt++;
+    }
+    auto* pool = BufferPoolMgr::GetInstance();
+    for(size_t i = 0; i < kReadSlices; i++) {
+        slices[i] = pool->Acquire();
+        iov[iovCnt].iov_base = slices[i];
+        iov[iovCnt].iov_len = BufferPool::kSliceSize;
+        iovCnt++;
+    }
+    const ssize_t len = readv(fd, iov, iovCnt);
+    size_t remain = len > 0 ? len : 0;
+    if(len < 0) {
+        *saveErrno = errno;
+    }
+    readable_ += remain;
+    if(useTail) {
+        size_t n = std::min(remain, nodes_.back().Writable());
+        nodes_.back().wpos += n;
+        remain -= n;
+    }
+    size_t used = 0;
+    for(; used < kReadSlices && remain > 0; used++) {
+        Node node;
+        node.base = slices[used];
+        node.cap = BufferPool::kSliceSize;
+        node.wpos = std::min(remain, BufferPool::kSliceSize);
+        remain -= node.wpos;
+        nodes_.push_back(std::move(node));
+    }
+    /* 倒序归还，下次 Acquire 先拿到刚用过的热分片 */
+    for(size_t i = kReadSlices; i > used; i--) {
+        pool->Release(slices[i - 1]);
+    }
+    return len;
+}
+
+size_t BufferChain::PeekIov(struct iovec* iov, size_t max) const {
+    size_t iovCnt = 0;
+    for(const auto& node : nodes_) {
+        if(iovCnt == max) { break; }
+        if(node.Readable() == 0) { continue; }
+        iov[iovCnt].iov_base = node.base + node.rpos;
+        iov[iovCnt].iov_len = node.Readable();
+        iovCnt++;
+    }
+    return iovCnt;
+}
+
+ssize_t BufferChain::WriteFd(int fd, int* saveErrno) {
+    struct iovec iov[kWriteIovMax];
+    int iovCnt = static_cast<int>(PeekIov(iov, kWriteIovMax));
+    if(iovCnt == 0) { return 0; }
+    const ssize_t len = writev(fd, iov, iovCnt);
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
+
+}  // namespace amot
@@ -0,0 +1,183 @@
+/**
+ * @file buffer.h
+ * @brief 分片链式缓冲区，分片来自全局池，支持 readv/writev 与零拷贝前插
+ * @version 0.1
+ * @date 2024-03-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "singleton.h"
+
+namespace amot {
+
+/**
+ * @brief 固定大小分片的全局池
+ * @details 每个线程持有少量分片的本地缓存，批量与全局空闲表交换
+ */
+class BufferPool {
+public:
+    static constexpr size_t kSliceSize = 4096;
+
+    BufferPool() = default;
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    char* Acquire();
+
+    void Release(char* slice);
+
+    /**
+     * @brief 全局空闲表中的分片数(不含线程本地缓存)
+     */
+    size_t FreeCount() const;
+
+    /**
+     * @brief 当前从系统申请的分片总数
+     */
+    size_t AllocatedCount() const;
+
+    /**
+     * @brief 全局空闲表上限，超出的分片直接归还系统
+     */
+    void SetMaxFree(size_t maxFree);
+
+private:
+    friend struct BufferPoolLocalCache;
+
+    void AcquireBatch_(std::vector<char*>& out, size_t n);
+    void ReleaseBatch_(std::vector<char*>& in, size_t n);
+
+    std::vector<char*> free_;
+    size_t allocated_ = 0;
+    size_t maxFree_ = 16384;
+    mutable std::mutex mtx_;
+};
+
+using BufferPoolMgr = amot::Singleton<BufferPool>;
+
+/**
+ * @brief 链式缓冲区
+ * @details 数据保存在一串分片中：池分片、超大堆块，或外部持有的只读内存
+ *          (如 mmap 的文件)。扩容只追加分片，不做 realloc 与 memmove。
+ */
+class BufferChain {
+public:
+    BufferChain() = default;
+    ~BufferChain();
+
+    BufferChain(BufferChain&& other) noexcept;
+    BufferChain& operator=(BufferChain&& other) noexcept;
+
+    BufferChain(const BufferChain&) = delete;
+    BufferChain& operator=(const BufferChain&) = delete;
+
+    size_t ReadableBytes() const { return readable_; }
+
+    bool Empty() const { return readable_ == 0; }
+
+    /**
+     * @brief 追加数据(拷贝到分片中)
+     */
+    void Append(const char* data, size_t len);
+    void Append(std::string_view str) { Append(str.data(), str.size()); }
+
+    /**
+     * @brief 追加外部内存(不拷贝)，owner 保证其在发送完成前有效
+     */
+    void AppendRef(const char* data, size_t len, std::shared_ptr<const void> owner = nullptr);
+
+    /**
+     * @brief 把另一条链的分片整体接到尾部(不拷贝)，other 被清空
+     */
+    void Append(BufferChain&& other);
+
+    /**
+     * @brief 在头部插入数据，不移动已有数据
+     */
+    void Prepend(const char* data, size_t len);
+    void Prepend(std::string_view str) { Prepend(str.data(), str.size()); }
+
+    /**
+     * @brief 丢弃头部 len 字节，读空的分片立即归还池
+     */
+    void Retrieve(size_t len);
+
+    void RetrieveAll();
+
+    std::string RetrieveAllToStr();
+
+    /**
+     * @brief 可读数据按分片切成的视图，供解析器直接扫描
+     */
+    std::vector<std::string_view> Spans() const;
+
+    /**
+     * @brief 第一个非空分片的视图
+     */
+    std::string_view Front() const;
+
+    /**
+     * @brief 保证头部 len 字节在一块连续内存中并返回其视图
+     * @details 跨分片时合并到一个新块，只在少见的跨分片请求头上发生
+     */
+    std::string_view Contiguous(size_t len);
+
+    /**
+     * @brief 用可读分片填充 iovec，不消费数据
+     *
+     * @return size_t       填充的 iovec 个数
+     */
+    size_t PeekIov(struct iovec* iov, size_t max) const;
+
+    /**
+     * @brief 从 fd 读取，直接 readv 到空闲分片
+     */
+    ssize_t ReadFd(int fd, int* saveErrno);
+
+    /**
+     * @brief 写入 fd，直接 writev 整条链
+     */
+    ssize_t WriteFd(int fd, int* saveErrno);
+
+    /**
+     * @brief 当前持有的分片数，空闲连接应为 0
+     */
+    size_t SliceCount() const { return nodes_.size(); }
+
+private:
+    enum class Kind { POOL, HEAP, REF };
+
+    struct Node {
+        char* base = nullptr;
+        size_t cap = 0;
+        size_t rpos = 0;
+        size_t wpos = 0;
+        Kind kind = Kind::POOL;
+        std::shared_ptr<const void> owner;
+
+        size_t Readable() const { return wpos - rpos; }
+        size_t Writable() const { return kind == Kind::REF ? 0 : cap - wpos; }
+    };
+
+    static Node NewPoolNode_();
+    static void FreeNode_(Node& node);
+
+    std::deque<Node> nodes_;
+    size_t readable_ = 0;
+};
+
+}  // namespace amot
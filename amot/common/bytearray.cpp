@@ -0,0 +1,91 @@
+#include "bytearray.h"
+
+namespace amot {
+
+namespace {
+/* 64 位 varint 最多 10 字节，32 位最多 5 字节 */
+constexpr size_t kMaxVarint64 = 10;
+constexpr size_t kMaxVarint32 = 5;
+}  // namespace
+
+void ByteArray::WriteVarUint64(uint64_t value) {
+    char* p = Grow(kMaxVarint64);
+    size_t n = 0;
+    while(value >= 0x80) {
+        p[n++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    p[n++] = static_cast<char>(value);
+    wpos_ += n;
+}
+
+void ByteArray::WriteString(std::string_view str) {
+    WriteVarUint64(str.size());
+    WriteBytes(str.data(), str.size());
+}
+
+bool ByteArray::ReadVarUint64(uint64_t& out) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(Peek());
+    size_t avail = std::min(ReadableBytes(), kMaxVarint64);
+    uint64_t value = 0;
+    for(size_t i = 0; i < avail; i++) {
+        uint64_t byte = p[i];
+        /* 第 10 字节只能携带最高 1 位 */
+        if(i == kMaxVarint64 - 1 && byte > 1) { return false; }
+        value |= (byte & 0x7f) << (7 * i);
+        if(byte < 0x80) {
+            rpos_ += i + 1;
+            out = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ByteArray::ReadVarUint32(uint32_t& out) {
+    size_t pos = rpos_;
+    uint64_t value;
+    if(!ReadVarUint64(value)) { return false; }
+    if(value > UINT32_MAX || rpos_ - pos > kMaxVarint32) {
+        rpos_ = pos;
+        return false;
+    }
+    out = static_cast<uint32_t>(value);
+    return true;
+}
+
+bool ByteArray::ReadVarInt64(int64_t& out) {
+    uint64_t value;
+    if(!ReadVarUint64(value)) { return false; }
+    out = UnZigZag64(value);
+    return true;
+}
+
+bool ByteArray::ReadVarInt32(int32_t& out) {
+    uint32_t value;
+    if(!ReadVarUint32(value)) { return false; }
+    out = UnZigZag32(value);
+    return true;
+}
+
+bool ByteArray::ReadStringView(std::string_view& out) {
+    size_t pos = rpos_;
+    uint64_t len;
+    if(!ReadVarUint64(len)) { return false; }
+    if(ReadableBytes() < len) {
+        rpos_ = pos;
+        return false;
+    }
+    out = std::string_view(Peek(), len);
+    rpos_ += len;
+    return true;
+}
+
+bool ByteArray::ReadString(std::string& out) {
+    std::string_view view;
+    if(!ReadStringView(view)) { return false; }
+    out.assign(view);
+    return true;
+}
+
+}  // namespace amot
@@ -0,0 +1,221 @@
+/**
+ * @file bytearray.h
+ * @brief 二进制序列化缓冲：定长大小端整数/浮点、varint/zigzag 与字符串编码
+ * @version 0.1
+ * @date 2024-05-11
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "endian.h"
+
+namespace amot {
+
+/**
+ * @brief 连续内存的序列化缓冲，写入追加到末尾，读取从读位置向后
+ * @details 定长数值按指定字节序编码，数组借助 byteswapBytes 批量转换；
+ *          varint 为 LEB128，有符号数先做 zigzag；字符串为 varint 长度 + 内容。
+ *          读取失败(数据不足或编码非法)时返回 false，读位置不变。
+ */
+class ByteArray {
+public:
+    ByteArray() = default;
+
+    /**
+     * @brief 拷贝 data 作为待读取的内容
+     */
+    explicit ByteArray(std::string_view data) { WriteBytes(data.data(), data.size()); }
+
+    /* ---------------- 写 ---------------- */
+
+    template<class T>
+    void WriteBE(T value) { WriteFixed<T, AMOT_BIG_ENDIAN>(value); }
+
+    template<class T>
+    void WriteLE(T value) { WriteFixed<T, AMOT_LITTLE_ENDIAN>(value); }
+
+    template<class T>
+    void WriteArrayBE(std::span<const T> values) { WriteArray<T, AMOT_BIG_ENDIAN>(values); }
+
+    template<class T>
+    void WriteArrayLE(std::span<const T> values) { WriteArray<T, AMOT_LITTLE_ENDIAN>(values); }
+
+    void WriteVarUint32(uint32_t value) { WriteVarUint64(value); }
+    void WriteVarUint64(uint64_t value);
+
+    void WriteVarInt32(int32_t value) { WriteVarUint64(ZigZag32(value)); }
+    void WriteVarInt64(int64_t value) { WriteVarUint64(ZigZag64(value)); }
+
+    /**
+     * @brief varint 长度 + 内容
+     */
+    void WriteString(std::string_view str);
+
+    void WriteBytes(const void* data, size_t len) {
+        if(len == 0) { return; }
+        memcpy(Grow(len), data, len);
+        wpos_ += len;
+    }
+
+    /* ---------------- 读 ---------------- */
+
+    template<class T>
+    bool ReadBE(T& out) { return ReadFixed<T, AMOT_BIG_ENDIAN>(out); }
+
+    template<class T>
+    bool ReadLE(T& out) { return ReadFixed<T, AMOT_LITTLE_ENDIAN>(out); }
+
+    template<class T>
+    bool ReadArrayBE(std::span<T> out) { return ReadArray<T, AMOT_BIG_ENDIAN>(out); }
+
+    template<class T>
+    bool ReadArrayLE(std::span<T> out) { return ReadArray<T, AMOT_LITTLE_ENDIAN>(out); }
+
+    bool ReadVarUint32(uint32_t& out);
+    bool ReadVarUint64(uint64_t& out);
+
+    bool ReadVarInt32(int32_t& out);
+    bool ReadVarInt64(int64_t& out);
+
+    bool ReadString(std::string& out);
+
+    /**
+     * @brief 同 ReadString，但不拷贝，视图在下一次写入前有效
+     */
+    bool ReadStringView(std::string_view& out);
+
+    bool ReadBytes(void* out, size_t len) {
+        if(ReadableBytes() < len) { return false; }
+        if(len > 0) { memcpy(out, data_.data() + rpos_, len); }
+        rpos_ += len;
+        return true;
+    }
+
+    /* ---------------- 状态 ---------------- */
+
+    // 未读取的部分
+    const char* Peek() const { return data_.data() + rpos_; }
+    size_t ReadableBytes() const { return wpos_ - rpos_; }
+    std::string_view View() const { return std::string_view(Peek(), ReadableBytes()); }
+
+    size_t ReadPosition() const { return rpos_; }
+    // 把读位置退回到之前 ReadPosition() 的值，用于整体回滚，两者之间不能写入
+    void SetReadPosition(size_t pos) { rpos_ = pos <= wpos_ ? pos : wpos_; }
+
+    void Reserve(size_t len) {
+        if(data_.size() < wpos_ + len) { data_.resize(wpos_ + len); }
+    }
+
+    void Clear() { rpos_ = wpos_ = 0; }
+
+    static uint64_t ZigZag64(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    static uint32_t ZigZag32(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+    static int64_t UnZigZag64(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+    static int32_t UnZigZag32(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+private:
+    template<class T>
+    static constexpr void CheckType() {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "fixed-width encoding needs a number");
+        static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+    }
+
+    /* 按位拷贝后转换，浮点数也按位编码 */
+    template<class T, int Order>
+    static void Store(char* dst, T value) {
+        if constexpr(sizeof(T) > 1 && Order != AMOT_BYTE_ORDER) {
+            using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+            U bits;
+            memcpy(&bits, &value, sizeof(T));
+            bits = byteswap(bits);
+            memcpy(dst, &bits, sizeof(T));
+        } else {
+            memcpy(dst, &value, sizeof(T));
+        }
+    }
+
+    template<class T, int Order>
+    void WriteFixed(T value) {
+        CheckType<T>();
+        Store<T, Order>(Grow(sizeof(T)), value);
+        wpos_ += sizeof(T);
+    }
+
+    template<class T, int Order>
+    bool ReadFixed(T& out) {
+        CheckType<T>();
+        if(ReadableBytes() < sizeof(T)) { return false; }
+        /* 转换是对合的，读与写共用 */
+        T raw;
+        memcpy(&raw, Peek(), sizeof(T));
+        char bytes[sizeof(T)];
+        Store<T, Order>(bytes, raw);
+        memcpy(&out, bytes, sizeof(T));
+        rpos_ += sizeof(T);
+        return true;
+    }
+
+    template<class T, int Order>
+    void WriteArray(std::span<const T> values) {
+        CheckType<T>();
+        size_t len = values.size_bytes();
+        if(len == 0) { return; }
+        char* dst = Grow(len);
+        if constexpr(sizeof(T) > 1 && Order != AMOT_BYTE_ORDER) {
+            byteswapBytes(values.data(), dst, values.size(), sizeof(T));
+        } else {
+            memcpy(dst, values.data(), len);
+        }
+        wpos_ += len;
+    }
+
+    template<class T, int Order>
+    bool ReadArray(std::span<T> out) {
+        CheckType<T>();
+        size_t len = out.size_bytes();
+        if(ReadableBytes() < len) { return false; }
+        if(len == 0) { return true; }
+        if constexpr(sizeof(T) > 1 && Order != AMOT_BYTE_ORDER) {
+            byteswapBytes(Peek(), out.data(), out.size(), sizeof(T));
+        } else {
+            memcpy(out.data(), Peek(), len);
+        }
+        rpos_ += len;
+        return true;
+    }
+
+    /**
+     * @brief 保证写位置之后至少有 len 字节，返回写位置
+     */
+    char* Grow(size_t len) {
+        if(data_.size() - wpos_ < len) {
+            /* 已读部分较多时先前移，避免只增不减 */
+            if(rpos_ > 0 && rpos_ >= data_.size() / 2) {
+                memmove(data_.data(), data_.data() + rpos_, wpos_ - rpos_);
+                wpos_ -= rpos_;
+                rpos_ = 0;
+            }
+            if(data_.size() - wpos_ < len) {
+                data_.resize(std::max(data_.size() * 2, wpos_ + len));
+            }
+        }
+        return data_.data() + wpos_;
+    }
+
+    std::vector<char> data_;
+    size_t rpos_ = 0;
+    size_t wpos_ = 0;
+};
+
+}  // namespace amot
@@ -0,0 +1,155 @@
+/**
+ * @file clock.h
+ * @brief 计时用的时钟：单调时钟、粗粒度单调时钟、按事件循环缓存的 now 与校准后的 TSC 时钟
+ * @version 0.1
+ * @date 2024-05-15
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace amot {
+
+/*
+ * 定时器、超时与耗时统计一律使用单调时钟，不受墙上时间调整影响；
+ * 墙上时间(日志、HTTP Date 等)使用 GetCurrentMS 或 system_clock。
+ */
+
+inline uint64_t MonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+inline uint64_t MonotonicUs() { return MonotonicNs() / 1000; }
+
+inline uint64_t MonotonicMs() { return MonotonicNs() / 1000000; }
+
+/**
+ * @brief 粗粒度单调时钟，精度为一个时钟节拍(通常 1~4ms)，读取只需访问 vDSO 中的一个变量
+ */
+inline uint64_t CoarseMonotonicMs() {
+#ifdef CLOCK_MONOTONIC_COARSE
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#else
+    return MonotonicMs();
+#endif
+}
+
+/**
+ * @brief 按事件循环缓存的当前时间
+ * @details 事件循环每轮(通常在 epoll_wait 返回后)调用一次 Update，本轮内的定时器、
+ *          超时与时间戳都读缓存值，不再各自读时钟。缓存是线程本地的；从未调用过 Update
+ *          的线程读到的是实时的单调时间。缓存值在一轮内不变，需要测量本轮内耗时的
+ *          地方应直接用 MonotonicNs/MonotonicUs。
+ */
+class LoopClock {
+public:
+    /**
+     * @brief 刷新本线程的缓存，返回新的毫秒值
+     */
+    static uint64_t Update() {
+        Cached() = MonotonicNs();
+        return Cached() / 1000000;
+    }
+
+    static uint64_t NowNs() {
+        uint64_t ns = Cached();
+        return ns ? ns : MonotonicNs();
+    }
+
+    static uint64_t NowUs() { return NowNs() / 1000; }
+
+    static uint64_t NowMs() { return NowNs() / 1000000; }
+
+private:
+    static uint64_t& Cached() {
+        static thread_local uint64_t ns = 0;
+        return ns;
+    }
+};
+
+/**
+ * @brief 基于 TSC 的时钟，读数与 MonotonicNs 同一基准
+ * @details 只在 CPU 声明 invariant TSC(频率恒定、各核同步)时启用，否则 Available()
+ *          为 false，NowNs() 退回 MonotonicNs()。首次使用时用约 10ms 对照单调时钟校准，
+ *          之后读取只需一条 rdtsc 和一次乘法，适合热路径上的大量时间戳。
+ */
+class TscClock {
+public:
+    static bool Available() { return Get().available; }
+
+    static uint64_t Ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return MonotonicNs();
+#endif
+    }
+
+    static uint64_t NowNs() {
+        const Calibration& c = Get();
+        if(!c.available) { return MonotonicNs(); }
+        return c.baseNs + static_cast<uint64_t>(static_cast<double>(Ticks() - c.baseTicks) * c.nsPerTick);
+    }
+
+    // 每纳秒的 tick 数，即 TSC 频率(GHz)；不可用时为 0
+    static double TicksPerNs() {
+        const Calibration& c = Get();
+        return c.available ? 1.0 / c.nsPerTick : 0;
+    }
+
+private:
+    struct Calibration {
+        bool available = false;
+        uint64_t baseTicks = 0;
+        uint64_t baseNs = 0;
+        double nsPerTick = 1.0;
+    };
+
+    static bool Invariant() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned a, b, c, d;
+        if(!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007) { return false; }
+        __get_cpuid(0x80000007, &a, &b, &c, &d);
+        return d & (1u << 8);
+#else
+        return false;
+#endif
+    }
+
+    static Calibration Calibrate() {
+        Calibration c;
+        if(!Invariant()) { return c; }
+        uint64_t ns0 = MonotonicNs();
+        uint64_t t0 = Ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t ns1 = MonotonicNs();
+        uint64_t t1 = Ticks();
+        if(t1 <= t0 || ns1 <= ns0) { return c; }
+        c.nsPerTick = static_cast<double>(ns1 - ns0) / static_cast<double>(t1 - t0);
+        c.baseTicks = t1;
+        c.baseNs = ns1;
+        c.available = true;
+        return c;
+    }
+
+    static const Calibration& Get() {
+        static const Calibration calibration = Calibrate();
+        return calibration;
+    }
+};
+
+}  // namespace amot
@@ -0,0 +1,167 @@
+#include "endian.h"
+
+#include <atomic>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define AMOT_ENDIAN_X86 1
+#endif
+
+namespace amot {
+
+namespace {
+
+using SwapFn = void (*)(const uint8_t*, uint8_t*, size_t);
+
+template<size_t W>
+void SwapScalar(const uint8_t* src, uint8_t* dst, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if constexpr(W == 2) {
+            uint16_t v;
+            memcpy(&v, src + i * 2, 2);
+            v = bswap_16(v);
+            memcpy(dst + i * 2, &v, 2);
+        } else if constexpr(W == 4) {
+            uint32_t v;
+            memcpy(&v, src + i * 4, 4);
+            v = bswap_32(v);
+            memcpy(dst + i * 4, &v, 4);
+        } else {
+            uint64_t v;
+            memcpy(&v, src + i * 8, 8);
+            v = bswap_64(v);
+            memcpy(dst + i * 8, &v, 8);
+        }
+    }
+}
+
+#ifdef AMOT_ENDIAN_X86
+
+/* 16 字节内按元素宽度反转的 pshufb 掩码 */
+template<size_t W>
+struct ShuffleMask {
+    alignas(16) char bytes[16] = {};
+    constexpr ShuffleMask() {
+        for(size_t i = 0; i < 16; i++) { bytes[i] = static_cast<char>(i / W * W + (W - 1 - i % W)); }
+    }
+};
+template<size_t W>
+constexpr ShuffleMask<W> kMask;
+
+/* ---------------- SSSE3 实现 ---------------- */
+
+template<size_t W>
+__attribute__((target("ssse3")))
+void SwapSsse3(const uint8_t* src, uint8_t* dst, size_t count) {
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(kMask<W>.bytes));
+    size_t bytes = count * W;
+    size_t i = 0;
+    for(; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, mask));
+    }
+    SwapScalar<W>(src + i, dst + i, (bytes - i) / W);
+}
+
+/* ---------------- AVX2 实现 ---------------- */
+
+/* vpshufb 只在 128 位通道内重排，元素不跨通道，两个通道用同一掩码 */
+template<size_t W>
+__attribute__((target("avx2")))
+void SwapAvx2(const uint8_t* src, uint8_t* dst, size_t count) {
+    const __m256i mask = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(kMask<W>.bytes)));
+    size_t bytes = count * W;
+    size_t i = 0;
+    for(; i + 64 <= bytes; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_shuffle_epi8(b, mask));
+    }
+    if(i + 32 <= bytes) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, mask));
+        i += 32;
+    }
+    SwapSsse3<W>(src + i, dst + i, (bytes - i) / W);
+}
+
+#endif  // AMOT_ENDIAN_X86
+
+struct SwapOps {
+    SwapFn swap16;
+    SwapFn swap32;
+    SwapFn swap64;
+};
+
+const SwapOps kScalarOps = { SwapScalar<2>, SwapScalar<4>, SwapScalar<8> };
+#ifdef AMOT_ENDIAN_X86
+const SwapOps kSsse3Ops = { SwapSsse3<2>, SwapSsse3<4>, SwapSsse3<8> };
+const SwapOps kAvx2Ops = { SwapAvx2<2>, SwapAvx2<4>, SwapAvx2<8> };
+#endif
+
+ByteswapLevel SupportedLevel() {
+#ifdef AMOT_ENDIAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return ByteswapLevel::AVX2;
+    }
+    if(__builtin_cpu_supports("ssse3")) {
+        return ByteswapLevel::SSSE3;
+    }
+#endif
+    return ByteswapLevel::SCALAR;
+}
+
+const SwapOps* OpsOf(ByteswapLevel level) {
+    switch(level) {
+#ifdef AMOT_ENDIAN_X86
+    case ByteswapLevel::AVX2: return &kAvx2Ops;
+    case ByteswapLevel::SSSE3: return &kSsse3Ops;
+#endif
+    default: return &kScalarOps;
+    }
+}
+
+std::atomic<ByteswapLevel> g_level{SupportedLevel()};
+std::atomic<const SwapOps*> g_ops{OpsOf(g_level.load())};
+
+}  // namespace
+
+ByteswapLevel getByteswapLevel() {
+    return g_level.load(std::memory_order_relaxed);
+}
+
+ByteswapLevel setByteswapLevel(ByteswapLevel level) {
+    ByteswapLevel supported = SupportedLevel();
+    if(level > supported) { level = supported; }
+    g_level.store(level, std::memory_order_relaxed);
+    g_ops.store(OpsOf(level), std::memory_order_relaxed);
+    return level;
+}
+
+const char* byteswapLevelName(ByteswapLevel level) {
+    switch(level) {
+    case ByteswapLevel::AVX2: return "avx2";
+    case ByteswapLevel::SSSE3: return "ssse3";
+    default: return "scalar";
+    }
+}
+
+void byteswapBytes(const void* src, void* dst, size_t count, size_t width) {
+    const SwapOps* ops = g_ops.load(std::memory_order_relaxed);
+    auto in = static_cast<const uint8_t*>(src);
+    auto out = static_cast<uint8_t*>(dst);
+    switch(width) {
+    case 2: ops->swap16(in, out, count); break;
+    case 4: ops->swap32(in, out, count); break;
+    case 8: ops->swap64(in, out, count); break;
+    default:
+        if(in != out) { memcpy(out, in, count * width); }
+        break;
+    }
+}
+
+}  // namespace amot
@@ -4,7 +4,10 @@
 #define AMOT_BIG_ENDIAN 2
 
 #include <byteswap.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <span>
+#include <type_traits>
 
 namespace amot {
 /**
@@ -34,6 +37,50 @@ byteswap(T value) {
 	return (T)bswap_16((uint16_t)value);
 }
 
+/**
+ * @brief 批量字节序转换所用的指令集
+ */
+enum class ByteswapLevel {
+	SCALAR = 0,
+	SSSE3,
+	AVX2,
+};
+
+/**
+ * @brief 当前使用的指令集，默认按 CPU 能力选择最高的
+ */
+ByteswapLevel getByteswapLevel();
+
+/**
+ * @brief 指定指令集(用于测试与基准)，CPU 不支持时降级，返回实际生效的级别
+ */
+ByteswapLevel setByteswapLevel(ByteswapLevel level);
+
+const char* byteswapLevelName(ByteswapLevel level);
+
+/**
+ * @brief 批量转换 count 个宽度为 width(2/4/8)字节的元素，src 与 dst 可以相同，不能部分重叠
+ */
+void byteswapBytes(const void* src, void* dst, size_t count, size_t width);
+
+/**
+ * @brief 数组的字节序转化，就地进行，浮点数按位转换
+ */
+template<class T, size_t N>
+void byteswap(std::span<T, N> values) {
+	static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8));
+	byteswapBytes(values.data(), values.data(), values.size(), sizeof(T));
+}
+
+/**
+ * @brief 数组的字节序转化，结果写入 dst
+ */
+template<class T>
+void byteswap(const T* src, T* dst, size_t count) {
+	static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8));
+	byteswapBytes(src, dst, count, sizeof(T));
+}
+
 #if BYTE_ORDER == BIG_ENDIAN
 #define AMOT_BYTE_ORDER AMOT_BIG_ENDIAN
 #else
@@ -49,6 +96,9 @@ T byteswapOnLittleEndian(T t) {
 	return t;
 }
 
+template<class T, size_t N>
+void byteswapOnLittleEndian(std::span<T, N>) {}
+
 /**
  * @brief 只在大端机器上执行byteswap,在小端机器上什么都不做
  */
@@ -57,6 +107,11 @@ T byteswapOnBigEndian(T t) {
 	return byteswap(t);
 }
 
+template<class T, size_t N>
+void byteswapOnBigEndian(std::span<T, N> values) {
+	byteswap(values);
+}
+
 #else
 /**
  * @brief 只在小端机器上执行byteswap, 在大端机器上什么都不做
@@ -66,6 +121,11 @@ T byteswapOnLittleEndian(T t) {
 	return byteswap(t);
 }
 
+template<class T, size_t N>
+void byteswapOnLittleEndian(std::span<T, N> values) {
+	byteswap(values);
+}
+
 /**
  * @brief 只在大端机器上执行byteswap, 在小端机器上什么都不做
  */
@@ -73,5 +133,8 @@ template<class T>
 T byteswapOnBigEndian(T t) {
 	return t;
 }
+
+template<class T, size_t N>
+void byteswapOnBigEndian(std::span<T, N>) {}
 #endif
 }
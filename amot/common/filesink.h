@@ -0,0 +1,275 @@
+/**
+ * @file filesink.h
+ * @brief 批量写入、可轮转的文件 sink，磁盘 I/O 由独立线程完成
+ * @version 0.1
+ * @date 2024-05-09
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spdlog/details/os.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/rotating_file_sink.h>
+
+namespace amot {
+
+enum class FsyncPolicy {
+	NEVER,			// 交给操作系统回写
+	ON_FLUSH,		// 显式 flush、轮转和关闭时 fsync
+	EVERY_BATCH,	// 每批写入后 fsync
+};
+
+struct FileSinkOptions {
+	size_t bufferSize = 1 << 20;						// 单个缓冲的字节数，写满即交给 I/O 线程
+	size_t maxPendingBuffers = 4;						// 等待写盘的缓冲上限，超过时调用方等待
+	std::chrono::milliseconds flushInterval{200};		// 缓冲里的数据最长停留时间
+	FsyncPolicy fsync = FsyncPolicy::NEVER;
+	size_t maxFileSize = 0;								// 超过后轮转，0 表示不按大小轮转
+	std::chrono::seconds rotateInterval{0};				// 文件打开超过该时长后轮转，0 表示不按时间轮转
+	size_t maxFiles = 5;								// 保留的历史文件数，base.1.log ~ base.N.log
+};
+
+/**
+ * @brief 批量写入的文件 sink
+ * @details 调用方在 sink 锁内把消息格式化追加到内存缓冲，没有系统调用；
+ *          缓冲写满或 flushInterval 内没有写满过时整块交给 I/O 线程，由它 write、
+ *          按 FsyncPolicy fsync 并按大小或时间轮转，调用方只在积压的缓冲超过
+ *          maxPendingBuffers 时才等待。文件以追加方式打开，不会截断已有内容。
+ *          轮转时 base.log 依次改名为 base.1.log、base.2.log……
+ */
+class BatchFileSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+	explicit BatchFileSink(std::string path, const FileSinkOptions& options = FileSinkOptions())
+		: m_options(options), m_path(std::move(path)), m_active(NewBuffer()) {
+		auto dir = spdlog::details::os::dir_name(m_path);
+		if(!dir.empty()) { spdlog::details::os::create_dir(dir); }
+		if(!Open()) {
+			throw spdlog::spdlog_ex("Failed opening file " + m_path + " for writing", errno);
+		}
+		m_thread = std::thread([this]() { Run(); });
+	}
+
+	~BatchFileSink() override {
+		{
+			std::lock_guard<std::mutex> locker(mutex_);
+			Submit(false);
+		}
+		{
+			std::lock_guard<std::mutex> locker(m_ioMutex);
+			m_stop = true;
+		}
+		m_ioCond.notify_all();
+		m_thread.join();
+		Close();
+	}
+
+	const std::string& Path() const { return m_path; }
+
+	uint64_t BytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+
+	// 调用方因积压而等待的次数
+	uint64_t StallCount() const { return m_stalls.load(std::memory_order_relaxed); }
+
+	uint64_t RotationCount() const { return m_rotations.load(std::memory_order_relaxed); }
+
+	uint64_t ErrorCount() const { return m_errors.load(std::memory_order_relaxed); }
+
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override {
+		formatter_->format(msg, *m_active);
+		if(m_active->size() >= m_options.bufferSize) { Submit(false); }
+	}
+
+	// 等待此前的消息写入文件，按策略 fsync
+	void flush_() override {
+		uint64_t seq = Submit(m_options.fsync != FsyncPolicy::NEVER);
+		std::unique_lock<std::mutex> locker(m_ioMutex);
+		m_doneCond.wait(locker, [&]() { return m_written >= seq; });
+	}
+
+private:
+	using Buffer = spdlog::memory_buf_t;
+
+	struct Batch {
+		std::unique_ptr<Buffer> buffer;
+		uint64_t seq;
+		bool sync;
+	};
+
+	std::unique_ptr<Buffer> NewBuffer() {
+		auto buffer = std::make_unique<Buffer>();
+		buffer->reserve(m_options.bufferSize + 1024);
+		return buffer;
+	}
+
+	// 需持有 mutex_，把当前缓冲交给 I/O 线程，返回其序号
+	uint64_t Submit(bool sync) {
+		std::unique_lock<std::mutex> locker(m_ioMutex);
+		if(m_pending.size() >= m_options.maxPendingBuffers) {
+			m_stalls.fetch_add(1, std::memory_order_relaxed);
+			m_doneCond.wait(locker, [&]() { return m_pending.size() < m_options.maxPendingBuffers; });
+		}
+		std::unique_ptr<Buffer> next;
+		if(!m_spare.empty()) {
+			next = std::move(m_spare.back());
+			m_spare.pop_back();
+		}
+		locker.unlock();
+		if(!next) { next = NewBuffer(); }
+		std::swap(next, m_active);
+		locker.lock();
+		m_pending.push_back(Batch{std::move(next), ++m_submitted, sync});
+		uint64_t seq = m_submitted;
+		locker.unlock();
+		m_ioCond.notify_one();
+		return seq;
+	}
+
+	void Run() {
+		std::unique_lock<std::mutex> locker(m_ioMutex);
+		while(true) {
+			if(m_pending.empty()) {
+				if(m_stop) { break; }
+				if(m_ioCond.wait_for(locker, m_options.flushInterval) == std::cv_status::timeout &&
+				   m_pending.empty()) {
+					locker.unlock();
+					SubmitStale();
+					locker.lock();
+				}
+				continue;
+			}
+			Batch batch = std::move(m_pending.front());
+			m_pending.pop_front();
+			locker.unlock();
+
+			Write(*batch.buffer, batch.sync);
+			batch.buffer->clear();
+
+			locker.lock();
+			m_spare.push_back(std::move(batch.buffer));
+			m_written = batch.seq;
+			m_doneCond.notify_all();
+		}
+	}
+
+	// 一个周期内没有交来缓冲时把未写满的缓冲交出去；调用方正持有锁时下一轮再试，不与其互等
+	void SubmitStale() {
+		std::unique_lock<std::mutex> locker(mutex_, std::try_to_lock);
+		if(locker.owns_lock() && m_active->size() > 0) { Submit(false); }
+	}
+
+	void Write(const Buffer& buffer, bool sync) {
+		if(buffer.size() > 0 && ShouldRotate(buffer.size())) { Rotate(); }
+		const char* data = buffer.data();
+		size_t left = buffer.size();
+		while(left > 0 && m_fd >= 0) {
+			ssize_t n = ::write(m_fd, data, left);
+			if(n < 0) {
+				if(errno == EINTR) { continue; }
+				Error("write");
+				break;
+			}
+			data += n;
+			left -= n;
+		}
+		m_fileSize += buffer.size() - left;
+		m_bytesWritten.fetch_add(buffer.size() - left, std::memory_order_relaxed);
+		if(m_fd >= 0 && (sync || (m_options.fsync == FsyncPolicy::EVERY_BATCH && buffer.size() > 0))) {
+			if(::fsync(m_fd) != 0) { Error("fsync"); }
+		}
+	}
+
+	bool ShouldRotate(size_t incoming) const {
+		if(m_fileSize == 0) { return false; }
+		if(m_options.maxFileSize > 0 && m_fileSize + incoming > m_options.maxFileSize) { return true; }
+		return m_options.rotateInterval.count() > 0 &&
+			   std::chrono::steady_clock::now() - m_openedAt >= m_options.rotateInterval;
+	}
+
+	void Rotate() {
+		Close();
+		using Rotating = spdlog::sinks::rotating_file_sink_mt;
+		for(size_t i = m_options.maxFiles; i > 0; i--) {
+			std::string src = Rotating::calc_filename(m_path, i - 1);
+			if(!spdlog::details::os::path_exists(src)) { continue; }
+			std::string dst = Rotating::calc_filename(m_path, i);
+			if(i == m_options.maxFiles) {
+				std::remove(dst.c_str());
+			}
+			if(std::rename(src.c_str(), dst.c_str()) != 0) { Error("rename"); }
+		}
+		if(m_options.maxFiles == 0) { std::remove(m_path.c_str()); }
+		if(!Open()) { Error("open"); }
+		m_rotations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool Open() {
+		m_fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if(m_fd < 0) { return false; }
+		struct stat st;
+		m_fileSize = fstat(m_fd, &st) == 0 ? st.st_size : 0;
+		m_openedAt = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	void Close() {
+		if(m_fd < 0) { return; }
+		if(m_options.fsync != FsyncPolicy::NEVER) { ::fsync(m_fd); }
+		::close(m_fd);
+		m_fd = -1;
+	}
+
+	// I/O 线程中无法抛给调用方，与 spdlog 默认的错误处理一样打印到 stderr
+	void Error(const char* what) {
+		m_errors.fetch_add(1, std::memory_order_relaxed);
+		fprintf(stderr, "[*** LOG ERROR ***] BatchFileSink %s %s failed: %s\n", m_path.c_str(), what,
+				strerror(errno));
+	}
+
+	const FileSinkOptions m_options;
+	const std::string m_path;
+
+	// 由 mutex_ 保护
+	std::unique_ptr<Buffer> m_active;
+
+	// 由 m_ioMutex 保护
+	std::mutex m_ioMutex;
+	std::condition_variable m_ioCond;
+	std::condition_variable m_doneCond;
+	std::deque<Batch> m_pending;
+	std::vector<std::unique_ptr<Buffer>> m_spare;
+	uint64_t m_submitted = 0;
+	uint64_t m_written = 0;
+	bool m_stop = false;
+
+	// 只由 I/O 线程访问(构造与析构除外)
+	int m_fd = -1;
+	size_t m_fileSize = 0;
+	std::chrono::steady_clock::time_point m_openedAt;
+
+	std::atomic<uint64_t> m_bytesWritten{0};
+	std::atomic<uint64_t> m_stalls{0};
+	std::atomic<uint64_t> m_rotations{0};
+	std::atomic<uint64_t> m_errors{0};
+	std::thread m_thread;
+};
+
+}  // namespace amot
@@ -0,0 +1,161 @@
+/**
+ * @file histogram.h
+ * @brief HDR 风格的对数-线性直方图，无锁记录，用于延迟统计
+ * @version 0.1
+ * @date 2024-04-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace amot {
+
+/**
+ * @brief 对数-线性分桶直方图
+ * @details 每个 2 的幂区间划分为 2^(kSubBits-1) 个线性子桶，相对误差不超过
+ *          1/2^(kSubBits-1)。计数为原子变量，多个线程可并发 Record，
+ *          读取(百分位等)不阻塞写入。
+ */
+class Histogram {
+public:
+    static constexpr int kSubBits = 8;
+    static constexpr size_t kHalf = size_t(1) << (kSubBits - 1);
+    static constexpr size_t kBuckets = (64 - kSubBits + 2) * kHalf;
+
+    Histogram() : counts_(new std::atomic<uint64_t>[kBuckets]) { Reset(); }
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    static size_t IndexOf(uint64_t value) {
+        if(value < (uint64_t(1) << kSubBits)) { return value; }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - kSubBits + 1;
+        return shift * kHalf + (value >> shift);
+    }
+
+    /**
+     * @brief 桶的下界与上界(含)
+     */
+    static uint64_t LowerOf(size_t index) {
+        if(index < (size_t(1) << kSubBits)) { return index; }
+        size_t shift = index / kHalf - 1;
+        return uint64_t(index - shift * kHalf) << shift;
+    }
+
+    static uint64_t UpperOf(size_t index) {
+        if(index < (size_t(1) << kSubBits)) { return index; }
+        size_t shift = index / kHalf - 1;
+        return ((uint64_t(index - shift * kHalf) + 1) << shift) - 1;
+    }
+
+    void Record(uint64_t value, uint64_t count = 1) {
+        counts_[IndexOf(value)].fetch_add(count, std::memory_order_relaxed);
+        total_.fetch_add(count, std::memory_order_relaxed);
+        sum_.fetch_add(value * count, std::memory_order_relaxed);
+        uint64_t cur = max_.load(std::memory_order_relaxed);
+        while(value > cur && !max_.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+        cur = min_.load(std::memory_order_relaxed);
+        while(value < cur && !min_.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+    }
+
+    /**
+     * @brief 带协调遗漏(coordinated omission)修正的记录
+     * @details 当一次耗时 value 超过期望间隔 interval 时，被它阻塞而没能发出
+     *          的请求本应观察到 value - interval, value - 2*interval ... 的延迟，
+     *          一并补记。
+     */
+    void RecordCorrected(uint64_t value, uint64_t interval) {
+        Record(value);
+        if(interval == 0 || value <= interval) { return; }
+        for(uint64_t missing = value - interval; missing >= interval; missing -= interval) {
+            Record(missing);
+        }
+    }
+
+    void Merge(const Histogram& other) {
+        for(size_t i = 0; i < kBuckets; i++) {
+            uint64_t n = other.counts_[i].load(std::memory_order_relaxed);
+            if(n) { counts_[i].fetch_add(n, std::memory_order_relaxed); }
+        }
+        total_.fetch_add(other.Count(), std::memory_order_relaxed);
+        sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if(other.Count() > 0) {
+            uint64_t v = other.Max();
+            uint64_t cur = max_.load(std::memory_order_relaxed);
+            while(v > cur && !max_.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+            v = other.Min();
+            cur = min_.load(std::memory_order_relaxed);
+            while(v < cur && !min_.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+        }
+    }
+
+    void Reset() {
+        for(size_t i = 0; i < kBuckets; i++) {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        min_.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const { return total_.load(std::memory_order_relaxed); }
+
+    uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+    uint64_t Min() const {
+        return Count() ? min_.load(std::memory_order_relaxed) : 0;
+    }
+
+    double Mean() const {
+        uint64_t n = Count();
+        return n ? double(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 百分位数，p 取值 [0, 100]，返回所在桶的上界(不超过最大值)
+     */
+    uint64_t Percentile(double p) const {
+        uint64_t n = Count();
+        if(n == 0) { return 0; }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * n + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, n);
+        uint64_t seen = 0;
+        for(size_t i = 0; i < kBuckets; i++) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if(seen >= rank) {
+                return std::min(UpperOf(i), Max());
+            }
+        }
+        return Max();
+    }
+
+    /**
+     * @brief 遍历非空桶: fn(下界, 上界, 计数)
+     */
+    template<typename Fn>
+    void ForEach(Fn&& fn) const {
+        for(size_t i = 0; i < kBuckets; i++) {
+            uint64_t n = counts_[i].load(std::memory_order_relaxed);
+            if(n) { fn(LowerOf(i), UpperOf(i), n); }
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> min_;
+};
+
+}  // namespace amot
@@ -1,69 +1,444 @@
 /**
  * @file log.h
  * @author your name (you@domain.com)
- * @brief 
+ * @brief
  * @version 0.1
  * @date 2023-11-26
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
 #include <spdlog/spdlog.h>
+#include <spdlog/details/log_msg_buffer.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include "filesink.h"
+#include "mpmcqueue.h"
 #include "singleton.h"
 
+/**
+ * @brief 按调用点缓存日志器句柄，只有第一次执行时查表
+ * @details name 需为常量；LoggerManager 创建的日志器不会被替换，缓存始终有效
+ */
+#define AMOT_LOGGER(name) \
+	([]() -> const ::amot::LoggerManager::LogPtr & { \
+		static const ::amot::LoggerManager::LogPtr logger = ::amot::LoggerMgr::GetInstance()->GetLogger(name); \
+		return logger; \
+	}())
+
 namespace amot {
 
+// 异步模式下某个线程的缓冲已满时的处理方式
+enum class LogOverflow {
+	BLOCK,		// 等待后台线程腾出空间
+	DROP,		// 丢弃新消息
+	OVERRUN,	// 丢弃该线程缓冲中最旧的消息
+};
+
+struct AsyncLogOptions {
+	size_t queueSize = 2048;				// 每个线程的缓冲条数
+	LogOverflow overflow = LogOverflow::BLOCK;
+	size_t batchSize = 256;					// 后台线程每轮从每个缓冲最多取的条数
+	std::chrono::milliseconds flushInterval{100};	// sink 落盘的最长间隔
+};
+
+class AsyncLogBackend;
+
+/**
+ * @brief LoggerManager 创建的日志器
+ * @details 未开启异步时与 spdlog::logger 相同；开启后消息在调用线程格式化，
+ *          拷贝到该线程自己的无锁缓冲，由后台线程批量写 sink。
+ *          异步模式下销毁日志器之前需先 flush。
+ */
+class Logger : public spdlog::logger {
+public:
+	Logger(std::string name, spdlog::sink_ptr sink) : spdlog::logger(std::move(name), std::move(sink)) {}
+
+	/**
+	 * @brief 切换后台，只是一次原子写；旧后台须在不再有线程经它投递后才能销毁
+	 */
+	void SetBackend(AsyncLogBackend* backend) { m_backend.store(backend, std::memory_order_release); }
+
+	// 以下由后台线程调用，直接写 sink
+	void Write(const spdlog::details::log_msg& msg) {
+		for(auto& sink : sinks_) {
+			if(!sink->should_log(msg.level)) { continue; }
+			try {
+				sink->log(msg);
+			} catch(const std::exception& ex) {
+				err_handler_(ex.what());
+			} catch(...) {
+				err_handler_("Unknown exception in logger");
+			}
+		}
+	}
+
+	void FlushSinks() {
+		for(auto& sink : sinks_) {
+			try {
+				sink->flush();
+			} catch(const std::exception& ex) {
+				err_handler_(ex.what());
+			} catch(...) {
+				err_handler_("Unknown exception in logger");
+			}
+		}
+	}
+
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override;
+	void flush_() override;
+
+private:
+	std::atomic<AsyncLogBackend*> m_backend{nullptr};
+};
+
+/**
+ * @brief 异步日志后台
+ * @details 每个线程一条 MpmcQueue 作为缓冲，生产者只与后台线程共享这条队列，
+ *          互不竞争。后台线程轮流从各缓冲取一批消息写出，空闲时睡眠，
+ *          生产者只在它睡眠时才唤醒。sink 按 flushInterval、flush_on 级别或
+ *          显式 flush 落盘，其余时候由 sink 自己的缓冲合并写入。
+ */
+class AsyncLogBackend {
+public:
+	explicit AsyncLogBackend(const AsyncLogOptions& options)
+		: m_options(options), m_id(NextId()) {
+		m_thread = std::thread([this]() { Run(); });
+	}
+
+	// 写完所有已提交的消息后退出
+	~AsyncLogBackend() {
+		{
+			std::lock_guard<std::mutex> locker(m_wakeMutex);
+			m_stop.store(true, std::memory_order_seq_cst);
+		}
+		m_wakeCond.notify_one();
+		m_thread.join();
+	}
+
+	void Post(Logger* logger, const spdlog::details::log_msg& msg, bool flush) {
+		Ring& ring = Local();
+		Record record{logger, spdlog::details::log_msg_buffer(msg), flush};
+		if(!ring.queue.try_push(std::move(record))) {
+			switch(m_options.overflow) {
+			case LogOverflow::BLOCK:
+				Wake();
+				ring.queue.push(std::move(record));
+				break;
+			case LogOverflow::DROP:
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			case LogOverflow::OVERRUN:
+				do {
+					Record oldest;
+					if(ring.queue.try_pop(oldest)) {
+						m_dropped.fetch_add(1, std::memory_order_relaxed);
+					}
+				} while(!ring.queue.try_push(std::move(record)));
+				break;
+			}
+		}
+		Wake();
+	}
+
+	/**
+	 * @brief 等待调用前提交的消息全部写出并落盘
+	 */
+	void Flush() {
+		std::unique_lock<std::mutex> locker(m_flushMutex);
+		uint64_t ticket = m_flushRequested.fetch_add(1, std::memory_order_seq_cst) + 1;
+		{
+			std::lock_guard<std::mutex> wake(m_wakeMutex);
+			m_wakeCond.notify_one();
+		}
+		m_flushCond.wait(locker, [&]() { return m_flushDone >= ticket; });
+	}
+
+	// DROP/OVERRUN 策略下丢弃的消息数
+	uint64_t DroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	struct Record {
+		Logger* logger = nullptr;
+		spdlog::details::log_msg_buffer msg;
+		bool flush = false;
+	};
+
+	struct Ring {
+		explicit Ring(size_t capacity) : queue(capacity) {}
+		MpmcQueue<Record> queue;
+		std::atomic<bool> orphaned{false};	// 所属线程已退出
+	};
+
+	static uint64_t NextId() {
+		static std::atomic<uint64_t> id{0};
+		return ++id;
+	}
+
+	Ring& Local() {
+		struct Slot {
+			uint64_t owner = 0;
+			std::shared_ptr<Ring> ring;
+			~Slot() { if(ring) { ring->orphaned.store(true, std::memory_order_release); } }
+		};
+		thread_local Slot slot;
+		if(slot.owner != m_id) {
+			if(slot.ring) { slot.ring->orphaned.store(true, std::memory_order_release); }
+			slot.ring = std::make_shared<Ring>(m_options.queueSize);
+			slot.owner = m_id;
+			std::lock_guard<std::mutex> locker(m_ringsMutex);
+			m_rings.push_back(slot.ring);
+			m_ringsVersion.fetch_add(1, std::memory_order_release);
+		}
+		return *slot.ring;
+	}
+
+	void Wake() {
+		// 与 Run 中的 fence 配对：要么后台线程看到新消息，要么这里看到它在睡眠
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(m_sleeping.load(std::memory_order_relaxed)) {
+			std::lock_guard<std::mutex> locker(m_wakeMutex);
+			m_wakeCond.notify_one();
+		}
+	}
+
+	bool Pending(const std::vector<std::shared_ptr<Ring>>& rings) const {
+		for(auto& ring : rings) {
+			if(!ring->queue.empty()) { return true; }
+		}
+		return m_stop.load(std::memory_order_relaxed) ||
+			   m_flushRequested.load(std::memory_order_relaxed) > m_flushDone;
+	}
+
+	void Run() {
+		std::vector<std::shared_ptr<Ring>> rings;
+		uint64_t version = 0;
+		std::vector<Logger*> dirty;		// 写过但还没落盘，落盘后不再持有
+		auto lastFlush = std::chrono::steady_clock::now();
+		auto mark = [](std::vector<Logger*>& list, Logger* logger) {
+			for(auto* l : list) { if(l == logger) { return; } }
+			list.push_back(logger);
+		};
+
+		while(true) {
+			if(m_ringsVersion.load(std::memory_order_acquire) != version) {
+				std::lock_guard<std::mutex> locker(m_ringsMutex);
+				// 线程已退出且写空的缓冲不再需要
+				m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](auto& ring) {
+					return ring->orphaned.load(std::memory_order_acquire) && ring->queue.empty();
+				}), m_rings.end());
+				rings = m_rings;
+				version = m_ringsVersion.load(std::memory_order_relaxed);
+			}
+
+			// flush 请求需要写出请求之前的全部消息，不受 batchSize 限制
+			uint64_t requested = m_flushRequested.load(std::memory_order_seq_cst);
+			bool stopping = m_stop.load(std::memory_order_seq_cst);
+			bool full = requested > m_flushDone || stopping;
+			size_t written = 0;
+			Record record;
+			for(auto& ring : rings) {
+				size_t limit = full ? ring->queue.size() : m_options.batchSize;
+				for(size_t n = 0; n < limit && ring->queue.try_pop(record); n++, written++) {
+					record.logger->Write(record.msg);
+					mark(dirty, record.logger);
+					if(record.flush) { record.logger->FlushSinks(); }
+				}
+				if(ring->orphaned.load(std::memory_order_relaxed) && ring->queue.empty()) {
+					m_ringsVersion.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if(full || now - lastFlush >= m_options.flushInterval) {
+				for(auto* logger : dirty) { logger->FlushSinks(); }
+				dirty.clear();
+				lastFlush = now;
+			}
+			if(requested > m_flushDone) {
+				{
+					std::lock_guard<std::mutex> locker(m_flushMutex);
+					m_flushDone = requested;
+				}
+				m_flushCond.notify_all();
+			}
+			if(stopping) {
+				// 停止标志在写出之前读取，此后提交的消息也已在上面写出
+				bool empty = true;
+				for(auto& ring : rings) { empty = empty && ring->queue.empty(); }
+				if(empty && m_ringsVersion.load(std::memory_order_acquire) == version) { break; }
+				continue;
+			}
+			if(written > 0) { continue; }
+
+			std::unique_lock<std::mutex> locker(m_wakeMutex);
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!Pending(rings) && m_ringsVersion.load(std::memory_order_acquire) == version) {
+				auto timeout = dirty.empty() ? std::chrono::milliseconds(1000) : m_options.flushInterval;
+				m_wakeCond.wait_for(locker, timeout);
+			}
+			m_sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	const AsyncLogOptions m_options;
+	const uint64_t m_id;	// 区分先后创建的后台，线程缓存的缓冲按它失效
+
+	std::mutex m_ringsMutex;
+	std::vector<std::shared_ptr<Ring>> m_rings;
+	std::atomic<uint64_t> m_ringsVersion{0};
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCond;
+	std::atomic<bool> m_sleeping{false};
+	std::atomic<bool> m_stop{false};
+
+	std::mutex m_flushMutex;
+	std::condition_variable m_flushCond;
+	std::atomic<uint64_t> m_flushRequested{0};
+	uint64_t m_flushDone = 0;		// 由 m_flushMutex 保护写入
+
+	std::atomic<uint64_t> m_dropped{0};
+	std::thread m_thread;
+};
+
+inline void Logger::sink_it_(const spdlog::details::log_msg& msg) {
+	if(AsyncLogBackend* backend = m_backend.load(std::memory_order_acquire)) {
+		backend->Post(this, msg, should_flush_(msg));
+	} else {
+		spdlog::logger::sink_it_(msg);
+	}
+}
+
+inline void Logger::flush_() {
+	if(AsyncLogBackend* backend = m_backend.load(std::memory_order_acquire)) {
+		backend->Flush();
+	} else {
+		spdlog::logger::flush_();
+	}
+}
+
 class LoggerManager {
 public:
 	using LogPtr = std::shared_ptr<spdlog::logger>;
 	LoggerManager() {
-		m_root = spdlog::stdout_color_mt("root");
+		m_root = Create("root", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
 		m_root->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%^%l%$] [thread %t] : %v");
 		m_loggers["root"] = m_root;
 
 		Init();
 	}
 
+	~LoggerManager() {
+		// 先停止投递，再等后台写完。已读到后台指针的投递可能还没结束，
+		// 后台开启后不再销毁，投递路径因此只需一次原子读
+		for(auto& it : m_loggers) {
+			static_cast<Logger*>(it.second.get())->SetBackend(nullptr);
+		}
+		if(m_backend) {
+			m_backend->Flush();
+			m_backend.release();
+		}
+	}
+
 	LogPtr GetLogger(const std::string& name) {
-		std::lock_guard<std::mutex> locker(m_mutex);
+		{
+			std::shared_lock<std::shared_mutex> reader(m_mutex);
+			auto it = m_loggers.find(name);
+			if(it != m_loggers.end()) {
+				return it->second;
+			}
+		}
+
+		std::lock_guard<std::shared_mutex> locker(m_mutex);
 		auto it = m_loggers.find(name);
 		if(it != m_loggers.end()) {
 			return it->second;
 		}
 
-		LogPtr logger = spdlog::stdout_color_mt(name);
+		LogPtr logger = Create(name, std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
 		m_loggers[name] = logger;
 		return logger;
 	}
 
-	LogPtr GetFileLogger(const std::string& name, std::string path) {
-		std::lock_guard<std::mutex> locker(m_mutex);
+	/**
+	 * @brief 取得或创建写文件的日志器，文件以追加方式打开，批量写入并按 options 轮转
+	 * @details 同名日志器已存在时直接返回，path 与 options 不生效
+	 */
+	LogPtr GetFileLogger(const std::string& name, std::string path, const FileSinkOptions& options = {}) {
+		{
+			std::shared_lock<std::shared_mutex> reader(m_mutex);
+			auto it = m_loggers.find(name);
+			if(it != m_loggers.end()) {
+				return it->second;
+			}
+		}
+
+		std::lock_guard<std::shared_mutex> locker(m_mutex);
 		auto it = m_loggers.find(name);
 		if(it != m_loggers.end()) {
 			return it->second;
 		}
 
-		LogPtr logger = spdlog::basic_logger_mt(name, path, true);
+		LogPtr logger = Create(name, std::make_shared<BatchFileSink>(std::move(path), options));
 		logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%^%l%$] [thread %t] : %v");
 		m_loggers[name] = logger;
 		return logger;
 	}
 
+	/**
+	 * @brief 开启异步日志，已创建和之后创建的日志器都生效，已取得的句柄无需更换
+	 * @return 已开启过时返回 false，选项不变
+	 */
+	bool EnableAsync(const AsyncLogOptions& options = {}) {
+		std::lock_guard<std::shared_mutex> locker(m_mutex);
+		if(m_backend) { return false; }
+		m_backend = std::make_unique<AsyncLogBackend>(options);
+		for(auto& it : m_loggers) {
+			static_cast<Logger*>(it.second.get())->SetBackend(m_backend.get());
+		}
+		return true;
+	}
+
+	// 异步模式下丢弃的消息数
+	uint64_t DroppedCount() const {
+		return m_backend ? m_backend->DroppedCount() : 0;
+	}
+
 	void Init() {  }
 
 	LogPtr GetRoot() const { return m_root; }
 
 private:
+	LogPtr Create(const std::string& name, spdlog::sink_ptr sink) {
+		auto logger = std::make_shared<Logger>(name, std::move(sink));
+		logger->SetBackend(m_backend.get());
+		spdlog::initialize_logger(logger);
+		return logger;
+	}
+
 	std::map<std::string, LogPtr> m_loggers;
 	LogPtr m_root;
+	std::unique_ptr<AsyncLogBackend> m_backend;
 
-	std::mutex m_mutex;
+	std::shared_mutex m_mutex;
 };
 
 // 日志器管理类单例模式
 using LoggerMgr =  amot::Singleton<LoggerManager>;
-}
\ No newline at end of file
+}
@@ -0,0 +1,255 @@
+#include "metrics.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+namespace amot {
+
+namespace {
+
+[[maybe_unused]] bool ValidName(const std::string& name) {
+    if(name.empty() || (name[0] >= '0' && name[0] <= '9')) { return false; }
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == ':';
+    });
+}
+
+/* 整数按整数输出，其余保留足够的有效位 */
+void AppendValue(std::string& out, double value) {
+    if(isnan(value)) {
+        out += "NaN";
+        return;
+    }
+    if(isinf(value)) {
+        out += value > 0 ? "+Inf" : "-Inf";
+        return;
+    }
+    char text[32];
+    if(value == floor(value) && fabs(value) < 1e15) {
+        snprintf(text, sizeof(text), "%.0f", value);
+    } else {
+        snprintf(text, sizeof(text), "%.15g", value);
+    }
+    out += text;
+}
+
+void AppendEscaped(std::string& out, const std::string& text, bool quote) {
+    for(char c : text) {
+        if(c == '\\') {
+            out += "\\\\";
+        } else if(c == '\n') {
+            out += "\\n";
+        } else if(c == '"' && quote) {
+            out += "\\\"";
+        } else {
+            out += c;
+        }
+    }
+}
+
+/* {a="1",b="2"}，extra 为直方图的 le 标签 */
+void AppendLabels(std::string& out, const MetricLabels& labels, const char* extraValue = nullptr) {
+    if(labels.empty() && !extraValue) { return; }
+    out += '{';
+    bool first = true;
+    for(auto& [key, value] : labels) {
+        if(!first) { out += ','; }
+        first = false;
+        out += key;
+        out += "=\"";
+        AppendEscaped(out, value, true);
+        out += '"';
+    }
+    if(extraValue) {
+        if(!first) { out += ','; }
+        out += "le=\"";
+        out += extraValue;
+        out += '"';
+    }
+    out += '}';
+}
+
+const char* TypeName(MetricType type) {
+    switch(type) {
+    case MetricType::COUNTER: return "counter";
+    case MetricType::GAUGE: return "gauge";
+    case MetricType::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+}  // namespace
+
+size_t MetricShard() {
+    static std::atomic<size_t> next{0};
+    static thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % Counter::kShards;
+    return shard;
+}
+
+LatencyHistogram::LatencyHistogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+    for(double bound : bounds_) {
+        boundsNs_.push_back(bound <= 0 ? 0 : static_cast<uint64_t>(bound * 1e9 + 0.5));
+    }
+}
+
+std::vector<double> LatencyHistogram::DefaultBounds() {
+    return {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+void LatencyHistogram::Collect(std::vector<uint64_t>* buckets, uint64_t* count, double* sum) const {
+    buckets->assign(boundsNs_.size() + 1, 0);
+    /* HDR 桶按上界归入第一个不小于它的边界 */
+    hist_.ForEach([&](uint64_t, uint64_t upper, uint64_t n) {
+        size_t i = std::lower_bound(boundsNs_.begin(), boundsNs_.end(), upper) - boundsNs_.begin();
+        (*buckets)[i] += n;
+    });
+    uint64_t total = 0;
+    for(auto& n : *buckets) {
+        total += n;
+        n = total;
+    }
+    // 总数取桶的合计，与写入并发时也和桶保持一致
+    *count = total;
+    *sum = static_cast<double>(hist_.Sum()) / 1e9;
+}
+
+const MetricsSnapshot::Series* MetricsSnapshot::Find(const std::string& name, const MetricLabels& labels) const {
+    for(auto& family : families) {
+        if(family.name != name) { continue; }
+        for(auto& series : family.series) {
+            if(series.labels == labels) { return &series; }
+        }
+    }
+    return nullptr;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::GetEntry_(const std::string& name, const std::string& help, MetricType type,
+                                                   const MetricLabels& labels, const std::vector<double>* bounds) {
+    assert(ValidName(name));
+    auto it = families_.find(name);
+    if(it == families_.end()) {
+        Family family;
+        family.help = help;
+        family.type = type;
+        if(bounds) { family.bounds = *bounds; }
+        it = families_.emplace(name, std::move(family)).first;
+    }
+    // 同一名字只能是一种类型
+    assert(it->second.type == type);
+    return it->second.entries[labels];
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    Entry& entry = GetEntry_(name, help, MetricType::COUNTER, labels, nullptr);
+    if(!entry.counter) { entry.counter.reset(new Counter()); }
+    return *entry.counter;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    Entry& entry = GetEntry_(name, help, MetricType::GAUGE, labels, nullptr);
+    if(!entry.gauge && !entry.callback) { entry.gauge.reset(new Gauge()); }
+    assert(entry.gauge);
+    return *entry.gauge;
+}
+
+void MetricsRegistry::AddGaugeCallback(const std::string& name, const std::string& help, const MetricLabels& labels,
+                                       std::function<double()> fn) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    Entry& entry = GetEntry_(name, help, MetricType::GAUGE, labels, nullptr);
+    assert(!entry.gauge);
+    entry.callback = std::move(fn);
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(const std::string& name, const std::string& help,
+                                                const MetricLabels& labels, const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    Entry& entry = GetEntry_(name, help, MetricType::HISTOGRAM, labels, &bounds);
+    if(!entry.histogram) { entry.histogram.reset(new LatencyHistogram(families_[name].bounds)); }
+    return *entry.histogram;
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() const {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> locker(mutex_);
+    snapshot.families.reserve(families_.size());
+    for(auto& [name, family] : families_) {
+        MetricsSnapshot::Family out;
+        out.name = name;
+        out.help = family.help;
+        out.type = family.type;
+        out.series.reserve(family.entries.size());
+        for(auto& [labels, entry] : family.entries) {
+            MetricsSnapshot::Series series;
+            series.labels = labels;
+            if(entry.counter) {
+                series.value = static_cast<double>(entry.counter->Value());
+            } else if(entry.gauge) {
+                series.value = static_cast<double>(entry.gauge->Value());
+            } else if(entry.callback) {
+                series.value = entry.callback();
+            } else if(entry.histogram) {
+                entry.histogram->Collect(&series.buckets, &series.count, &series.sum);
+                out.bounds = entry.histogram->Bounds();
+            }
+            out.series.push_back(std::move(series));
+        }
+        snapshot.families.push_back(std::move(out));
+    }
+    return snapshot;
+}
+
+std::string MetricsRegistry::FormatPrometheus(const MetricsSnapshot& snapshot) {
+    std::string out;
+    for(auto& family : snapshot.families) {
+        out += "# HELP ";
+        out += family.name;
+        out += ' ';
+        AppendEscaped(out, family.help, false);
+        out += "\n# TYPE ";
+        out += family.name;
+        out += ' ';
+        out += TypeName(family.type);
+        out += '\n';
+        for(auto& series : family.series) {
+            if(family.type != MetricType::HISTOGRAM) {
+                out += family.name;
+                AppendLabels(out, series.labels);
+                out += ' ';
+                AppendValue(out, series.value);
+                out += '\n';
+                continue;
+            }
+            for(size_t i = 0; i < series.buckets.size(); i++) {
+                std::string le;
+                AppendValue(le, i < family.bounds.size() ? family.bounds[i] : INFINITY);
+                out += family.name;
+                out += "_bucket";
+                AppendLabels(out, series.labels, le.c_str());
+                out += ' ';
+                out += std::to_string(series.buckets[i]);
+                out += '\n';
+            }
+            out += family.name;
+            out += "_sum";
+            AppendLabels(out, series.labels);
+            out += ' ';
+            AppendValue(out, series.sum);
+            out += '\n';
+            out += family.name;
+            out += "_count";
+            AppendLabels(out, series.labels);
+            out += ' ';
+            out += std::to_string(series.count);
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+}  // namespace amot
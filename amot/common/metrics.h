@@ -0,0 +1,227 @@
+/**
+ * @file metrics.h
+ * @brief 指标：按线程分片的计数器/仪表、HDR 直方图与可导出 Prometheus 文本的注册表
+ * @version 0.1
+ * @date 2024-05-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "histogram.h"
+#include "singleton.h"
+
+namespace amot {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM,
+};
+
+/**
+ * @brief 当前线程使用的分片号
+ * @details 线程首次使用时按顺序分配，线程数不超过分片数时各线程独占一个分片
+ */
+size_t MetricShard();
+
+/**
+ * @brief 单调递增的计数器
+ * @details 每个分片独占一条缓存行，线程只写自己的分片，读取时求和；
+ *          线程多于分片数时共享分片，仍然正确，只是会有竞争。
+ */
+class Counter {
+public:
+    static constexpr size_t kShards = 16;
+
+    Counter() = default;
+
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void Inc(uint64_t n = 1) { shards_[MetricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t Value() const {
+        uint64_t sum = 0;
+        for(auto& shard : shards_) { sum += shard.value.load(std::memory_order_relaxed); }
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards_[kShards];
+};
+
+/**
+ * @brief 可增可减的仪表，分片方式同 Counter
+ * @details 只支持增减；需要设置绝对值的量(队列长度、内存占用等)用
+ *          MetricsRegistry::AddGaugeCallback 在快照时读取。
+ */
+class Gauge {
+public:
+    Gauge() = default;
+
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void Add(int64_t n) { shards_[MetricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+    void Inc() { Add(1); }
+    void Dec() { Add(-1); }
+
+    int64_t Value() const {
+        int64_t sum = 0;
+        for(auto& shard : shards_) { sum += shard.value.load(std::memory_order_relaxed); }
+        return sum;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+    Shard shards_[Counter::kShards];
+};
+
+/**
+ * @brief 延迟直方图，以纳秒记录，导出时换算为秒
+ * @details 记录直接写入 HDR 直方图，无锁；导出时按 bounds(秒)汇总为
+ *          Prometheus 的累计桶，桶边界处的误差不超过 HDR 的相对精度。
+ */
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(std::vector<double> bounds = DefaultBounds());
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t ns) { hist_.Record(ns); }
+
+    const Histogram& Hdr() const { return hist_; }
+
+    const std::vector<double>& Bounds() const { return bounds_; }
+
+    /**
+     * @brief 各桶的累计计数(与 Bounds 对应，最后一项为 +Inf)、总数与总和(秒)
+     */
+    void Collect(std::vector<uint64_t>* buckets, uint64_t* count, double* sum) const;
+
+    // 500us ~ 10s
+    static std::vector<double> DefaultBounds();
+
+private:
+    std::vector<double> bounds_;
+    std::vector<uint64_t> boundsNs_;
+    Histogram hist_;
+};
+
+/**
+ * @brief 某一时刻全部指标的取值
+ */
+struct MetricsSnapshot {
+    struct Series {
+        MetricLabels labels;
+        double value = 0;                   // 计数器与仪表
+        std::vector<uint64_t> buckets;      // 直方图的累计桶，最后一项为 +Inf
+        uint64_t count = 0;
+        double sum = 0;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        MetricType type = MetricType::COUNTER;
+        std::vector<double> bounds;         // 直方图的桶上界(不含 +Inf)
+        std::vector<Series> series;
+    };
+
+    std::vector<Family> families;
+
+    /**
+     * @brief 按名字与标签查找，找不到返回 nullptr
+     */
+    const Series* Find(const std::string& name, const MetricLabels& labels = {}) const;
+};
+
+/**
+ * @brief 指标注册表
+ * @details 同名指标构成一个族，族内按标签区分。Get* 在首次调用时创建，之后返回同一对象，
+ *          引用在注册表生命周期内有效；热路径上应保存引用，不要每次查找。
+ *          Snapshot 只在注册时与读取时持锁，读取各指标用 relaxed 原子读，不阻塞写入方。
+ *
+ *          auto& requests = MetricsMgr::GetInstance()->GetCounter("requests_total", "Requests.");
+ *          requests.Inc();
+ *          std::string text = MetricsMgr::GetInstance()->Prometheus();
+ */
+class MetricsRegistry {
+public:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& GetCounter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    Gauge& GetGauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    /**
+     * @brief 快照时调用 fn 取值的仪表，同名同标签重复添加时替换
+     * @details fn 在做快照的线程上、持注册表锁时调用，不能再访问注册表
+     */
+    void AddGaugeCallback(const std::string& name, const std::string& help, const MetricLabels& labels,
+                          std::function<double()> fn);
+
+    /**
+     * @brief 同一族内的桶边界以首次创建时为准
+     */
+    LatencyHistogram& GetHistogram(const std::string& name, const std::string& help,
+                                   const MetricLabels& labels = {},
+                                   const std::vector<double>& bounds = LatencyHistogram::DefaultBounds());
+
+    MetricsSnapshot Snapshot() const;
+
+    /**
+     * @brief Prometheus 文本格式(0.0.4)
+     */
+    std::string Prometheus() const { return FormatPrometheus(Snapshot()); }
+
+    static std::string FormatPrometheus(const MetricsSnapshot& snapshot);
+
+private:
+    struct Entry {
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::function<double()> callback;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    struct Family {
+        std::string help;
+        MetricType type;
+        std::vector<double> bounds;
+        std::map<MetricLabels, Entry> entries;
+    };
+
+    Entry& GetEntry_(const std::string& name, const std::string& help, MetricType type,
+                     const MetricLabels& labels, const std::vector<double>* bounds);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+using MetricsMgr = Singleton<MetricsRegistry>;
+
+}  // namespace amot
@@ -0,0 +1,197 @@
+/**
+ * @file mpmcqueue.h
+ * @brief 有界无锁多生产者多消费者队列
+ * @version 0.1
+ * @date 2024-04-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace amot {
+
+/**
+ * @brief 与 Queue 接口相同的无锁有界队列
+ * @details 采用 Vyukov 的按槽序号环形数组：每个槽带一个序号，生产者/消费者
+ *          通过 CAS 抢占下标后只写读自己的槽，不加锁。容量向上取整为 2 的幂。
+ *          push/pop 在满/空时先自旋让出，再用 atomic wait 睡眠，仅在有等待者时唤醒。
+ */
+template <typename T>
+requires std::is_move_assignable_v<T> class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity = 1024)
+        : _capacity(round_up(capacity)), _mask(_capacity - 1), _cells(new Cell[_capacity]) {
+        for (size_t i = 0; i < _capacity; i++)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue() {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        for (size_t pos = _head.load(std::memory_order_relaxed); pos != tail; pos++)
+            std::launder(reinterpret_cast<T *>(_cells[pos & _mask].storage))->~T();
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    // 队列满则阻塞，仅在 stop 之后返回 false
+    bool push(T &&item) {
+        return wait_until(_pops, _push_waiters, [&]() { return try_push(std::move(item)); });
+    }
+
+    // 非阻塞 push，队列满或已 stop 时返回 false，此时不移动 item
+    bool try_push(T &&item) {
+        if (_stop.load(std::memory_order_relaxed))
+            return false;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::move(item));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        signal(_pushes, _pop_waiters);
+        return true;
+    }
+
+    // 队列空则阻塞；stop 之后取完剩余元素再返回 false
+    bool pop(T &item) {
+        return wait_until(_pushes, _pop_waiters, [&]() { return try_pop(item); });
+    }
+
+    bool try_pop(T &item) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        T *slot = std::launder(reinterpret_cast<T *>(cell->storage));
+        item = std::move(*slot);
+        slot->~T();
+        cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+        signal(_pops, _push_waiters);
+        return true;
+    }
+
+    // 最多取出 max 个元素追加到 out(需支持 push_back)，不等待，返回取出个数
+    template <typename Container>
+    size_t drain_to(Container &out, size_t max) {
+        size_t n = 0;
+        T item;
+        while (n < max && try_pop(item)) {
+            out.push_back(std::move(item));
+            n++;
+        }
+        return n;
+    }
+
+    // 近似值
+    size_t size() const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return _capacity; }
+
+    void stop() {
+        _stop.store(true, std::memory_order_seq_cst);
+        _pushes.fetch_add(1, std::memory_order_seq_cst);
+        _pops.fetch_add(1, std::memory_order_seq_cst);
+        _pushes.notify_all();
+        _pops.notify_all();
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr int kSpinRounds = 64;
+
+    static size_t round_up(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        return cap;
+    }
+
+    // 对端每完成一次操作 epoch 加一；等待者先登记再读 epoch，
+    // 与 signal 中先改 epoch 再读等待数构成 Dekker 配对，不会丢唤醒
+    static void signal(std::atomic<uint32_t> &epoch, std::atomic<uint32_t> &waiters) {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst))
+            epoch.notify_all();
+    }
+
+    template <typename Try>
+    bool wait_until(std::atomic<uint32_t> &epoch, std::atomic<uint32_t> &waiters, Try &&attempt) {
+        for (int i = 0; i < kSpinRounds; i++) {
+            if (attempt())
+                return true;
+            if (_stop.load(std::memory_order_relaxed))
+                return attempt();
+            std::this_thread::yield();
+        }
+        for (;;) {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            uint32_t seen = epoch.load(std::memory_order_seq_cst);
+            if (attempt()) {
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (_stop.load(std::memory_order_seq_cst)) {
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+                return attempt();
+            }
+            epoch.wait(seen, std::memory_order_seq_cst);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<uint32_t> _pushes{0};
+    std::atomic<uint32_t> _pop_waiters{0};
+    alignas(64) std::atomic<uint32_t> _pops{0};
+    std::atomic<uint32_t> _push_waiters{0};
+    std::atomic<bool> _stop{false};
+};
+
+}  // namespace amot
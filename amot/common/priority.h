@@ -0,0 +1,150 @@
+/**
+ * @file priority.h
+ * @brief 任务优先级与多优先级队列(加权轮转 / 严格优先，带防饿死)
+ * @version 0.1
+ * @date 2024-04-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <utility>
+
+namespace amot {
+
+enum class Priority : uint8_t {
+    LATENCY = 0,  // 延迟敏感，如请求处理、协程恢复
+    NORMAL = 1,
+    BATCH = 2,    // 后台任务，如压缩、日志落盘
+};
+
+constexpr size_t kPriorityCount = 3;
+
+struct PriorityOptions {
+    // true: 总是先取最高优先级的非空队列；false: 按 weights 加权轮转
+    bool strict = false;
+    uint32_t weights[kPriorityCount] = {8, 4, 1};
+    // 低优先级队首等待超过该时长时优先取出，0 表示不做防饿死
+    std::chrono::milliseconds starvation{100};
+};
+
+/**
+ * @brief 按优先级分道的 FIFO，本身不加锁，由使用者保护
+ */
+template <typename T>
+class PriorityLanes {
+public:
+    explicit PriorityLanes(const PriorityOptions &options = {}) { setOptions(options); }
+
+    void setOptions(const PriorityOptions &options) {
+        _options = options;
+        for (size_t i = 0; i < kPriorityCount; i++) {
+            if (_options.weights[i] == 0)
+                _options.weights[i] = 1;
+            _credits[i] = _options.weights[i];
+        }
+    }
+
+    void push(T &&item, Priority priority = Priority::NORMAL) {
+        int64_t now = _options.starvation.count() > 0 ? nowMS() : 0;
+        _lanes[static_cast<size_t>(priority)].push_back(Entry{std::move(item), now});
+        _size++;
+    }
+
+    /**
+     * @param from 	非空时返回取出元素的优先级
+     */
+    bool pop(T &item, Priority *from = nullptr) {
+        size_t lane;
+        if (!pick(lane))
+            return false;
+        item = std::move(_lanes[lane].front().item);
+        _lanes[lane].pop_front();
+        _size--;
+        if (from)
+            *from = static_cast<Priority>(lane);
+        return true;
+    }
+
+    /**
+     * @brief 只从指定优先级取，不影响轮转
+     */
+    bool popFrom(T &item, Priority priority) {
+        auto &lane = _lanes[static_cast<size_t>(priority)];
+        if (lane.empty())
+            return false;
+        item = std::move(lane.front().item);
+        lane.pop_front();
+        _size--;
+        return true;
+    }
+
+    size_t size() const { return _size; }
+    size_t size(Priority priority) const { return _lanes[static_cast<size_t>(priority)].size(); }
+    bool empty() const { return _size == 0; }
+
+    void clear() {
+        for (auto &lane : _lanes)
+            lane.clear();
+        _size = 0;
+    }
+
+private:
+    struct Entry {
+        T item;
+        int64_t enqueueMS;
+    };
+
+    static int64_t nowMS() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    bool pick(size_t &lane) {
+        if (_size == 0)
+            return false;
+        // 防饿死：低优先级队首等待超时则先取，从最低优先级查起
+        if (_options.starvation.count() > 0 && _size > _lanes[0].size()) {
+            int64_t deadline = nowMS() - _options.starvation.count();
+            for (size_t i = kPriorityCount - 1; i > 0; i--) {
+                if (!_lanes[i].empty() && _lanes[i].front().enqueueMS <= deadline) {
+                    lane = i;
+                    return true;
+                }
+            }
+        }
+        if (_options.strict) {
+            for (size_t i = 0; i < kPriorityCount; i++) {
+                if (!_lanes[i].empty()) {
+                    lane = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+        // 加权轮转：当前队列额度用完或为空时换下一个，并补满额度
+        for (size_t tries = 0; tries <= 2 * kPriorityCount; tries++) {
+            if (!_lanes[_cursor].empty() && _credits[_cursor] > 0) {
+                _credits[_cursor]--;
+                lane = _cursor;
+                return true;
+            }
+            _credits[_cursor] = _options.weights[_cursor];
+            _cursor = (_cursor + 1) % kPriorityCount;
+        }
+        return false;
+    }
+
+    PriorityOptions _options;
+    std::deque<Entry> _lanes[kPriorityCount];
+    uint32_t _credits[kPriorityCount] = {};
+    size_t _cursor = 0;
+    size_t _size = 0;
+};
+
+}  // namespace amot
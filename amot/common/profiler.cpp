@@ -0,0 +1,305 @@
+#include "profiler.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "util.h"
+
+namespace amot {
+
+namespace {
+/* 正在采样的分析器，信号处理函数据此找到采样环 */
+std::atomic<Profiler*> g_active{nullptr};
+/* 正在执行的信号处理函数数，Stop 等它归零后才能回收 */
+std::atomic<int> g_inHandler{0};
+/* 首次 Start 之前的 SIGPROF 处理方式 */
+struct sigaction g_oldAction;
+
+/* 内核对线程 CPU 时钟的编码，同 pthread_getcpuclockid */
+clockid_t ThreadCpuClock(long tid) {
+    return static_cast<clockid_t>((~static_cast<unsigned>(tid) << 3) | 6);
+}
+}  // namespace
+
+struct Profiler::Slot {
+    std::atomic<uint64_t> seq;
+    long tid;
+    int depth;
+    void* pcs[kMaxDepth];
+};
+
+Profiler::Profiler() = default;
+
+Profiler::~Profiler() {
+    Stop();
+}
+
+bool Profiler::Start(const ProfilerOptions& options) {
+    Profiler* expected = nullptr;
+    if(Running() || !g_active.compare_exchange_strong(expected, this)) { return false; }
+    // 上一次运行的信号处理函数可能还引用着旧的采样环
+    while(g_inHandler.load(std::memory_order_acquire) > 0) { std::this_thread::yield(); }
+
+    options_ = options;
+    options_.maxDepth = std::clamp(options_.maxDepth, 1, kMaxDepth);
+    options_.frequency = std::max(options_.frequency, 1);
+    size_t capacity = 2;
+    while(capacity < options_.bufferSize) { capacity <<= 1; }
+    slots_.reset(new Slot[capacity]);
+    for(size_t i = 0; i < capacity; i++) { slots_[i].seq.store(i, std::memory_order_relaxed); }
+    mask_ = capacity - 1;
+    writePos_.store(0, std::memory_order_relaxed);
+    readPos_ = 0;
+    selfTid_ = 0;
+
+    // backtrace 首次调用会加载 libgcc，不能发生在信号处理函数里
+    void* warmup[1];
+    ::backtrace(warmup, 1);
+
+    struct sigaction action = {};
+    action.sa_sigaction = &Profiler::OnSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    static std::once_flag saved;
+    std::call_once(saved, [&]() { sigaction(SIGPROF, &action, &g_oldAction); });
+    sigaction(SIGPROF, &action, nullptr);
+
+    running_.store(true, std::memory_order_release);
+    ScanThreads();
+    thread_ = std::thread([this]() { Run(); });
+    return true;
+}
+
+void Profiler::Stop() {
+    {
+        std::lock_guard<std::mutex> locker(runMutex_);
+        if(!running_.load(std::memory_order_relaxed)) { return; }
+        running_.store(false, std::memory_order_release);
+    }
+    runCond_.notify_all();
+    thread_.join();
+
+    DisarmAll();
+    // 已经发出还未处理的 SIGPROF 交给原来的处理方式，默认动作是终止进程，改为忽略
+    if(g_oldAction.sa_handler == SIG_DFL && !(g_oldAction.sa_flags & SA_SIGINFO)) {
+        signal(SIGPROF, SIG_IGN);
+    } else {
+        sigaction(SIGPROF, &g_oldAction, nullptr);
+    }
+    g_active.store(nullptr, std::memory_order_release);
+    while(g_inHandler.load(std::memory_order_acquire) > 0) { std::this_thread::yield(); }
+    Drain();
+}
+
+void Profiler::Reset() {
+    std::lock_guard<std::mutex> locker(dataMutex_);
+    stacks_.clear();
+    samples_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+}
+
+std::string Profiler::Folded() const {
+    std::vector<std::pair<std::string, uint64_t>> stacks;
+    {
+        std::lock_guard<std::mutex> locker(dataMutex_);
+        stacks.assign(stacks_.begin(), stacks_.end());
+    }
+    std::sort(stacks.begin(), stacks.end());
+    std::string out;
+    for(auto& [stack, count] : stacks) {
+        out += stack;
+        out += ' ';
+        out += std::to_string(count);
+        out += '\n';
+    }
+    return out;
+}
+
+bool Profiler::DumpFolded(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if(!out) { return false; }
+    out << Folded();
+    return static_cast<bool>(out);
+}
+
+void Profiler::OnSignal(int, siginfo_t*, void* context) {
+    int savedErrno = errno;
+    g_inHandler.fetch_add(1, std::memory_order_acquire);
+    if(Profiler* profiler = g_active.load(std::memory_order_acquire)) {
+        if(profiler->running_.load(std::memory_order_acquire)) { profiler->Capture(context); }
+    }
+    g_inHandler.fetch_sub(1, std::memory_order_release);
+    errno = savedErrno;
+}
+
+/* 信号处理函数中执行：只用原子操作和 backtrace，不分配内存 */
+void Profiler::Capture(void* context) {
+    uint64_t pos = writePos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while(true) {
+        slot = &slots_[pos & mask_];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        if(seq == pos) {
+            if(writePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if(seq < pos) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = writePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    int depth = ::backtrace(slot->pcs, options_.maxDepth);
+    // 去掉信号处理相关的帧，从被中断的指令开始
+    int skip = std::min(depth, 2);
+#if defined(__x86_64__)
+    void* interrupted = reinterpret_cast<void*>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+    for(int i = 0; i < depth; i++) {
+        if(slot->pcs[i] == interrupted) {
+            skip = i;
+            break;
+        }
+    }
+#else
+    (void)context;
+#endif
+    std::copy(slot->pcs + skip, slot->pcs + depth, slot->pcs);
+    slot->depth = depth - skip;
+    slot->tid = syscall(SYS_gettid);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+void Profiler::Run() {
+    selfTid_ = GetThreadId();
+    auto lastScan = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> locker(runMutex_);
+    while(running_.load(std::memory_order_relaxed)) {
+        runCond_.wait_for(locker, std::chrono::milliseconds(100));
+        locker.unlock();
+        Drain();
+        auto now = std::chrono::steady_clock::now();
+        if(running_.load(std::memory_order_relaxed) && now - lastScan >= options_.scanInterval) {
+            ScanThreads();
+            lastScan = now;
+        }
+        locker.lock();
+    }
+}
+
+void Profiler::Drain() {
+    std::unordered_map<std::string, uint64_t> batch;
+    std::string key;
+    while(true) {
+        Slot& slot = slots_[readPos_ & mask_];
+        if(slot.seq.load(std::memory_order_acquire) != readPos_ + 1) { break; }
+        key.clear();
+        if(options_.perThread) {
+            key = ThreadName(slot.tid);
+        }
+        for(int i = slot.depth - 1; i >= 0; i--) {
+            auto it = symbols_.find(slot.pcs[i]);
+            if(it == symbols_.end()) {
+                std::string name = SymbolizeAddress(slot.pcs[i]);
+                // 折叠栈以 ';' 分帧、以最后一个空格分隔次数
+                std::replace(name.begin(), name.end(), ';', ':');
+                std::replace(name.begin(), name.end(), ' ', '_');
+                it = symbols_.emplace(slot.pcs[i], std::move(name)).first;
+            }
+            if(!key.empty()) { key += ';'; }
+            key += it->second;
+        }
+        if(key.empty()) { key = "[unknown]"; }
+        batch[key]++;
+        slot.seq.store(readPos_ + mask_ + 1, std::memory_order_release);
+        readPos_++;
+    }
+    if(batch.empty()) { return; }
+    std::lock_guard<std::mutex> locker(dataMutex_);
+    uint64_t total = 0;
+    for(auto& [stack, count] : batch) {
+        stacks_[stack] += count;
+        total += count;
+    }
+    samples_.fetch_add(total, std::memory_order_relaxed);
+}
+
+void Profiler::ScanThreads() {
+    std::vector<long> alive;
+    if(DIR* dir = opendir("/proc/self/task")) {
+        while(struct dirent* entry = readdir(dir)) {
+            if(entry->d_name[0] == '.') { continue; }
+            alive.push_back(strtol(entry->d_name, nullptr, 10));
+        }
+        closedir(dir);
+    }
+    std::sort(alive.begin(), alive.end());
+    // 已退出线程的定时器
+    for(auto it = timers_.begin(); it != timers_.end();) {
+        if(std::binary_search(alive.begin(), alive.end(), it->first)) {
+            ++it;
+            continue;
+        }
+        timer_delete(static_cast<timer_t>(it->second));
+        threadNames_.erase(it->first);
+        it = timers_.erase(it);
+    }
+    for(long tid : alive) {
+        // 不采样后台线程自己
+        if(tid != selfTid_ && timers_.count(tid) == 0) { ArmTimer(tid); }
+    }
+}
+
+void Profiler::ArmTimer(long tid) {
+    struct sigevent event = {};
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event._sigev_un._tid = static_cast<pid_t>(tid);
+    timer_t timer;
+    // 线程可能刚好退出，创建失败时忽略
+    if(timer_create(ThreadCpuClock(tid), &event, &timer) != 0) { return; }
+    long intervalNs = 1000000000L / options_.frequency;
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = intervalNs / 1000000000L;
+    spec.it_interval.tv_nsec = intervalNs % 1000000000L;
+    spec.it_value = spec.it_interval;
+    if(timer_settime(timer, 0, &spec, nullptr) != 0) {
+        timer_delete(timer);
+        return;
+    }
+    timers_[tid] = timer;
+}
+
+void Profiler::DisarmAll() {
+    for(auto& [tid, timer] : timers_) {
+        timer_delete(static_cast<timer_t>(timer));
+    }
+    timers_.clear();
+    threadNames_.clear();
+}
+
+std::string Profiler::ThreadName(long tid) {
+    auto it = threadNames_.find(tid);
+    if(it != threadNames_.end()) { return it->second; }
+    std::string name;
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::getline(comm, name);
+    if(name.empty()) { name = "thread"; }
+    name += '-';
+    name += std::to_string(tid);
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return threadNames_[tid] = name;
+}
+
+}  // namespace amot
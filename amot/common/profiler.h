@@ -0,0 +1,128 @@
+/**
+ * @file profiler.h
+ * @brief 进程内采样 CPU 分析器，按线程 CPU 时间定时采集调用栈，输出火焰图所用的折叠栈
+ * @version 0.1
+ * @date 2024-05-13
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <signal.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "singleton.h"
+
+namespace amot {
+
+struct ProfilerOptions {
+    int frequency = 99;                             // 每个线程每秒 CPU 时间的采样次数
+    size_t bufferSize = 4096;                       // 采样环的槽数，满时丢弃新采样
+    int maxDepth = 64;                              // 单个调用栈最多的帧数，不超过 kMaxDepth
+    bool perThread = false;                         // 以线程名作为折叠栈的根
+    std::chrono::milliseconds scanInterval{1000};   // 重新扫描线程、为新线程设定时器的间隔
+};
+
+/**
+ * @brief 采样 CPU 分析器
+ * @details 为进程内每个线程创建一个按该线程 CPU 时间计时的 timer_create 定时器，到期时向
+ *          该线程发送 SIGPROF。信号处理函数只把调用栈写入预先分配的无锁环，不分配内存、
+ *          不加锁；后台线程取出采样、解析符号并按调用栈计数。之后启动的线程在下一次扫描时
+ *          加入。同一时刻进程内只能有一个分析器在运行。
+ *
+ *          ProfilerMgr::GetInstance()->Start();
+ *          ...
+ *          ProfilerMgr::GetInstance()->Stop();
+ *          ProfilerMgr::GetInstance()->DumpFolded("cpu.folded");  // flamegraph.pl cpu.folded
+ */
+class Profiler {
+public:
+    static constexpr int kMaxDepth = 128;
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /**
+     * @brief 开始采样，已在运行或有其他分析器在运行时返回 false
+     * @details 之前的统计结果保留，与本次累加，需要时先 Reset
+     */
+    bool Start(const ProfilerOptions& options = {});
+
+    /**
+     * @brief 停止采样，返回时已取出全部采样
+     */
+    void Stop();
+
+    bool Running() const { return running_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 清空统计结果
+     */
+    void Reset();
+
+    /**
+     * @brief 折叠栈文本，每行为 "外层;...;内层 次数"
+     */
+    std::string Folded() const;
+
+    bool DumpFolded(const std::string& path) const;
+
+    // 已统计的采样数
+    uint64_t SampleCount() const { return samples_.load(std::memory_order_relaxed); }
+
+    // 采样环已满而丢弃的采样数
+    uint64_t DroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot;
+
+    static void OnSignal(int sig, siginfo_t* info, void* context);
+
+    void Capture(void* context);
+    void Run();
+    void Drain();
+    void ScanThreads();
+    void ArmTimer(long tid);
+    void DisarmAll();
+    std::string ThreadName(long tid);
+
+    ProfilerOptions options_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::mutex runMutex_;
+    std::condition_variable runCond_;
+
+    /* 采样环，信号处理函数为生产者，后台线程为消费者 */
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> writePos_{0};
+    uint64_t readPos_ = 0;
+
+    std::map<long, void*> timers_;                  // tid -> timer_t，只由控制线程与后台线程先后访问
+    long selfTid_ = 0;
+    std::unordered_map<void*, std::string> symbols_;
+    std::unordered_map<long, std::string> threadNames_;
+
+    mutable std::mutex dataMutex_;
+    std::unordered_map<std::string, uint64_t> stacks_;
+
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+using ProfilerMgr = Singleton<Profiler>;
+
+}  // namespace amot
@@ -7,23 +7,37 @@
 
 namespace amot {
 
+/**
+ * @brief 加锁的 MPMC 队列
+ * @details capacity 为 0 时无界；有界时满则 push 阻塞、try_push 失败，形成背压。
+ *          无锁版本见 MpmcQueue，接口相同。
+ */
 template <typename T>
 requires std::is_move_assignable_v<T> class Queue {
 public:
-    void push(T &&item) {
+    explicit Queue(size_t capacity = 0) : _capacity(capacity) {}
+
+    // 有界时队列满则阻塞，仅在 stop 之后返回 false
+    bool push(T &&item) {
         {
-            std::scoped_lock guard(_mutex);
+            std::unique_lock lock(_mutex);
+            if (_capacity)
+                _notFull.wait(lock, [&]() { return _queue.size() < _capacity || _stop; });
+            if (_stop)
+                return false;
             _queue.push(std::move(item));
         }
         _cond.notify_one();
+        return true;
     }
 
-    bool try_push(const T &item) {
+    // 非阻塞 push，锁被占用或队列满时返回 false，此时不移动 item
+    bool try_push(T &&item) {
         {
             std::unique_lock lock(_mutex, std::try_to_lock);
-            if (!lock)
+            if (!lock || _stop || (_capacity && _queue.size() >= _capacity))
                 return false;
-            _queue.push(item);
+            _queue.push(std::move(item));
         }
         _cond.notify_one();
         return true;
@@ -36,6 +50,8 @@ public:
             return false;
         item = std::move(_queue.front());
         _queue.pop();
+        lock.unlock();
+        notify_not_full(1);
         return true;
     }
 
@@ -46,6 +62,8 @@ public:
 
         item = std::move(_queue.front());
         _queue.pop();
+        lock.unlock();
+        notify_not_full(1);
         return true;
     }
 
@@ -62,9 +80,26 @@ public:
 
         item = std::move(_queue.front());
         _queue.pop();
+        lock.unlock();
+        notify_not_full(1);
         return true;
     }
 
+    // 一次加锁最多取出 max 个元素追加到 out(需支持 push_back)，不等待，返回取出个数
+    template <typename Container>
+    size_t drain_to(Container &out, size_t max) {
+        size_t n = 0;
+        {
+            std::scoped_lock guard(_mutex);
+            for (; n < max && !_queue.empty(); ++n) {
+                out.push_back(std::move(_queue.front()));
+                _queue.pop();
+            }
+        }
+        notify_not_full(n);
+        return n;
+    }
+
     std::size_t size() const {
         std::scoped_lock guard(_mutex);
         return _queue.size();
@@ -75,18 +110,32 @@ public:
         return _queue.empty();
     }
 
+    size_t capacity() const { return _capacity; }
+
     void stop() {
         {
             std::scoped_lock guard(_mutex);
             _stop = true;
         }
         _cond.notify_all();
+        _notFull.notify_all();
     }
 
 private:
+    void notify_not_full(size_t n) {
+        if (!_capacity || n == 0)
+            return;
+        if (n == 1)
+            _notFull.notify_one();
+        else
+            _notFull.notify_all();
+    }
+
     std::queue<T> _queue;
+    const size_t _capacity;
     bool _stop = false;
     mutable std::mutex _mutex;
     std::condition_variable _cond;
+    std::condition_variable _notFull;
 };
 }  // namespace amot
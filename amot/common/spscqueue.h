@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace amot {
+
+/**
+ * @brief 有界单生产者单消费者环形队列，无锁
+ * @details 生产者与消费者各自缓存对方的下标，只有缓存显示满/空时才读取
+ *          对方的原子变量，减少缓存行往返。容量向上取整为 2 的幂。
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity = 1024)
+        : _capacity(round_up(capacity)),
+          _mask(_capacity - 1),
+          _slots(new T[_capacity]) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    /**
+     * @brief 仅生产者线程调用，队列满时返回 false 且不移动 item
+     */
+    bool try_push(T &&item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache >= _capacity) {
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache >= _capacity)
+                return false;
+        }
+        _slots[tail & _mask] = std::move(item);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 仅消费者线程调用
+     */
+    bool try_pop(T &item) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache)
+                return false;
+        }
+        item = std::move(_slots[head & _mask]);
+        _slots[head & _mask] = T();
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 任意线程可调用，结果只是瞬时近似
+     */
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) ==
+               _tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) -
+               _head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return _capacity; }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t cap = 2;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<T[]> _slots;
+
+    alignas(kCacheLine) std::atomic<size_t> _head{0};   // 消费者写
+    size_t _tail_cache = 0;                              // 消费者私有
+    alignas(kCacheLine) std::atomic<size_t> _tail{0};   // 生产者写
+    size_t _head_cache = 0;                              // 生产者私有
+};
+
+}  // namespace amot
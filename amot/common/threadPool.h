@@ -1,26 +1,43 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
-#include "queue.h"
+#include "priority.h"
+#include "topology.h"
+#include "workstealdeque.h"
+#include "workerstats.h"
 
 namespace amot {
 class ThreadPool {
 public:
     struct WorkItem {
-        // Whether or not do work steal for fn.
-        // If the user don't assign a thread to fn,
-        // thread pool will apply random policy to fn.
-        // If enable canSteal,
-        // thread pool will apply work steal policy firstly , if failed, will
-        // apply random policy to fn.
+        // Whether or not fn may run on a worker other than the one it was
+        // queued on. Items scheduled with an explicit id are never stolen.
+        // Items without an id go to the submitting worker's own deque (or to
+        // the global injection queue when submitted from outside the pool)
+        // and can be stolen by idle workers if work steal is enabled.
         bool canSteal = false;
         std::function<void()> fn = nullptr;
+        // Only NORMAL items use the local deque. LATENCY and BATCH items go
+        // through the shared lanes, where LATENCY ones are taken before any
+        // local work.
+        Priority priority = Priority::NORMAL;
+        // steady clock ns when queued, 0 unless Options::recordTimings.
+        int64_t enqueueNs = 0;
     };
 
     enum ERROR_TYPE {
@@ -29,122 +46,615 @@ public:
         ERROR_POOL_ITEM_IS_NULL,
     };
 
+    struct Options {
+        // Core workers, always running. Explicit ids in scheduleById address
+        // these workers only.
+        size_t threadNum = std::thread::hardware_concurrency();
+        // Elastic mode when greater than threadNum: extra workers are spawned
+        // while a backlog lasts and retire after idleTimeout.
+        size_t maxThreadNum = 0;
+        bool enableWorkSteal = false;
+        PlacementPolicy placement = PlacementPolicy::NONE;
+        int32_t node = -1;
+        std::chrono::milliseconds idleTimeout{10000};
+        // A backlog of at least backlogThreshold queued items must last this
+        // long before another worker is spawned.
+        std::chrono::microseconds growDelay{1000};
+        size_t backlogThreshold = 64;
+        // An idle worker polls spinRounds times with a cpu pause, then
+        // yieldRounds times with sched_yield, then parks. More rounds lower
+        // the wake-up latency at the cost of cpu time.
+        uint32_t spinRounds = 16;
+        uint32_t yieldRounds = 2;
+        // Dispatch between priority lanes of the shared queues.
+        PriorityOptions lanes;
+        // Measure busy/idle time and record queue wait and run time
+        // histograms. Costs two clock reads per task.
+        bool recordTimings = false;
+    };
+
+    explicit ThreadPool(const Options &options);
+
+    // enableCoreBindings keeps the original behaviour: worker i is pinned to
+    // the i-th available cpu (PlacementPolicy::LINEAR).
     explicit ThreadPool(size_t threadNum = std::thread::hardware_concurrency(),
                         bool enableWorkSteal = false,
                         bool enableCoreBindings = false);
+    // Place workers by topology. If node >= 0, only cpus of that NUMA node are
+    // used, which is how per-node pools are built.
+    ThreadPool(size_t threadNum, bool enableWorkSteal, PlacementPolicy policy,
+               int32_t node = -1);
     ~ThreadPool();
 
+    // One pool per NUMA node, each with threadsPerNode workers placed by
+    // policy inside its node.
+    static std::vector<std::unique_ptr<ThreadPool>> createPerNode(
+        size_t threadsPerNode, bool enableWorkSteal = true,
+        PlacementPolicy policy = PlacementPolicy::COMPACT);
+
     ThreadPool::ERROR_TYPE scheduleById(std::function<void()> fn,
-                                        int32_t id = -1);
+                                        int32_t id = -1,
+                                        Priority priority = Priority::NORMAL);
+
+    // Run fn on the pool and get its result through a future. If the pool
+    // has stopped, the future throws std::future_error (broken_promise).
+    // Coroutines should use co_await offload(pool, fn) from reactor.h instead
+    // of blocking on the future.
+    template <typename Fn, typename R = std::invoke_result_t<std::decay_t<Fn>>>
+    std::future<R> submit(Fn &&fn, int32_t id = -1,
+                          Priority priority = Priority::NORMAL);
+
+    // Enqueue every callable in fns with one lock on the target queue and at
+    // most one wakeup per parked worker.
+    template <typename Range>
+    ThreadPool::ERROR_TYPE submitBulk(Range &&fns,
+                                      Priority priority = Priority::NORMAL);
+
+    // Call fn(i) for every i in [begin, end) and wait for all of them. Chunks
+    // are claimed dynamically, starting at remaining / (2 * threads) and
+    // shrinking down to grain, so uneven work still balances. The calling
+    // thread takes part, so it is safe to call from inside a worker. The
+    // first exception thrown by fn is rethrown here.
+    template <typename Index, typename Fn>
+    void parallelFor(Index begin, Index end, Index grain, Fn &&fn);
+
     int32_t getCurrentId() const;
     size_t getItemCount() const;
+    // Number of core workers.
     int32_t getThreadNum() const { return _threadNum; }
+    // Upper bound of workers, equal to getThreadNum() unless elastic.
+    int32_t getMaxThreadNum() const { return _slotNum; }
+    // Workers currently running, core and extra.
+    int32_t getActiveThreadNum() const {
+        return _active.load(std::memory_order_relaxed);
+    }
+
+    // Cpus worker id is bound to, empty if it is not bound.
+    const std::vector<uint32_t> &getWorkerCpus(int32_t id) const {
+        return _workerCpus.at(id);
+    }
+    // NUMA node of worker id, -1 if it is not bound.
+    int32_t getWorkerNode(int32_t id) const { return _workerNodes.at(id); }
+    // Order in which worker id looks for work: itself first, then workers on
+    // the same LLC, the same node, and finally remote nodes.
+    const std::vector<int32_t> &getStealOrder(int32_t id) const {
+        return _stealOrder.at(id);
+    }
+
+    // Counters summed over all worker slots. Workers keep writing while this
+    // reads, so the fields are not a consistent cut but each is exact.
+    ExecutorStats getStats() const;
+    const WorkerStats &getWorkerStats(int32_t id) const {
+        return _workers.at(id)->stats;
+    }
+    // Merge the per-worker histograms (ns) into out. Empty unless
+    // Options::recordTimings is set.
+    void mergeWaitTime(Histogram &out) const;
+    void mergeRunTime(Histogram &out) const;
+
+    // Allocation hook for worker-owned data: the memory prefers the NUMA node
+    // of worker id. Release it with deallocateLocal.
+    void *allocateLocal(int32_t id, size_t bytes) const {
+        return Topology::allocOnNode(bytes, getWorkerNode(id));
+    }
+    static void deallocateLocal(void *p, size_t bytes) {
+        Topology::freeOnNode(p, bytes);
+    }
 
 private:
+    // Mutex-protected priority lanes used for the global injection queue and
+    // for the items pinned to one worker. Sizes are mirrored in atomics so
+    // that idle workers can check them without taking the lock.
+    class LockedQueue {
+    public:
+        void setOptions(const PriorityOptions &options) {
+            std::scoped_lock guard(_mutex);
+            _lanes.setOptions(options);
+        }
+
+        void push(WorkItem *item) {
+            std::scoped_lock guard(_mutex);
+            pushLocked(item);
+        }
+
+        void pushBulk(const std::vector<WorkItem *> &items) {
+            std::scoped_lock guard(_mutex);
+            for (auto *item : items)
+                pushLocked(item);
+        }
+
+        WorkItem *pop() {
+            if (_size.load(std::memory_order_relaxed) == 0)
+                return nullptr;
+            std::scoped_lock guard(_mutex);
+            return popLocked();
+        }
+
+        // Pop up to max items: the first one is chosen by the lane policy.
+        // If it is NORMAL, more NORMAL items are moved to deque so that one
+        // lock trip feeds several tasks.
+        WorkItem *popBatch(WorkStealDeque<WorkItem *> &deque, size_t max) {
+            if (_size.load(std::memory_order_relaxed) == 0)
+                return nullptr;
+            std::scoped_lock guard(_mutex);
+            WorkItem *first = popLocked();
+            if (!first || first->priority != Priority::NORMAL)
+                return first;
+            WorkItem *item = nullptr;
+            size_t n = 1;
+            for (; n < max && _lanes.popFrom(item, Priority::NORMAL); ++n)
+                deque.push(item);
+            _size.fetch_sub(n - 1, std::memory_order_relaxed);
+            return first;
+        }
+
+        size_t size() const { return _size.load(std::memory_order_seq_cst); }
+        size_t latencySize() const {
+            return _latency.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void pushLocked(WorkItem *item) {
+            Priority priority = item->priority;
+            _lanes.push(std::move(item), priority);
+            if (priority == Priority::LATENCY)
+                _latency.fetch_add(1, std::memory_order_relaxed);
+            _size.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        WorkItem *popLocked() {
+            WorkItem *item = nullptr;
+            Priority from;
+            if (!_lanes.pop(item, &from))
+                return nullptr;
+            if (from == Priority::LATENCY)
+                _latency.fetch_sub(1, std::memory_order_relaxed);
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return item;
+        }
+
+        std::mutex _mutex;
+        PriorityLanes<WorkItem *> _lanes;
+        std::atomic<size_t> _size{0};
+        std::atomic<size_t> _latency{0};
+    };
+
+    struct Worker {
+        explicit Worker(bool timings) : stats(timings) {}
+
+        WorkStealDeque<WorkItem *> deque;  // owner LIFO, thieves FIFO
+        LockedQueue inbox;                 // items scheduled with this id
+        std::condition_variable cond;
+        bool notified = false;  // guarded by _parkMutex
+        uint32_t tick = 0;      // owner only
+        std::atomic<bool> alive{false};
+        WorkerStats stats;  // written by the owner only
+    };
+
+    static Options makeOptions(size_t threadNum, bool enableWorkSteal,
+                               PlacementPolicy policy, int32_t node);
+    static void cpuRelax();
+    int64_t stamp() const {
+        return _options.recordTimings ? WorkerStats::nowNs() : 0;
+    }
+
     std::pair<size_t, ThreadPool *> *getCurrent() const;
+    void start(const Topology &topology);
+    void spawn(int32_t id);
+    void run(int32_t id);
+    WorkItem *findWork(int32_t id);
+    bool hasWork(int32_t id) const;
+    bool park(int32_t id);
+    void wakeOne();
+    void wake(int32_t id);
+    void wakeMany(size_t n);
+    void maybeGrow();
+
+    Options _options;
     int32_t _threadNum;
+    int32_t _slotNum;
+    std::atomic<int32_t> _active{0};
+    std::mutex _growMutex;
+    std::atomic<int64_t> _backlogSince{0};  // steady clock ns, 0 if no backlog
 
-    std::vector<Queue<WorkItem>> _queues;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    LockedQueue _injector;  // items submitted from outside the pool
     std::vector<std::thread> _threads;
+    std::vector<std::vector<uint32_t>> _workerCpus;
+    std::vector<int32_t> _workerNodes;
+    std::vector<std::vector<int32_t>> _stealOrder;
+
+    static constexpr size_t kInjectBatch = 32;
+
+    std::atomic<int32_t> _searching{0};
+    std::mutex _parkMutex;
+    std::vector<int32_t> _parked;  // guarded by _parkMutex
+    std::atomic<int32_t> _parkedCount{0};
 
     std::atomic<bool> _stop;
     bool _enableWorkSteal;
-    bool _enableCoreBindings;
 };
 
-#ifdef __linux__
-static void getCurrentCpus(std::vector<uint32_t> &ids) {
-    cpu_set_t set;
-    ids.clear();
-    if (sched_getaffinity(0, sizeof(set), &set) == 0)
-        for (uint32_t i = 0; i < CPU_SETSIZE; i++)
-            if (CPU_ISSET(i, &set))
-                ids.emplace_back(i);
+inline ThreadPool::ThreadPool(const Options &options)
+    : _options(options),
+      _threadNum(options.threadNum ? options.threadNum
+                                    : std::thread::hardware_concurrency()),
+      _slotNum(std::max<int32_t>(_threadNum, options.maxThreadNum)),
+      _stop(false),
+      _enableWorkSteal(options.enableWorkSteal) {
+    if (options.node >= 0)
+        start(Topology::get().onNode(options.node));
+    else
+        start(Topology::get());
 }
-#endif
 
 inline ThreadPool::ThreadPool(size_t threadNum, bool enableWorkSteal,
                               bool enableCoreBindings)
-    : _threadNum(threadNum ? threadNum : std::thread::hardware_concurrency()),
-      _queues(_threadNum),
-      _stop(false),
-      _enableWorkSteal(enableWorkSteal),
-      _enableCoreBindings(enableCoreBindings) {
-    auto worker = [this](size_t id) {
-        auto current = getCurrent();
-        current->first = id;
-        current->second = this;
-        while (true) {
-            WorkItem workerItem = {};
-            if (_enableWorkSteal) {
-                // Try to do work steal firstly.
-                for (auto n = 0; n < _threadNum * 2; ++n) {
-                    if (_queues[(id + n) % _threadNum].try_pop_if(
-                            workerItem,
-                            [](auto &item) { return item.canSteal; }))
-                        break;
-                }
-            }
+    : ThreadPool(makeOptions(threadNum, enableWorkSteal,
+                             enableCoreBindings ? PlacementPolicy::LINEAR
+                                                : PlacementPolicy::NONE,
+                             -1)) {}
 
-            if (!workerItem.fn && !_queues[id].pop(workerItem)) {
-                // If thread is going to stop, don't wait for any new task any
-                // more. Otherwise wait for a pop task if _enableWorkSteal false
-                // or work steal failed,
-                if (_stop)
-                    break;
-                else
-                    continue;
-            }
-
-            if (workerItem.fn)
-                workerItem.fn();
-        }
-    };
+inline ThreadPool::ThreadPool(size_t threadNum, bool enableWorkSteal,
+                              PlacementPolicy policy, int32_t node)
+    : ThreadPool(makeOptions(threadNum, enableWorkSteal, policy, node)) {}
 
-    _threads.reserve(_threadNum);
+inline ThreadPool::Options ThreadPool::makeOptions(size_t threadNum,
+                                                   bool enableWorkSteal,
+                                                   PlacementPolicy policy,
+                                                   int32_t node) {
+    Options options;
+    options.threadNum = threadNum;
+    options.enableWorkSteal = enableWorkSteal;
+    options.placement = policy;
+    options.node = node;
+    return options;
+}
 
-#ifdef __linux__
-    // Since the CPU IDs might not start at 0 and might not be continuous
-    // in the containers,
-    // we need to get the available cpus at first.
-    std::vector<uint32_t> cpu_ids;
-    if (_enableCoreBindings)
-        getCurrentCpus(cpu_ids);
-#else
-    // Avoid unused member warning.
-    // [[maybe_unused]] in non-static data members is ignored in GCC.
-    (void)_enableCoreBindings;
+inline void ThreadPool::cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
 #endif
+}
 
-    for (auto i = 0; i < _threadNum; ++i) {
-        _threads.emplace_back(worker, i);
+inline std::vector<std::unique_ptr<ThreadPool>> ThreadPool::createPerNode(
+    size_t threadsPerNode, bool enableWorkSteal, PlacementPolicy policy) {
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    for (int32_t node : Topology::get().nodes())
+        pools.emplace_back(std::make_unique<ThreadPool>(
+            threadsPerNode, enableWorkSteal, policy, node));
+    return pools;
+}
 
-#ifdef __linux__
-        if (!_enableCoreBindings)
+inline void ThreadPool::start(const Topology &topology) {
+    // Every slot up to the elastic maximum gets its placement and queues up
+    // front; only the core workers are started here.
+    _workerCpus = topology.placement(_options.placement, _slotNum);
+    _workerNodes.assign(_slotNum, -1);
+    for (auto i = 0; i < _slotNum; ++i) {
+        if (_workerCpus[i].empty())
             continue;
+        const CpuInfo *info = topology.find(_workerCpus[i][0]);
+        _workerNodes[i] = info ? info->node : -1;
+    }
+
+    // Steal victims sorted by distance between the first cpus of two workers;
+    // unbound pools keep the plain ring order.
+    _stealOrder.resize(_slotNum);
+    for (auto i = 0; i < _slotNum; ++i) {
+        auto &order = _stealOrder[i];
+        for (auto n = 0; n < _slotNum; ++n)
+            order.push_back((i + n) % _slotNum);
+        if (_workerCpus[i].empty())
+            continue;
+        auto distance = [&](int32_t j) {
+            if (_workerCpus[j].empty())
+                return 5;
+            return topology.distance(_workerCpus[i][0], _workerCpus[j][0]);
+        };
+        std::stable_sort(order.begin() + 1, order.end(),
+                         [&](int32_t a, int32_t b) { return distance(a) < distance(b); });
+    }
+
+    _injector.setOptions(_options.lanes);
+    _workers.reserve(_slotNum);
+    for (auto i = 0; i < _slotNum; ++i) {
+        _workers.emplace_back(std::make_unique<Worker>(_options.recordTimings));
+        _workers.back()->inbox.setOptions(_options.lanes);
+    }
+
+    _threads.resize(_slotNum);
+    for (auto i = 0; i < _threadNum; ++i)
+        spawn(i);
+}
+
+inline void ThreadPool::spawn(int32_t id) {
+    // A retired worker has already left run(); reap it before reusing the slot.
+    if (_threads[id].joinable())
+        _threads[id].join();
+    _workers[id]->alive.store(true, std::memory_order_seq_cst);
+    _active.fetch_add(1, std::memory_order_relaxed);
+    _threads[id] = std::thread([this, id]() { run(id); });
+}
+
+inline void ThreadPool::maybeGrow() {
+    if (_slotNum == _threadNum || _stop)
+        return;
+    // Growing only helps when nobody is idle.
+    if (_active.load(std::memory_order_relaxed) >= _slotNum ||
+        _parkedCount.load(std::memory_order_relaxed) > 0 ||
+        _searching.load(std::memory_order_relaxed) > 0)
+        return;
+    if (getItemCount() < _options.backlogThreshold) {
+        _backlogSince.store(0, std::memory_order_relaxed);
+        return;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    int64_t since = _backlogSince.load(std::memory_order_relaxed);
+    if (since == 0) {
+        since = now;
+        _backlogSince.store(now, std::memory_order_relaxed);
+    }
+    if (std::chrono::nanoseconds(now - since) < _options.growDelay)
+        return;
 
-        // Run threads per core.
+    std::scoped_lock guard(_growMutex);
+    if (_stop)
+        return;
+    for (auto i = _threadNum; i < _slotNum; ++i) {
+        if (!_workers[i]->alive.load(std::memory_order_relaxed)) {
+            spawn(i);
+            break;
+        }
+    }
+    // The next worker needs the backlog to persist again.
+    _backlogSince.store(0, std::memory_order_relaxed);
+}
+
+inline void ThreadPool::run(int32_t id) {
+    auto current = getCurrent();
+    current->first = id;
+    current->second = this;
+
+#ifdef __linux__
+    // Bind before running any task so that worker-owned data is first
+    // touched on its own node.
+    if (!_workerCpus[id].empty()) {
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
-        CPU_SET(cpu_ids[i % cpu_ids.size()], &cpuset);
-        int rc = sched_setaffinity(_threads[i].native_handle(),
-                                   sizeof(cpu_set_t), &cpuset);
+        for (auto cpu : _workerCpus[id])
+            CPU_SET(cpu, &cpuset);
+        int rc = sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
         if (rc != 0)
             std::cerr << "Error calling sched_setaffinity: " << rc << "\n";
+    }
 #endif
+
+    // A new extra worker may not be enough for the backlog that spawned it.
+    if (id >= _threadNum)
+        maybeGrow();
+
+    const uint32_t rounds = _options.spinRounds + _options.yieldRounds;
+    WorkerStats &stats = _workers[id]->stats;
+    while (true) {
+        WorkItem *item = findWork(id);
+        if (!item) {
+            // Spin, then yield, then park. While anyone is searching,
+            // submitters do not wake parked workers, so a burst wakes at most
+            // one sleeper and the searchers pick up the rest.
+            _searching.fetch_add(1, std::memory_order_seq_cst);
+            for (uint32_t round = 0; round < rounds && !item; ++round) {
+                if (round < _options.spinRounds)
+                    cpuRelax();
+                else
+                    std::this_thread::yield();
+                item = findWork(id);
+            }
+            bool last = _searching.fetch_sub(1, std::memory_order_seq_cst) == 1;
+            // The last searcher found work: if there is more, hand the search
+            // over to a parked worker.
+            if (item && last && hasWork(id))
+                wakeOne();
+        }
+        if (item) {
+            // The task may block for long; if a backlog is left behind, this
+            // is the last chance to grow before nobody else looks at it.
+            if (_slotNum > _threadNum)
+                maybeGrow();
+            int64_t start = stats.stamp();
+            if (item->fn)
+                item->fn();
+            stats.onRun(item->enqueueNs, start);
+            delete item;
+            continue;
+        }
+        // Drain everything that is still reachable before leaving.
+        if (_stop && !hasWork(id))
+            break;
+        if (!park(id))
+            break;  // retired after idleTimeout
     }
 }
 
+inline ThreadPool::WorkItem *ThreadPool::findWork(int32_t id) {
+    Worker &self = *_workers[id];
+    WorkItem *item = nullptr;
+    // Look at the shared queues first every now and then, so that a worker
+    // busy with its own LIFO deque cannot starve them.
+    if (++self.tick % 61 == 0) {
+        if ((item = self.inbox.pop()) || (item = _injector.pop()))
+            return item;
+        maybeGrow();
+    }
+    if ((item = self.inbox.pop()))
+        return item;
+    if (_injector.latencySize() > 0 && (item = _injector.pop()))
+        return item;
+    if (self.deque.pop(item))
+        return item;
+    // Take a fair share of the injection queue; the rest of the batch lands in
+    // our deque where other workers can steal it. Without stealing the batch
+    // would be stuck behind us, so take one at a time.
+    size_t share = _injector.size() / std::max<int32_t>(_active, 1) + 1;
+    size_t batch = _enableWorkSteal ? std::min<size_t>(share, kInjectBatch) : 1;
+    if ((item = _injector.popBatch(self.deque, batch)))
+        return item;
+    if (_enableWorkSteal) {
+        // Nearest victims first; the second pass retries lost races.
+        const auto &victims = _stealOrder[id];
+        for (auto round = 0; round < 2; ++round) {
+            for (size_t n = 1; n < victims.size(); ++n) {
+                bool hit = _workers[victims[n]]->deque.steal(item);
+                self.stats.onSteal(hit);
+                if (hit)
+                    return item;
+            }
+        }
+    }
+    return nullptr;
+}
+
+inline bool ThreadPool::hasWork(int32_t id) const {
+    const Worker &self = *_workers[id];
+    if (self.inbox.size() || _injector.size() || !self.deque.empty())
+        return true;
+    if (_enableWorkSteal) {
+        for (auto &worker : _workers)
+            if (!worker->deque.empty())
+                return true;
+    }
+    return false;
+}
+
+inline bool ThreadPool::park(int32_t id) {
+    Worker &self = *_workers[id];
+    std::unique_lock lock(_parkMutex);
+    _parked.push_back(id);
+    _parkedCount.fetch_add(1, std::memory_order_seq_cst);
+    // Pairs with the fence in wakeOne()/wake(): either the submitter sees us
+    // parked, or we see its item here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool retire = false;
+    auto woken = [&]() { return self.notified || _stop.load(); };
+    if (!_stop && !hasWork(id)) {
+        int64_t since = self.stats.onPark();
+        if (id < _threadNum)
+            self.cond.wait(lock, woken);
+        else if (!self.cond.wait_for(lock, _options.idleTimeout, woken))
+            retire = !hasWork(id);
+        self.stats.onUnpark(since);
+    }
+    if (self.notified) {
+        // The waker already took us off the parked list.
+        self.notified = false;
+        return true;
+    }
+    _parked.erase(std::find(_parked.begin(), _parked.end(), id));
+    _parkedCount.fetch_sub(1, std::memory_order_relaxed);
+    if (retire) {
+        self.alive.store(false, std::memory_order_relaxed);
+        _active.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+inline void ThreadPool::wakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // A searching worker rechecks all queues before it parks.
+    if (_searching.load(std::memory_order_seq_cst) > 0 ||
+        _parkedCount.load(std::memory_order_seq_cst) == 0)
+        return;
+    std::scoped_lock guard(_parkMutex);
+    if (_parked.empty())
+        return;
+    int32_t id = _parked.back();
+    _parked.pop_back();
+    _parkedCount.fetch_sub(1, std::memory_order_relaxed);
+    _workers[id]->notified = true;
+    _workers[id]->cond.notify_one();
+}
+
+inline void ThreadPool::wake(int32_t id) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_parkedCount.load(std::memory_order_seq_cst) == 0)
+        return;
+    std::scoped_lock guard(_parkMutex);
+    auto it = std::find(_parked.begin(), _parked.end(), id);
+    if (it == _parked.end())
+        return;
+    _parked.erase(it);
+    _parkedCount.fetch_sub(1, std::memory_order_relaxed);
+    _workers[id]->notified = true;
+    _workers[id]->cond.notify_one();
+}
+
 inline ThreadPool::~ThreadPool() {
     _stop = true;
-    for (auto &queue : _queues)
-        queue.stop();
+    {
+        std::scoped_lock guard(_parkMutex);
+        for (auto &worker : _workers)
+            worker->cond.notify_all();
+    }
+    // Wait out a spawn in flight; later ones see _stop under the lock.
+    { std::scoped_lock guard(_growMutex); }
     for (auto &thread : _threads)
-        thread.join();
+        if (thread.joinable())
+            thread.join();
+
+    // Items that raced with the stop are dropped.
+    WorkItem *item = nullptr;
+    while ((item = _injector.pop()))
+        delete item;
+    for (auto &worker : _workers) {
+        while ((item = worker->inbox.pop()))
+            delete item;
+        while (worker->deque.pop(item))
+            delete item;
+    }
+}
+
+inline void ThreadPool::wakeMany(size_t n) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (n == 0 || _parkedCount.load(std::memory_order_seq_cst) == 0)
+        return;
+    std::scoped_lock guard(_parkMutex);
+    for (; n > 0 && !_parked.empty(); --n) {
+        int32_t id = _parked.back();
+        _parked.pop_back();
+        _parkedCount.fetch_sub(1, std::memory_order_relaxed);
+        _workers[id]->notified = true;
+        _workers[id]->cond.notify_one();
+    }
 }
 
 inline ThreadPool::ERROR_TYPE ThreadPool::scheduleById(std::function<void()> fn,
-                                                       int32_t id) {
+                                                       int32_t id,
+                                                       Priority priority) {
     if (nullptr == fn) {
         return ERROR_POOL_ITEM_IS_NULL;
     }
@@ -154,21 +664,25 @@ inline ThreadPool::ERROR_TYPE ThreadPool::scheduleById(std::function<void()> fn,
     }
 
     if (id == -1) {
-        if (_enableWorkSteal) {
-            // Try to push to a non-block queue firstly.
-            WorkItem workerItem{/*canSteal = */ true, fn};
-            for (auto n = 0; n < _threadNum * 2; ++n) {
-                if (_queues.at(n % _threadNum).try_push(workerItem))
-                    return ERROR_NONE;
-            }
+        auto *item = new WorkItem{/*canSteal = */ _enableWorkSteal, std::move(fn),
+                                  priority, stamp()};
+        int32_t self = getCurrentId();
+        if (self != -1 && _enableWorkSteal && priority == Priority::NORMAL) {
+            // Submitted from a worker: keep it local and hot in cache, other
+            // workers get it by stealing. Without stealing nobody else could
+            // run it, so it goes through the shared queue.
+            _workers[self]->deque.push(item);
+            wakeOne();
+        } else {
+            _injector.push(item);
+            wakeOne();
+            maybeGrow();
         }
-
-        id = rand() % _threadNum;
-        _queues[id].push(
-            WorkItem{/*canSteal = */ _enableWorkSteal, std::move(fn)});
     } else {
         assert(id < _threadNum);
-        _queues[id].push(WorkItem{/*canSteal = */ false, std::move(fn)});
+        _workers[id]->inbox.push(
+            new WorkItem{/*canSteal = */ false, std::move(fn), priority, stamp()});
+        wake(id);
     }
 
     return ERROR_NONE;
@@ -188,11 +702,138 @@ inline int32_t ThreadPool::getCurrentId() const {
 }
 
 inline size_t ThreadPool::getItemCount() const {
-    size_t ret = 0;
-    for (auto i = 0; i < _threadNum; ++i) {
-        ret += _queues[i].size();
+    size_t ret = _injector.size();
+    for (auto &worker : _workers) {
+        ret += worker->inbox.size() + worker->deque.size();
     }
     return ret;
 }
-}  // namespace amot
 
+inline ExecutorStats ThreadPool::getStats() const {
+    ExecutorStats stats;
+    for (auto &worker : _workers)
+        stats += worker->stats.snapshot();
+    return stats;
+}
+
+inline void ThreadPool::mergeWaitTime(Histogram &out) const {
+    for (auto &worker : _workers)
+        worker->stats.mergeWaitTime(out);
+}
+
+inline void ThreadPool::mergeRunTime(Histogram &out) const {
+    for (auto &worker : _workers)
+        worker->stats.mergeRunTime(out);
+}
+
+template <typename Fn, typename R>
+inline std::future<R> ThreadPool::submit(Fn &&fn, int32_t id, Priority priority) {
+    // std::function needs a copyable target, so the packaged_task is shared.
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<Fn>(fn));
+    std::future<R> future = task->get_future();
+    scheduleById([task]() { (*task)(); }, id, priority);
+    return future;
+}
+
+template <typename Range>
+inline ThreadPool::ERROR_TYPE ThreadPool::submitBulk(Range &&fns, Priority priority) {
+    if (_stop) {
+        return ERROR_POOL_HAS_STOP;
+    }
+
+    std::vector<WorkItem *> items;
+    for (auto &&fn : fns) {
+        std::function<void()> f(std::forward<decltype(fn)>(fn));
+        if (nullptr == f) {
+            for (auto *item : items)
+                delete item;
+            return ERROR_POOL_ITEM_IS_NULL;
+        }
+        items.push_back(new WorkItem{/*canSteal = */ _enableWorkSteal, std::move(f),
+                                     priority, stamp()});
+    }
+    if (items.empty())
+        return ERROR_NONE;
+
+    // From inside a worker the batch stays local and is spread by stealing;
+    // without stealing it has to go through the shared queue.
+    int32_t self = getCurrentId();
+    if (self != -1 && _enableWorkSteal && priority == Priority::NORMAL) {
+        for (auto *item : items)
+            _workers[self]->deque.push(item);
+        wakeMany(items.size() - 1);
+    } else {
+        _injector.pushBulk(items);
+        wakeMany(items.size());
+        maybeGrow();
+    }
+    return ERROR_NONE;
+}
+
+template <typename Index, typename Fn>
+inline void ThreadPool::parallelFor(Index begin, Index end, Index grain, Fn &&fn) {
+    static_assert(std::is_integral_v<Index>, "parallelFor needs an integral index");
+    if (end <= begin)
+        return;
+    struct State {
+        size_t total;
+        size_t grain;
+        size_t workers;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cond;
+    };
+    auto state = std::make_shared<State>();
+    state->total = static_cast<size_t>(end - begin);
+    state->grain = grain > 0 ? static_cast<size_t>(grain) : 1;
+    state->workers = static_cast<size_t>(_threadNum) + 1;
+
+    // fn outlives every claimed chunk because the caller waits for them all;
+    // helpers that start after the range is exhausted never touch it.
+    auto *body = &fn;
+    auto loop = [state, body, begin]() {
+        while (true) {
+            size_t cur = state->next.load(std::memory_order_relaxed);
+            if (cur >= state->total)
+                return;
+            size_t remaining = state->total - cur;
+            size_t chunk = std::max(state->grain, remaining / (2 * state->workers));
+            chunk = std::min(chunk, remaining);
+            if (!state->next.compare_exchange_weak(cur, cur + chunk,
+                                                   std::memory_order_relaxed))
+                continue;
+            if (!state->failed.load(std::memory_order_relaxed)) {
+                try {
+                    for (size_t i = cur; i < cur + chunk; ++i)
+                        (*body)(static_cast<Index>(begin + static_cast<Index>(i)));
+                } catch (...) {
+                    std::scoped_lock guard(state->mutex);
+                    if (!state->failed.exchange(true))
+                        state->error = std::current_exception();
+                }
+            }
+            if (state->done.fetch_add(chunk, std::memory_order_acq_rel) + chunk ==
+                state->total) {
+                std::scoped_lock guard(state->mutex);
+                state->cond.notify_all();
+            }
+        }
+    };
+
+    size_t chunks = (state->total + state->grain - 1) / state->grain;
+    size_t helpers = std::min<size_t>(_threadNum, chunks > 0 ? chunks - 1 : 0);
+    if (helpers > 0 && !_stop)
+        submitBulk(std::vector<std::function<void()>>(helpers, loop));
+    loop();
+
+    std::unique_lock lock(state->mutex);
+    state->cond.wait(lock, [&]() {
+        return state->done.load(std::memory_order_acquire) == state->total;
+    });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+}  // namespace amot
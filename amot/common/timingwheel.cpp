@@ -0,0 +1,100 @@
+#include "timingwheel.h"
+
+#include <assert.h>
+#include <algorithm>
+
+namespace amot {
+
+namespace {
+constexpr uint64_t kUninit = UINT64_MAX;
+}  // namespace
+
+TimingWheel::TimingWheel(size_t maxId, int timeoutMS, int tickMS, size_t slots)
+    : maxId_(maxId), timeoutMS_(timeoutMS), tickMS_(tickMS > 0 ? tickMS : 1),
+      entries_(new Entry[maxId]), wheel_(std::max<size_t>(slots, 2)),
+      current_(kUninit), cursor_(0), size_(0) {
+    assert(timeoutMS > 0);
+}
+
+void TimingWheel::Add(int id, uint64_t nowMS) {
+    assert(id >= 0 && static_cast<size_t>(id) < maxId_);
+    std::lock_guard<std::mutex> locker(mutex_);
+    if(current_ == kUninit || size_ == 0) {
+        /* 空轮期间不会 tick，重新对齐当前时间 */
+        current_ = nowMS - nowMS % tickMS_;
+    }
+    Entry& entry = entries_[id];
+    if(entry.active) {
+        Remove_(id);
+    }
+    entry.active = true;
+    entry.lastActive.store(nowMS, std::memory_order_relaxed);
+    size_++;
+    Insert_(id, nowMS + timeoutMS_);
+}
+
+void TimingWheel::Remove(int id) {
+    assert(id >= 0 && static_cast<size_t>(id) < maxId_);
+    std::lock_guard<std::mutex> locker(mutex_);
+    Remove_(id);
+}
+
+void TimingWheel::Remove_(int id) {
+    Entry& entry = entries_[id];
+    if(!entry.active) { return; }
+    /* 桶里的旧记录靠 generation 识别，不必立即删除 */
+    entry.active = false;
+    entry.generation++;
+    size_--;
+}
+
+void TimingWheel::Insert_(int id, uint64_t deadline) {
+    uint64_t ticks = deadline > current_ ? (deadline - current_ + tickMS_ - 1) / tickMS_ : 1;
+    ticks = std::clamp<uint64_t>(ticks, 1, wheel_.size() - 1);
+    wheel_[(cursor_ + ticks) % wheel_.size()].push_back(Slot{ id, entries_[id].generation });
+}
+
+size_t TimingWheel::Tick(uint64_t nowMS, std::vector<int>& expired) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    if(current_ == kUninit || nowMS < current_ + tickMS_) { return 0; }
+    const uint64_t target = nowMS - nowMS % tickMS_;
+    if(size_ == 0) {
+        current_ = target;
+        return 0;
+    }
+    /* 停顿超过一圈时每个槽只需处理一次，先跳过多出的整圈 */
+    const uint64_t process = std::min<uint64_t>((target - current_) / tickMS_, wheel_.size());
+    current_ = target - process * tickMS_;
+    size_t count = 0;
+    for(uint64_t i = 0; i < process; i++) {
+        cursor_ = (cursor_ + 1) % wheel_.size();
+        current_ += tickMS_;
+        swap_.clear();
+        swap_.swap(wheel_[cursor_]);
+        for(const Slot& slot : swap_) {
+            Entry& entry = entries_[slot.id];
+            if(!entry.active || entry.generation != slot.generation) { continue; }
+            uint64_t deadline = entry.lastActive.load(std::memory_order_relaxed) + timeoutMS_;
+            if(deadline <= nowMS) {
+                entry.active = false;
+                entry.generation++;
+                size_--;
+                expired.push_back(slot.id);
+                count++;
+            } else {
+                /* 期间有过活动，按最新时间重新入桶 */
+                Insert_(slot.id, deadline);
+            }
+        }
+    }
+    return count;
+}
+
+int TimingWheel::GetNextTick(uint64_t nowMS) const {
+    std::lock_guard<std::mutex> locker(mutex_);
+    if(size_ == 0 || current_ == kUninit) { return -1; }
+    uint64_t next = current_ + tickMS_;
+    return next > nowMS ? static_cast<int>(next - nowMS) : 0;
+}
+
+}  // namespace amot
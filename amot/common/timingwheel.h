@@ -0,0 +1,105 @@
+/**
+ * @file timingwheel.h
+ * @brief 哈希时间轮，管理连接空闲超时
+ * @version 0.1
+ * @date 2024-03-23
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace amot {
+
+/**
+ * @brief 连接空闲超时时间轮
+ * @details 连接有活动时只写自己的 lastActive(O(1)，不移动桶)，到期检查时
+ *          才按最新的 lastActive 惰性重新入桶。同一 tick 内到期的连接一次
+ *          性返回，由调用方批量关闭。Touch 无锁；Add/Remove/Tick 由一把锁保护，
+ *          关闭连接的工作线程可以直接 Remove。
+ */
+class TimingWheel {
+public:
+    /**
+     * @param maxId         id(即 fd)上限
+     * @param timeoutMS     空闲超时，毫秒
+     * @param tickMS        时间轮精度，毫秒
+     * @param slots         槽数，跨度 slots * tickMS 应不小于 timeoutMS
+     */
+    TimingWheel(size_t maxId, int timeoutMS, int tickMS = 100, size_t slots = 512);
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    void Add(int id, uint64_t nowMS);
+
+    /**
+     * @brief 记录活动时间，不做任何桶操作
+     */
+    void Touch(int id, uint64_t nowMS) {
+        entries_[id].lastActive.store(nowMS, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 不再跟踪 id，须在 id(fd)关闭并可能被复用之前调用
+     */
+    void Remove(int id);
+
+    /**
+     * @brief 推进时间轮，收集到期的 id
+     *
+     * @param nowMS         当前时间
+     * @param expired       输出到期 id(追加)
+     * @return size_t       本次到期的数量
+     */
+    size_t Tick(uint64_t nowMS, std::vector<int>& expired);
+
+    /**
+     * @brief 距离下一次 tick 的毫秒数，没有连接时返回 -1，可直接作为 epoll_wait 超时
+     */
+    int GetNextTick(uint64_t nowMS) const;
+
+    size_t Size() const {
+        std::lock_guard<std::mutex> locker(mutex_);
+        return size_;
+    }
+
+    int TimeoutMS() const { return timeoutMS_; }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> lastActive{0};
+        uint32_t generation = 0;
+        bool active = false;
+    };
+
+    struct Slot {
+        int id;
+        uint32_t generation;
+    };
+
+    void Remove_(int id);
+    void Insert_(int id, uint64_t deadline);
+
+    size_t maxId_;
+    uint64_t timeoutMS_;
+    uint64_t tickMS_;
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<Entry[]> entries_;
+    std::vector<std::vector<Slot>> wheel_;
+    std::vector<Slot> swap_;
+
+    /* 当前槽对应的时间(已处理到此) */
+    uint64_t current_;
+    size_t cursor_;
+    size_t size_;
+};
+
+}  // namespace amot
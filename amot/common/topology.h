@@ -0,0 +1,357 @@
+/**
+ * @file topology.h
+ * @brief CPU 拓扑探测(SMT、LLC、NUMA)与线程放置策略
+ * @version 0.1
+ * @date 2024-04-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace amot {
+
+enum class PlacementPolicy {
+    NONE,           // 不绑核
+    LINEAR,         // 按可用 CPU 编号依次绑定
+    COMPACT,        // 先占满同一物理核的超线程，再同一 LLC、同一节点
+    SCATTER,        // 依次分散到不同节点、LLC、物理核，最后才用超线程
+    PHYSICAL_CORE,  // 每个物理核一个线程，不使用超线程兄弟
+    NUMA_NODE,      // 线程按节点均分，每个线程绑定到所在节点的全部 CPU
+};
+
+struct CpuInfo {
+    uint32_t id = 0;
+    int32_t core = 0;     // 物理核编号，全局唯一
+    int32_t llc = 0;      // 末级缓存域，取共享该缓存的最小 CPU 号
+    int32_t node = 0;     // NUMA 节点
+    int32_t package = 0;
+};
+
+/**
+ * @brief 从 /sys/devices/system 读出的 CPU 拓扑
+ * @details sysfs 不可用时退化为每个 CPU 一个物理核、同一 LLC、同一节点。
+ */
+class Topology {
+public:
+    /**
+     * @brief 当前进程可用 CPU 的拓扑，首次调用时探测
+     */
+    static const Topology &get() {
+        static const Topology topology = discover();
+        return topology;
+    }
+
+    /**
+     * @param sysRoot 	sysfs 根目录，测试时可指向伪造的目录
+     * @param allowed 	只保留这些 CPU，为空时取 sched_getaffinity 的结果
+     */
+    static Topology discover(const std::string &sysRoot = "/sys/devices/system",
+                             std::vector<uint32_t> allowed = {}) {
+        namespace fs = std::filesystem;
+        if (allowed.empty())
+            allowed = affinityCpus();
+        if (allowed.empty())
+            allowed = parseList(readFile(sysRoot + "/cpu/online"));
+        std::sort(allowed.begin(), allowed.end());
+
+        std::map<uint32_t, int32_t> nodeOf;
+        std::error_code ec;
+        for (auto &entry : fs::directory_iterator(sysRoot + "/node", ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+                continue;
+            int32_t node = std::stoi(name.substr(4));
+            for (uint32_t cpu : parseList(readFile(entry.path().string() + "/cpulist")))
+                nodeOf[cpu] = node;
+        }
+
+        Topology topology;
+        std::map<std::pair<int32_t, int32_t>, int32_t> coreIds;
+        for (uint32_t id : allowed) {
+            std::string dir = sysRoot + "/cpu/cpu" + std::to_string(id);
+            CpuInfo info;
+            info.id = id;
+            info.package = readInt(dir + "/topology/physical_package_id", 0);
+            int32_t coreId = readInt(dir + "/topology/core_id", -1);
+            if (coreId < 0)
+                coreId = static_cast<int32_t>(id) + (1 << 20);
+            auto key = std::make_pair(info.package, coreId);
+            auto it = coreIds.find(key);
+            if (it == coreIds.end())
+                it = coreIds.emplace(key, static_cast<int32_t>(coreIds.size())).first;
+            info.core = it->second;
+            info.llc = lastLevelCache(dir, info.package);
+            auto node = nodeOf.find(id);
+            info.node = node == nodeOf.end() ? 0 : node->second;
+            topology._cpus.push_back(info);
+        }
+        return topology;
+    }
+
+    const std::vector<CpuInfo> &cpus() const { return _cpus; }
+
+    const CpuInfo *find(uint32_t cpu) const {
+        for (auto &info : _cpus)
+            if (info.id == cpu)
+                return &info;
+        return nullptr;
+    }
+
+    std::vector<int32_t> nodes() const {
+        std::vector<int32_t> ret;
+        for (auto &info : _cpus)
+            if (std::find(ret.begin(), ret.end(), info.node) == ret.end())
+                ret.push_back(info.node);
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    size_t coreCount() const {
+        std::vector<int32_t> cores;
+        for (auto &info : _cpus)
+            cores.push_back(info.core);
+        std::sort(cores.begin(), cores.end());
+        return std::unique(cores.begin(), cores.end()) - cores.begin();
+    }
+
+    /**
+     * @brief 只含某个 NUMA 节点 CPU 的子拓扑
+     */
+    Topology onNode(int32_t node) const {
+        Topology sub;
+        for (auto &info : _cpus)
+            if (info.node == node)
+                sub._cpus.push_back(info);
+        return sub;
+    }
+
+    /**
+     * @brief 两个 CPU 之间的距离：0 同一 CPU，1 超线程兄弟，2 同一 LLC，3 同一节点，4 跨节点
+     */
+    int distance(uint32_t a, uint32_t b) const {
+        if (a == b)
+            return 0;
+        const CpuInfo *x = find(a), *y = find(b);
+        if (!x || !y)
+            return 4;
+        if (x->core == y->core)
+            return 1;
+        if (x->llc == y->llc)
+            return 2;
+        if (x->node == y->node)
+            return 3;
+        return 4;
+    }
+
+    /**
+     * @brief 按策略给 threadNum 个线程分配 CPU 集合，NONE 或拓扑为空时返回空集合
+     */
+    std::vector<std::vector<uint32_t>> placement(PlacementPolicy policy,
+                                                 size_t threadNum) const {
+        std::vector<std::vector<uint32_t>> ret(threadNum);
+        if (policy == PlacementPolicy::NONE || _cpus.empty())
+            return ret;
+        if (policy == PlacementPolicy::NUMA_NODE) {
+            auto ids = nodes();
+            for (size_t i = 0; i < threadNum; i++) {
+                int32_t node = ids[i * ids.size() / threadNum];
+                for (auto &info : _cpus)
+                    if (info.node == node)
+                        ret[i].push_back(info.id);
+            }
+            return ret;
+        }
+
+        std::vector<uint32_t> order;
+        if (policy == PlacementPolicy::LINEAR) {
+            for (auto &info : _cpus)
+                order.push_back(info.id);
+        } else if (policy == PlacementPolicy::SCATTER) {
+            order = scatterOrder();
+        } else {
+            for (auto &info : compactOrder()) {
+                if (policy == PlacementPolicy::PHYSICAL_CORE && !order.empty() &&
+                    find(order.back())->core == info.core)
+                    continue;
+                order.push_back(info.id);
+            }
+        }
+        for (size_t i = 0; i < threadNum; i++)
+            ret[i].push_back(order[i % order.size()]);
+        return ret;
+    }
+
+    /**
+     * @brief 分配 bytes 字节并尽量放在 node 节点上，node < 0 时不设策略
+     * @details 使用 mbind(MPOL_PREFERRED)，内核不支持时退化为首次访问分配，
+     *          因此由绑在该节点上的工作线程首次写入效果最好。需用 freeOnNode 释放。
+     */
+    static void *allocOnNode(size_t bytes, int32_t node) {
+#ifdef __linux__
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+        if (node >= 0 && node < 64) {
+            const int kMpolPreferred = 1;
+            unsigned long mask = 1UL << node;
+            syscall(SYS_mbind, p, bytes, kMpolPreferred, &mask, sizeof(mask) * 8, 0);
+        }
+        return p;
+#else
+        (void)node;
+        return ::operator new(bytes);
+#endif
+    }
+
+    static void freeOnNode(void *p, size_t bytes) {
+        if (!p)
+            return;
+#ifdef __linux__
+        munmap(p, bytes);
+#else
+        (void)bytes;
+        ::operator delete(p);
+#endif
+    }
+
+    static std::vector<uint32_t> parseList(const std::string &list) {
+        std::vector<uint32_t> ret;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            std::string item = list.substr(pos, end - pos);
+            pos = end + 1;
+            if (item.empty() || !::isdigit(item[0]))
+                continue;
+            size_t dash = item.find('-');
+            uint32_t lo = std::stoul(item.substr(0, dash));
+            uint32_t hi = dash == std::string::npos ? lo : std::stoul(item.substr(dash + 1));
+            for (uint32_t i = lo; i <= hi; i++)
+                ret.push_back(i);
+        }
+        return ret;
+    }
+
+private:
+    static std::vector<uint32_t> affinityCpus() {
+        std::vector<uint32_t> ids;
+#ifdef __linux__
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            for (uint32_t i = 0; i < CPU_SETSIZE; i++)
+                if (CPU_ISSET(i, &set))
+                    ids.push_back(i);
+#endif
+        return ids;
+    }
+
+    static std::string readFile(const std::string &path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static int32_t readInt(const std::string &path, int32_t def) {
+        std::string s = readFile(path);
+        if (s.empty() || !(::isdigit(s[0]) || s[0] == '-'))
+            return def;
+        return std::stoi(s);
+    }
+
+    /**
+     * @brief 最高一级数据/统一缓存的共享域，取其中最小的 CPU 号作为编号
+     */
+    static int32_t lastLevelCache(const std::string &cpuDir, int32_t package) {
+        int32_t level = -1, llc = -1 - package;
+        for (int i = 0;; i++) {
+            std::string dir = cpuDir + "/cache/index" + std::to_string(i);
+            std::string type = readFile(dir + "/type");
+            if (type.empty())
+                break;
+            if (type == "Instruction")
+                continue;
+            int32_t l = readInt(dir + "/level", -1);
+            auto shared = parseList(readFile(dir + "/shared_cpu_list"));
+            if (l > level && !shared.empty()) {
+                level = l;
+                llc = static_cast<int32_t>(*std::min_element(shared.begin(), shared.end()));
+            }
+        }
+        return llc;
+    }
+
+    std::vector<CpuInfo> compactOrder() const {
+        auto order = _cpus;
+        std::sort(order.begin(), order.end(), [](const CpuInfo &a, const CpuInfo &b) {
+            return std::tie(a.node, a.llc, a.core, a.id) < std::tie(b.node, b.llc, b.core, b.id);
+        });
+        return order;
+    }
+
+    template <typename T>
+    static std::vector<T> interleave(const std::vector<std::vector<T>> &groups) {
+        std::vector<T> ret;
+        for (size_t i = 0;; i++) {
+            bool any = false;
+            for (auto &group : groups) {
+                if (i < group.size()) {
+                    ret.push_back(group[i]);
+                    any = true;
+                }
+            }
+            if (!any)
+                return ret;
+        }
+    }
+
+    /**
+     * @brief 先取每个物理核的第一个超线程，在节点间、节点内的 LLC 间轮转；再取第二个超线程，依此类推
+     */
+    std::vector<uint32_t> scatterOrder() const {
+        std::map<int32_t, int> rankInCore;
+        std::map<int, std::map<int32_t, std::map<int32_t, std::vector<uint32_t>>>> tree;
+        for (auto &info : compactOrder())
+            tree[rankInCore[info.core]++][info.node][info.llc].push_back(info.id);
+        std::vector<uint32_t> order;
+        for (auto &[rank, nodes] : tree) {
+            std::vector<std::vector<uint32_t>> perNode;
+            for (auto &[node, llcs] : nodes) {
+                std::vector<std::vector<uint32_t>> perLlc;
+                for (auto &[llc, ids] : llcs)
+                    perLlc.push_back(ids);
+                perNode.push_back(interleave(perLlc));
+            }
+            auto level = interleave(perNode);
+            order.insert(order.end(), level.begin(), level.end());
+        }
+        return order;
+    }
+
+    std::vector<CpuInfo> _cpus;
+};
+
+}  // namespace amot
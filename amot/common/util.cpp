@@ -0,0 +1,63 @@
+#include "util.h"
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <sstream>
+
+namespace amot {
+
+long GetThreadId() {
+    return syscall(SYS_gettid);
+}
+
+uint64_t GetCurrentMS() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 取 dladdr 得到的符号名并还原 C++ 名字，找不到符号时退回到 模块+偏移 */
+std::string SymbolizeAddress(void* pc) {
+    Dl_info info;
+    if(dladdr(pc, &info) && info.dli_sname) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+        free(demangled);
+        return name;
+    }
+    char text[64];
+    if(dladdr(pc, &info) && info.dli_fname) {
+        const char* base = strrchr(info.dli_fname, '/');
+        snprintf(text, sizeof(text), "%s+0x%lx", base ? base + 1 : info.dli_fname,
+                 static_cast<unsigned long>(reinterpret_cast<uintptr_t>(pc) - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+    } else {
+        snprintf(text, sizeof(text), "0x%lx", static_cast<unsigned long>(reinterpret_cast<uintptr_t>(pc)));
+    }
+    return text;
+}
+
+void Backtrace(std::vector<std::string>& bt, int size, int skip) {
+    std::vector<void*> pcs(size > 0 ? size : 0);
+    int n = ::backtrace(pcs.data(), size);
+    for(int i = skip; i < n; i++) {
+        bt.push_back(SymbolizeAddress(pcs[i]));
+    }
+}
+
+std::string BacktraceToString(int size, int skip, const std::string& prefix) {
+    std::vector<std::string> bt;
+    Backtrace(bt, size, skip);
+    std::stringstream ss;
+    for(auto& frame : bt) {
+        ss << prefix << frame << std::endl;
+    }
+    return ss.str();
+}
+
+}  // namespace amot
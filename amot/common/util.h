@@ -2,6 +2,7 @@
 
 #include <cxxabi.h>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <stdio.h>
 #include <stdint.h>
@@ -16,11 +17,24 @@ long GetThreadId();
 
 uint32_t GetFiberId();
 
+/**
+ * @brief 墙上时间，自 1970 年起的毫秒数；会随系统时间调整跳变，计时请用 clock.h
+ */
 uint64_t GetCurrentMS();
 
+/**
+ * @brief 当前调用栈，由内向外，每帧为还原后的函数名
+ * @param size 最多取的帧数
+ * @param skip 跳过最内层的帧数，默认跳过 Backtrace 自身
+ */
 void Backtrace(std::vector<std::string> &bt, int size = 64, int skip = 1);
 std::string BacktraceToString(int size = 64, int skip = 2, const std::string& prefix = "");
 
+/**
+ * @brief 把代码地址解析为函数名，没有符号时返回 模块+偏移
+ */
+std::string SymbolizeAddress(void* pc);
+
 template<class T>
 const char* TypeToName() {
 	static const char* s_name = abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, nullptr);
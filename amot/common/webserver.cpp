@@ -1,6 +1,9 @@
 #include "webserver.h"
 
 using namespace std;
+using amot::LoopClock;
+using amot::MonotonicMs;
+using amot::MonotonicUs;
 
 WebServer::WebServer(
             int port, int trigMode, int timeoutMS, bool OptLinger,
@@ -8,13 +11,26 @@ WebServer::WebServer(
             const char* dbName, int connPoolNum, int threadNum,
             bool openLog, int logLevel, int logQueSize):
             port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+            acceptPaused_(false),
+            flushPolicy_(amot::FlushPolicy::IMMEDIATE), flushEventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+            timer_(new amot::TimingWheel(MAX_FD, timeoutMS > 0 ? timeoutMS : 1)),
+            threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller()),
+            fileCache_(new amot::FileCache()), metrics_(new amot::HttpMetrics()),
+            admission_(new amot::AdmissionController()), pendingTasks_(0),
+            coroutineMode_(false), offloadProcess_(false), nextReactor_(0)
     {
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    /* 小文件由共享的 mmap 缓存提供，大文件走 sendfile */
+    HttpConn::fileCache = fileCache_.get();
+    HttpConn::flushPolicy = flushPolicy_;
+    /* 连接据此提供 /metrics，并在响应写完时按路由记录请求与耗时 */
+    HttpConn::metrics = metrics_.get();
+    metrics_->Registry()->AddGaugeCallback("amot_http_connections", "Open HTTP connections.", {},
+                                           [] { return static_cast<double>(HttpConn::userCount.load()); });
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
 
     InitEventMode_(trigMode);
@@ -31,6 +47,7 @@ WebServer::WebServer(
                             (connEvent_ & EPOLLET ? "ET": "LT"));
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
+            LOG_INFO("FileCache inotify: %s", fileCache_->GetInotifyFd() >= 0 ? "on" : "off");
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
         }
     }
@@ -38,11 +55,37 @@ WebServer::WebServer(
 
 WebServer::~WebServer() {
     close(listenFd_);
+    if(flushEventFd_ >= 0) { close(flushEventFd_); }
     isClose_ = true;
     free(srcDir_);
     //SqlConnPool::Instance()->ClosePool();
 }
 
+void WebServer::SetFlushPolicy(amot::FlushPolicy policy) {
+    flushPolicy_ = policy;
+    HttpConn::flushPolicy = policy;
+}
+
+void WebServer::SetAdmissionOptions(const amot::AdmissionOptions& options) {
+    admission_.reset(new amot::AdmissionController(options));
+}
+
+void WebServer::SetCoroutineMode(int reactorNum, bool offloadProcess) {
+    assert(reactorNum > 0);
+    coroutineMode_ = true;
+    offloadProcess_ = offloadProcess;
+    for(int i = 0; i < reactorNum; i++) {
+        reactors_.emplace_back(new amot::Reactor(MAX_FD));
+    }
+    if(offloadProcess_) {
+        cpuPool_.reset(new amot::ThreadPool());
+    }
+    /* 连接 fd 在 Reactor 中以边沿触发注册，读写必须读空/写满 */
+    HttpConn::isET = true;
+    LOG_INFO("Coroutine mode, reactor num: %d, offload: %s",
+             reactorNum, offloadProcess ? "true" : "false");
+}
+
 void WebServer::InitEventMode_(int trigMode) {
     listenEvent_ = EPOLLRDHUP;
     connEvent_ = EPOLLONESHOT | EPOLLRDHUP;
@@ -71,11 +114,22 @@ void WebServer::InitEventMode_(int trigMode) {
 void WebServer::Start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
     if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    for(auto& reactor : reactors_) {
+        reactor->start();
+    }
     while(!isClose_) {
         if(timeoutMS_ > 0) {
-            timeMS = timer_->GetNextTick();
+            /* O(1)：只算到下一个 tick 的时间 */
+            timeMS = timer_->GetNextTick(MonotonicMs());
+        }
+        if(acceptPaused_ && (timeMS < 0 || timeMS > 10)) {
+            /* 暂停 accept 期间定期醒来检查能否恢复 */
+            timeMS = 10;
         }
         int eventCnt = epoller_->Wait(timeMS);
+        /* 本轮的定时器与准入判断都读这个缓存时间，不再各自读时钟 */
+        LoopClock::Update();
+        uint64_t busyStart = LoopClock::NowUs();
         for(int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
             int fd = epoller_->GetEventFd(i);
@@ -83,6 +137,16 @@ void WebServer::Start() {
             if(fd == listenFd_) {
                 DealListen_();
             }
+            else if(fd == flushEventFd_) {
+                /* 只用于唤醒，待写连接在本轮末尾统一处理 */
+                uint64_t cnt;
+                ssize_t n = read(flushEventFd_, &cnt, sizeof(cnt));
+                (void)n;
+            }
+            else if(fd == fileCache_->GetInotifyFd()) {
+                /* 资源文件变更，使缓存失效 */
+                fileCache_->OnInotify();
+            }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 assert(users_.count(fd) > 0);
                 CloseConn_(&users_[fd]);
@@ -98,30 +162,80 @@ void WebServer::Start() {
                 LOG_ERROR("Unexpected event");
             }
         }
+        FlushPending_();
+        if(timeoutMS_ > 0) {
+            CloseExpired_();
+        }
+        admission_->OnLoop(MonotonicUs() - busyStart);
+        if(acceptPaused_ && admission_->CanResumeAccept(pendingTasks_, LoopClock::NowMs())) {
+            ResumeAccept_();
+        }
     }
 }
 
 void WebServer::SendError_(int fd, const char*info) {
     assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
+    /* 不阻塞事件循环，发不出去就直接关闭 */
+    int ret = send(fd, info, strlen(info), MSG_DONTWAIT | MSG_NOSIGNAL);
     if(ret < 0) {
         LOG_WARN("send error to client[%d] error!", fd);
     }
     close(fd);
 }
 
+void WebServer::SendBusy_(int fd) {
+    assert(fd > 0);
+    std::string_view busy = amot::AdmissionController::BusyResponse();
+    send(fd, busy.data(), busy.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void WebServer::PauseAccept_() {
+    /* 新连接留在内核全连接队列，不再消耗事件循环 */
+    epoller_->ModFd(listenFd_, listenEvent_);
+    acceptPaused_ = true;
+    LOG_WARN("Overloaded, pause accept!");
+}
+
+void WebServer::ResumeAccept_() {
+    epoller_->ModFd(listenFd_, listenEvent_ | EPOLLIN);
+    acceptPaused_ = false;
+    LOG_INFO("Resume accept");
+}
+
 void WebServer::CloseConn_(HttpConn* client) {
     assert(client);
     LOG_INFO("Client[%d] quit!", client->GetFd());
+    /* 在 fd 关闭(可能被复用)之前移出时间轮，否则到期时会再关一次 */
+    if(timeoutMS_ > 0 && !coroutineMode_) { timer_->Remove(client->GetFd()); }
     epoller_->DelFd(client->GetFd());
     client->Close();
 }
 
+void WebServer::CloseExpired_() {
+    /* 同一 tick 到期的连接批量关闭 */
+    expired_.clear();
+    if(timer_->Tick(LoopClock::NowMs(), expired_) == 0) { return; }
+    for(int fd : expired_) {
+        assert(users_.count(fd) > 0);
+        CloseConn_(&users_[fd]);
+    }
+}
+
 void WebServer::AddClient_(int fd, sockaddr_in addr) {
     assert(fd > 0);
     users_[fd].init(fd, addr);
+    metrics_->OnAccept();
+    if(coroutineMode_) {
+        /* 连接整个生命周期都在同一个 Reactor 上，超时由 Reactor 的读等待负责 */
+        SetFdNonblock(fd);
+        HttpConn* client = &users_[fd];
+        auto& reactor = reactors_[nextReactor_++ % reactors_.size()];
+        reactor->spawn([this, client] { return ServeConn_(client); });
+        LOG_INFO("Client[%d] in!", fd);
+        return;
+    }
     if(timeoutMS_ > 0) {
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        timer_->Add(fd, LoopClock::NowMs());
     }
     epoller_->AddFd(fd, EPOLLIN | connEvent_);
     SetFdNonblock(fd);
@@ -132,6 +246,11 @@ void WebServer::DealListen_() {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
     do {
+        auto decision = admission_->OnAccept(pendingTasks_, LoopClock::NowMs());
+        if(decision == amot::AdmissionController::Decision::PAUSE) {
+            PauseAccept_();
+            return;
+        }
         int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
         if(fd <= 0) { return;}
         else if(HttpConn::userCount >= MAX_FD) {
@@ -139,25 +258,49 @@ void WebServer::DealListen_() {
             LOG_WARN("Clients is full!");
             return;
         }
+        else if(decision == amot::AdmissionController::Decision::REJECT) {
+            /* 过载时尽早拒绝，代价只有一次 accept + send */
+            SendBusy_(fd);
+            close(fd);
+            continue;
+        }
         AddClient_(fd, addr);
     } while(listenEvent_ & EPOLLET);
 }
 
 void WebServer::DealRead_(HttpConn* client) {
     assert(client);
+    if(!admission_->TryAcquire()) {
+        /* 超过自适应并发上限，不进线程池排队 */
+        SendBusy_(client->GetFd());
+        CloseConn_(client);
+        return;
+    }
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    pendingTasks_++;
+    uint64_t admitUS = MonotonicUs();
+    threadpool_->AddTask([this, client, admitUS] {
+        pendingTasks_--;
+        OnRead_(client);
+        /* 延迟样本包含排队时间，排队一增长上限就收缩 */
+        admission_->Release(MonotonicUs() - admitUS);
+    });
 }
 
 void WebServer::DealWrite_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    pendingTasks_++;
+    threadpool_->AddTask([this, client] {
+        pendingTasks_--;
+        OnWrite_(client);
+    });
 }
 
 void WebServer::ExtentTime_(HttpConn* client) {
     assert(client);
-    if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+    /* 只刷新活动时间，到期检查时再惰性重新入桶 */
+    if(timeoutMS_ > 0) { timer_->Touch(client->GetFd(), LoopClock::NowMs()); }
 }
 
 void WebServer::OnRead_(HttpConn* client) {
@@ -165,6 +308,7 @@ void WebServer::OnRead_(HttpConn* client) {
     int ret = -1;
     int readErrno = 0;
     ret = client->read(&readErrno);
+    if(ret > 0) { metrics_->OnRead(ret); }
     if(ret <= 0 && readErrno != EAGAIN) {
         CloseConn_(client);
         return;
@@ -173,22 +317,69 @@ void WebServer::OnRead_(HttpConn* client) {
 }
 
 void WebServer::OnProcess(HttpConn* client) {
-    if(client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+    /* 先处理完读缓冲里全部流水线请求，响应在连接的 ResponseQueue 中攒成一批 */
+    while(client->process()) {
+        if(flushPolicy_ == amot::FlushPolicy::IMMEDIATE) { break; }
+    }
+    if(client->ToWriteBytes() > 0) {
+        if(flushPolicy_ == amot::FlushPolicy::IMMEDIATE) {
+            /* 直接写，只有写不完才注册 EPOLLOUT */
+            OnWrite_(client);
+        } else {
+            QueueFlush_(client);
+        }
     } else {
         epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
     }
 }
 
-void WebServer::OnWrite_(HttpConn* client) {
+void WebServer::QueueFlush_(HttpConn* client) {
+    if(flushEventFd_ < 0) {
+        OnWrite_(client);
+        return;
+    }
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> locker(flushMtx_);
+        wakeup = flushList_.empty();
+        flushList_.push_back(client);
+    }
+    /* 由线程池调用时事件循环可能正阻塞在 epoll_wait 上 */
+    if(wakeup) {
+        uint64_t one = 1;
+        ssize_t n = write(flushEventFd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void WebServer::FlushPending_() {
+    {
+        std::lock_guard<std::mutex> locker(flushMtx_);
+        if(flushList_.empty()) { return; }
+        flushing_.swap(flushList_);
+    }
+    /* 本轮各连接攒下的响应各自一次 Flush 写出，请求处理仍留在线程池 */
+    for(HttpConn* client : flushing_) {
+        OnWrite_(client, true);
+    }
+    flushing_.clear();
+}
+
+void WebServer::OnWrite_(HttpConn* client, bool inLoop) {
     assert(client);
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
+    if(ret > 0) { metrics_->OnWrite(ret); }
     if(client->ToWriteBytes() == 0) {
         /* 传输完成 */
         if(client->IsKeepAlive()) {
-            OnProcess(client);
+            if(inLoop) {
+                /* 入队前 OnProcess 已处理完读缓冲里的完整请求，剩下的只能等新数据 */
+                epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+            } else {
+                OnProcess(client);
+            }
             return;
         }
     }
@@ -202,6 +393,59 @@ void WebServer::OnWrite_(HttpConn* client) {
     CloseConn_(client);
 }
 
+amot::Reactor::ConnTask WebServer::ServeConn_(HttpConn* client) {
+    amot::Reactor* reactor = amot::Reactor::current();
+    const int fd = client->GetFd();
+    reactor->add_fd(fd);
+    while(true) {
+        int readErrno = 0;
+        ssize_t ret = client->read(&readErrno);
+        if(ret > 0) { metrics_->OnRead(ret); }
+        if(ret <= 0 && readErrno != EAGAIN) { break; }
+
+        if(!admission_->TryAcquire()) {
+            SendBusy_(fd);
+            break;
+        }
+        uint64_t admitUS = MonotonicUs();
+        /* 读缓冲里的流水线请求一次处理完，响应攒在 ResponseQueue 里一起写 */
+        if(offloadProcess_) {
+            co_await amot::offload(*cpuPool_, [this, client] {
+                while(client->process()) {
+                    if(flushPolicy_ == amot::FlushPolicy::IMMEDIATE) { break; }
+                }
+            });
+        } else {
+            while(client->process()) {
+                if(flushPolicy_ == amot::FlushPolicy::IMMEDIATE) { break; }
+            }
+        }
+
+        const bool responded = client->ToWriteBytes() > 0;
+        bool writeFailed = false;
+        while(client->ToWriteBytes() > 0) {
+            int writeErrno = 0;
+            ssize_t len = client->write(&writeErrno);
+            if(len >= 0) {
+                metrics_->OnWrite(len);
+                continue;
+            }
+            if(writeErrno != EAGAIN || !co_await reactor->writable(fd)) {
+                writeFailed = true;
+                break;
+            }
+        }
+        admission_->Release(MonotonicUs() - admitUS);
+        if(writeFailed || (responded && !client->IsKeepAlive())) { break; }
+
+        /* 数据已读空，挂起等待下一批请求，等待期间不占用任何线程 */
+        if(ret < 0 && !co_await reactor->readable(fd, timeoutMS_)) { break; }
+    }
+    reactor->remove_fd(fd);
+    LOG_INFO("Client[%d] quit!", fd);
+    client->Close();
+}
+
 /* Create listenFd */
 bool WebServer::InitSocket_() {
     int ret;
@@ -263,6 +507,12 @@ bool WebServer::InitSocket_() {
         return false;
     }
     SetFdNonblock(listenFd_);
+    if(fileCache_->GetInotifyFd() >= 0) {
+        epoller_->AddFd(fileCache_->GetInotifyFd(), EPOLLIN);
+    }
+    if(flushEventFd_ >= 0) {
+        epoller_->AddFd(flushEventFd_, EPOLLIN);
+    }
     LOG_INFO("Server port:%d", port_);
     return true;
 }
@@ -1,18 +1,41 @@
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#include "admission.h"
+#include "clock.h"
 #include "epoller.h"
 #include "log.h"
+#include "timingwheel.h"
+#include "amot/http/filecache.h"
+#include "amot/http/httpmetrics.h"
+#include "amot/http/responsequeue.h"
+#include "amot/coroutine/reactor.h"
+#include "threadPool.h"
 
-
+/*
+ * 本文件依赖的 HttpConn、SqlConnPool、Log 不在本仓库中，webserver.cpp 未列入 LIB_SRC，
+ * 不参与构建。WebServer 对 HttpConn 的约定如下，补齐 HttpConn 时以此为准：
+ *
+ *   static amot::FileCache* fileCache      共享的静态文件缓存，交给连接内的 StaticFileServer
+ *   static amot::FlushPolicy flushPolicy   连接内 ResponseQueue 的写出策略
+ *   bool process()                         处理读缓冲中的一个请求，响应加入 ResponseQueue，没有完整请求时返回 false
+ *   ssize_t write(int* saveErrno)          即 ResponseQueue::Flush
+ *   size_t ToWriteBytes() const            即 ResponseQueue::ToWriteBytes
+ *   static amot::HttpMetrics* metrics      交给连接内 StaticFileServer::SetMetrics 提供 /metrics，
+ *                                          并交给 ResponseQueue::SetMetrics；process() 在解析出请求时取
+ *                                          MonotonicNs()，响应入队后调用 Track(metrics->RouteOf(path, code), ...)
+ *   static std::atomic<int> userCount      当前连接数，导出为 amot_http_connections
+ */
 class WebServer {
 public:
     WebServer(
@@ -24,6 +47,25 @@ public:
     ~WebServer();
     void Start();
 
+    /**
+     * @brief 设置响应写出策略，需在 Start 之前调用，默认 IMMEDIATE
+     * @details END_OF_LOOP/CORK 下写出由事件循环线程完成，请求处理仍在线程池
+     */
+    void SetFlushPolicy(amot::FlushPolicy policy);
+
+    /**
+     * @brief 设置过载准入参数，需在 Start 之前调用
+     */
+    void SetAdmissionOptions(const amot::AdmissionOptions& options);
+
+    /**
+     * @brief 切换为协程模式：每个连接是 Reactor 上的一个 Task，需在 Start 之前调用
+     *
+     * @param reactorNum        Reactor 线程数
+     * @param offloadProcess    请求处理是否交给 CPU 线程池(处理逻辑较重时开启)
+     */
+    void SetCoroutineMode(int reactorNum, bool offloadProcess = false);
+
 private:
     bool InitSocket_(); 
     void InitEventMode_(int trigMode);
@@ -34,12 +76,19 @@ private:
     void DealRead_(HttpConn* client);
 
     void SendError_(int fd, const char*info);
+    void SendBusy_(int fd);
+    void PauseAccept_();
+    void ResumeAccept_();
     void ExtentTime_(HttpConn* client);
     void CloseConn_(HttpConn* client);
+    void CloseExpired_();
 
     void OnRead_(HttpConn* client);
-    void OnWrite_(HttpConn* client);
+    void OnWrite_(HttpConn* client, bool inLoop = false);
     void OnProcess(HttpConn* client);
+    void QueueFlush_(HttpConn* client);
+    void FlushPending_();
+    amot::Reactor::ConnTask ServeConn_(HttpConn* client);
 
     static const int MAX_FD = 65536;
 
@@ -49,14 +98,33 @@ private:
     bool openLinger_;
     int timeoutMS_;  /* 毫秒MS */
     bool isClose_;
+    bool acceptPaused_;
     int listenFd_;
     char* srcDir_;
     
     uint32_t listenEvent_;
     uint32_t connEvent_;
+    amot::FlushPolicy flushPolicy_;
+    /* END_OF_LOOP/CORK: 有待写响应的连接，事件循环每轮结束时统一写出 */
+    int flushEventFd_;
+    std::mutex flushMtx_;
+    std::vector<HttpConn*> flushList_;
+    std::vector<HttpConn*> flushing_;
    
-    std::unique_ptr<HeapTimer> timer_;
+    std::unique_ptr<amot::TimingWheel> timer_;
+    std::vector<int> expired_;
     std::unique_ptr<ThreadPool> threadpool_;
     std::unique_ptr<Epoller> epoller_;
+    std::unique_ptr<amot::FileCache> fileCache_;
+    std::unique_ptr<amot::HttpMetrics> metrics_;
+    std::unique_ptr<amot::AdmissionController> admission_;
+    std::atomic<size_t> pendingTasks_;  /* 已投递线程池但尚未开始执行的任务数 */
     std::unordered_map<int, HttpConn> users_;
+
+    /* 协程模式 */
+    bool coroutineMode_;
+    bool offloadProcess_;
+    size_t nextReactor_;
+    std::vector<std::unique_ptr<amot::Reactor>> reactors_;
+    std::unique_ptr<amot::ThreadPool> cpuPool_;
 };
\ No newline at end of file
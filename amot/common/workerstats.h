@@ -0,0 +1,153 @@
+/**
+ * @file workerstats.h
+ * @brief 执行器工作线程的运行统计：计数、忙闲时间、排队与运行耗时直方图
+ * @version 0.1
+ * @date 2024-05-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "histogram.h"
+
+namespace amot {
+
+/**
+ * @brief 某一时刻的统计快照，可累加多个线程的结果
+ */
+struct ExecutorStats {
+    uint64_t executed = 0;       // 已执行任务数
+    uint64_t stealAttempts = 0;  // 窃取尝试次数(每探测一个受害者计一次)
+    uint64_t stealHits = 0;
+    uint64_t parks = 0;          // 进入睡眠次数
+    uint64_t unparks = 0;        // 从睡眠中醒来次数
+    uint64_t busyNs = 0;         // 任务运行总时长，需开启计时
+    uint64_t idleNs = 0;         // 睡眠总时长，需开启计时
+
+    ExecutorStats &operator+=(const ExecutorStats &other) {
+        executed += other.executed;
+        stealAttempts += other.stealAttempts;
+        stealHits += other.stealHits;
+        parks += other.parks;
+        unparks += other.unparks;
+        busyNs += other.busyNs;
+        idleNs += other.idleNs;
+        return *this;
+    }
+};
+
+/**
+ * @brief 单个工作线程的统计
+ * @details 只由所属线程写入，计数用 relaxed 的 load + store 累加，不产生原子
+ *          读改写；其它线程随时可读快照，不与写入方竞争锁。
+ *          计时(忙闲时长与直方图，单位纳秒)默认关闭，开启后每个任务多两次取时。
+ */
+class alignas(64) WorkerStats {
+public:
+    explicit WorkerStats(bool timings = false) {
+        if (timings) {
+            _wait = std::make_unique<Histogram>();
+            _run = std::make_unique<Histogram>();
+        }
+    }
+
+    WorkerStats(const WorkerStats &) = delete;
+    WorkerStats &operator=(const WorkerStats &) = delete;
+
+    bool timings() const { return _run != nullptr; }
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // 开启计时时返回当前时间，否则为 0，用于给任务打入队时间戳
+    int64_t stamp() const { return timings() ? nowNs() : 0; }
+
+    /**
+     * @brief 任务执行完毕后调用
+     * @param enqueueNs 	入队时间戳，0 表示不记录排队耗时
+     * @param startNs 		开始执行的时间戳，取自 stamp()
+     */
+    void onRun(int64_t enqueueNs, int64_t startNs) {
+        add(_executed, 1);
+        if (!_run)
+            return;
+        int64_t end = nowNs();
+        if (enqueueNs > 0 && startNs > enqueueNs)
+            _wait->Record(startNs - enqueueNs);
+        _run->Record(end - startNs);
+        add(_busyNs, end - startNs);
+    }
+
+    // 只记录排队耗时，用于定时任务的延迟执行等场景
+    void onWait(uint64_t waitNs) {
+        if (_wait)
+            _wait->Record(waitNs);
+    }
+
+    void onSteal(bool hit) {
+        add(_stealAttempts, 1);
+        if (hit)
+            add(_stealHits, 1);
+    }
+
+    // 返回 stamp()，醒来时交给 onUnpark
+    int64_t onPark() {
+        add(_parks, 1);
+        return stamp();
+    }
+
+    void onUnpark(int64_t parkNs) {
+        add(_unparks, 1);
+        if (parkNs > 0)
+            add(_idleNs, nowNs() - parkNs);
+    }
+
+    ExecutorStats snapshot() const {
+        ExecutorStats stats;
+        stats.executed = _executed.load(std::memory_order_relaxed);
+        stats.stealAttempts = _stealAttempts.load(std::memory_order_relaxed);
+        stats.stealHits = _stealHits.load(std::memory_order_relaxed);
+        stats.parks = _parks.load(std::memory_order_relaxed);
+        stats.unparks = _unparks.load(std::memory_order_relaxed);
+        stats.busyNs = _busyNs.load(std::memory_order_relaxed);
+        stats.idleNs = _idleNs.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // 直方图合并到 out，未开启计时时不做任何事
+    void mergeWaitTime(Histogram &out) const {
+        if (_wait)
+            out.Merge(*_wait);
+    }
+
+    void mergeRunTime(Histogram &out) const {
+        if (_run)
+            out.Merge(*_run);
+    }
+
+private:
+    static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> _executed{0};
+    std::atomic<uint64_t> _stealAttempts{0};
+    std::atomic<uint64_t> _stealHits{0};
+    std::atomic<uint64_t> _parks{0};
+    std::atomic<uint64_t> _unparks{0};
+    std::atomic<uint64_t> _busyNs{0};
+    std::atomic<uint64_t> _idleNs{0};
+    std::unique_ptr<Histogram> _wait;
+    std::unique_ptr<Histogram> _run;
+};
+
+}  // namespace amot
@@ -0,0 +1,139 @@
+/**
+ * @file workstealdeque.h
+ * @brief Chase-Lev 无锁工作窃取双端队列
+ * @version 0.1
+ * @date 2024-04-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace amot {
+
+/**
+ * @brief 所有者在底部 push/pop(LIFO)，窃取者从顶部 steal(FIFO)
+ * @details 按 Lê 等人 "Correct and Efficient Work-Stealing for Weak Memory Models"
+ *          实现。容量不足时由所有者扩容，旧数组保留到析构，窃取者无需回收协议。
+ *          T 需可平凡复制，一般存放指针。
+ */
+template <typename T>
+class WorkStealDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealDeque stores trivially copyable T");
+
+public:
+    explicit WorkStealDeque(int64_t capacity = 256) {
+        int64_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        _arrays.emplace_back(new Array(cap));
+        _array.store(_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealDeque(const WorkStealDeque &) = delete;
+    WorkStealDeque &operator=(const WorkStealDeque &) = delete;
+
+    /**
+     * @brief 仅所有者线程调用
+     */
+    void push(T item) {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        Array *a = _array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1)
+            a = grow(a, b, t);
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 仅所有者线程调用，取最近 push 的元素
+     */
+    bool pop(T &item) {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = _array.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        if (t > b) {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = a->get(b);
+        if (t == b) {
+            // 只剩最后一个，与窃取者竞争
+            bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 任意线程调用，取最早 push 的元素；队列为空或竞争失败时返回 false
+     */
+    bool steal(T &item) {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        Array *a = _array.load(std::memory_order_acquire);
+        T value = a->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+            return false;
+        item = value;
+        return true;
+    }
+
+    /**
+     * @brief 近似值，仅用于判断是否有活可偷和统计
+     */
+    size_t size() const {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Array {
+        explicit Array(int64_t cap)
+            : capacity(cap), mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T v) { slots[i & mask].store(v, std::memory_order_relaxed); }
+
+        const int64_t capacity;
+        const int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Array *grow(Array *old, int64_t b, int64_t t) {
+        _arrays.emplace_back(new Array(old->capacity * 2));
+        Array *a = _arrays.back().get();
+        for (int64_t i = t; i < b; i++)
+            a->put(i, old->get(i));
+        _array.store(a, std::memory_order_release);
+        return a;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    alignas(kCacheLine) std::atomic<int64_t> _top{0};
+    alignas(kCacheLine) std::atomic<int64_t> _bottom{0};
+    alignas(kCacheLine) std::atomic<Array *> _array{nullptr};
+    std::vector<std::unique_ptr<Array>> _arrays;  // 所有者私有，含已淘汰的旧数组
+};
+
+}  // namespace amot
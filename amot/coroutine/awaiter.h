@@ -6,6 +6,7 @@
 #include "executor.h"
 #include "result.h"
 #include "scheduler.h"
+#include "trace.h"
 
 namespace amot {
 
@@ -28,6 +29,7 @@ struct Awaiter {
 	void await_suspend(std::coroutine_handle<> handle) {
 		// 记录当前协程的 handle，方便后续恢复
 		this->_handle = handle;
+		AMOT_TRACE(suspend, trace_id(handle), _executor);
 		// 调用 after_suspend，逻辑由子类定义
 		after_suspend();
 	}
@@ -42,24 +44,28 @@ struct Awaiter {
 	void resume(ResultType value) {
 		dispatch([this, value]() {
 			_result = Result<ResultType>(static_cast<R>(value));
-			_handle.resume();
+			resume_handle();
 		});
 	}
 
 	void resume_unsafe() {
-		dispatch([this]() { _handle.resume(); });
+		dispatch([this]() { resume_handle(); });
 	}
 
 	void resume_exception(std::exception_ptr &&e) {
 		dispatch([this, e]() {
 			_result = Result<R>(static_cast<std::exception_ptr>(e));
-			_handle.resume();
+			resume_handle();
 		});
 	}
 
 	void install_executor(AbstractExecutor *executor) {
 		_executor = executor;
 	}
+
+	std::coroutine_handle<> handle() const {
+		return _handle;
+	}
 protected:
 	/**
 	 * @brief 虚函数，在子类中实现具体逻辑
@@ -71,6 +77,7 @@ protected:
 private:
 	// 方便用调度器调度任意逻辑
 	void dispatch(std::function<void()> &&f) {
+		AMOT_TRACE(dispatch, trace_id(_handle), _executor);
 		if (_executor) {
 			_executor->execute(std::move(f));
 		} else {
@@ -78,6 +85,11 @@ private:
 		}
 	}
 
+	void resume_handle() {
+		AMOT_TRACE(resume, trace_id(_handle), _executor);
+		_handle.resume();
+	}
+
 protected:
 	std::optional<Result<R>> _result{};
 private:
@@ -93,6 +105,7 @@ struct Awaiter<void> {
 
 	void await_suspend(std::coroutine_handle<> handle) {
 		this->_handle = handle;
+		AMOT_TRACE(suspend, trace_id(handle), _executor);
 		after_suspend();
 	}
 
@@ -104,26 +117,31 @@ struct Awaiter<void> {
 	void resume() {
 		dispatch([this]() {
 			_result = Result<ResultType>();
-			_handle.resume();
+			resume_handle();
 		});
 	}
 
 	void resume_exception(std::exception_ptr &&e) {
 		dispatch([this, e]() {
 			_result = Result<void>(static_cast<std::exception_ptr>(e));
-			_handle.resume();
+			resume_handle();
 		});
 	}
 
 	void install_executor(AbstractExecutor *executor) {
 		_executor = executor;
 	}
+
+	std::coroutine_handle<> handle() const {
+		return _handle;
+	}
 protected:
 	virtual void after_suspend() {}
 
 	virtual void before_resume() {}
 private:
 	void dispatch(std::function<void()> &&f) {
+		AMOT_TRACE(dispatch, trace_id(_handle), _executor);
 		if (_executor) {
 			_executor->execute(std::move(f));
 		} else {
@@ -131,6 +149,11 @@ private:
 		}
 	}
 
+	void resume_handle() {
+		AMOT_TRACE(resume, trace_id(_handle), _executor);
+		_handle.resume();
+	}
+
 protected:
 	std::optional<Result<ResultType>> _result{};
 private:
@@ -175,7 +198,9 @@ struct DispatchAwaiter {
 	bool await_ready() const { return false; }
 
 	void await_suspend(std::coroutine_handle<> handle) const {
-		_executor->execute([handle]() {
+		AMOT_TRACE(dispatch, trace_id(handle), _executor);
+		_executor->execute([handle, executor = _executor]() {
+			AMOT_TRACE(resume, trace_id(handle), executor);
 			handle.resume();
 		});
 	}
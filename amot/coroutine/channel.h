@@ -1,7 +1,6 @@
 #pragma once
 
 #include <coroutine>
-#include <execution>
 #include <list>
 #include <spdlog/spdlog.h>
 
@@ -112,6 +111,7 @@ struct Channel {
 			writer->resume();
 			return;
 		}
+		AMOT_TRACE_LABEL(wait, trace_id(reader_awaiter->handle()), this, "channel read");
 		reader_list.push_back(reader_awaiter);
 	}
 
@@ -136,6 +136,7 @@ struct Channel {
 			return;
 		}
 		// suspend writer
+		AMOT_TRACE_LABEL(wait, trace_id(writer_awaiter->handle()), this, "channel write");
 		writer_list.push_back(writer_awaiter);
 	}
 
@@ -6,6 +6,9 @@
 #include <future>
 #include <spdlog/spdlog.h>
 
+#include "amot/common/priority.h"
+#include "amot/common/workerstats.h"
+
 namespace amot {
 
 class AbstractExecutor {
@@ -36,10 +39,13 @@ public:
 
 /**
  * @brief 循环调度器，协程的恢复位置都在同一线程上
+ * @details 任务按优先级分道，默认加权轮转并防饿死，见 PriorityOptions。
+ *          record_timings 开启后统计排队与运行耗时，见 stats()
  */
 class LooperExecutor : public AbstractExecutor {
 public:
-	LooperExecutor() {
+	explicit LooperExecutor(const PriorityOptions &options = {}, bool record_timings = false)
+		: executable_queue(options), worker_stats(record_timings) {
 		is_active.store(true, std::memory_order_relaxed);
 		work_thread = std::thread(&LooperExecutor::run_loop, this);
 	}
@@ -52,9 +58,13 @@ public:
 	}
 
 	void execute(std::function<void()> &&func) override {
+		execute(std::move(func), Priority::NORMAL);
+	}
+
+	void execute(std::function<void()> &&func, Priority priority) {
 		std::unique_lock lock(queue_lock);
 		if (is_active.load(std::memory_order_relaxed)) {
-			executable_queue.push(func);
+			executable_queue.push(Executable{std::move(func), worker_stats.stamp()}, priority);
 			lock.unlock();
 			// 往队列中加入任务进行通知
 			queue_condition.notify_one();
@@ -65,38 +75,60 @@ public:
 		is_active.store(false, std::memory_order_relaxed);
 		if (!wait_for_complete) {
 			std::unique_lock lock(queue_lock);
-			decltype(executable_queue) empty_queue;
-			std::swap(executable_queue, empty_queue);
+			executable_queue.clear();
 			lock.unlock();
 		}
 		queue_condition.notify_all();
 	}
+
+	// 工作线程之外调用也不会与其竞争
+	ExecutorStats stats() const {
+		return worker_stats.snapshot();
+	}
+
+	void merge_wait_time(Histogram &out) const {
+		worker_stats.mergeWaitTime(out);
+	}
+
+	void merge_run_time(Histogram &out) const {
+		worker_stats.mergeRunTime(out);
+	}
 private:
+	struct Executable {
+		std::function<void()> func;
+		int64_t enqueue_ns;
+	};
+
 	void run_loop() {
 		// 检查当前事件循环是否是工作状态，或者队列没有清空
 		while (is_active.load(std::memory_order_relaxed) || !executable_queue.empty()) {
 			std::unique_lock lock(queue_lock);
 			if (executable_queue.empty()) {
 				// 队列为空时，阻塞等待新任务加入队列或者关闭事件循环的通知
+				int64_t since = worker_stats.onPark();
 				queue_condition.wait(lock);
+				worker_stats.onUnpark(since);
 				if (executable_queue.empty()) {
 					continue;
 				}
 			}
 			// 队列不为空，则先取出任务，解锁后执行
 			// 注意：func 是外部逻辑，不需要锁保护；func 当中可能请求锁，导致死锁
-			auto func = executable_queue.front();
-			executable_queue.pop();
+			Executable executable;
+			executable_queue.pop(executable);
 			lock.unlock();
 
-			func();
+			int64_t start = worker_stats.stamp();
+			executable.func();
+			worker_stats.onRun(executable.enqueue_ns, start);
 		}
 		spdlog::debug("executor run_loop exit.");
 	}
 private:
 	std::condition_variable queue_condition;
 	std::mutex queue_lock;
-	std::queue<std::function<void()>> executable_queue;
+	PriorityLanes<Executable> executable_queue;
+	WorkerStats worker_stats;
 
 	std::atomic<bool> is_active;
 	std::thread work_thread;
@@ -105,8 +137,28 @@ private:
 class SharedLooperExecutor : public AbstractExecutor {
 public:
 	void execute(std::function<void()> &&func) override {
+		instance().execute(std::move(func));
+	}
+
+	static LooperExecutor &instance() {
 		static LooperExecutor sharedLooperExecutor;
-		sharedLooperExecutor.execute(std::move(func));
+		return sharedLooperExecutor;
+	}
+};
+
+/**
+ * @brief 带优先级的调度器句柄，作为 Task 的 Executor 使用
+ * @details 协程启动以及每次 co_await 之后的恢复都以 P 投递到共享的 LooperExecutor，
+ *          例如 Task<int, LatencyExecutor> 的恢复不会排在后台任务后面。
+ */
+template <Priority P>
+class PriorityExecutor : public AbstractExecutor {
+public:
+	void execute(std::function<void()> &&func) override {
+		SharedLooperExecutor::instance().execute(std::move(func), P);
 	}
 };
+
+using LatencyExecutor = PriorityExecutor<Priority::LATENCY>;
+using BatchExecutor = PriorityExecutor<Priority::BATCH>;
 }
\ No newline at end of file
@@ -25,11 +25,16 @@ struct Promise {
 	DispatchAwaiter initial_suspend() { return DispatchAwaiter{&executor}; }
 
 	// 协程结束后挂起，等待外部销毁
-	std::suspend_always final_suspend() noexcept { return {}; }
+	std::suspend_always final_suspend() noexcept {
+		AMOT_TRACE(complete, trace_id(std::coroutine_handle<Promise>::from_promise(*this)), &executor);
+		return {};
+	}
 
 	// 构造协程的返回值对象
 	Task<ResultType, Executor> get_return_object() {
-		return Task{std::coroutine_handle<Promise>::from_promise(*this)};
+		auto handle = std::coroutine_handle<Promise>::from_promise(*this);
+		AMOT_TRACE(create, trace_id(handle), &executor);
+		return Task{handle};
 	}
 
 	template <typename _ResultType, typename _Executor>
@@ -128,11 +133,16 @@ struct Promise<void, Executor> {
 	DispatchAwaiter initial_suspend() { return DispatchAwaiter{&executor}; }
 
 	// 协程结束后挂起，等待外部销毁
-	std::suspend_always final_suspend() noexcept { return {}; }
+	std::suspend_always final_suspend() noexcept {
+		AMOT_TRACE(complete, trace_id(std::coroutine_handle<Promise>::from_promise(*this)), &executor);
+		return {};
+	}
 
 	// 构造协程的返回值对象
 	Task<void, Executor> get_return_object() {
-		return Task{std::coroutine_handle<Promise>::from_promise(*this)};
+		auto handle = std::coroutine_handle<Promise>::from_promise(*this);
+		AMOT_TRACE(create, trace_id(handle), &executor);
+		return Task{handle};
 	}
 
 	template <typename _ResultType, typename _Executor>
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "task.h"
+#include "amot/common/clock.h"
+#include "amot/common/timingwheel.h"
+
+namespace amot {
+
+class Reactor;
+
+/**
+ * @brief 把协程恢复投递到所属 Reactor 的调度器
+ * @details 默认构造时绑定当前线程的 Reactor(协程帧在 Reactor 线程上创建)，
+ *          不在 Reactor 线程上时退化为就地执行。
+ */
+class ReactorExecutor : public AbstractExecutor {
+public:
+	ReactorExecutor();
+
+	explicit ReactorExecutor(Reactor *reactor) : _reactor(reactor) {}
+
+	void execute(std::function<void()> &&func) override;
+
+	Reactor *reactor() const { return _reactor; }
+private:
+	Reactor *_reactor;
+};
+
+/**
+ * @brief 等待 fd 可读/可写
+ * @details co_await 结果为 true 表示就绪，false 表示超时或 fd 已被移除。
+ *          没有协程等待时到达的边沿会被记下，之后的 co_await 直接返回 true，
+ *          不会因为错过边沿而一直等到超时。
+ */
+struct IoAwaiter : public Awaiter<bool> {
+	IoAwaiter(Reactor *reactor, int fd, bool write, int timeout_ms)
+		: _reactor(reactor), _fd(fd), _write(write), _timeout_ms(timeout_ms) {}
+
+	bool await_ready();
+
+	bool await_resume() {
+		return _ready ? true : Awaiter<bool>::await_resume();
+	}
+
+protected:
+	void after_suspend() override;
+
+private:
+	Reactor *_reactor;
+	int _fd;
+	bool _write;
+	int _timeout_ms;
+	bool _ready = false;
+};
+
+/**
+ * @brief 线程池已停止、不再接受任务时，co_await offload 抛出此异常
+ */
+struct OffloadRejectedException : std::exception {
+	const char *what() const noexcept override {
+		return "offload: thread pool has stopped.";
+	}
+};
+
+/**
+ * @brief 把 CPU 密集的计算交给线程池，完成后回到协程自己的调度器继续
+ *
+ * @tparam Pool 需提供 scheduleById(std::function<void()>)，接受时返回 Pool::ERROR_NONE，
+ *              如 amot::ThreadPool
+ */
+template <typename R, typename Pool>
+struct OffloadAwaiter : public Awaiter<R> {
+	OffloadAwaiter(Pool *pool, std::function<R()> &&func)
+		: _pool(pool), _func(std::move(func)) {}
+
+protected:
+	void after_suspend() override {
+		auto ret = _pool->scheduleById([this]() {
+			try {
+				this->resume(_func());
+			} catch (...) {
+				this->resume_exception(std::current_exception());
+			}
+		});
+		// 任务没被接受就不会有人恢复协程
+		if (ret != Pool::ERROR_NONE) {
+			this->resume_exception(std::make_exception_ptr(OffloadRejectedException()));
+		}
+	}
+
+private:
+	Pool *_pool;
+	std::function<R()> _func;
+};
+
+template <typename Pool>
+struct OffloadAwaiter<void, Pool> : public Awaiter<void> {
+	OffloadAwaiter(Pool *pool, std::function<void()> &&func)
+		: _pool(pool), _func(std::move(func)) {}
+
+protected:
+	void after_suspend() override {
+		auto ret = _pool->scheduleById([this]() {
+			try {
+				_func();
+				this->resume();
+			} catch (...) {
+				this->resume_exception(std::current_exception());
+			}
+		});
+		if (ret != Pool::ERROR_NONE) {
+			this->resume_exception(std::make_exception_ptr(OffloadRejectedException()));
+		}
+	}
+
+private:
+	Pool *_pool;
+	std::function<void()> _func;
+};
+
+template <typename Pool, typename Fn>
+auto offload(Pool &pool, Fn &&func) {
+	using R = std::invoke_result_t<Fn>;
+	return OffloadAwaiter<R, Pool>(&pool, std::function<R()>(std::forward<Fn>(func)));
+}
+
+/**
+ * @brief 单线程事件循环：epoll 驱动的 IO 等待 + 协程就绪队列
+ * @details 每个连接是一个 Task<void, ReactorExecutor>，读、解析、处理、写都在同一个
+ *          Reactor 线程上顺序执行，不再为每个事件投递线程池任务，也不需要 EPOLLONESHOT
+ *          重新注册。fd 以边沿触发注册一次，syscall 返回 EAGAIN 后再 co_await 等待。
+ */
+class Reactor {
+public:
+	using ConnTask = Task<void, ReactorExecutor>;
+
+	/**
+	 * @param max_fd 		可管理的最大 fd(用于读超时的时间轮)
+	 */
+	explicit Reactor(size_t max_fd = 65536, int max_events = 1024)
+		: _epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+		  _wakeup_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+		  _events(max_events), _max_fd(max_fd) {
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = _wakeup_fd;
+		epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wakeup_fd, &ev);
+	}
+
+	Reactor(Reactor &) = delete;
+	Reactor &operator=(Reactor &) = delete;
+
+	~Reactor() {
+		stop();
+		join();
+		// 先销毁挂起的协程帧，再关闭 fd
+		_tasks.clear();
+		close(_wakeup_fd);
+		close(_epoll_fd);
+	}
+
+	/**
+	 * @brief 当前线程正在运行的 Reactor
+	 */
+	static Reactor *current() { return current_ref(); }
+
+	/**
+	 * @brief 投递任务，任意线程可调用
+	 */
+	void execute(std::function<void()> &&func) {
+		if (current() == this) {
+			_local.push_back(std::move(func));
+			return;
+		}
+		if (_remote_hook && _remote_hook(func)) {
+			return;
+		}
+		bool need_wakeup;
+		{
+			std::lock_guard lock(_remote_lock);
+			need_wakeup = _remote.empty();
+			_remote.push_back(std::move(func));
+		}
+		if (need_wakeup) {
+			wakeup();
+		}
+	}
+
+	/**
+	 * @brief 唤醒阻塞在 epoll_wait 上的事件循环
+	 */
+	void wakeup() {
+		uint64_t one = 1;
+		ssize_t n = ::write(_wakeup_fd, &one, sizeof(one));
+		(void)n;
+	}
+
+	/**
+	 * @brief 接入外部消息通道，需在 run 之前设置
+	 *
+	 * @param poll 			每轮循环开始时调用，用于收取外部消息
+	 * @param before_sleep 	即将阻塞等待前调用，返回 true 表示又有消息到达、本轮不阻塞
+	 */
+	void set_poll_hooks(std::function<bool()> &&poll, std::function<bool()> &&before_sleep) {
+		_poll_hook = std::move(poll);
+		_sleep_hook = std::move(before_sleep);
+	}
+
+	/**
+	 * @brief 其他线程 execute 时优先交给 hook 投递，hook 返回 false 时走默认的加锁队列
+	 */
+	void set_remote_hook(std::function<bool(std::function<void()> &)> &&hook) {
+		_remote_hook = std::move(hook);
+	}
+
+	/**
+	 * @brief 在 Reactor 线程上创建并托管一个协程，协程结束后自动销毁
+	 */
+	void spawn(std::function<ConnTask()> &&make_task) {
+		execute([this, make_task = std::move(make_task)]() {
+			auto it = _tasks.insert(_tasks.end(), make_task());
+			it->finally([this, it]() {
+				// 此时协程尚未到达 final_suspend，延后到下一轮再销毁
+				_local.push_back([this, it]() { _tasks.erase(it); });
+			});
+		});
+	}
+
+	/**
+	 * @brief 以边沿触发注册 fd，只需注册一次
+	 */
+	bool add_fd(int fd) {
+		if (fd < 0) return false;
+		if (static_cast<size_t>(fd) >= _states.size()) _states.resize(fd + 1);
+		_states[fd] = IoState();
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		ev.data.fd = fd;
+		return epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+	}
+
+	/**
+	 * @brief 注销 fd，仍在等待的协程收到 false
+	 */
+	void remove_fd(int fd) {
+		epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+		if (static_cast<size_t>(fd) >= _states.size()) return;
+		IoState &state = _states[fd];
+		state.read_ready = state.write_ready = false;
+		if (_wheel) _wheel->Remove(fd);
+		if (auto reader = std::exchange(state.reader, nullptr)) reader->resume(false);
+		if (auto writer = std::exchange(state.writer, nullptr)) writer->resume(false);
+	}
+
+	/**
+	 * @brief 等待可读，timeout_ms > 0 时超时返回 false
+	 * @details 同一 Reactor 上的读超时共用一个时间轮，超时时长以第一次使用的为准
+	 */
+	IoAwaiter readable(int fd, int timeout_ms = 0) {
+		return IoAwaiter(this, fd, false, timeout_ms);
+	}
+
+	IoAwaiter writable(int fd) {
+		return IoAwaiter(this, fd, true, 0);
+	}
+
+	/**
+	 * @brief 在当前线程运行事件循环直到 stop()
+	 */
+	void run() {
+		current_ref() = this;
+		LoopClock::Update();
+		while (_running.load(std::memory_order_relaxed)) {
+			if (_poll_hook) _poll_hook();
+			run_ready();
+			int timeout = -1;
+			if (!_local.empty()) {
+				timeout = 0;
+			} else if (_wheel) {
+				// 就绪任务可能运行了较长时间，这里不用缓存
+				timeout = _wheel->GetNextTick(MonotonicMs());
+			}
+			if (timeout != 0 && _sleep_hook && _sleep_hook()) {
+				timeout = 0;
+			}
+			int n = epoll_wait(_epoll_fd, _events.data(), static_cast<int>(_events.size()), timeout);
+			// 本轮之后的超时登记与到期检查都使用这个时间
+			uint64_t now = LoopClock::Update();
+			for (int i = 0; i < n; i++) {
+				int fd = _events[i].data.fd;
+				if (fd == _wakeup_fd) {
+					uint64_t cnt;
+					ssize_t r = ::read(_wakeup_fd, &cnt, sizeof(cnt));
+					(void)r;
+					continue;
+				}
+				dispatch(fd, _events[i].events);
+			}
+			if (_wheel) {
+				_expired.clear();
+				_wheel->Tick(now, _expired);
+				for (int fd : _expired) {
+					if (auto reader = std::exchange(_states[fd].reader, nullptr)) reader->resume(false);
+				}
+			}
+		}
+		run_ready();
+		current_ref() = nullptr;
+	}
+
+	/**
+	 * @brief 在新线程中运行事件循环
+	 */
+	void start() {
+		_thread = std::thread([this]() { run(); });
+	}
+
+	void stop() {
+		_running.store(false, std::memory_order_relaxed);
+		wakeup();
+	}
+
+	void join() {
+		if (_thread.joinable()) _thread.join();
+	}
+
+	/**
+	 * @brief 托管中的协程数(仅 Reactor 线程上调用)
+	 */
+	size_t task_count() const { return _tasks.size(); }
+
+private:
+	friend struct IoAwaiter;
+
+	struct IoState {
+		IoAwaiter *reader = nullptr;
+		IoAwaiter *writer = nullptr;
+		// 边沿触发下，没有等待者时到达的事件记在这里，由下一次等待取走
+		bool read_ready = false;
+		bool write_ready = false;
+	};
+
+	static Reactor *&current_ref() {
+		static thread_local Reactor *reactor = nullptr;
+		return reactor;
+	}
+
+	void run_ready() {
+		{
+			std::lock_guard lock(_remote_lock);
+			while (!_remote.empty()) {
+				_local.push_back(std::move(_remote.front()));
+				_remote.pop_front();
+			}
+		}
+		// 只运行本轮开始时已就绪的任务，新投递的留到下一轮，避免饿死 IO
+		size_t n = _local.size();
+		for (size_t i = 0; i < n && !_local.empty(); i++) {
+			auto func = std::move(_local.front());
+			_local.pop_front();
+			func();
+		}
+	}
+
+	void dispatch(int fd, uint32_t events) {
+		if (static_cast<size_t>(fd) >= _states.size()) return;
+		IoState &state = _states[fd];
+		if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+			if (state.reader) {
+				if (_wheel) _wheel->Remove(fd);
+				std::exchange(state.reader, nullptr)->resume(true);
+			} else {
+				state.read_ready = true;
+			}
+		}
+		if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+			if (state.writer) {
+				std::exchange(state.writer, nullptr)->resume(true);
+			} else {
+				state.write_ready = true;
+			}
+		}
+	}
+
+	/**
+	 * @brief 取走并清除记下的就绪事件
+	 */
+	bool take_ready(int fd, bool write) {
+		if (fd < 0 || static_cast<size_t>(fd) >= _states.size()) return false;
+		IoState &state = _states[fd];
+		return std::exchange(write ? state.write_ready : state.read_ready, false);
+	}
+
+	void park(IoAwaiter *awaiter, int fd, bool write, int timeout_ms) {
+		if (static_cast<size_t>(fd) >= _states.size()) _states.resize(fd + 1);
+		IoState &state = _states[fd];
+		if (write) {
+			state.writer = awaiter;
+			return;
+		}
+		state.reader = awaiter;
+		if (timeout_ms > 0 && static_cast<size_t>(fd) < _max_fd) {
+			if (!_wheel) _wheel = std::make_unique<TimingWheel>(_max_fd, timeout_ms);
+			_wheel->Add(fd, LoopClock::NowMs());
+		}
+	}
+
+private:
+	int _epoll_fd;
+	int _wakeup_fd;
+	std::vector<struct epoll_event> _events;
+	std::vector<IoState> _states;
+	size_t _max_fd;
+	std::unique_ptr<TimingWheel> _wheel;	// 读超时，首次使用时按该超时创建
+	std::vector<int> _expired;
+
+	std::deque<std::function<void()>> _local;		// 仅 Reactor 线程访问
+	std::mutex _remote_lock;
+	std::deque<std::function<void()>> _remote;		// 其他线程投递的任务
+
+	std::function<bool()> _poll_hook;
+	std::function<bool()> _sleep_hook;
+	std::function<bool(std::function<void()> &)> _remote_hook;
+
+	std::list<ConnTask> _tasks;
+	std::atomic<bool> _running{true};
+	std::thread _thread;
+};
+
+inline ReactorExecutor::ReactorExecutor() : _reactor(Reactor::current()) {}
+
+inline void ReactorExecutor::execute(std::function<void()> &&func) {
+	if (_reactor) {
+		_reactor->execute(std::move(func));
+	} else {
+		func();
+	}
+}
+
+inline bool IoAwaiter::await_ready() {
+	_ready = _reactor->take_ready(_fd, _write);
+	return _ready;
+}
+
+inline void IoAwaiter::after_suspend() {
+	_reactor->park(this, _fd, _write, _timeout_ms);
+}
+} // namespace amot
@@ -0,0 +1,552 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include "awaiter.h"
+#include "amot/common/histogram.h"
+
+namespace amot {
+
+template <typename T>
+class ResourcePool;
+
+template <typename T>
+struct AcquireAwaiter;
+
+/**
+ * @brief 资源池配置
+ */
+struct ResourcePoolOptions {
+	size_t min_size = 0;								// 常驻资源数，maintain() 时补齐
+	size_t max_size = 8;								// 资源总数上限(含借出)
+	std::chrono::milliseconds idle_timeout{60000};		// 空闲超过该时间且总数大于 min_size 时回收
+	std::chrono::milliseconds validate_after{1000};		// 空闲超过该时间的资源借出前先做健康检查
+};
+
+/**
+ * @brief 资源池统计快照，等待时间单位为微秒
+ */
+struct ResourcePoolStats {
+	size_t total = 0;
+	size_t idle = 0;
+	size_t waiting = 0;
+	uint64_t acquired = 0;
+	uint64_t waited = 0;				// 需要挂起等待的借出次数
+	uint64_t created = 0;
+	uint64_t destroyed = 0;
+	uint64_t health_check_failed = 0;
+	double wait_mean_us = 0;
+	uint64_t wait_p99_us = 0;
+	uint64_t wait_max_us = 0;
+};
+
+/**
+ * @brief 池中资源的借用凭证，析构时自动归还
+ */
+template <typename T>
+class Lease {
+public:
+	Lease() = default;
+
+	Lease(Lease &&other) noexcept
+		: _pool(std::exchange(other._pool, nullptr)),
+		  _slot(std::exchange(other._slot, nullptr)),
+		  _broken(other._broken) {}
+
+	Lease &operator=(Lease &&other) noexcept {
+		if (this != &other) {
+			release();
+			_pool = std::exchange(other._pool, nullptr);
+			_slot = std::exchange(other._slot, nullptr);
+			_broken = other._broken;
+		}
+		return *this;
+	}
+
+	Lease(Lease &) = delete;
+	Lease &operator=(Lease &) = delete;
+
+	~Lease() { release(); }
+
+	T *get() const { return _slot ? _slot->resource.get() : nullptr; }
+	T *operator->() const { return get(); }
+	T &operator*() const { return *get(); }
+	explicit operator bool() const { return _slot != nullptr; }
+
+	/**
+	 * @brief 标记资源已损坏，归还时销毁而不是放回池中
+	 */
+	void invalidate() { _broken = true; }
+
+	/**
+	 * @brief 提前归还
+	 */
+	void release() {
+		if (_slot) {
+			_pool->give_back(std::exchange(_slot, nullptr), _broken);
+			_pool = nullptr;
+			_broken = false;
+		}
+	}
+
+private:
+	friend struct AcquireAwaiter<T>;
+
+	using Slot = typename ResourcePool<T>::Slot;
+
+	Lease(ResourcePool<T> *pool, Slot *slot) : _pool(pool), _slot(slot) {}
+
+	ResourcePool<T> *_pool = nullptr;
+	Slot *_slot = nullptr;
+	bool _broken = false;
+};
+
+/**
+ * @brief co_await pool.acquire() 的等待体
+ * @details 有空闲资源或还能新建时不挂起；否则挂起进入等待队列，由归还资源的
+ *          一方直接把资源交给它并通过协程自己的调度器恢复，等待期间不占用线程。
+ */
+template <typename T>
+struct AcquireAwaiter : public Awaiter<typename ResourcePool<T>::Slot *> {
+	using Slot = typename ResourcePool<T>::Slot;
+	using Clock = std::chrono::steady_clock;
+
+	explicit AcquireAwaiter(ResourcePool<T> *pool) : _pool(pool) {}
+
+	AcquireAwaiter(AcquireAwaiter &&other) noexcept
+		: Awaiter<Slot *>(other),
+		  _pool(other._pool),
+		  _slot(std::exchange(other._slot, nullptr)),
+		  _wait_start(other._wait_start) {}
+
+	~AcquireAwaiter() {
+		if (_queued) _pool->remove_waiter(this);
+	}
+
+	bool await_ready() {
+		_slot = _pool->try_take();
+		return _slot != nullptr;
+	}
+
+	Lease<T> await_resume() {
+		if (!_slot) {
+			_slot = Awaiter<Slot *>::await_resume();
+		}
+		return Lease<T>(_pool, std::exchange(_slot, nullptr));
+	}
+
+protected:
+	void after_suspend() override {
+		_wait_start = Clock::now();
+		_pool->push_waiter(this);
+	}
+
+private:
+	friend class ResourcePool<T>;
+
+	ResourcePool<T> *_pool;
+	Slot *_slot = nullptr;
+	bool _queued = false;				// 受池的锁保护
+	Clock::time_point _wait_start{};
+};
+
+/**
+ * @brief 协程友好的通用资源池(数据库连接等)
+ *
+ * @tparam T 资源类型，由 factory 创建，池负责其生命周期
+ *
+ * 用法:
+ *   ResourcePool<Conn> pool(opts, [] { return std::make_unique<Conn>(...); },
+ *                           [](Conn &c) { return c.ping(); });
+ *   auto conn = co_await pool.acquire();
+ *   conn->query(...);
+ *
+ * 借出的 Lease 必须在池析构前归还。
+ */
+template <typename T>
+class ResourcePool {
+public:
+	using Factory = std::function<std::unique_ptr<T>()>;
+	using HealthCheck = std::function<bool(T &)>;
+	using Clock = std::chrono::steady_clock;
+
+	struct PoolClosedException : std::exception {
+		const char *what() const noexcept override {
+			return "ResourcePool is closed.";
+		}
+	};
+
+	struct CreateFailedException : std::runtime_error {
+		CreateFailedException() : std::runtime_error("ResourcePool failed to create resource.") {}
+	};
+
+	ResourcePool(ResourcePoolOptions options, Factory factory, HealthCheck health_check = nullptr)
+		: _options(options), _factory(std::move(factory)), _health_check(std::move(health_check)) {
+		if (_options.max_size == 0) _options.max_size = 1;
+		_options.min_size = std::min(_options.min_size, _options.max_size);
+	}
+
+	ResourcePool(ResourcePool &) = delete;
+	ResourcePool &operator=(ResourcePool &) = delete;
+
+	~ResourcePool() {
+		close();
+	}
+
+	auto acquire() {
+		if (_closed.load(std::memory_order_relaxed)) {
+			throw PoolClosedException();
+		}
+		return AcquireAwaiter<T>(this);
+	}
+
+	/**
+	 * @brief 周期维护：回收超时空闲资源，补齐到 min_size
+	 */
+	void maintain() {
+		std::list<Slot> evicted;
+		auto now = Clock::now();
+		{
+			std::lock_guard lock(_lock);
+			// 最久未用的在队首
+			while (!_idle.empty() && _total > _options.min_size
+					&& now - _idle.front()->last_used >= _options.idle_timeout) {
+				evicted.splice(evicted.end(), _slots, _idle.front());
+				_idle.pop_front();
+				_total--;
+			}
+		}
+		_destroyed.fetch_add(evicted.size(), std::memory_order_relaxed);
+		evicted.clear();
+
+		while (!_closed.load(std::memory_order_relaxed)) {
+			{
+				std::lock_guard lock(_lock);
+				if (_total >= _options.min_size) break;
+				_total++;
+			}
+			auto resource = create();
+			if (!resource) {
+				std::lock_guard lock(_lock);
+				_total--;
+				break;
+			}
+			put_new(std::move(resource));
+		}
+	}
+
+	/**
+	 * @brief 关闭池：等待者收到 PoolClosedException，空闲资源立即销毁，借出的归还时销毁
+	 */
+	void close() {
+		bool expect = false;
+		if (!_closed.compare_exchange_strong(expect, true, std::memory_order_relaxed)) {
+			return;
+		}
+		std::list<Slot> idle;
+		std::deque<AcquireAwaiter<T> *> waiters;
+		{
+			std::lock_guard lock(_lock);
+			for (auto it : _idle) {
+				idle.splice(idle.end(), _slots, it);
+			}
+			_total -= _idle.size();
+			_idle.clear();
+			for (auto w : _waiters) w->_queued = false;
+			waiters.swap(_waiters);
+		}
+		_destroyed.fetch_add(idle.size(), std::memory_order_relaxed);
+		for (auto waiter : waiters) {
+			waiter->resume_exception(std::make_exception_ptr(PoolClosedException()));
+		}
+	}
+
+	ResourcePoolStats stats() const {
+		ResourcePoolStats s;
+		{
+			std::lock_guard lock(_lock);
+			s.total = _total;
+			s.idle = _idle.size();
+			s.waiting = _waiters.size();
+		}
+		s.acquired = _wait_us.Count();
+		s.waited = _waited.load(std::memory_order_relaxed);
+		s.created = _created.load(std::memory_order_relaxed);
+		s.destroyed = _destroyed.load(std::memory_order_relaxed);
+		s.health_check_failed = _health_failed.load(std::memory_order_relaxed);
+		s.wait_mean_us = _wait_us.Mean();
+		s.wait_p99_us = _wait_us.Percentile(99);
+		s.wait_max_us = _wait_us.Max();
+		return s;
+	}
+
+	/**
+	 * @brief 借出等待时间分布(微秒)，不需要等待的借出记为 0
+	 */
+	const Histogram &wait_histogram() const { return _wait_us; }
+
+	const ResourcePoolOptions &options() const { return _options; }
+
+private:
+	friend class Lease<T>;
+	friend struct AcquireAwaiter<T>;
+
+	struct Slot {
+		std::unique_ptr<T> resource;
+		Clock::time_point last_used;
+		typename std::list<Slot>::iterator self;
+	};
+
+	using SlotIter = typename std::list<Slot>::iterator;
+
+	std::unique_ptr<T> create() {
+		std::unique_ptr<T> resource;
+		try {
+			resource = _factory();
+		} catch (...) {
+			resource = nullptr;
+		}
+		if (resource) _created.fetch_add(1, std::memory_order_relaxed);
+		return resource;
+	}
+
+	/**
+	 * @brief 新建的资源入池(已计入 _total)，有等待者时直接交给它
+	 */
+	void put_new(std::unique_ptr<T> resource) {
+		std::unique_lock lock(_lock);
+		auto it = _slots.insert(_slots.end(), Slot{std::move(resource), Clock::now(), {}});
+		it->self = it;
+		hand_over(lock, &*it);
+	}
+
+	/**
+	 * @brief 把资源交给第一个等待者，没有则放入空闲队列；调用时持有锁
+	 */
+	void hand_over(std::unique_lock<std::mutex> &lock, Slot *slot) {
+		if (_closed.load(std::memory_order_relaxed)) {
+			std::list<Slot> dead;
+			dead.splice(dead.end(), _slots, slot->self);
+			_total--;
+			lock.unlock();
+			_destroyed.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (_waiters.empty()) {
+			slot->last_used = Clock::now();
+			_idle.push_back(slot->self);
+			return;
+		}
+		auto waiter = _waiters.front();
+		_waiters.pop_front();
+		waiter->_queued = false;
+		lock.unlock();
+		auto waited = Clock::now() - waiter->_wait_start;
+		_wait_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(waited).count());
+		_waited.fetch_add(1, std::memory_order_relaxed);
+		waiter->resume(slot);
+	}
+
+	/**
+	 * @brief 不挂起地取得资源：空闲的优先(最近用过的)，其次在上限内新建
+	 *
+	 * @return Slot* 为空表示需要等待
+	 */
+	Slot *try_take() {
+		while (true) {
+			std::unique_lock lock(_lock);
+			if (_closed.load(std::memory_order_relaxed)) {
+				throw PoolClosedException();
+			}
+			if (!_idle.empty()) {
+				SlotIter it = _idle.back();
+				_idle.pop_back();
+				lock.unlock();
+				if (!validate(*it)) {
+					discard(&*it);
+					continue;
+				}
+				_wait_us.Record(0);
+				return &*it;
+			}
+			// 有人在排队时不插队新建，保证先来先得
+			if (_total >= _options.max_size || !_waiters.empty()) {
+				return nullptr;
+			}
+			_total++;
+			lock.unlock();
+
+			auto resource = create();
+			if (!resource) {
+				release_reservation();
+				throw CreateFailedException();
+			}
+			lock.lock();
+			auto it = _slots.insert(_slots.end(), Slot{std::move(resource), Clock::now(), {}});
+			it->self = it;
+			lock.unlock();
+			_wait_us.Record(0);
+			return &*it;
+		}
+	}
+
+	/**
+	 * @brief 空闲较久的资源借出前做健康检查
+	 */
+	bool validate(Slot &slot) {
+		if (!_health_check || Clock::now() - slot.last_used < _options.validate_after) {
+			return true;
+		}
+		bool ok = false;
+		try {
+			ok = _health_check(*slot.resource);
+		} catch (...) {
+			ok = false;
+		}
+		if (!ok) _health_failed.fetch_add(1, std::memory_order_relaxed);
+		return ok;
+	}
+
+	/**
+	 * @brief 销毁一个借出状态的资源
+	 */
+	void discard(Slot *slot) {
+		std::list<Slot> dead;
+		{
+			std::lock_guard lock(_lock);
+			dead.splice(dead.end(), _slots, slot->self);
+		}
+		_destroyed.fetch_add(1, std::memory_order_relaxed);
+		dead.clear();
+		release_reservation();
+	}
+
+	/**
+	 * @brief 名额空出：有等待者时为其新建一个资源
+	 */
+	void release_reservation() {
+		{
+			std::lock_guard lock(_lock);
+			if (_waiters.empty() || _closed.load(std::memory_order_relaxed)) {
+				_total--;
+				return;
+			}
+			// 名额直接转给等待者，_total 不变
+		}
+		auto resource = create();
+		if (resource) {
+			put_new(std::move(resource));
+		} else {
+			fail_reservation();
+		}
+	}
+
+	/**
+	 * @brief 为等待者新建资源失败：归还名额，队首等待者收到 CreateFailedException
+	 */
+	void fail_reservation() {
+		AcquireAwaiter<T> *waiter = nullptr;
+		{
+			std::lock_guard lock(_lock);
+			_total--;
+			if (!_waiters.empty()) {
+				waiter = _waiters.front();
+				_waiters.pop_front();
+				waiter->_queued = false;
+			}
+		}
+		if (waiter) {
+			waiter->resume_exception(std::make_exception_ptr(CreateFailedException()));
+		}
+	}
+
+	void give_back(Slot *slot, bool broken) {
+		if (broken) {
+			discard(slot);
+			return;
+		}
+		std::unique_lock lock(_lock);
+		hand_over(lock, slot);
+	}
+
+	void push_waiter(AcquireAwaiter<T> *waiter) {
+		std::unique_lock lock(_lock);
+		if (_closed.load(std::memory_order_relaxed)) {
+			lock.unlock();
+			waiter->resume_exception(std::make_exception_ptr(PoolClosedException()));
+			return;
+		}
+		// 入队前资源可能刚被归还，与 try_take 一样先做健康检查
+		while (!_idle.empty()) {
+			SlotIter it = _idle.back();
+			_idle.pop_back();
+			lock.unlock();
+			if (validate(*it)) {
+				_wait_us.Record(0);
+				waiter->resume(&*it);
+				return;
+			}
+			discard(&*it);
+			lock.lock();
+			if (_closed.load(std::memory_order_relaxed)) {
+				lock.unlock();
+				waiter->resume_exception(std::make_exception_ptr(PoolClosedException()));
+				return;
+			}
+		}
+		if (_total < _options.max_size && _waiters.empty()) {
+			_total++;
+			waiter->_queued = true;
+			_waiters.push_back(waiter);
+			lock.unlock();
+			auto resource = create();
+			if (resource) {
+				put_new(std::move(resource));
+			} else {
+				fail_reservation();
+			}
+			return;
+		}
+		waiter->_queued = true;
+		_waiters.push_back(waiter);
+	}
+
+	void remove_waiter(AcquireAwaiter<T> *waiter) {
+		std::lock_guard lock(_lock);
+		for (auto it = _waiters.begin(); it != _waiters.end(); ++it) {
+			if (*it == waiter) {
+				_waiters.erase(it);
+				break;
+			}
+		}
+		waiter->_queued = false;
+	}
+
+private:
+	ResourcePoolOptions _options;
+	Factory _factory;
+	HealthCheck _health_check;
+
+	mutable std::mutex _lock;
+	std::list<Slot> _slots;						// 所有存活的资源(空闲与借出)
+	std::deque<SlotIter> _idle;					// 队尾为最近归还
+	std::deque<AcquireAwaiter<T> *> _waiters;
+	size_t _total = 0;							// 存活数 + 正在创建数
+	std::atomic<bool> _closed{false};
+
+	Histogram _wait_us;
+	std::atomic<uint64_t> _waited{0};
+	std::atomic<uint64_t> _created{0};
+	std::atomic<uint64_t> _destroyed{0};
+	std::atomic<uint64_t> _health_failed{0};
+};
+} // namespace amot
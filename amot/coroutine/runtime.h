@@ -0,0 +1,317 @@
+#pragma once
+
+#include <sched.h>
+
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "reactor.h"
+#include "amot/common/spscqueue.h"
+
+namespace amot {
+
+class Runtime;
+
+/**
+ * @brief co_await runtime.call_on(core, fn)：fn 在目标核上执行，结果回到调用方自己的调度器
+ */
+template <typename R>
+struct CallOnAwaiter : public Awaiter<R> {
+	CallOnAwaiter(Runtime *runtime, size_t core, std::function<R()> &&func)
+		: _runtime(runtime), _core(core), _func(std::move(func)) {}
+
+protected:
+	void after_suspend() override;
+
+private:
+	Runtime *_runtime;
+	size_t _core;
+	std::function<R()> _func;
+};
+
+template <>
+struct CallOnAwaiter<void> : public Awaiter<void> {
+	CallOnAwaiter(Runtime *runtime, size_t core, std::function<void()> &&func)
+		: _runtime(runtime), _core(core), _func(std::move(func)) {}
+
+protected:
+	void after_suspend() override;
+
+private:
+	Runtime *_runtime;
+	size_t _core;
+	std::function<void()> _func;
+};
+
+/**
+ * @brief 每核一个线程的无共享运行时
+ * @details 每个核独占一个 Reactor(epoll、就绪队列、读超时时间轮和其上的连接)。
+ *          核之间只通过 SPSC 队列传递消息：每对 (源核, 目标核) 一条队列，目标核空闲
+ *          阻塞时才用 eventfd 敲门。目标队列满时消息暂存在源核本地的溢出队列中，
+ *          之后按序补发，同一对核之间的消息始终保持 FIFO。
+ *          非运行时线程提交的消息走 Reactor 自带的加锁队列。
+ */
+class Runtime {
+public:
+	using Message = std::function<void()>;
+
+	/**
+	 * @param cores 			核数，0 表示按可用 CPU 数
+	 * @param pin 				是否把第 i 个核的线程绑定到第 i 个可用 CPU
+	 * @param queue_capacity 	每条核间队列的容量
+	 */
+	explicit Runtime(size_t cores = 0, bool pin = true, size_t queue_capacity = 1024) {
+		std::vector<int> cpus = available_cpus();
+		if (cores == 0) cores = cpus.empty() ? 1 : cpus.size();
+		for (size_t i = 0; i < cores; i++) {
+			auto core = std::make_unique<Core>();
+			core->reactor = std::make_unique<Reactor>();
+			for (size_t src = 0; src < cores; src++) {
+				core->inbound.emplace_back(std::make_unique<SpscQueue<Message>>(queue_capacity));
+			}
+			core->overflow.resize(cores);
+			_cores.push_back(std::move(core));
+		}
+		for (size_t i = 0; i < cores; i++) {
+			Reactor &reactor = *_cores[i]->reactor;
+			reactor.set_poll_hooks([this, i]() { return poll(i); },
+								   [this, i]() { return before_sleep(i); });
+			reactor.set_remote_hook([this, i](Message &msg) { return route(i, msg); });
+			_cores[i]->cpu = (pin && !cpus.empty()) ? cpus[i % cpus.size()] : -1;
+			reactor.start();
+		}
+	}
+
+	Runtime(Runtime &) = delete;
+	Runtime &operator=(Runtime &) = delete;
+
+	~Runtime() {
+		stop();
+		join();
+	}
+
+	size_t size() const { return _cores.size(); }
+
+	/**
+	 * @brief 当前线程所属的核，不在任何运行时线程上时为 -1
+	 */
+	static int current_core() { return binding().core; }
+
+	static Runtime *current() { return binding().runtime; }
+
+	Reactor &reactor(size_t core) { return *_cores.at(core)->reactor; }
+
+	/**
+	 * @brief 在目标核上执行 fn
+	 */
+	void submit_to(size_t core, Message &&fn) {
+		_cores.at(core)->reactor->execute(std::move(fn));
+	}
+
+	/**
+	 * @brief 在目标核上创建并托管一个协程，协程的 IO 与恢复都在该核上
+	 */
+	void spawn_on(size_t core, std::function<Reactor::ConnTask()> &&make_task) {
+		_cores.at(core)->reactor->spawn(std::move(make_task));
+	}
+
+	/**
+	 * @brief 在目标核上执行 fn 并等待结果，调用方协程随后在自己的核上恢复
+	 */
+	template <typename Fn>
+	auto call_on(size_t core, Fn &&fn) {
+		using R = std::invoke_result_t<Fn>;
+		return CallOnAwaiter<R>(this, core, std::function<R()>(std::forward<Fn>(fn)));
+	}
+
+	void stop() {
+		for (auto &core : _cores) core->reactor->stop();
+	}
+
+	void join() {
+		for (auto &core : _cores) core->reactor->join();
+	}
+
+	/**
+	 * @brief 累计敲门(eventfd 写)次数，用于观察批量效果
+	 */
+	uint64_t doorbells() const { return _doorbells.load(std::memory_order_relaxed); }
+
+private:
+	struct Binding {
+		Runtime *runtime = nullptr;
+		int core = -1;
+	};
+
+	struct Core {
+		std::unique_ptr<Reactor> reactor;
+		std::vector<std::unique_ptr<SpscQueue<Message>>> inbound;	// inbound[src]，本核消费
+		std::vector<std::deque<Message>> overflow;					// overflow[dst]，本核生产
+		int cpu = -1;
+		alignas(64) std::atomic<bool> sleeping{false};
+	};
+
+	static constexpr size_t kPollBatch = 256;
+
+	static Binding &binding() {
+		static thread_local Binding b;
+		return b;
+	}
+
+	static std::vector<int> available_cpus() {
+		std::vector<int> cpus;
+		cpu_set_t set;
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (int i = 0; i < CPU_SETSIZE; i++) {
+				if (CPU_ISSET(i, &set)) cpus.push_back(i);
+			}
+		}
+		return cpus;
+	}
+
+	/**
+	 * @brief 目标核的 Reactor 被其他线程 execute 时调用：源是本运行时的核就走 SPSC
+	 */
+	bool route(size_t dst, Message &msg) {
+		const Binding &b = binding();
+		if (b.runtime != this || b.core < 0) return false;
+		Core &src = *_cores[b.core];
+		auto &overflow = src.overflow[dst];
+		if (!overflow.empty() || !_cores[dst]->inbound[b.core]->try_push(std::move(msg))) {
+			overflow.push_back(std::move(msg));
+		}
+		ring(dst);
+		return true;
+	}
+
+	void ring(size_t dst) {
+		Core &core = *_cores[dst];
+		// 与 before_sleep 中的 store + 检查配对，避免丢失唤醒
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (core.sleeping.load(std::memory_order_relaxed)
+				&& core.sleeping.exchange(false, std::memory_order_acq_rel)) {
+			_doorbells.fetch_add(1, std::memory_order_relaxed);
+			core.reactor->wakeup();
+		}
+	}
+
+	/**
+	 * @brief 核线程第一次进入循环时登记所属的核并绑核，早于执行任何消息
+	 */
+	void bind(size_t self) {
+		binding() = {this, static_cast<int>(self)};
+		int cpu = _cores[self]->cpu;
+		if (cpu >= 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			sched_setaffinity(0, sizeof(set), &set);
+		}
+	}
+
+	/**
+	 * @brief 本核每轮循环：补发溢出消息，收取各源核的消息并执行
+	 */
+	bool poll(size_t self) {
+		Core &core = *_cores[self];
+		if (binding().runtime != this) bind(self);
+		core.sleeping.store(false, std::memory_order_relaxed);
+		bool worked = false;
+		for (size_t dst = 0; dst < _cores.size(); dst++) {
+			auto &overflow = core.overflow[dst];
+			if (overflow.empty()) continue;
+			auto &queue = *_cores[dst]->inbound[self];
+			while (!overflow.empty() && queue.try_push(std::move(overflow.front()))) {
+				overflow.pop_front();
+			}
+			ring(dst);
+		}
+		Message msg;
+		for (auto &queue : core.inbound) {
+			for (size_t n = 0; n < kPollBatch && queue->try_pop(msg); n++) {
+				msg();
+				worked = true;
+			}
+		}
+		return worked;
+	}
+
+	/**
+	 * @brief 即将阻塞：先声明睡眠再复查队列，复查到消息则本轮不阻塞
+	 */
+	bool before_sleep(size_t self) {
+		Core &core = *_cores[self];
+		core.sleeping.store(true, std::memory_order_seq_cst);
+		bool pending = false;
+		for (auto &queue : core.inbound) {
+			if (!queue->empty()) {
+				pending = true;
+				break;
+			}
+		}
+		// 有消息积压在溢出队列时不能睡，要等目标核腾出空间后补发
+		for (auto &overflow : core.overflow) {
+			if (!overflow.empty()) pending = true;
+		}
+		if (pending) core.sleeping.store(false, std::memory_order_relaxed);
+		return pending;
+	}
+
+private:
+	std::vector<std::unique_ptr<Core>> _cores;
+	std::atomic<uint64_t> _doorbells{0};
+};
+
+template <typename R>
+inline void CallOnAwaiter<R>::after_suspend() {
+	_runtime->submit_to(_core, [this]() {
+		try {
+			this->resume(_func());
+		} catch (...) {
+			this->resume_exception(std::current_exception());
+		}
+	});
+}
+
+inline void CallOnAwaiter<void>::after_suspend() {
+	_runtime->submit_to(_core, [this]() {
+		try {
+			_func();
+			this->resume();
+		} catch (...) {
+			this->resume_exception(std::current_exception());
+		}
+	});
+}
+
+/**
+ * @brief 每核一份的数据，按缓存行对齐避免伪共享
+ * @details local() 只能在运行时线程上调用；on(core) 用于初始化或运行时停止后汇总。
+ */
+template <typename T>
+class CoreLocal {
+public:
+	explicit CoreLocal(const Runtime &runtime) : _slots(runtime.size()) {}
+
+	T &local() {
+		int core = Runtime::current_core();
+		assert(core >= 0 && static_cast<size_t>(core) < _slots.size());
+		return _slots[core].value;
+	}
+
+	T &on(size_t core) { return _slots.at(core).value; }
+
+	size_t size() const { return _slots.size(); }
+
+private:
+	struct alignas(64) Slot {
+		T value{};
+	};
+	std::vector<Slot> _slots;
+};
+} // namespace amot
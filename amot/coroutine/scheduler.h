@@ -7,38 +7,46 @@
 #include <chrono>
 #include <spdlog/spdlog.h>
 
+#include "amot/common/clock.h"
+#include "amot/common/workerstats.h"
+#include "trace.h"
+
 namespace amot {
 
 /**
  * @brief 延时执行器
+ * @details 计划时间取自单调时钟(毫秒)，不受系统时间调整影响
  */
 class DelayedExecutable {
 
 public:
-	DelayedExecutable(std::function<void()> &&func, long long delay) : func(std::move(func)) {
-		auto now = std::chrono::system_clock::now();
-		auto current = std::chrono::duration_cast<std::chrono::milliseconds>
-												(now.time_since_epoch()).count();
-		scheduled_time = current + delay;
+	/**
+	 * @param now 	当前时间，调用方已读过时钟时传入以免重复读取
+	 */
+	DelayedExecutable(std::function<void()> &&func, long long delay, uint64_t id = 0,
+					  long long now = static_cast<long long>(MonotonicMs()))
+		: scheduled_time(now + delay), id(id), func(std::move(func)) {
 	}
-	
-	long long delay() const {
-		auto now = std::chrono::system_clock::now();
-		auto current = std::chrono::duration_cast<std::chrono::milliseconds>
-												(now.time_since_epoch()).count();
-		return scheduled_time - current;
+
+	long long delay(long long now = static_cast<long long>(MonotonicMs())) const {
+		return scheduled_time - now;
 	}
 
 	long long get_scheduled_time() const {
 		return scheduled_time;
 	}
 
+	uint64_t get_id() const {
+		return id;
+	}
+
 	void operator()() {
 		func();
 	}
 
 private:
 	long long scheduled_time;		// 计划执行时间
+	uint64_t id;					// 调度器内的序号，用于追踪
 	std::function<void()> func;		// 任务
 };
 
@@ -56,8 +64,9 @@ public:
 			DelayedExecutable, std::vector<DelayedExecutable>, DelayedExecutableCompare>;
 	/**
 	 * @brief 创建调度器
+	 * @param record_timings 	统计运行耗时，排队耗时记为实际执行晚于计划时间的部分
 	 */
-	Scheduler() {
+	explicit Scheduler(bool record_timings = false) : worker_stats(record_timings) {
 		is_active.store(true, std::memory_order_relaxed);
 		// 初始化线程同时绑定循环任务
 		work_thread = std::thread(&Scheduler::run_loop, this);
@@ -76,10 +85,15 @@ public:
 	 */
 	void execute(std::function<void()> &&func, long long delay = 0) {
 		delay = delay < 0 ? 0 : delay;
+		// 锁外读一次时钟，锁内只比较计划时间
+		long long now = static_cast<long long>(MonotonicMs());
 		std::unique_lock lock(queue_lock);
 		if (is_active.load(std::memory_order_relaxed)) {
-			bool need_notify = executable_queue.empty() || executable_queue.top().delay() > delay;
-			executable_queue.push(DelayedExecutable(std::move(func), delay));
+			bool need_notify = executable_queue.empty() ||
+				executable_queue.top().get_scheduled_time() > now + delay;
+			uint64_t id = ++timer_seq;
+			AMOT_TRACE(timer_add, id, this);
+			executable_queue.push(DelayedExecutable(std::move(func), delay, id, now));
 			lock.unlock();
 			if (need_notify) {
 				queue_condition.notify_one();
@@ -104,6 +118,18 @@ public:
 			work_thread.join();
 		}
 	}
+
+	ExecutorStats stats() const {
+		return worker_stats.snapshot();
+	}
+
+	void merge_wait_time(Histogram &out) const {
+		worker_stats.mergeWaitTime(out);
+	}
+
+	void merge_run_time(Histogram &out) const {
+		worker_stats.mergeRunTime(out);
+	}
 private:
 	void run_loop() {
 		// 检查当前事件循环是否是工作状态，或者队列没有清空
@@ -111,7 +137,9 @@ private:
 			std::unique_lock lock(queue_lock);
 			if (executable_queue.empty()) {
 				// 队列为空时，阻塞等待新任务加入队列或者关闭事件循环的通知
+				int64_t since = worker_stats.onPark();
 				queue_condition.wait(lock);
+				worker_stats.onUnpark(since);
 				if (executable_queue.empty()) {
 					continue;
 				}
@@ -119,18 +147,29 @@ private:
 			// 队列不为空，则先取出任务，解锁后执行
 			// 注意：func 是外部逻辑，不需要锁保护；func 当中可能请求锁，导致死锁
 			auto executable = executable_queue.top();
-			long long delay = executable.delay();
+			long long now = static_cast<long long>(MonotonicMs());
+			long long delay = executable.delay(now);
 			// 时间大于0， 则等待该时间
 			if (delay > 0) {
 				// 条件变量进行等待
+				int64_t since = worker_stats.onPark();
 				auto status = queue_condition.wait_for(lock, std::chrono::milliseconds(delay));
+				worker_stats.onUnpark(since);
 				if (status != std::cv_status::timeout) {
 					continue;
 				}
+				now = static_cast<long long>(MonotonicMs());
 			}
 			executable_queue.pop();
 			lock.unlock();
+			if (worker_stats.timings()) {
+				long long late = -executable.delay(now);
+				worker_stats.onWait(late > 0 ? static_cast<uint64_t>(late) * 1000000 : 0);
+			}
+			AMOT_TRACE(timer_fire, executable.get_id(), this);
+			int64_t start = worker_stats.stamp();
 			executable();
+			worker_stats.onRun(0, start);
 		}
 		spdlog::debug("run_loop exit.");
 	}
@@ -139,6 +178,8 @@ private:
 	std::condition_variable queue_condition;
 	std::mutex queue_lock;
 	ExecutableQueue executable_queue;
+	uint64_t timer_seq = 0;
+	WorkerStats worker_stats;
 
 	std::atomic<bool> is_active;
 	std::thread work_thread;
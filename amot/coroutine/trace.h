@@ -0,0 +1,268 @@
+/**
+ * @file trace.h
+ * @brief 协程生命周期追踪：每线程环形缓冲记录事件，导出为 Chrome trace JSON
+ * @version 0.1
+ * @date 2024-05-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 协程生命周期追踪，编译时开关
+ * 定义 AMOT_ENABLE_TRACE(cmake -DAMOT_ENABLE_TRACE=ON)后 Promise、Awaiter、Channel、
+ * Scheduler 中的埋点才会生效，否则宏展开为空，没有任何开销。
+ * 事件写入每个线程自己的环形缓冲，满了覆盖最旧的，通过 Tracer::dump_chrome_json
+ * 导出为 Chrome trace / Perfetto 可以打开的 JSON。
+ */
+#ifdef AMOT_ENABLE_TRACE
+#define AMOT_TRACE(event, id, executor) \
+	::amot::Tracer::instance().record(::amot::TraceEvent::event, (id), (executor), nullptr)
+#define AMOT_TRACE_LABEL(event, id, executor, label) \
+	::amot::Tracer::instance().record(::amot::TraceEvent::event, (id), (executor), (label))
+#else
+#define AMOT_TRACE(event, id, executor) ((void)0)
+#define AMOT_TRACE_LABEL(event, id, executor, label) ((void)0)
+#endif
+
+namespace amot {
+
+enum class TraceEvent : uint8_t {
+	create,		// 协程创建
+	dispatch,	// 恢复请求投递给调度器
+	resume,		// 协程在当前线程上恢复执行
+	suspend,	// 协程挂起
+	complete,	// 协程执行结束
+	wait,		// 挂在 Channel 等资源上，label 说明原因
+	timer_add,	// Scheduler 收到延时任务，id 为定时器序号
+	timer_fire,	// Scheduler 开始执行延时任务
+};
+
+// 协程以帧地址作为 id
+inline uint64_t trace_id(std::coroutine_handle<> handle) {
+	return reinterpret_cast<uint64_t>(handle.address());
+}
+
+struct TraceRecord {
+	int64_t ts_ns;
+	uint64_t id;
+	const void *executor;
+	const char *label;
+	TraceEvent event;
+};
+
+/**
+ * @brief 单个线程的事件环，只有所属线程写入
+ * @details 写入不加锁；导出时读取的区间若在拷贝期间被覆盖则丢弃，
+ *          因此线程仍在运行时导出只会少掉最旧的一部分事件。
+ */
+class TraceBuffer {
+public:
+	TraceBuffer(size_t capacity, uint32_t tid)
+		: _capacity(round_up(capacity)), _mask(_capacity - 1),
+		  _records(new TraceRecord[_capacity]), _tid(tid) {}
+
+	void push(const TraceRecord &record) {
+		uint64_t head = _head.load(std::memory_order_relaxed);
+		_records[head & _mask] = record;
+		_head.store(head + 1, std::memory_order_release);
+	}
+
+	void snapshot(std::vector<TraceRecord> &out) const {
+		uint64_t head = _head.load(std::memory_order_acquire);
+		uint64_t begin = head > _capacity ? head - _capacity : 0;
+		size_t offset = out.size();
+		for (uint64_t i = begin; i < head; i++) {
+			out.push_back(_records[i & _mask]);
+		}
+		// 拷贝期间被写入方追上的部分可能已被覆盖
+		uint64_t now = _head.load(std::memory_order_acquire);
+		if (now > begin + _capacity) {
+			size_t stale = std::min<uint64_t>(now - _capacity - begin, head - begin);
+			out.erase(out.begin() + offset, out.begin() + offset + stale);
+		}
+	}
+
+	void clear() { _head.store(0, std::memory_order_relaxed); }
+
+	uint32_t tid() const { return _tid; }
+
+private:
+	static size_t round_up(size_t capacity) {
+		size_t cap = 2;
+		while (cap < capacity) cap <<= 1;
+		return cap;
+	}
+
+	const size_t _capacity;
+	const size_t _mask;
+	std::unique_ptr<TraceRecord[]> _records;
+	std::atomic<uint64_t> _head{0};
+	uint32_t _tid;
+};
+
+class Tracer {
+public:
+	static Tracer &instance() {
+		static Tracer tracer;
+		return tracer;
+	}
+
+	/**
+	 * @brief 运行时开关，默认开启；关闭后埋点只剩一次原子读
+	 */
+	void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+	bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief 每个线程环形缓冲的事件数，只影响之后首次记录事件的线程
+	 */
+	void set_buffer_capacity(size_t capacity) { _capacity.store(capacity, std::memory_order_relaxed); }
+
+	void record(TraceEvent event, uint64_t id, const void *executor, const char *label) noexcept {
+		if (!_enabled.load(std::memory_order_relaxed)) return;
+		local().push(TraceRecord{now_ns(), id, executor, label, event});
+	}
+
+	/**
+	 * @brief 丢弃所有已记录的事件，需在没有线程写入时调用
+	 */
+	void clear() {
+		std::lock_guard lock(_buffers_lock);
+		for (auto &buffer : _buffers) buffer->clear();
+	}
+
+	/**
+	 * @brief 导出 Chrome trace JSON
+	 * @details 每个线程一行：resume 到 suspend/complete 之间是一段执行切片，
+	 *          dispatch 到 resume 之间用箭头(flow)连接，便于看出调度延迟和跨线程的
+	 *          恢复链路；每个协程从 create 到 complete 还有一条异步轨道。
+	 */
+	void dump_chrome_json(std::ostream &out) {
+		std::vector<std::shared_ptr<TraceBuffer>> buffers;
+		{
+			std::lock_guard lock(_buffers_lock);
+			buffers = _buffers;
+		}
+		int pid = getpid();
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		auto emit = [&](const std::string &event) {
+			out << (first ? "\n" : ",\n") << event;
+			first = false;
+		};
+		std::vector<TraceRecord> records;
+		for (auto &buffer : buffers) {
+			records.clear();
+			buffer->snapshot(records);
+			std::string head = "\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(buffer->tid());
+			emit("{\"ph\":\"M\",\"name\":\"thread_name\"," + head +
+				 ",\"args\":{\"name\":\"thread " + std::to_string(buffer->tid()) + "\"}}");
+			for (auto &record : records) {
+				convert(record, head, emit);
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	}
+
+	bool dump_chrome_json(const std::string &path) {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out) return false;
+		dump_chrome_json(out);
+		return static_cast<bool>(out);
+	}
+
+private:
+	Tracer() = default;
+
+	static int64_t now_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	TraceBuffer &local() {
+		thread_local TraceBuffer *buffer = nullptr;
+		if (!buffer) {
+			// 缓冲由 Tracer 持有，线程退出后事件仍可导出
+			auto owned = std::make_shared<TraceBuffer>(_capacity.load(std::memory_order_relaxed),
+													   static_cast<uint32_t>(syscall(SYS_gettid)));
+			std::lock_guard lock(_buffers_lock);
+			_buffers.push_back(owned);
+			buffer = owned.get();
+		}
+		return *buffer;
+	}
+
+	static std::string hex(uint64_t value) {
+		char text[24];
+		snprintf(text, sizeof(text), "0x%llx", static_cast<unsigned long long>(value));
+		return text;
+	}
+
+	template <typename Emit>
+	static void convert(const TraceRecord &record, const std::string &head, Emit &emit) {
+		char ts[32];
+		snprintf(ts, sizeof(ts), "%.3f", record.ts_ns / 1000.0);
+		std::string id = hex(record.id);
+		std::string common = head + ",\"ts\":" + ts;
+		std::string args = ",\"args\":{\"id\":\"" + id + "\",\"executor\":\"" +
+						   hex(reinterpret_cast<uint64_t>(record.executor)) + "\"}";
+		std::string task = "\"name\":\"task " + id + "\",\"cat\":\"coroutine\"";
+		switch (record.event) {
+		case TraceEvent::create:
+			emit("{\"ph\":\"b\"," + task + ",\"id\":\"" + id + "\"," + common + args + "}");
+			break;
+		case TraceEvent::dispatch:
+			emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"dispatch\",\"cat\":\"coroutine\"," + common + args + "}");
+			emit("{\"ph\":\"s\",\"name\":\"resume\",\"cat\":\"coroutine\",\"id\":\"" + id + "\"," + common + "}");
+			break;
+		case TraceEvent::resume:
+			emit("{\"ph\":\"B\"," + task + "," + common + args + "}");
+			emit("{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"resume\",\"cat\":\"coroutine\",\"id\":\"" + id + "\"," + common + "}");
+			break;
+		case TraceEvent::suspend:
+			emit("{\"ph\":\"E\"," + common + "}");
+			break;
+		case TraceEvent::complete:
+			emit("{\"ph\":\"E\"," + common + "}");
+			emit("{\"ph\":\"e\"," + task + ",\"id\":\"" + id + "\"," + common + "}");
+			break;
+		case TraceEvent::wait:
+			emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" + std::string(record.label ? record.label : "wait") +
+				 "\",\"cat\":\"coroutine\"," + common + args + "}");
+			break;
+		case TraceEvent::timer_add:
+			emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"timer add\",\"cat\":\"timer\"," + common + args + "}");
+			emit("{\"ph\":\"s\",\"name\":\"timer\",\"cat\":\"timer\",\"id\":\"" + id + "\"," + common + "}");
+			break;
+		case TraceEvent::timer_fire:
+			emit("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"timer fire\",\"cat\":\"timer\"," + common + args + "}");
+			emit("{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"timer\",\"cat\":\"timer\",\"id\":\"" + id + "\"," + common + "}");
+			break;
+		}
+	}
+
+	std::atomic<bool> _enabled{true};
+	std::atomic<size_t> _capacity{1 << 16};
+	std::mutex _buffers_lock;
+	std::vector<std::shared_ptr<TraceBuffer>> _buffers;
+};
+
+}
@@ -0,0 +1,266 @@
+#include "filecache.h"
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+namespace amot {
+
+namespace {
+
+struct MimeEntry {
+    const char* suffix;
+    const char* type;
+};
+
+const MimeEntry kMimeTypes[] = {
+    { ".html",  "text/html" },
+    { ".htm",   "text/html" },
+    { ".css",   "text/css" },
+    { ".js",    "text/javascript" },
+    { ".json",  "application/json" },
+    { ".xml",   "text/xml" },
+    { ".xhtml", "application/xhtml+xml" },
+    { ".txt",   "text/plain" },
+    { ".rtf",   "application/rtf" },
+    { ".pdf",   "application/pdf" },
+    { ".word",  "application/nsword" },
+    { ".png",   "image/png" },
+    { ".gif",   "image/gif" },
+    { ".jpg",   "image/jpeg" },
+    { ".jpeg",  "image/jpeg" },
+    { ".svg",   "image/svg+xml" },
+    { ".ico",   "image/x-icon" },
+    { ".au",    "audio/basic" },
+    { ".mpeg",  "video/mpeg" },
+    { ".mpg",   "video/mpeg" },
+    { ".mp4",   "video/mp4" },
+    { ".avi",   "video/x-msvideo" },
+    { ".gz",    "application/x-gzip" },
+    { ".tar",   "application/x-tar" },
+};
+
+std::string BuildHeader(const CachedFile& file, bool keepAlive) {
+    std::string header;
+    header.reserve(256);
+    header += "HTTP/1.1 200 OK\r\n";
+    if(keepAlive) {
+        header += "Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n";
+    } else {
+        header += "Connection: close\r\n";
+    }
+    header += "Content-type: ";
+    header += file.mimeType;
+    header += "\r\nContent-length: ";
+    header += std::to_string(file.size);
+    header += "\r\nETag: ";
+    header += file.etag;
+    header += "\r\nLast-Modified: ";
+    header += file.lastModified;
+    header += "\r\n\r\n";
+    return header;
+}
+
+}  // namespace
+
+const char* GetMimeType(const std::string& path) {
+    auto idx = path.find_last_of('.');
+    if(idx != std::string::npos) {
+        for(const auto& mime : kMimeTypes) {
+            if(strcasecmp(path.c_str() + idx, mime.suffix) == 0) {
+                return mime.type;
+            }
+        }
+    }
+    return "text/plain";
+}
+
+std::string FormatHttpDate(time_t t) {
+    struct tm tmv;
+    char buf[64];
+    gmtime_r(&t, &tmv);
+    size_t len = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+    return std::string(buf, len);
+}
+
+std::string MakeETag(size_t size, time_t mtime) {
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "\"%lx-%zx\"", static_cast<long>(mtime), size);
+    return std::string(buf, len);
+}
+
+CachedFile::~CachedFile() {
+    if(data && size > 0) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+FileCache::FileCache(size_t budget, size_t maxFileSize)
+    : budget_(budget), maxFileSize_(maxFileSize), usage_(0) {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileCache::~FileCache() {
+    if(inotifyFd_ >= 0) {
+        close(inotifyFd_);
+    }
+}
+
+FileCache::FilePtr FileCache::Get(const std::string& path) {
+    std::unique_lock<std::mutex> locker(mtx_);
+    auto it = entries_.find(path);
+    if(it != entries_.end()) {
+        if(inotifyFd_ < 0) {
+            /* 没有 inotify 时退化为每次 stat 校验 */
+            struct stat st;
+            if(stat(path.c_str(), &st) < 0 || st.st_mtime != it->second.file->mtime
+                    || static_cast<size_t>(st.st_size) != it->second.file->size
+                    || !(st.st_mode & S_IROTH)) {
+                Erase_(it);
+                it = entries_.end();
+            }
+        }
+        if(it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return it->second.file;
+        }
+    }
+    locker.unlock();
+
+    /* 其他用户不可读的文件不进缓存，由调用方按 403 处理 */
+    struct stat st;
+    if(stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode) || !(st.st_mode & S_IROTH)
+            || static_cast<size_t>(st.st_size) > maxFileSize_) {
+        return nullptr;
+    }
+    /* 载入不持锁，避免慢盘阻塞其他线程的命中 */
+    FilePtr file = Load_(path, st);
+    if(!file) { return nullptr; }
+
+    locker.lock();
+    it = entries_.find(path);
+    if(it != entries_.end()) {
+        /* 其他线程已载入 */
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return it->second.file;
+    }
+    Watch_(path);
+    lru_.push_front(path);
+    entries_[path] = Entry{ file, lru_.begin() };
+    usage_ += file->size;
+    EvictIfNeeded_();
+    return file;
+}
+
+FileCache::FilePtr FileCache::Load_(const std::string& path, const struct stat& st) {
+    auto file = std::make_shared<CachedFile>();
+    file->path = path;
+    file->size = st.st_size;
+    file->mtime = st.st_mtime;
+    if(file->size > 0) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) { return nullptr; }
+        void* ptr = mmap(nullptr, file->size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(ptr == MAP_FAILED) { return nullptr; }
+        file->data = static_cast<const char*>(ptr);
+    }
+    file->etag = MakeETag(file->size, file->mtime);
+    file->lastModified = FormatHttpDate(file->mtime);
+    file->mimeType = GetMimeType(path);
+    file->keepAliveHeader = BuildHeader(*file, true);
+    file->closeHeader = BuildHeader(*file, false);
+    return file;
+}
+
+void FileCache::Watch_(const std::string& path) {
+    if(inotifyFd_ < 0) { return; }
+    auto idx = path.find_last_of('/');
+    std::string dir = idx == std::string::npos ? "." : path.substr(0, idx);
+    if(dirWatches_.count(dir)) { return; }
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(),
+                               IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE | IN_CREATE
+                               | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if(wd < 0) { return; }
+    dirWatches_[dir] = wd;
+    watchDirs_[wd] = dir;
+}
+
+void FileCache::OnInotify() {
+    if(inotifyFd_ < 0) { return; }
+    alignas(struct inotify_event) char buf[8192];
+    while(true) {
+        ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+        if(len <= 0) { break; }
+        std::lock_guard<std::mutex> locker(mtx_);
+        for(char* p = buf; p < buf + len;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if(ev->wd == -1 || (ev->mask & IN_Q_OVERFLOW)) {
+                /* 事件队列溢出(wd 为 -1)，丢失的事件无从得知，清掉全部缓存 */
+                entries_.clear();
+                lru_.clear();
+                usage_ = 0;
+                continue;
+            }
+            auto dirIt = watchDirs_.find(ev->wd);
+            if(dirIt == watchDirs_.end()) { continue; }
+            if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                /* 目录本身变化，清掉该目录下全部缓存 */
+                const std::string prefix = dirIt->second + "/";
+                for(auto it = entries_.begin(); it != entries_.end();) {
+                    auto cur = it++;
+                    if(cur->first.compare(0, prefix.size(), prefix) == 0) { Erase_(cur); }
+                }
+                if(ev->mask & IN_IGNORED) {
+                    dirWatches_.erase(dirIt->second);
+                    watchDirs_.erase(dirIt);
+                }
+                continue;
+            }
+            if(ev->len > 0) {
+                auto it = entries_.find(dirIt->second + "/" + ev->name);
+                if(it != entries_.end()) { Erase_(it); }
+            }
+        }
+    }
+}
+
+void FileCache::Invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = entries_.find(path);
+    if(it != entries_.end()) { Erase_(it); }
+}
+
+void FileCache::Erase_(std::unordered_map<std::string, Entry>::iterator it) {
+    usage_ -= it->second.file->size;
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+}
+
+void FileCache::EvictIfNeeded_() {
+    /* 正在发送中的文件由 shared_ptr 持有，淘汰后等发送完成才真正 munmap */
+    while(usage_ > budget_ && !lru_.empty()) {
+        auto it = entries_.find(lru_.back());
+        assert(it != entries_.end());
+        Erase_(it);
+    }
+}
+
+size_t FileCache::MemoryUsage() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return usage_;
+}
+
+size_t FileCache::Count() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return entries_.size();
+}
+
+}  // namespace amot
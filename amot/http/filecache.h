@@ -0,0 +1,134 @@
+/**
+ * @file filecache.h
+ * @brief 基于 mmap 的静态文件缓存，LRU 淘汰 + inotify 失效
+ * @version 0.1
+ * @date 2024-03-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace amot {
+
+/**
+ * @brief 已映射到内存的文件，响应头在载入时预先生成
+ */
+struct CachedFile {
+    CachedFile() = default;
+    ~CachedFile();
+
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+
+    std::string path;
+    const char* data = nullptr;
+    size_t size = 0;
+    time_t mtime = 0;
+
+    std::string etag;
+    std::string lastModified;
+    std::string mimeType;
+
+    /* 预生成的完整响应头(含状态行与空行)，分别对应 keep-alive 与 close */
+    std::string keepAliveHeader;
+    std::string closeHeader;
+};
+
+class FileCache {
+public:
+    using FilePtr = std::shared_ptr<const CachedFile>;
+
+    /**
+     * @brief 构造文件缓存
+     *
+     * @param budget        缓存占用内存上限(字节)
+     * @param maxFileSize   可缓存的单个文件大小上限，超过的文件走 sendfile
+     */
+    explicit FileCache(size_t budget = 64 << 20, size_t maxFileSize = 256 << 10);
+
+    ~FileCache();
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    /**
+     * @brief 获取缓存文件，未命中时载入
+     *
+     * @param path          文件绝对路径
+     * @return FilePtr      文件不存在、不是普通文件、其他用户不可读或过大时返回 nullptr
+     */
+    FilePtr Get(const std::string& path);
+
+    /**
+     * @brief 使某个文件的缓存失效
+     */
+    void Invalidate(const std::string& path);
+
+    /**
+     * @brief inotify 句柄，由事件循环监听可读事件，不可用时返回 -1
+     */
+    int GetInotifyFd() const { return inotifyFd_; }
+
+    /**
+     * @brief inotify 可读时调用，批量处理文件变更事件
+     */
+    void OnInotify();
+
+    size_t MaxFileSize() const { return maxFileSize_; }
+
+    size_t MemoryUsage() const;
+
+    size_t Count() const;
+
+private:
+    struct Entry {
+        FilePtr file;
+        std::list<std::string>::iterator lru;
+    };
+
+    FilePtr Load_(const std::string& path, const struct stat& st);
+    void Watch_(const std::string& path);
+    void Erase_(std::unordered_map<std::string, Entry>::iterator it);
+    void EvictIfNeeded_();
+
+    size_t budget_;
+    size_t maxFileSize_;
+    size_t usage_;
+
+    int inotifyFd_;
+    /* 监听的目录: wd -> 目录路径，目录路径 -> wd */
+    std::unordered_map<int, std::string> watchDirs_;
+    std::unordered_map<std::string, int> dirWatches_;
+
+    /* 表头为最近使用 */
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, Entry> entries_;
+
+    mutable std::mutex mtx_;
+};
+
+/**
+ * @brief 根据文件后缀返回 Content-type
+ */
+const char* GetMimeType(const std::string& path);
+
+/**
+ * @brief 生成 RFC 1123 格式的 HTTP 时间
+ */
+std::string FormatHttpDate(time_t t);
+
+/**
+ * @brief 由文件大小和修改时间生成 ETag
+ */
+std::string MakeETag(size_t size, time_t mtime);
+
+}  // namespace amot
@@ -0,0 +1,77 @@
+#include "httpmetrics.h"
+
+#include <mutex>
+
+namespace amot {
+
+namespace {
+const char* const kCodeClass[] = {"other", "1xx", "2xx", "3xx", "4xx", "5xx"};
+}  // namespace
+
+HttpMetrics::HttpMetrics(MetricsRegistry* registry, size_t maxRoutes)
+    : registry_(registry), maxRoutes_(maxRoutes),
+      connections_(registry->GetCounter("amot_http_connections_total", "Accepted HTTP connections.")),
+      received_(registry->GetCounter("amot_http_received_bytes_total", "Bytes read from HTTP connections.")),
+      sent_(registry->GetCounter("amot_http_sent_bytes_total", "Bytes written to HTTP connections.")) {
+}
+
+void HttpMetrics::SetRoutes(std::vector<std::string> routes) {
+    table_ = std::move(routes);
+}
+
+std::string_view HttpMetrics::RouteOf(std::string_view path, int code) const {
+    if(code != 200 && code != 304) { return "unmatched"; }
+    if(path == kPath) { return kPath; }
+    std::string_view best;
+    for(auto& route : table_) {
+        if(route.size() <= best.size() || path.substr(0, route.size()) != route) { continue; }
+        if(path.size() == route.size() || path[route.size()] == '/' || route.back() == '/') {
+            best = route;
+        }
+    }
+    if(!best.empty()) { return best; }
+    /* 路径对应磁盘上真实存在的文件，目录数有限 */
+    size_t slash = path.find('/', 1);
+    return slash == std::string_view::npos ? std::string_view("/") : path.substr(0, slash);
+}
+
+void HttpMetrics::OnRequest(std::string_view route, int code, uint64_t latencyNs) {
+    Route* r = GetRoute_(route);
+    GetRequests_(r, code)->Inc();
+    r->latency->Record(latencyNs);
+}
+
+HttpMetrics::Route* HttpMetrics::GetRoute_(std::string_view route) {
+    {
+        std::shared_lock<std::shared_mutex> locker(mutex_);
+        auto it = routes_.find(route);
+        if(it != routes_.end()) { return it->second.get(); }
+        if(routes_.size() >= maxRoutes_) {
+            it = routes_.find(std::string_view("other"));
+            if(it != routes_.end()) { return it->second.get(); }
+        }
+    }
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    // 超过上限后新路由归入 other，other 本身不占名额
+    std::string name(routes_.size() >= maxRoutes_ && !routes_.count(route) ? "other" : route);
+    auto it = routes_.find(name);
+    if(it != routes_.end()) { return it->second.get(); }
+    auto r = std::make_unique<Route>();
+    r->name = name;
+    r->latency = &registry_->GetHistogram("amot_http_request_duration_seconds",
+                                          "Time spent handling HTTP requests.", {{"route", name}});
+    return routes_.emplace(name, std::move(r)).first->second.get();
+}
+
+Counter* HttpMetrics::GetRequests_(Route* route, int code) {
+    int index = code >= 100 && code < 600 ? code / 100 : 0;
+    Counter* counter = route->requests[index].load(std::memory_order_acquire);
+    if(counter) { return counter; }
+    // 注册表对同一标签返回同一对象，并发创建时结果相同
+    counter = &registry_->GetCounter("amot_http_requests_total", "HTTP requests handled.",
+                                     {{"route", route->name}, {"code", kCodeClass[index]}});
+    route->requests[index].store(counter, std::memory_order_release);
+    return counter;
+}
+
+}  // namespace amot
@@ -0,0 +1,505 @@
+#include "httpparser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define AMOT_HTTP_X86 1
+#endif
+
+namespace amot {
+
+namespace {
+
+/* RFC 7230 tchar */
+struct TokenTable {
+    bool map[256] = {};
+    constexpr TokenTable() {
+        for(int c = '0'; c <= '9'; c++) { map[c] = true; }
+        for(int c = 'a'; c <= 'z'; c++) { map[c] = true; }
+        for(int c = 'A'; c <= 'Z'; c++) { map[c] = true; }
+        for(char c : std::string_view("!#$%&'*+-.^_`|~")) { map[static_cast<uint8_t>(c)] = true; }
+    }
+};
+constexpr TokenTable kToken;
+
+inline bool IsValueChar(uint8_t c) {
+    return c == '\t' || (c >= 0x20 && c != 0x7f);
+}
+
+inline bool IsTargetChar(uint8_t c) {
+    return c > 0x20 && c != 0x7f;
+}
+
+/* ---------------- 标量实现 ---------------- */
+
+size_t HeaderEndScalar(const char* p, size_t len, size_t from) {
+    for(size_t i = from; i < len; i++) {
+        if(p[i] != '\n') { continue; }
+        if(i >= 1 && p[i - 1] == '\n') { return i + 1; }
+        if(i >= 2 && p[i - 1] == '\r' && p[i - 2] == '\n') { return i + 1; }
+    }
+    return 0;
+}
+
+const char* TokenEndScalar(const char* p, const char* end) {
+    while(p < end && kToken.map[static_cast<uint8_t>(*p)]) { ++p; }
+    return p;
+}
+
+const char* ValueEndScalar(const char* p, const char* end) {
+    while(p < end && IsValueChar(static_cast<uint8_t>(*p))) { ++p; }
+    return p;
+}
+
+const char* TargetEndScalar(const char* p, const char* end) {
+    while(p < end && IsTargetChar(static_cast<uint8_t>(*p))) { ++p; }
+    return p;
+}
+
+#ifdef AMOT_HTTP_X86
+
+/* ---------------- SSE4.2 实现 ---------------- */
+
+/* 非 tchar 的区间，'{'..'\xff' 中的 '|' '~' 需回退到查表 */
+alignas(16) const char kTokenRanges[16] = {
+    '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'
+};
+alignas(16) const char kValueRanges[16] = { '\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f' };
+alignas(16) const char kTargetRanges[16] = { '\x00', ' ', '\x7f', '\x7f' };
+
+__attribute__((target("sse4.2")))
+size_t HeaderEndSse42(const char* p, size_t len, size_t from) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = from;
+    for(; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(b, nl));
+        while(mask) {
+            size_t q = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if(q >= 1 && p[q - 1] == '\n') { return q + 1; }
+            if(q >= 2 && p[q - 1] == '\r' && p[q - 2] == '\n') { return q + 1; }
+        }
+    }
+    return HeaderEndScalar(p, len, i);
+}
+
+__attribute__((target("sse4.2")))
+const char* RangesEndSse42(const char* p, const char* end, const char* ranges, int rangesLen,
+                           const bool* retry) {
+    const __m128i r = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+    while(end - p >= 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(r, rangesLen, b, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if(idx == 16) {
+            p += 16;
+            continue;
+        }
+        p += idx;
+        if(!retry || !retry[static_cast<uint8_t>(*p)]) { return p; }
+        ++p;
+    }
+    return p;
+}
+
+__attribute__((target("sse4.2")))
+const char* TokenEndSse42(const char* p, const char* end) {
+    return TokenEndScalar(RangesEndSse42(p, end, kTokenRanges, 16, kToken.map), end);
+}
+
+__attribute__((target("sse4.2")))
+const char* ValueEndSse42(const char* p, const char* end) {
+    return ValueEndScalar(RangesEndSse42(p, end, kValueRanges, 6, nullptr), end);
+}
+
+__attribute__((target("sse4.2")))
+const char* TargetEndSse42(const char* p, const char* end) {
+    return TargetEndScalar(RangesEndSse42(p, end, kTargetRanges, 4, nullptr), end);
+}
+
+/* ---------------- AVX2 实现 ---------------- */
+
+__attribute__((target("avx2")))
+size_t HeaderEndAvx2(const char* p, size_t len, size_t from) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t i = from;
+    for(; i + 32 <= len; i += 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, nl));
+        while(mask) {
+            size_t q = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if(q >= 1 && p[q - 1] == '\n') { return q + 1; }
+            if(q >= 2 && p[q - 1] == '\r' && p[q - 2] == '\n') { return q + 1; }
+        }
+    }
+    return HeaderEndSse42(p, len, i);
+}
+
+__attribute__((target("avx2")))
+const char* ValueEndAvx2(const char* p, const char* end) {
+    const __m256i sp = _mm256_set1_epi8(0x20);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i ones = _mm256_set1_epi8(-1);
+    while(end - p >= 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        /* b >= 0x20 或 b == '\t' 为合法，0x7f 非法 */
+        __m256i ok = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(b, sp), b),
+                                     _mm256_cmpeq_epi8(b, tab));
+        __m256i stop = _mm256_or_si256(_mm256_andnot_si256(ok, ones), _mm256_cmpeq_epi8(b, del));
+        unsigned mask = _mm256_movemask_epi8(stop);
+        if(mask) { return p + __builtin_ctz(mask); }
+        p += 32;
+    }
+    return ValueEndSse42(p, end);
+}
+
+#endif  // AMOT_HTTP_X86
+
+struct ScanOps {
+    size_t (*headerEnd)(const char*, size_t, size_t);
+    const char* (*tokenEnd)(const char*, const char*);
+    const char* (*valueEnd)(const char*, const char*);
+    const char* (*targetEnd)(const char*, const char*);
+};
+
+const ScanOps kScalarOps = { HeaderEndScalar, TokenEndScalar, ValueEndScalar, TargetEndScalar };
+#ifdef AMOT_HTTP_X86
+const ScanOps kSse42Ops = { HeaderEndSse42, TokenEndSse42, ValueEndSse42, TargetEndSse42 };
+const ScanOps kAvx2Ops = { HeaderEndAvx2, TokenEndSse42, ValueEndAvx2, TargetEndSse42 };
+#endif
+
+HttpScanLevel SupportedLevel() {
+#ifdef AMOT_HTTP_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2")) {
+        return HttpScanLevel::AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.2")) {
+        return HttpScanLevel::SSE42;
+    }
+#endif
+    return HttpScanLevel::SCALAR;
+}
+
+const ScanOps* OpsOf(HttpScanLevel level) {
+    switch(level) {
+#ifdef AMOT_HTTP_X86
+    case HttpScanLevel::AVX2: return &kAvx2Ops;
+    case HttpScanLevel::SSE42: return &kSse42Ops;
+#endif
+    default: return &kScalarOps;
+    }
+}
+
+std::atomic<HttpScanLevel> g_level{SupportedLevel()};
+std::atomic<const ScanOps*> g_ops{OpsOf(g_level.load())};
+
+inline bool EqualsNoCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+/* 逗号分隔的列表中是否含有 token，如 "keep-alive, Upgrade" */
+bool ListContains(std::string_view list, std::string_view token) {
+    while(!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        while(!item.empty() && (item.front() == ' ' || item.front() == '\t')) { item.remove_prefix(1); }
+        while(!item.empty() && (item.back() == ' ' || item.back() == '\t')) { item.remove_suffix(1); }
+        if(EqualsNoCase(item, token)) { return true; }
+        if(comma == std::string_view::npos) { break; }
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+}  // namespace
+
+HttpScanLevel GetHttpScanLevel() {
+    return g_level.load(std::memory_order_relaxed);
+}
+
+HttpScanLevel SetHttpScanLevel(HttpScanLevel level) {
+    HttpScanLevel supported = SupportedLevel();
+    if(level > supported) { level = supported; }
+    g_level.store(level, std::memory_order_relaxed);
+    g_ops.store(OpsOf(level), std::memory_order_relaxed);
+    return level;
+}
+
+const char* HttpScanLevelName(HttpScanLevel level) {
+    switch(level) {
+    case HttpScanLevel::AVX2: return "avx2";
+    case HttpScanLevel::SSE42: return "sse4.2";
+    default: return "scalar";
+    }
+}
+
+std::string_view HttpRequestView::Header(std::string_view name) const {
+    for(size_t i = 0; i < headerCount; i++) {
+        if(EqualsNoCase(headers[i].name, name)) {
+            return headers[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+HttpParser::HttpParser(size_t maxHeaderSize, size_t maxBodySize)
+    : maxHeaderSize_(maxHeaderSize), maxBodySize_(maxBodySize) {
+    Reset();
+}
+
+void HttpParser::Reset() {
+    stage_ = Stage::HEADER;
+    error_ = "";
+    skipped_ = 0;
+    scanned_ = 0;
+    headLen_ = 0;
+    headerCount_ = 0;
+    minorVersion_ = 1;
+    keepAlive_ = true;
+    chunked_ = false;
+    contentLength_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+    chunkRemain_ = 0;
+}
+
+HttpParser::Status HttpParser::Fail_(const char* error) {
+    error_ = error;
+    return Status::ERROR;
+}
+
+HttpParser::Status HttpParser::Parse(char* data, size_t len, HttpRequestView* req,
+                                     size_t* consumed) {
+    if(stage_ == Stage::HEADER) {
+        /* RFC 7230 §3.5: 请求行之前的空行忽略，否则其中的 CRLF 会被当成头部终止符。
+           跳过的字节计入 consumed 与头部长度上限 */
+        while(skipped_ < len && (data[skipped_] == '\r' || data[skipped_] == '\n')) { ++skipped_; }
+        if(skipped_ == len) {
+            return len > maxHeaderSize_ ? Fail_("header too large") : Status::PARTIAL;
+        }
+        const ScanOps* ops = g_ops.load(std::memory_order_relaxed);
+        /* 回退两个字节，终止符可能跨越两次读取 */
+        size_t from = std::max(scanned_ >= 2 ? scanned_ - 2 : 0, skipped_);
+        size_t end = ops->headerEnd(data, len, from);
+        if(end == 0) {
+            scanned_ = len;
+            return len > maxHeaderSize_ ? Fail_("header too large") : Status::PARTIAL;
+        }
+        if(end > maxHeaderSize_) { return Fail_("header too large"); }
+        headLen_ = end;
+        if(!ParseHead_(data, headLen_)) { return Status::ERROR; }
+        if(chunked_) {
+            stage_ = Stage::CHUNK_SIZE;
+            readPos_ = writePos_ = headLen_;
+        } else {
+            stage_ = Stage::BODY;
+        }
+    }
+
+    if(stage_ == Stage::BODY) {
+        if(len < headLen_ + contentLength_) { return Status::PARTIAL; }
+        *consumed = headLen_ + contentLength_;
+    } else {
+        Status status = ParseChunked_(data, len);
+        if(status != Status::COMPLETE) { return status; }
+        *consumed = readPos_;
+    }
+    Fill_(data, req);
+    Reset();
+    return Status::COMPLETE;
+}
+
+bool HttpParser::ParseHead_(const char* data, size_t headLen) {
+    const ScanOps* ops = g_ops.load(std::memory_order_relaxed);
+    const char* p = data;
+    const char* end = data + headLen;
+    auto span = [data](const char* b, const char* e) {
+        return Span{ static_cast<uint32_t>(b - data), static_cast<uint32_t>(e - b) };
+    };
+
+    /* 请求之间可能有多余的空行 */
+    while(p < end && (*p == '\r' || *p == '\n')) { ++p; }
+
+    /* 请求行: METHOD SP target SP HTTP/1.x CRLF */
+    const char* q = ops->tokenEnd(p, end);
+    if(q == p || q >= end || *q != ' ') { Fail_("bad method"); return false; }
+    method_ = span(p, q);
+    p = q + 1;
+    q = ops->targetEnd(p, end);
+    if(q == p || q >= end || *q != ' ') { Fail_("bad target"); return false; }
+    target_ = span(p, q);
+    p = q + 1;
+    if(end - p < 9 || memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9') {
+        Fail_("bad version");
+        return false;
+    }
+    minorVersion_ = p[7] - '0';
+    p += 8;
+    if(*p == '\r') { ++p; }
+    if(p >= end || *p != '\n') { Fail_("bad request line"); return false; }
+    ++p;
+
+    keepAlive_ = minorVersion_ >= 1;
+    bool hasLength = false;
+    headerCount_ = 0;
+    while(p < end) {
+        if(*p == '\r' || *p == '\n') { break; }
+        if(headerCount_ == HttpRequestView::kMaxHeaders) { Fail_("too many headers"); return false; }
+        q = ops->tokenEnd(p, end);
+        if(q == p || q >= end || *q != ':') { Fail_("bad header name"); return false; }
+        HeaderSpan& header = headers_[headerCount_++];
+        header.name = span(p, q);
+        p = q + 1;
+        while(p < end && (*p == ' ' || *p == '\t')) { ++p; }
+        q = ops->valueEnd(p, end);
+        if(q >= end || (*q != '\r' && *q != '\n')) { Fail_("bad header value"); return false; }
+        const char* valueEnd = q;
+        while(valueEnd > p && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) { --valueEnd; }
+        header.value = span(p, valueEnd);
+        if(*q == '\r') { ++q; }
+        if(q >= end || *q != '\n') { Fail_("bad header line"); return false; }
+        p = q + 1;
+
+        std::string_view name(data + header.name.off, header.name.len);
+        std::string_view value(data + header.value.off, header.value.len);
+        if(EqualsNoCase(name, "Content-Length")) {
+            size_t length = 0;
+            if(value.empty()) { Fail_("bad content-length"); return false; }
+            for(char c : value) {
+                if(c < '0' || c > '9' || length > (maxBodySize_ / 10 + 1)) {
+                    Fail_("bad content-length");
+                    return false;
+                }
+                length = length * 10 + (c - '0');
+            }
+            if(hasLength && length != contentLength_) { Fail_("conflicting content-length"); return false; }
+            hasLength = true;
+            contentLength_ = length;
+        } else if(EqualsNoCase(name, "Transfer-Encoding")) {
+            chunked_ = ListContains(value, "chunked");
+        } else if(EqualsNoCase(name, "Connection")) {
+            if(ListContains(value, "close")) {
+                keepAlive_ = false;
+            } else if(ListContains(value, "keep-alive")) {
+                keepAlive_ = true;
+            }
+        }
+    }
+    if(chunked_) {
+        /* 同时出现时以 Transfer-Encoding 为准 */
+        contentLength_ = 0;
+    } else if(contentLength_ > maxBodySize_) {
+        Fail_("body too large");
+        return false;
+    }
+    return true;
+}
+
+HttpParser::Status HttpParser::ParseChunked_(char* data, size_t len) {
+    while(true) {
+        switch(stage_) {
+        case Stage::CHUNK_SIZE: {
+            const char* nl = static_cast<const char*>(memchr(data + readPos_, '\n', len - readPos_));
+            if(!nl) {
+                return len - readPos_ > 1024 ? Fail_("chunk size line too long") : Status::PARTIAL;
+            }
+            const char* p = data + readPos_;
+            size_t size = 0;
+            int digits = 0;
+            for(; p < nl; p++, digits++) {
+                int v;
+                if(*p >= '0' && *p <= '9') { v = *p - '0'; }
+                else if(*p >= 'a' && *p <= 'f') { v = *p - 'a' + 10; }
+                else if(*p >= 'A' && *p <= 'F') { v = *p - 'A' + 10; }
+                else { break; }
+                if(digits >= 16) { return Fail_("chunk size overflow"); }
+                size = size * 16 + v;
+            }
+            /* 忽略 chunk-ext */
+            if(digits == 0 || (p < nl && *p != ';' && *p != '\r' && *p != ' ' && *p != '\t')) {
+                return Fail_("bad chunk size");
+            }
+            if(writePos_ - headLen_ + size > maxBodySize_) { return Fail_("body too large"); }
+            readPos_ = nl - data + 1;
+            if(size == 0) {
+                stage_ = Stage::CHUNK_TRAILER;
+            } else {
+                chunkRemain_ = size;
+                stage_ = Stage::CHUNK_DATA;
+            }
+            break;
+        }
+        case Stage::CHUNK_DATA: {
+            size_t n = std::min(chunkRemain_, len - readPos_);
+            if(n == 0) { return Status::PARTIAL; }
+            /* 原地压缩: 把块数据前移覆盖已解析的块头 */
+            if(writePos_ != readPos_) {
+                memmove(data + writePos_, data + readPos_, n);
+            }
+            writePos_ += n;
+            readPos_ += n;
+            chunkRemain_ -= n;
+            if(chunkRemain_ == 0) { stage_ = Stage::CHUNK_CRLF; }
+            break;
+        }
+        case Stage::CHUNK_CRLF: {
+            if(readPos_ >= len) { return Status::PARTIAL; }
+            if(data[readPos_] == '\r') {
+                if(readPos_ + 1 >= len) { return Status::PARTIAL; }
+                readPos_++;
+            }
+            if(data[readPos_] != '\n') { return Fail_("bad chunk terminator"); }
+            readPos_++;
+            stage_ = Stage::CHUNK_SIZE;
+            break;
+        }
+        case Stage::CHUNK_TRAILER: {
+            const char* nl = static_cast<const char*>(memchr(data + readPos_, '\n', len - readPos_));
+            if(!nl) {
+                return len - readPos_ > maxHeaderSize_ ? Fail_("trailer too large") : Status::PARTIAL;
+            }
+            size_t lineLen = nl - (data + readPos_);
+            readPos_ = nl - data + 1;
+            if(lineLen == 0 || (lineLen == 1 && nl[-1] == '\r')) {
+                return Status::COMPLETE;
+            }
+            break;
+        }
+        default:
+            return Fail_("bad state");
+        }
+    }
+}
+
+void HttpParser::Fill_(const char* data, HttpRequestView* req) const {
+    auto view = [data](Span s) { return std::string_view(data + s.off, s.len); };
+    req->method = view(method_);
+    req->target = view(target_);
+    size_t qs = req->target.find('?');
+    req->path = req->target.substr(0, qs);
+    req->query = qs == std::string_view::npos ? std::string_view() : req->target.substr(qs + 1);
+    req->minorVersion = minorVersion_;
+    req->headerCount = headerCount_;
+    for(size_t i = 0; i < headerCount_; i++) {
+        req->headers[i].name = view(headers_[i].name);
+        req->headers[i].value = view(headers_[i].value);
+    }
+    req->keepAlive = keepAlive_;
+    req->chunked = chunked_;
+    if(chunked_) {
+        req->body = std::string_view(data + headLen_, writePos_ - headLen_);
+        req->contentLength = req->body.size();
+    } else {
+        req->body = std::string_view(data + headLen_, contentLength_);
+        req->contentLength = contentLength_;
+    }
+}
+
+}  // namespace amot
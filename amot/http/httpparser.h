@@ -0,0 +1,157 @@
+/**
+ * @file httpparser.h
+ * @brief 可恢复的零拷贝 HTTP/1.1 请求解析器，支持流水线与 chunked 请求体
+ * @version 0.1
+ * @date 2024-03-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+namespace amot {
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @brief 解析结果，全部为指向输入缓冲区的视图，缓冲区被修改前有效
+ */
+struct HttpRequestView {
+    static constexpr size_t kMaxHeaders = 64;
+
+    std::string_view method;
+    std::string_view target;    // 原始请求目标，含查询串
+    std::string_view path;
+    std::string_view query;
+    int minorVersion = 1;
+
+    HttpHeader headers[kMaxHeaders];
+    size_t headerCount = 0;
+
+    bool keepAlive = true;
+    bool chunked = false;
+    size_t contentLength = 0;
+    std::string_view body;
+
+    /**
+     * @brief 按名字查找请求头(不区分大小写)，不存在时返回空视图
+     */
+    std::string_view Header(std::string_view name) const;
+};
+
+/**
+ * @brief 扫描所用的指令集
+ */
+enum class HttpScanLevel {
+    SCALAR = 0,
+    SSE42,
+    AVX2,
+};
+
+/**
+ * @brief 当前使用的扫描指令集，默认按 CPU 能力选择最高的
+ */
+HttpScanLevel GetHttpScanLevel();
+
+/**
+ * @brief 指定扫描指令集(用于测试与基准)，CPU 不支持时降级，返回实际生效的级别
+ */
+HttpScanLevel SetHttpScanLevel(HttpScanLevel level);
+
+const char* HttpScanLevelName(HttpScanLevel level);
+
+class HttpParser {
+public:
+    enum class Status {
+        COMPLETE,   // 解析出一个完整请求
+        PARTIAL,    // 数据不足，等待更多数据后以相同起点再次调用
+        ERROR,      // 请求格式错误
+    };
+
+    /**
+     * @param maxHeaderSize     请求行加请求头的长度上限
+     * @param maxBodySize       请求体长度上限
+     */
+    explicit HttpParser(size_t maxHeaderSize = 8192, size_t maxBodySize = 8 << 20);
+
+    /**
+     * @brief 从缓冲区头部解析一个请求
+     * @details 返回 PARTIAL 时解析器记住已扫描的位置，追加数据后以同一起点
+     *          再次调用不会重复扫描。chunked 请求体在缓冲区内原地解码，
+     *          因此需要可写缓冲区。返回 COMPLETE 后 consumed 为该请求占用的
+     *          字节数，解析器自动复位，剩余数据即流水线中的下一个请求。
+     *
+     * @param data          未消费数据的起点，两次调用之间其已有内容不得改变
+     * @param len           可用数据长度
+     * @param req           输出请求视图
+     * @param consumed      输出该请求占用的字节数
+     */
+    Status Parse(char* data, size_t len, HttpRequestView* req, size_t* consumed);
+
+    void Reset();
+
+    /**
+     * @brief 出错时的简要原因
+     */
+    const char* Error() const { return error_; }
+
+private:
+    enum class Stage {
+        HEADER,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_CRLF,
+        CHUNK_TRAILER,
+    };
+
+    struct Span {
+        uint32_t off = 0;
+        uint32_t len = 0;
+    };
+
+    struct HeaderSpan {
+        Span name;
+        Span value;
+    };
+
+    bool ParseHead_(const char* data, size_t headLen);
+    Status ParseChunked_(char* data, size_t len);
+    Status Fail_(const char* error);
+    void Fill_(const char* data, HttpRequestView* req) const;
+
+    size_t maxHeaderSize_;
+    size_t maxBodySize_;
+
+    Stage stage_;
+    const char* error_;
+
+    /* 请求行之前已跳过的空行字节数 */
+    size_t skipped_;
+    /* 头部终止符的续扫起点 */
+    size_t scanned_;
+    size_t headLen_;
+
+    Span method_;
+    Span target_;
+    int minorVersion_;
+    HeaderSpan headers_[HttpRequestView::kMaxHeaders];
+    size_t headerCount_;
+    bool keepAlive_;
+    bool chunked_;
+    size_t contentLength_;
+
+    /* chunked 解码: 读位置、写位置与当前块剩余字节 */
+    size_t readPos_;
+    size_t writePos_;
+    size_t chunkRemain_;
+};
+
+}  // namespace amot
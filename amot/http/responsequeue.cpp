@@ -0,0 +1,206 @@
+#include "responsequeue.h"
+
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+#include "amot/common/clock.h"
+#include "httpmetrics.h"
+
+namespace amot {
+
+namespace {
+constexpr size_t kIovMax = 64;
+}  // namespace
+
+double WriteStats::WritesPerResponse() const {
+    uint64_t n = responses.load(std::memory_order_relaxed);
+    return n ? double(writeCalls.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+double WriteStats::PacketsPerResponse() const {
+    uint64_t n = responses.load(std::memory_order_relaxed);
+    if(n == 0) { return 0.0; }
+    if(!trackSegments.load(std::memory_order_relaxed)) { return WritesPerResponse(); }
+    return double(segments.load(std::memory_order_relaxed)) / n;
+}
+
+void WriteStats::Reset() {
+    responses = 0;
+    writeCalls = 0;
+    bytes = 0;
+    segments = 0;
+}
+
+WriteStats& WriteStats::Global() {
+    static WriteStats stats;
+    return stats;
+}
+
+ResponseQueue::ResponseQueue(FlushPolicy policy)
+    : policy_(policy), pendingBytes_(0), corked_(false) {}
+
+ResponseQueue::~ResponseQueue() {
+    Clear();
+}
+
+void ResponseQueue::Clear() {
+    for(auto& item : items_) {
+        if(item.fileFd >= 0) { close(item.fileFd); }
+    }
+    items_.clear();
+    pendingBytes_ = 0;
+    /* 连接关闭，未写完的响应不计入 */
+    tracked_.clear();
+    pushed_ = written_ = 0;
+}
+
+void ResponseQueue::Push(BufferChain&& response) {
+    WriteStats::Global().responses.fetch_add(1, std::memory_order_relaxed);
+    pendingBytes_ += response.ReadableBytes();
+    pushed_ += response.ReadableBytes();
+    /* 与上一个纯内存响应合并，flush 时少一次 iovec 拼接的遍历 */
+    if(!items_.empty() && items_.back().fileFd < 0) {
+        items_.back().data.Append(std::move(response));
+        return;
+    }
+    items_.emplace_back();
+    items_.back().data = std::move(response);
+}
+
+void ResponseQueue::PushFile(BufferChain&& header, int fileFd, off_t offset, size_t len) {
+    WriteStats::Global().responses.fetch_add(1, std::memory_order_relaxed);
+    pendingBytes_ += header.ReadableBytes() + len;
+    pushed_ += header.ReadableBytes() + len;
+    Item item;
+    item.data = std::move(header);
+    item.fileFd = fileFd;
+    item.offset = offset;
+    item.fileLen = len;
+    items_.push_back(std::move(item));
+}
+
+void ResponseQueue::Track(std::string_view route, int code, uint64_t startNs) {
+    if(!metrics_) { return; }
+    tracked_.push_back(Tracked{pushed_, std::string(route), code, startNs});
+}
+
+void ResponseQueue::Complete_() {
+    if(tracked_.empty() || tracked_.front().end > written_) { return; }
+    /* 一次写出可能完成多个流水线响应，共用一次取时 */
+    uint64_t now = MonotonicNs();
+    while(!tracked_.empty() && tracked_.front().end <= written_) {
+        Tracked& req = tracked_.front();
+        metrics_->OnRequest(req.route, req.code, now > req.startNs ? now - req.startNs : 0);
+        tracked_.pop_front();
+    }
+}
+
+void ResponseQueue::SetCork_(int sockFd, bool on) {
+    if(corked_ == on) { return; }
+    int opt = on ? 1 : 0;
+    /* 非 TCP 套接字上失败可忽略 */
+    setsockopt(sockFd, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt));
+    corked_ = on;
+}
+
+uint32_t ResponseQueue::SegmentsOut_(int sockFd) const {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if(getsockopt(sockFd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) { return 0; }
+    return info.tcpi_segs_out;
+}
+
+ssize_t ResponseQueue::Flush(int sockFd, int* saveErrno) {
+    if(items_.empty()) { return 0; }
+    auto& stats = WriteStats::Global();
+    const bool track = stats.trackSegments.load(std::memory_order_relaxed);
+    const uint32_t segBefore = track ? SegmentsOut_(sockFd) : 0;
+    const bool multi = items_.size() > 1 || items_.front().fileFd >= 0;
+    if(policy_ == FlushPolicy::CORK && multi) {
+        SetCork_(sockFd, true);
+    }
+
+    ssize_t total = 0;
+    bool failed = false;
+    struct iovec iov[kIovMax];
+    while(!items_.empty() && !failed) {
+        /* 把队首连续的内存段拼成一次 writev，遇到文件段停下 */
+        size_t iovCnt = 0;
+        size_t batchItems = 0;
+        for(auto& item : items_) {
+            iovCnt += item.data.PeekIov(iov + iovCnt, kIovMax - iovCnt);
+            batchItems++;
+            if(item.fileFd >= 0 || iovCnt == kIovMax) { break; }
+        }
+        if(iovCnt > 0) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovCnt;
+            int flags = MSG_NOSIGNAL;
+            /* 后面还有数据时提示内核等待凑满一个段 */
+            if(policy_ == FlushPolicy::CORK
+                    && (batchItems < items_.size() || items_[batchItems - 1].fileFd >= 0)) {
+                flags |= MSG_MORE;
+            }
+            ssize_t len = sendmsg(sockFd, &msg, flags);
+            if(len < 0 && errno == ENOTSOCK) {
+                len = writev(sockFd, iov, iovCnt);
+            }
+            stats.writeCalls.fetch_add(1, std::memory_order_relaxed);
+            if(len < 0) {
+                *saveErrno = errno;
+                failed = true;
+                break;
+            }
+            total += len;
+            size_t remain = len;
+            while(remain > 0) {
+                Item& head = items_.front();
+                size_t n = std::min(remain, head.data.ReadableBytes());
+                head.data.Retrieve(n);
+                remain -= n;
+                if(head.data.Empty() && head.fileFd < 0) { items_.pop_front(); }
+                else if(n == 0) { break; }
+            }
+            continue;
+        }
+
+        Item& head = items_.front();
+        if(head.fileFd >= 0 && head.fileLen > 0) {
+            ssize_t len = sendfile(sockFd, head.fileFd, &head.offset, head.fileLen);
+            stats.writeCalls.fetch_add(1, std::memory_order_relaxed);
+            if(len <= 0) {
+                *saveErrno = len < 0 ? errno : EIO;
+                failed = true;
+                break;
+            }
+            total += len;
+            head.fileLen -= len;
+            if(head.fileLen > 0) { continue; }
+        }
+        if(head.fileFd >= 0) { close(head.fileFd); }
+        items_.pop_front();
+    }
+
+    /* 关闭 cork 立即推出尾部不足一个 MSS 的数据 */
+    SetCork_(sockFd, false);
+    pendingBytes_ -= total;
+    written_ += total;
+    Complete_();
+    stats.bytes.fetch_add(total, std::memory_order_relaxed);
+    if(track) {
+        stats.segments.fetch_add(SegmentsOut_(sockFd) - segBefore, std::memory_order_relaxed);
+    }
+    if(failed && total == 0) { return -1; }
+    return total;
+}
+
+}  // namespace amot
@@ -0,0 +1,148 @@
+/**
+ * @file responsequeue.h
+ * @brief 连接上待发送响应的合并写出：一次 writev 发出多个响应，可选 TCP_CORK/MSG_MORE
+ * @version 0.1
+ * @date 2024-03-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "amot/common/buffer.h"
+
+namespace amot {
+
+class HttpMetrics;
+
+/**
+ * @brief 刷新策略
+ */
+enum class FlushPolicy {
+    IMMEDIATE,      // 每个响应入队后立即写出
+    END_OF_LOOP,    // 事件循环每轮结束时统一写出(协程模式下为一次读到的请求全部处理完后)
+    CORK,           // 同 END_OF_LOOP，多段写出期间打开 TCP_CORK 并使用 MSG_MORE
+};
+
+/**
+ * @brief 全局写出统计
+ */
+struct WriteStats {
+    std::atomic<uint64_t> responses{0};
+    std::atomic<uint64_t> writeCalls{0};    // writev/sendmsg/sendfile 调用次数
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> segments{0};      // 实际发出的 TCP 段数(需开启 trackSegments)
+    std::atomic<bool> trackSegments{false};
+
+    /**
+     * @brief 平均每个响应的写调用数
+     */
+    double WritesPerResponse() const;
+
+    /**
+     * @brief 平均每个响应的 TCP 段数，未开启 trackSegments 时退化为写调用数
+     */
+    double PacketsPerResponse() const;
+
+    void Reset();
+
+    static WriteStats& Global();
+};
+
+/**
+ * @brief 单个连接的待发送响应队列
+ */
+class ResponseQueue {
+public:
+    explicit ResponseQueue(FlushPolicy policy = FlushPolicy::END_OF_LOOP);
+    ~ResponseQueue();
+
+    ResponseQueue(const ResponseQueue&) = delete;
+    ResponseQueue& operator=(const ResponseQueue&) = delete;
+
+    /**
+     * @brief 加入一个完整响应(头部与正文都已在链中)
+     */
+    void Push(BufferChain&& response);
+
+    /**
+     * @brief 加入一个头部在链中、正文走 sendfile 的响应，fd 由队列负责关闭
+     */
+    void PushFile(BufferChain&& header, int fileFd, off_t offset, size_t len);
+
+    /**
+     * @brief 写出全部待发送数据
+     * @details 相邻的内存段合并为一次 writev，遇到文件段时用 sendfile。
+     *          CORK 策略下多段写出期间打开 TCP_CORK，结束时关闭让内核立即发出。
+     *
+     * @return ssize_t      写出的字节数，出错(含 EAGAIN)且未写出任何数据时返回 -1
+     */
+    ssize_t Flush(int sockFd, int* saveErrno);
+
+    /**
+     * @brief 是否需要在入队后立即写出
+     */
+    bool NeedFlushNow() const { return policy_ == FlushPolicy::IMMEDIATE; }
+
+    size_t ToWriteBytes() const { return pendingBytes_; }
+
+    size_t PendingResponses() const { return items_.size(); }
+
+    FlushPolicy Policy() const { return policy_; }
+
+    void SetPolicy(FlushPolicy policy) { policy_ = policy; }
+
+    /**
+     * @brief 设置请求指标，未设置时 Track 不生效
+     */
+    void SetMetrics(HttpMetrics* metrics) { metrics_ = metrics; }
+
+    /**
+     * @brief 登记最近加入的响应对应的请求，该响应最后一个字节写出时记入指标
+     *
+     * @param route         HttpMetrics::RouteOf 的结果
+     * @param code          状态码
+     * @param startNs       解析出请求时的 MonotonicNs()
+     */
+    void Track(std::string_view route, int code, uint64_t startNs);
+
+    void Clear();
+
+private:
+    struct Item {
+        BufferChain data;
+        int fileFd = -1;
+        off_t offset = 0;
+        size_t fileLen = 0;
+    };
+
+    /* 已登记的请求，end 为其响应末尾在本连接输出流中的位置 */
+    struct Tracked {
+        uint64_t end;
+        std::string route;
+        int code;
+        uint64_t startNs;
+    };
+
+    void Complete_();
+    void SetCork_(int sockFd, bool on);
+    uint32_t SegmentsOut_(int sockFd) const;
+
+    FlushPolicy policy_;
+    std::deque<Item> items_;
+    size_t pendingBytes_;
+    bool corked_;
+
+    HttpMetrics* metrics_ = nullptr;
+    std::deque<Tracked> tracked_;
+    uint64_t pushed_ = 0;       // 累计入队字节数
+    uint64_t written_ = 0;      // 累计写出字节数
+};
+
+}  // namespace amot
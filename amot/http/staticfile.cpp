@@ -0,0 +1,202 @@
+#include "staticfile.h"
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+
+namespace amot {
+
+namespace {
+
+const char* StatusText(int code) {
+    switch(code) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    default: return "Internal Server Error";
+    }
+}
+
+void AppendConnection(std::string& header, bool keepAlive) {
+    if(keepAlive) {
+        header += "Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n";
+    } else {
+        header += "Connection: close\r\n";
+    }
+}
+
+}  // namespace
+
+StaticFile::~StaticFile() {
+    Reset();
+}
+
+void StaticFile::Reset() {
+    if(fileFd_ >= 0) {
+        close(fileFd_);
+        fileFd_ = -1;
+    }
+    code_ = 0;
+    header_.clear();
+    cached_.reset();
+    iovCnt_ = 0;
+    offset_ = 0;
+    fileRemain_ = 0;
+}
+
+size_t StaticFile::ToWriteBytes() const {
+    size_t len = fileRemain_;
+    for(int i = 0; i < iovCnt_; i++) {
+        len += iov_[i].iov_len;
+    }
+    return len;
+}
+
+ssize_t StaticFile::WriteTo(int sockFd, int* saveErrno) {
+    ssize_t total = 0;
+    /* 头部与缓存文件体一次 writev 发出 */
+    while(iovCnt_ > 0 && ToWriteBytes() > fileRemain_) {
+        ssize_t len = writev(sockFd, iov_, iovCnt_);
+        if(len < 0) {
+            *saveErrno = errno;
+            return total > 0 ? total : -1;
+        }
+        total += len;
+        for(int i = 0; i < iovCnt_ && len > 0; i++) {
+            size_t n = std::min(static_cast<size_t>(len), iov_[i].iov_len);
+            iov_[i].iov_base = static_cast<char*>(iov_[i].iov_base) + n;
+            iov_[i].iov_len -= n;
+            len -= n;
+        }
+    }
+    while(fileRemain_ > 0) {
+        ssize_t len = sendfile(sockFd, fileFd_, &offset_, fileRemain_);
+        if(len <= 0) {
+            *saveErrno = len < 0 ? errno : EIO;
+            return total > 0 ? total : -1;
+        }
+        total += len;
+        fileRemain_ -= len;
+    }
+    return total;
+}
+
+StaticFileServer::StaticFileServer(std::string srcDir, FileCache* cache)
+    : srcDir_(std::move(srcDir)), cache_(cache) {
+    if(!srcDir_.empty() && srcDir_.back() == '/') { srcDir_.pop_back(); }
+}
+
+void StaticFileServer::MakeSimple_(int code, bool keepAlive, StaticFile* out) {
+    std::string body;
+    if(code != 304) {
+        body = "<html><title>Error</title><body bgcolor=\"ffffff\">" + std::to_string(code)
+               + " : " + StatusText(code) + "<hr><em>TinyWebServer</em></body></html>";
+    }
+    out->header_ = "HTTP/1.1 " + std::to_string(code) + " " + StatusText(code) + "\r\n";
+    AppendConnection(out->header_, keepAlive);
+    if(code != 304) {
+        out->header_ += "Content-type: text/html\r\nContent-length: " + std::to_string(body.size())
+                        + "\r\n";
+    }
+    out->header_ += "\r\n" + body;
+    out->iov_[0].iov_base = out->header_.data();
+    out->iov_[0].iov_len = out->header_.size();
+    out->iovCnt_ = 1;
+}
+
+void StaticFileServer::MakeText_(std::string_view contentType, const std::string& body, bool keepAlive,
+                                 StaticFile* out) {
+    out->code_ = 200;
+    out->header_ = "HTTP/1.1 200 OK\r\n";
+    AppendConnection(out->header_, keepAlive);
+    out->header_ += "Content-type: ";
+    out->header_ += contentType;
+    out->header_ += "\r\nContent-length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    out->iov_[0].iov_base = out->header_.data();
+    out->iov_[0].iov_len = out->header_.size();
+    out->iovCnt_ = 1;
+}
+
+int StaticFileServer::Open(const std::string& path, bool keepAlive,
+                           const std::string& ifNoneMatch, StaticFile* out) const {
+    if(metrics_ && path == HttpMetrics::kPath) {
+        out->Reset();
+        MakeText_(HttpMetrics::kContentType, metrics_->Render(), keepAlive, out);
+        return out->code_;
+    }
+    return Open_(path, keepAlive, ifNoneMatch, out);
+}
+
+int StaticFileServer::Open_(const std::string& path, bool keepAlive,
+                            const std::string& ifNoneMatch, StaticFile* out) const {
+    out->Reset();
+    if(path.empty() || path[0] != '/' || path.find("..") != std::string::npos) {
+        out->code_ = 403;
+        MakeSimple_(out->code_, keepAlive, out);
+        return out->code_;
+    }
+    const std::string full = srcDir_ + path;
+
+    /* 小文件：命中缓存时无需 open/stat/read */
+    if(cache_) {
+        auto file = cache_->Get(full);
+        if(file) {
+            if(!ifNoneMatch.empty() && ifNoneMatch == file->etag) {
+                out->code_ = 304;
+                MakeSimple_(out->code_, keepAlive, out);
+                return out->code_;
+            }
+            out->code_ = 200;
+            const std::string& header = keepAlive ? file->keepAliveHeader : file->closeHeader;
+            out->iov_[0].iov_base = const_cast<char*>(header.data());
+            out->iov_[0].iov_len = header.size();
+            out->iov_[1].iov_base = const_cast<char*>(file->data);
+            out->iov_[1].iov_len = file->size;
+            out->iovCnt_ = file->size > 0 ? 2 : 1;
+            out->cached_ = std::move(file);
+            return out->code_;
+        }
+    }
+
+    /* 大文件：sendfile 直接由页缓存拷贝到套接字 */
+    struct stat st;
+    if(stat(full.c_str(), &st) < 0 || S_ISDIR(st.st_mode)) {
+        out->code_ = 404;
+    } else if(!(st.st_mode & S_IROTH)) {
+        out->code_ = 403;
+    }
+    int fd = out->code_ == 0 ? open(full.c_str(), O_RDONLY | O_CLOEXEC) : -1;
+    if(fd < 0) {
+        if(out->code_ == 0) { out->code_ = 404; }
+        MakeSimple_(out->code_, keepAlive, out);
+        return out->code_;
+    }
+    std::string etag = MakeETag(st.st_size, st.st_mtime);
+    if(!ifNoneMatch.empty() && ifNoneMatch == etag) {
+        close(fd);
+        out->code_ = 304;
+        MakeSimple_(out->code_, keepAlive, out);
+        return out->code_;
+    }
+    out->code_ = 200;
+    out->fileFd_ = fd;
+    out->offset_ = 0;
+    out->fileRemain_ = st.st_size;
+    out->header_ = "HTTP/1.1 200 OK\r\n";
+    AppendConnection(out->header_, keepAlive);
+    out->header_ += std::string("Content-type: ") + GetMimeType(full)
+                    + "\r\nContent-length: " + std::to_string(st.st_size)
+                    + "\r\nETag: " + etag
+                    + "\r\nLast-Modified: " + FormatHttpDate(st.st_mtime) + "\r\n\r\n";
+    out->iov_[0].iov_base = out->header_.data();
+    out->iov_[0].iov_len = out->header_.size();
+    out->iovCnt_ = 1;
+    return out->code_;
+}
+
+}  // namespace amot
@@ -0,0 +1,99 @@
+/**
+ * @file staticfile.h
+ * @brief 静态文件响应：小文件走 mmap 缓存 + writev，大文件走 sendfile
+ * @version 0.1
+ * @date 2024-03-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <sys/uio.h>
+#include <string>
+
+#include "filecache.h"
+#include "httpmetrics.h"
+
+namespace amot {
+
+/**
+ * @brief 一次静态文件响应的发送状态
+ */
+class StaticFile {
+public:
+    StaticFile() = default;
+    ~StaticFile();
+
+    StaticFile(const StaticFile&) = delete;
+    StaticFile& operator=(const StaticFile&) = delete;
+
+    /**
+     * @brief 发送剩余数据，非阻塞套接字上遇到 EAGAIN 返回 -1 并设置 saveErrno
+     *
+     * @return ssize_t      本次写出的字节数
+     */
+    ssize_t WriteTo(int sockFd, int* saveErrno);
+
+    size_t ToWriteBytes() const;
+
+    void Reset();
+
+    int Code() const { return code_; }
+
+private:
+    friend class StaticFileServer;
+
+    int code_ = 0;
+    /* 头部来自缓存(iov_[0] 指向缓存内的字符串)或 header_ */
+    std::string header_;
+    FileCache::FilePtr cached_;
+    struct iovec iov_[2] = {};
+    int iovCnt_ = 0;
+
+    /* sendfile 路径 */
+    int fileFd_ = -1;
+    off_t offset_ = 0;
+    size_t fileRemain_ = 0;
+};
+
+class StaticFileServer {
+public:
+    /**
+     * @param srcDir            资源根目录，如 "./resources/"
+     * @param cache             共享的文件缓存，可为 nullptr(全部走 sendfile)
+     */
+    StaticFileServer(std::string srcDir, FileCache* cache);
+
+    /**
+     * @brief 由 HttpMetrics::kPath 提供 Prometheus 文本
+     * @details 请求数与耗时在响应写完时记录，见 ResponseQueue::Track
+     */
+    void SetMetrics(HttpMetrics* metrics) { metrics_ = metrics; }
+
+    /**
+     * @brief 打开静态文件并准备响应
+     *
+     * @param path          请求路径，如 "/index.html"
+     * @param keepAlive     是否保持连接
+     * @param ifNoneMatch   请求中的 If-None-Match，可为空
+     * @param out           响应发送状态
+     * @return int          状态码 200/304/403/404
+     */
+    int Open(const std::string& path, bool keepAlive, const std::string& ifNoneMatch,
+             StaticFile* out) const;
+
+private:
+    int Open_(const std::string& path, bool keepAlive, const std::string& ifNoneMatch,
+              StaticFile* out) const;
+
+    static void MakeSimple_(int code, bool keepAlive, StaticFile* out);
+    static void MakeText_(std::string_view contentType, const std::string& body, bool keepAlive,
+                          StaticFile* out);
+
+    std::string srcDir_;
+    FileCache* cache_;
+    HttpMetrics* metrics_ = nullptr;
+};
+
+}  // namespace amot
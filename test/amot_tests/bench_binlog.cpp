@@ -0,0 +1,78 @@
+/**
+ * 调用点开销对比，按 webserver 连接日志 "Client[{}] in!" 的形式:
+ *   sync    : spdlog 同步写文件，格式化与写入都在调用线程
+ *   async   : LoggerManager 异步模式，调用线程格式化后入队
+ *   binary  : BinaryLog，调用线程只写调用点编号、时间戳和原始参数，后台格式化写文件
+ *   raw     : BinaryLog 写二进制文件，格式化推迟到 amot_binlog_decode
+ * ns/call 只计算调用线程提交的时间，总耗时包含最后一次 flush。
+ * 二进制模式的缓冲按全部消息分配，调用线程不会因后台线程追不上而等待，
+ * 单核机器上更能看出调用点本身的开销。
+ *
+ * 用法: bench_binlog [messages=1000000] [dir=/tmp]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <spdlog/sinks/basic_file_sink.h>
+
+#include "amot/common/binlog.h"
+
+using namespace amot;
+
+using Clock = std::chrono::steady_clock;
+
+static void Report(const char *name, uint64_t messages, Clock::time_point start, Clock::time_point submitted,
+				   Clock::time_point done) {
+	printf("%8s %10.1f ns/call %10.1f ms total\n", name,
+		   std::chrono::duration<double, std::nano>(submitted - start).count() / messages,
+		   std::chrono::duration<double, std::milli>(done - start).count());
+}
+
+static std::shared_ptr<Logger> MakeLogger(const std::string &path) {
+	auto logger = std::make_shared<Logger>("bench", std::make_shared<spdlog::sinks::basic_file_sink_mt>(path, true));
+	logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] [thread %t] : %v");
+	return logger;
+}
+
+int main(int argc, char *argv[]) {
+	uint64_t messages = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	std::string dir = argc > 2 ? argv[2] : "/tmp";
+
+	for (const char *mode : {"sync", "async"}) {
+		auto logger = MakeLogger(dir + "/amot_bench_" + mode + ".log");
+		std::unique_ptr<AsyncLogBackend> backend;
+		if (std::string(mode) == "async") backend = std::make_unique<AsyncLogBackend>(AsyncLogOptions());
+		logger->SetBackend(backend.get());
+		auto start = Clock::now();
+		for (uint64_t i = 0; i < messages; i++) logger->info("Client[{}] in!", int(i));
+		auto submitted = Clock::now();
+		logger->flush();
+		Report(mode, messages, start, submitted, Clock::now());
+		logger->SetBackend(nullptr);
+	}
+
+	BinaryLogOptions options;
+	options.overflow = LogOverflow::BLOCK;
+	options.bufferSize = messages * 32;
+	{
+		BinaryLog binlog(MakeLogger(dir + "/amot_bench_binary.log"), options);
+		auto start = Clock::now();
+		for (uint64_t i = 0; i < messages; i++) AMOT_BINLOG(binlog, spdlog::level::info, "Client[{}] in!", int(i));
+		auto submitted = Clock::now();
+		binlog.Flush();
+		Report("binary", messages, start, submitted, Clock::now());
+	}
+	{
+		std::string path = dir + "/amot_bench_raw.bin";
+		std::remove(path.c_str());
+		BinaryLog binlog(path, options);
+		auto start = Clock::now();
+		for (uint64_t i = 0; i < messages; i++) AMOT_BINLOG(binlog, spdlog::level::info, "Client[{}] in!", int(i));
+		auto submitted = Clock::now();
+		binlog.Flush();
+		Report("raw", messages, start, submitted, Clock::now());
+	}
+	return 0;
+}
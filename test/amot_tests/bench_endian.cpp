@@ -0,0 +1,75 @@
+/**
+ * 批量字节序转换的吞吐，按指令集与元素宽度对比，另给出逐个调用 byteswap 的基线
+ * 以及 ByteArray 写大端数组的吞吐。数据量分别落在 L1、L2 与内存中。
+ *
+ * 用法: bench_endian [total_mb=512]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "amot/common/bytearray.h"
+#include "amot/common/endian.h"
+
+using namespace amot;
+
+using Clock = std::chrono::steady_clock;
+
+/* 防止编译器把结果优化掉 */
+static volatile uint64_t g_sink;
+
+template <class T, class F>
+static double Measure(std::vector<T> &data, size_t totalBytes, F &&fn) {
+	size_t rounds = std::max<size_t>(1, totalBytes / (data.size() * sizeof(T)));
+	auto begin = Clock::now();
+	for (size_t r = 0; r < rounds; r++) fn(data);
+	double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+	g_sink = g_sink + data[data.size() / 2];
+	return double(rounds) * data.size() * sizeof(T) / sec / 1e9;
+}
+
+template <class T>
+static void BenchWidth(size_t elements, size_t totalBytes) {
+	std::vector<T> data(elements);
+	for (size_t i = 0; i < elements; i++) data[i] = static_cast<T>(i * 0x9e3779b97f4a7c15ull);
+
+	double scalarLoop = Measure(data, totalBytes, [](std::vector<T> &v) {
+		for (auto &x : v) x = byteswap(x);
+	});
+	printf("  u%-2zu %10s %8.2f GB/s", sizeof(T) * 8, "per-value", scalarLoop);
+	for (auto level : {ByteswapLevel::SCALAR, ByteswapLevel::SSSE3, ByteswapLevel::AVX2}) {
+		if (setByteswapLevel(level) != level) continue;
+		double gbs = Measure(data, totalBytes, [](std::vector<T> &v) { byteswap(std::span<T>(v)); });
+		printf("  %6s %8.2f GB/s", byteswapLevelName(level), gbs);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+	size_t totalBytes = size_t(argc > 1 ? atoi(argv[1]) : 512) << 20;
+	ByteswapLevel best = getByteswapLevel();
+	printf("default level: %s\n", byteswapLevelName(best));
+	for (size_t bytes : {size_t(16) << 10, size_t(256) << 10, size_t(64) << 20}) {
+		printf("working set %zu KB\n", bytes >> 10);
+		BenchWidth<uint16_t>(bytes / 2, totalBytes);
+		BenchWidth<uint32_t>(bytes / 4, totalBytes);
+		BenchWidth<uint64_t>(bytes / 8, totalBytes);
+		setByteswapLevel(best);
+	}
+
+	/* ByteArray：定长逐个写入与数组批量写入 */
+	std::vector<uint32_t> values(64 << 10);
+	for (size_t i = 0; i < values.size(); i++) values[i] = static_cast<uint32_t>(i);
+	ByteArray ba;
+	double single = Measure(values, totalBytes, [&](std::vector<uint32_t> &v) {
+		ba.Clear();
+		for (auto x : v) ba.WriteBE(x);
+	});
+	double bulk = Measure(values, totalBytes, [&](std::vector<uint32_t> &v) {
+		ba.Clear();
+		ba.WriteArrayBE<uint32_t>(v);
+	});
+	printf("ByteArray u32 BE: WriteBE %.2f GB/s, WriteArrayBE %.2f GB/s\n", single, bulk);
+	return 0;
+}
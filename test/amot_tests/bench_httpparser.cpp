@@ -0,0 +1,99 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include "amot/http/httpparser.h"
+
+using namespace amot;
+
+struct Sample {
+	const char *name;
+	std::string raw;
+};
+
+static std::vector<Sample> MakeSamples() {
+	std::vector<Sample> samples;
+	samples.push_back({"curl", "GET /index.html HTTP/1.1\r\n"
+							   "Host: 127.0.0.1:1316\r\n"
+							   "User-Agent: curl/7.88.1\r\n"
+							   "Accept: */*\r\n"
+							   "\r\n"});
+	samples.push_back({"browser",
+					   "GET /images/profile/avatar.jpg?size=large&v=20240316 HTTP/1.1\r\n"
+					   "Host: www.example.com\r\n"
+					   "Connection: keep-alive\r\n"
+					   "sec-ch-ua: \"Chromium\";v=\"122\", \"Not(A:Brand\";v=\"24\"\r\n"
+					   "sec-ch-ua-mobile: ?0\r\n"
+					   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+					   "(KHTML, like Gecko) Chrome/122.0.0.0 Safari/537.36\r\n"
+					   "sec-ch-ua-platform: \"Linux\"\r\n"
+					   "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+					   "Sec-Fetch-Site: same-origin\r\n"
+					   "Sec-Fetch-Mode: no-cors\r\n"
+					   "Sec-Fetch-Dest: image\r\n"
+					   "Referer: https://www.example.com/users/profile/settings\r\n"
+					   "Accept-Encoding: gzip, deflate, br\r\n"
+					   "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+					   "Cookie: session=6f1c2b7a9e0d4c3b8a7f6e5d4c3b2a19; theme=dark; "
+					   "_ga=GA1.1.123456789.1700000000; _gid=GA1.1.987654321.1710000000\r\n"
+					   "\r\n"});
+	samples.push_back({"post-form", "POST /login HTTP/1.1\r\n"
+									"Host: 127.0.0.1:1316\r\n"
+									"Content-Type: application/x-www-form-urlencoded\r\n"
+									"Content-Length: 27\r\n"
+									"Origin: http://127.0.0.1:1316\r\n"
+									"\r\n"
+									"username=amot&password=1234"});
+	return samples;
+}
+
+/**
+ * @brief 把同一请求重复拼接成流水线，逐个解析，统计吞吐
+ */
+static void BenchOne(const Sample &sample, HttpScanLevel level) {
+	const int kPipeline = 1024;
+	const int kRounds = 200;
+	std::string stream;
+	stream.reserve(sample.raw.size() * kPipeline);
+	for (int i = 0; i < kPipeline; ++i)
+		stream += sample.raw;
+
+	HttpParser parser;
+	HttpRequestView req;
+	size_t headers = 0;
+	auto begin = std::chrono::steady_clock::now();
+	for (int r = 0; r < kRounds; ++r) {
+		size_t off = 0, consumed = 0;
+		while (off < stream.size()) {
+			if (parser.Parse(stream.data() + off, stream.size() - off, &req, &consumed) !=
+				HttpParser::Status::COMPLETE) {
+				spdlog::error("parse error: {}", parser.Error());
+				return;
+			}
+			headers += req.headerCount;
+			off += consumed;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double sec = std::chrono::duration<double>(end - begin).count();
+	double bytes = double(stream.size()) * kRounds;
+	double reqs = double(kPipeline) * kRounds;
+	spdlog::info("{:<10} {:<7} {:>6} B/req  {:>6.2f} GB/s  {:>7.2f} Mreq/s  ({} headers)",
+				 sample.name, HttpScanLevelName(level), sample.raw.size(), bytes / sec / 1e9,
+				 reqs / sec / 1e6, headers / (kPipeline * kRounds));
+}
+
+int main() {
+	spdlog::set_pattern("%v");
+	auto samples = MakeSamples();
+	for (auto level : {HttpScanLevel::SCALAR, HttpScanLevel::SSE42, HttpScanLevel::AVX2}) {
+		if (SetHttpScanLevel(level) != level) {
+			spdlog::info("{} not supported, skipped", HttpScanLevelName(level));
+			continue;
+		}
+		for (auto &sample : samples)
+			BenchOne(sample, level);
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * 多线程写文件日志的吞吐，对比同步日志器与异步模式的各溢出策略:
+ *   sync    : spdlog basic_file_sink_mt，每条消息在调用线程加锁写入
+ *   batch   : 同步日志器 + BatchFileSink，调用线程只格式化进内存缓冲，I/O 线程批量写盘
+ *   block   : 异步，缓冲满时等待
+ *   drop    : 异步，缓冲满时丢弃新消息
+ *   overrun : 异步，缓冲满时丢弃最旧的消息
+ * 调用方吞吐只计算各线程提交完的时间，总吞吐包含最后一次 flush。
+ *
+ * 用法: bench_log [max_threads=8] [messages=1000000] [path=/tmp/amot_bench.log]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "amot/common/log.h"
+
+using namespace amot;
+
+struct Result {
+	double caller;
+	double total;
+};
+
+static Result Run(const std::string &path, int threads, uint64_t messages, AsyncLogBackend *backend,
+				  bool batched = false) {
+	std::remove(path.c_str());
+	spdlog::sink_ptr sink;
+	if (batched) {
+		sink = std::make_shared<BatchFileSink>(path);
+	} else {
+		sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(path, true);
+	}
+	auto logger = std::make_shared<Logger>("bench", sink);
+	logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] [thread %t] : %v");
+	logger->SetBackend(backend);
+	uint64_t perThread = messages / threads;
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([&, t]() {
+			for (uint64_t i = 0; i < perThread; i++) {
+				logger->info("Client[{}] in! seq {}", t, i);
+			}
+		});
+	}
+	for (auto &worker : workers) worker.join();
+	auto submitted = std::chrono::steady_clock::now();
+	logger->flush();
+	auto done = std::chrono::steady_clock::now();
+	logger->SetBackend(nullptr);
+	uint64_t total = perThread * threads;
+	return {total / std::chrono::duration<double>(submitted - start).count(),
+			total / std::chrono::duration<double>(done - start).count()};
+}
+
+int main(int argc, char *argv[]) {
+	int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+	uint64_t messages = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+	std::string path = argc > 3 ? argv[3] : "/tmp/amot_bench.log";
+	printf("%d cpus, %llu messages per run, caller msg/s (total msg/s)\n",
+		   (int)std::thread::hardware_concurrency(), (unsigned long long)messages);
+	printf("%8s %24s %24s %24s %24s %24s\n", "threads", "sync", "batch", "block", "drop", "overrun");
+	LogOverflow policies[] = {LogOverflow::BLOCK, LogOverflow::DROP, LogOverflow::OVERRUN};
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		Result results[5];
+		results[0] = Run(path, threads, messages, nullptr);
+		results[1] = Run(path, threads, messages, nullptr, true);
+		for (int p = 0; p < 3; p++) {
+			AsyncLogOptions options;
+			options.overflow = policies[p];
+			AsyncLogBackend backend(options);
+			results[p + 2] = Run(path, threads, messages, &backend);
+		}
+		printf("%8d", threads);
+		for (auto &r : results) printf(" %11.0f (%10.0f)", r.caller, r.total);
+		printf("\n");
+	}
+	return 0;
+}
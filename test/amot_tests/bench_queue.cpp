@@ -0,0 +1,75 @@
+/**
+ * Queue(加锁，无界/有界) 与 MpmcQueue(无锁有界) 在多生产者多消费者下的吞吐:
+ *   pop   : 消费者逐个 pop
+ *   drain : 消费者用 drain_to 批量取，MpmcQueue 为逐个 try_pop
+ *
+ * 用法: bench_queue [max_threads=8] [items=1000000] [capacity=1024]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "amot/common/mpmcqueue.h"
+#include "amot/common/queue.h"
+
+using namespace amot;
+
+template <typename Q>
+static double Run(Q &queue, int producers, int consumers, uint64_t items, bool drain) {
+	uint64_t perProducer = items / producers;
+	uint64_t total = perProducer * producers;
+	std::atomic<uint64_t> consumed{0};
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&]() {
+			for (uint64_t i = 0; i < perProducer; i++) queue.push(uint64_t(i));
+		});
+	}
+	for (int c = 0; c < consumers; c++) {
+		threads.emplace_back([&]() {
+			std::vector<uint64_t> batch;
+			uint64_t value;
+			while (consumed.load(std::memory_order_relaxed) < total) {
+				size_t n = 0;
+				if (drain) {
+					batch.clear();
+					n = queue.drain_to(batch, 64);
+				} else if (queue.pop(value)) {
+					n = 1;
+				}
+				if (n) consumed.fetch_add(n, std::memory_order_relaxed);
+				else if (drain) std::this_thread::yield();
+			}
+			// 唤醒仍阻塞在 pop 的其它消费者
+			queue.stop();
+		});
+	}
+	for (auto &t : threads) t.join();
+	return total / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+	int maxThreads = argc > 1 ? atoi(argv[1]) : 8;
+	uint64_t items = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+	size_t capacity = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1024;
+	printf("%d cpus, %llu items per run, capacity %zu\n", (int)std::thread::hardware_concurrency(),
+		   (unsigned long long)items, capacity);
+	printf("%6s %14s %14s %14s %14s %14s\n", "p x c", "unbounded/s", "bounded/s", "bounded-drain/s",
+		   "mpmc/s", "mpmc-drain/s");
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		Queue<uint64_t> unbounded;
+		Queue<uint64_t> bounded(capacity), boundedDrain(capacity);
+		MpmcQueue<uint64_t> mpmc(capacity), mpmcDrain(capacity);
+		double a = Run(unbounded, threads, threads, items, false);
+		double b = Run(bounded, threads, threads, items, false);
+		double c = Run(boundedDrain, threads, threads, items, true);
+		double d = Run(mpmc, threads, threads, items, false);
+		double e = Run(mpmcDrain, threads, threads, items, true);
+		printf("%3dx%-2d %14.0f %14.0f %14.0f %14.0f %14.0f\n", threads, threads, a, b, c, d, e);
+	}
+	return 0;
+}
@@ -0,0 +1,333 @@
+/**
+ * 对比两种连接处理模型在回环上的吞吐与延迟:
+ *   threadpool : 主线程 epoll(EPOLLONESHOT)，每个事件 scheduleById 一个任务到线程池，
+ *                处理完再 ModFd 重新注册 —— 即 WebServer 原有模型
+ *   coroutine  : 每个连接一个 Task，跑在 Reactor 上，读-解析-处理-写顺序执行
+ *
+ * 用法: bench_reactor [connections=64] [seconds=3] [workers=2]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "amot/common/histogram.h"
+#include "amot/common/threadPool.h"
+#include "amot/coroutine/reactor.h"
+
+using namespace amot;
+
+static const char kRequest[] = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+static const char kResponse[] = "HTTP/1.1 200 OK\r\nContent-Length: 13\r\n\r\nHello, World!";
+
+static uint64_t NowNS() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void SetNonblock(int fd) {
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static int Listen(int *port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	listen(fd, 1024);
+	socklen_t len = sizeof(addr);
+	getsockname(fd, (struct sockaddr *)&addr, &len);
+	*port = ntohs(addr.sin_port);
+	SetNonblock(fd);
+	return fd;
+}
+
+/**
+ * @brief 连接上的请求处理：按空行切分请求，每个请求回一个固定响应
+ */
+struct Conn {
+	std::string in;
+	std::string out;
+
+	void Process() {
+		size_t pos = 0, end;
+		while ((end = in.find("\r\n\r\n", pos)) != std::string::npos) {
+			out.append(kResponse, sizeof(kResponse) - 1);
+			pos = end + 4;
+		}
+		in.erase(0, pos);
+	}
+};
+
+/* ---------------- 线程池模型 ---------------- */
+
+class ThreadPoolServer {
+public:
+	ThreadPoolServer(int workers) : _pool(workers), _conns(65536) {
+		_listen = Listen(&_port);
+		_epfd = epoll_create1(0);
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = _listen;
+		epoll_ctl(_epfd, EPOLL_CTL_ADD, _listen, &ev);
+		_thread = std::thread([this] { Loop(); });
+	}
+
+	~ThreadPoolServer() {
+		_stop = true;
+		_thread.join();
+		close(_listen);
+		close(_epfd);
+	}
+
+	int Port() const { return _port; }
+
+private:
+	void Loop() {
+		struct epoll_event events[256];
+		while (!_stop) {
+			int n = epoll_wait(_epfd, events, 256, 10);
+			for (int i = 0; i < n; i++) {
+				int fd = events[i].data.fd;
+				if (fd == _listen) {
+					int c;
+					while ((c = accept(_listen, nullptr, nullptr)) >= 0) {
+						SetNonblock(c);
+						_conns[c] = Conn();
+						struct epoll_event ev = {};
+						ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP;
+						ev.data.fd = c;
+						epoll_ctl(_epfd, EPOLL_CTL_ADD, c, &ev);
+					}
+					continue;
+				}
+				if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+					epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr);
+					close(fd);
+					continue;
+				}
+				// 与 WebServer::DealRead_ 相同：每个事件一个 std::function 任务
+				_pool.scheduleById(std::bind(&ThreadPoolServer::OnEvent, this, fd));
+			}
+		}
+	}
+
+	void OnEvent(int fd) {
+		Conn &conn = _conns[fd];
+		char buf[4096];
+		ssize_t len;
+		while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+			conn.in.append(buf, len);
+		}
+		if (len == 0) {
+			epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr);
+			close(fd);
+			return;
+		}
+		conn.Process();
+		uint32_t next = EPOLLIN;
+		while (!conn.out.empty()) {
+			len = ::write(fd, conn.out.data(), conn.out.size());
+			if (len <= 0) {
+				next = EPOLLOUT;
+				break;
+			}
+			conn.out.erase(0, len);
+		}
+		struct epoll_event ev = {};
+		ev.events = next | EPOLLET | EPOLLONESHOT | EPOLLRDHUP;
+		ev.data.fd = fd;
+		epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev);
+	}
+
+	ThreadPool _pool;
+	std::vector<Conn> _conns;
+	int _listen;
+	int _port;
+	int _epfd;
+	std::atomic<bool> _stop{false};
+	std::thread _thread;
+};
+
+/* ---------------- 协程模型 ---------------- */
+
+static Reactor::ConnTask Serve(int fd) {
+	Reactor *reactor = Reactor::current();
+	reactor->add_fd(fd);
+	Conn conn;
+	char buf[4096];
+	while (true) {
+		ssize_t len = ::read(fd, buf, sizeof(buf));
+		if (len > 0) {
+			conn.in.append(buf, len);
+			continue;
+		}
+		if (len == 0 || errno != EAGAIN) break;
+		conn.Process();
+		bool failed = false;
+		while (!conn.out.empty()) {
+			ssize_t n = ::write(fd, conn.out.data(), conn.out.size());
+			if (n > 0) {
+				conn.out.erase(0, n);
+			} else if (errno != EAGAIN || !co_await reactor->writable(fd)) {
+				failed = true;
+				break;
+			}
+		}
+		if (failed || !co_await reactor->readable(fd)) break;
+	}
+	reactor->remove_fd(fd);
+	close(fd);
+}
+
+class CoroutineServer {
+public:
+	CoroutineServer(int reactors) {
+		_listen = Listen(&_port);
+		for (int i = 0; i < reactors; i++) {
+			_reactors.emplace_back(new Reactor());
+			_reactors.back()->start();
+		}
+		_thread = std::thread([this] { Loop(); });
+	}
+
+	~CoroutineServer() {
+		_stop = true;
+		_thread.join();
+		_reactors.clear();
+		close(_listen);
+	}
+
+	int Port() const { return _port; }
+
+private:
+	void Loop() {
+		int epfd = epoll_create1(0);
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = _listen;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, _listen, &ev);
+		size_t next = 0;
+		while (!_stop) {
+			if (epoll_wait(epfd, &ev, 1, 10) <= 0) continue;
+			int c;
+			while ((c = accept(_listen, nullptr, nullptr)) >= 0) {
+				SetNonblock(c);
+				_reactors[next++ % _reactors.size()]->spawn([c] { return Serve(c); });
+			}
+		}
+		close(epfd);
+	}
+
+	std::vector<std::unique_ptr<Reactor>> _reactors;
+	int _listen;
+	int _port;
+	std::atomic<bool> _stop{false};
+	std::thread _thread;
+};
+
+/* ---------------- 客户端 ---------------- */
+
+struct ClientResult {
+	uint64_t requests = 0;
+	Histogram latency;
+};
+
+/**
+ * @brief 单线程 epoll 闭环客户端，每个连接同时只有一个请求在途
+ */
+static void RunClient(int port, int connections, double seconds, ClientResult *result) {
+	int epfd = epoll_create1(0);
+	std::vector<uint64_t> sent(65536);
+	std::vector<std::string> bufs(65536);
+	std::vector<int> fds;
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	for (int i = 0; i < connections; i++) {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			perror("connect");
+			exit(1);
+		}
+		SetNonblock(fd);
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+		fds.push_back(fd);
+		sent[fd] = NowNS();
+		ssize_t n = ::write(fd, kRequest, sizeof(kRequest) - 1);
+		(void)n;
+	}
+	const size_t respLen = sizeof(kResponse) - 1;
+	uint64_t end = NowNS() + uint64_t(seconds * 1e9);
+	struct epoll_event events[256];
+	char buf[4096];
+	while (NowNS() < end) {
+		int n = epoll_wait(epfd, events, 256, 10);
+		for (int i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+			ssize_t len;
+			while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+				bufs[fd].append(buf, len);
+			}
+			while (bufs[fd].size() >= respLen) {
+				bufs[fd].erase(0, respLen);
+				uint64_t now = NowNS();
+				result->latency.Record(now - sent[fd]);
+				result->requests++;
+				sent[fd] = now;
+				ssize_t w = ::write(fd, kRequest, sizeof(kRequest) - 1);
+				(void)w;
+			}
+		}
+	}
+	for (int fd : fds) close(fd);
+	close(epfd);
+}
+
+static void Report(const char *name, const ClientResult &r, double seconds) {
+	printf("%-11s %10.0f req/s   p50 %7.1fus   p99 %8.1fus   p99.9 %8.1fus\n", name,
+		   r.requests / seconds, r.latency.Percentile(50) / 1e3,
+		   r.latency.Percentile(99) / 1e3, r.latency.Percentile(99.9) / 1e3);
+}
+
+int main(int argc, char *argv[]) {
+	int connections = argc > 1 ? atoi(argv[1]) : 64;
+	double seconds = argc > 2 ? atof(argv[2]) : 3.0;
+	int workers = argc > 3 ? atoi(argv[3]) : 2;
+	printf("connections %d, %.1fs, %d workers/reactors\n", connections, seconds, workers);
+	{
+		ThreadPoolServer server(workers);
+		ClientResult result;
+		RunClient(server.Port(), connections, seconds, &result);
+		Report("threadpool", result, seconds);
+	}
+	{
+		CoroutineServer server(workers);
+		ClientResult result;
+		RunClient(server.Port(), connections, seconds, &result);
+		Report("coroutine", result, seconds);
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * ThreadPool 空任务吞吐随线程数的伸缩:
+ *   inject  : 外部线程连续提交空任务，走全局注入队列
+ *   fanout  : 每个任务在工作线程内再提交两个子任务(二叉树)，走本地双端队列与窃取
+ *   pinned  : 外部线程按 id 轮流指定工作线程提交
+ *
+ * 用法: bench_threadpool [max_threads=64] [tasks=1000000]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "amot/common/threadPool.h"
+
+using namespace amot;
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void WaitFor(const std::atomic<uint64_t> &done, uint64_t total) {
+	while (done.load(std::memory_order_acquire) < total) {
+		std::this_thread::yield();
+	}
+}
+
+static double Inject(int threads, uint64_t tasks) {
+	ThreadPool pool(threads, true);
+	std::atomic<uint64_t> done{0};
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < tasks; i++) {
+		pool.scheduleById([&done]() { done.fetch_add(1, std::memory_order_release); });
+	}
+	WaitFor(done, tasks);
+	return tasks / Seconds(start);
+}
+
+static void Spawn(ThreadPool *pool, std::atomic<uint64_t> *done, int depth) {
+	done->fetch_add(1, std::memory_order_release);
+	if (depth == 0) return;
+	pool->scheduleById([=]() { Spawn(pool, done, depth - 1); });
+	pool->scheduleById([=]() { Spawn(pool, done, depth - 1); });
+}
+
+static double Fanout(int threads, uint64_t tasks) {
+	int depth = 0;
+	while ((2ull << (depth + 1)) - 1 <= tasks) depth++;
+	uint64_t total = (2ull << depth) - 1;
+	ThreadPool pool(threads, true);
+	std::atomic<uint64_t> done{0};
+	auto start = std::chrono::steady_clock::now();
+	pool.scheduleById([&pool, &done, depth]() { Spawn(&pool, &done, depth); });
+	WaitFor(done, total);
+	return total / Seconds(start);
+}
+
+static double Pinned(int threads, uint64_t tasks) {
+	ThreadPool pool(threads, true);
+	std::atomic<uint64_t> done{0};
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < tasks; i++) {
+		pool.scheduleById([&done]() { done.fetch_add(1, std::memory_order_release); },
+						  i % threads);
+	}
+	WaitFor(done, tasks);
+	return tasks / Seconds(start);
+}
+
+int main(int argc, char *argv[]) {
+	int maxThreads = argc > 1 ? atoi(argv[1]) : 64;
+	uint64_t tasks = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+	printf("%d cpus, %llu tasks per run\n", (int)std::thread::hardware_concurrency(),
+		   (unsigned long long)tasks);
+	printf("%8s %14s %14s %14s\n", "threads", "inject/s", "fanout/s", "pinned/s");
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		double inject = Inject(threads, tasks);
+		double fanout = Fanout(threads, tasks);
+		double pinned = Pinned(threads, tasks);
+		printf("%8d %14.0f %14.0f %14.0f\n", threads, inject, fanout, pinned);
+	}
+	return 0;
+}
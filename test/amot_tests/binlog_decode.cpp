@@ -0,0 +1,37 @@
+/**
+ * 把 BinaryLog 写出的二进制日志解码为文本，格式仿照 LoggerManager 的默认格式，另附调用点位置
+ *
+ * 用法: amot_binlog_decode <file.bin> [more.bin ...]
+ */
+#include <cstdio>
+#include <ctime>
+
+#include "amot/common/binlog.h"
+
+using namespace amot;
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <file.bin> [more.bin ...]\n", argv[0]);
+		return 1;
+	}
+	for (int i = 1; i < argc; i++) {
+		BinlogReader reader(argv[i]);
+		if (!reader.IsOpen()) {
+			fprintf(stderr, "failed to open %s\n", argv[i]);
+			return 1;
+		}
+		BinlogReader::Entry entry;
+		while (reader.Next(entry)) {
+			time_t seconds = entry.wallNs / 1000000000;
+			struct tm tm;
+			localtime_r(&seconds, &tm);
+			char time[32];
+			strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &tm);
+			auto level = spdlog::level::to_string_view(entry.level);
+			printf("[%s.%03d] [%.*s] [thread %u] [%s:%d] : %s\n", time, int(entry.wallNs / 1000000 % 1000),
+				   int(level.size()), level.data(), entry.tid, entry.file.c_str(), entry.line, entry.text.c_str());
+		}
+	}
+	return 0;
+}
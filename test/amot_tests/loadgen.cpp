@@ -0,0 +1,470 @@
+/**
+ * @file loadgen.cpp
+ * @brief 基于 epoll 的 HTTP/1.1 压测工具，支持闭环/开环、流水线深度与请求配比
+ * @version 0.1
+ * @date 2024-04-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ * 闭环: 每个连接始终保持 pipeline 个请求在途，收到一个响应立即补发一个。
+ * 开环: 按 -r 给定的总速率均匀排定每个请求的计划发送时间，延迟从计划时间
+ *       算起，服务端变慢导致的发送推迟也计入延迟(避免协调遗漏)。
+ * 闭环下可用 -i 给出期望间隔，按 HdrHistogram 的方式补记被遗漏的样本。
+ *
+ * 例: amot_loadgen -c 64 -t 2 -d 10 -P 4 -m /index.html:8,/picture.html:2
+ *     amot_loadgen -c 32 -r 20000 -d 10
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "amot/common/epoller.h"
+#include "amot/common/histogram.h"
+
+using namespace amot;
+
+namespace {
+
+struct Target {
+	std::string path;
+	unsigned weight;
+	std::string request;
+};
+
+struct Options {
+	std::string host = "127.0.0.1";
+	int port = 1316;
+	int connections = 64;
+	int threads = 1;
+	double duration = 10.0;
+	double warmup = 1.0;
+	int pipeline = 1;
+	double rate = 0.0;			// 总请求速率，0 表示闭环
+	double intervalUS = 0.0;	// 闭环下协调遗漏修正的期望间隔
+	std::vector<Target> mix;
+};
+
+struct Result {
+	Histogram latency;
+	uint64_t responses = 0;
+	uint64_t errors = 0;
+	uint64_t reconnects = 0;
+	uint64_t bytes = 0;
+};
+
+uint64_t NowNS() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+struct Conn {
+	int fd = -1;
+	bool connected = false;
+	bool wantWrite = false;
+	std::string out;
+	size_t outOff = 0;
+	std::string in;
+	std::deque<uint64_t> inflight;	// 每个在途请求的起始时间(开环为计划时间)
+	uint64_t nextSend = 0;			// 开环下一个请求的计划时间
+	uint64_t interval = 0;			// 开环每连接请求间隔
+	uint32_t rng = 0;
+};
+
+class Worker {
+public:
+	Worker(const Options& opt, int connections, double rate, uint64_t startNS, Result* result)
+		: opt_(opt), epoller_(connections + 16), result_(result), conns_(connections),
+		  start_(startNS),
+		  measureFrom_(startNS + uint64_t(opt.warmup * 1e9)),
+		  end_(startNS + uint64_t((opt.warmup + opt.duration) * 1e9)) {
+		totalWeight_ = 0;
+		for(auto& t : opt_.mix) { totalWeight_ += t.weight; }
+		for(size_t i = 0; i < conns_.size(); i++) {
+			Conn& c = conns_[i];
+			c.rng = uint32_t(0x9e3779b9u * (i + 1) + reinterpret_cast<uintptr_t>(this));
+			if(rate > 0) {
+				c.interval = uint64_t(1e9 * connections / rate);
+				/* 错开各连接的首个请求，避免同一时刻齐发 */
+				c.nextSend = start_ + c.interval * i / conns_.size();
+			}
+		}
+		memset(&addr_, 0, sizeof(addr_));
+		addr_.sin_family = AF_INET;
+		addr_.sin_port = htons(opt_.port);
+		inet_pton(AF_INET, opt_.host.c_str(), &addr_.sin_addr);
+	}
+
+	void Run() {
+		for(size_t i = 0; i < conns_.size(); i++) { Connect_(i); }
+		const bool open = conns_.empty() ? false : conns_[0].interval > 0;
+		while(true) {
+			uint64_t now = NowNS();
+			if(now >= end_) { break; }
+			if(open) {
+				for(size_t i = 0; i < conns_.size(); i++) { Schedule_(i, now); }
+			}
+			int timeout = open ? 1 : 10;
+			int n = epoller_.Wait(timeout);
+			for(int k = 0; k < n; k++) {
+				int idx = fdIndex_[epoller_.GetEventFd(k)];
+				uint32_t events = epoller_.GetEvents(k);
+				Conn& c = conns_[idx];
+				if(!c.connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+					int err = 0;
+					socklen_t len = sizeof(err);
+					getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+					if(err != 0) { Reset_(idx); continue; }
+					c.connected = true;
+					if(!open) { Fill_(idx, NowNS()); }
+				}
+				if(events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+					if(!OnRead_(idx)) { Reset_(idx); continue; }
+				}
+				if(c.connected && (events & EPOLLOUT)) {
+					if(!Flush_(idx)) { Reset_(idx); continue; }
+				}
+			}
+		}
+		for(auto& c : conns_) {
+			if(c.fd >= 0) { close(c.fd); }
+		}
+	}
+
+private:
+	void Connect_(size_t idx) {
+		Conn& c = conns_[idx];
+		c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		if(c.fd < 0) { perror("socket"); exit(1); }
+		int one = 1;
+		setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		int ret = connect(c.fd, reinterpret_cast<struct sockaddr*>(&addr_), sizeof(addr_));
+		if(ret < 0 && errno != EINPROGRESS) { perror("connect"); exit(1); }
+		c.connected = false;
+		c.wantWrite = true;
+		if(static_cast<size_t>(c.fd) >= fdIndex_.size()) { fdIndex_.resize(c.fd + 1, -1); }
+		fdIndex_[c.fd] = static_cast<int>(idx);
+		epoller_.AddFd(c.fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP);
+	}
+
+	/**
+	 * @brief 连接出错或被对端关闭：在途请求记为错误并重连
+	 */
+	void Reset_(size_t idx) {
+		Conn& c = conns_[idx];
+		result_->errors += c.inflight.size();
+		result_->reconnects++;
+		epoller_.DelFd(c.fd);
+		close(c.fd);
+		c.fd = -1;
+		c.inflight.clear();
+		c.out.clear();
+		c.outOff = 0;
+		c.in.clear();
+		Connect_(idx);
+	}
+
+	const Target& Pick_(Conn& c) {
+		if(opt_.mix.size() == 1) { return opt_.mix[0]; }
+		/* xorshift32 */
+		c.rng ^= c.rng << 13;
+		c.rng ^= c.rng >> 17;
+		c.rng ^= c.rng << 5;
+		unsigned r = c.rng % totalWeight_;
+		for(auto& t : opt_.mix) {
+			if(r < t.weight) { return t; }
+			r -= t.weight;
+		}
+		return opt_.mix.back();
+	}
+
+	void Send_(size_t idx, uint64_t startNS) {
+		Conn& c = conns_[idx];
+		c.out += Pick_(c).request;
+		c.inflight.push_back(startNS);
+	}
+
+	/**
+	 * @brief 闭环：补满在途请求
+	 */
+	void Fill_(size_t idx, uint64_t now) {
+		Conn& c = conns_[idx];
+		while(c.inflight.size() < static_cast<size_t>(opt_.pipeline)) {
+			Send_(idx, now);
+		}
+		if(!Flush_(idx)) { Reset_(idx); }
+	}
+
+	/**
+	 * @brief 开环：发出所有已到计划时间的请求，受流水线深度限制
+	 */
+	void Schedule_(size_t idx, uint64_t now) {
+		Conn& c = conns_[idx];
+		if(!c.connected) { return; }
+		bool sent = false;
+		while(c.nextSend <= now && c.inflight.size() < static_cast<size_t>(opt_.pipeline)) {
+			Send_(idx, c.nextSend);
+			c.nextSend += c.interval;
+			sent = true;
+		}
+		if(sent && !Flush_(idx)) { Reset_(idx); }
+	}
+
+	bool Flush_(size_t idx) {
+		Conn& c = conns_[idx];
+		while(c.outOff < c.out.size()) {
+			ssize_t n = send(c.fd, c.out.data() + c.outOff, c.out.size() - c.outOff, MSG_NOSIGNAL);
+			if(n < 0) {
+				if(errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+				return false;
+			}
+			c.outOff += n;
+		}
+		if(c.outOff == c.out.size()) {
+			c.out.clear();
+			c.outOff = 0;
+		}
+		bool want = !c.out.empty();
+		if(want != c.wantWrite) {
+			c.wantWrite = want;
+			epoller_.ModFd(c.fd, EPOLLIN | EPOLLRDHUP | (want ? EPOLLOUT : 0));
+		}
+		return true;
+	}
+
+	bool OnRead_(size_t idx) {
+		Conn& c = conns_[idx];
+		char buf[65536];
+		bool peerClosed = false;
+		while(true) {
+			ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+			if(n > 0) {
+				c.in.append(buf, n);
+				result_->bytes += n;
+				continue;
+			}
+			if(n == 0) { peerClosed = true; break; }
+			if(errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+			return false;
+		}
+		bool keepAlive = true;
+		size_t pos = 0;
+		while(!c.inflight.empty()) {
+			size_t consumed = 0;
+			int status = ParseResponse_(c.in, pos, &consumed, &keepAlive);
+			if(status == 0) { break; }
+			if(status < 0) { return false; }
+			OnResponse_(c, status);
+			pos += consumed;
+			if(!keepAlive) { break; }
+		}
+		c.in.erase(0, pos);
+		if(!keepAlive || peerClosed) { return false; }
+		if(c.interval == 0) { Fill_(idx, NowNS()); }
+		return true;
+	}
+
+	void OnResponse_(Conn& c, int status) {
+		uint64_t now = NowNS();
+		uint64_t start = c.inflight.front();
+		c.inflight.pop_front();
+		if(start < measureFrom_ || now > end_) { return; }
+		result_->responses++;
+		if(status >= 400) { result_->errors++; }
+		uint64_t latency = now - start;
+		if(c.interval == 0 && opt_.intervalUS > 0) {
+			result_->latency.RecordCorrected(latency, uint64_t(opt_.intervalUS * 1000));
+		} else {
+			result_->latency.Record(latency);
+		}
+	}
+
+	/**
+	 * @brief 从 pos 处解析一个完整响应
+	 *
+	 * @return int      状态码；0 表示数据不完整；-1 表示格式错误
+	 */
+	static int ParseResponse_(const std::string& in, size_t pos, size_t* consumed, bool* keepAlive) {
+		size_t hdrEnd = in.find("\r\n\r\n", pos);
+		if(hdrEnd == std::string::npos) { return 0; }
+		if(in.compare(pos, 5, "HTTP/") != 0) { return -1; }
+		size_t sp = in.find(' ', pos);
+		if(sp == std::string::npos || sp > hdrEnd) { return -1; }
+		int status = atoi(in.c_str() + sp + 1);
+		if(status < 100) { return -1; }
+		size_t contentLength = 0;
+		*keepAlive = in.compare(pos, 8, "HTTP/1.0") != 0;
+		size_t line = in.find("\r\n", pos) + 2;
+		while(line < hdrEnd + 2) {
+			size_t eol = in.find("\r\n", line);
+			size_t colon = in.find(':', line);
+			if(colon != std::string::npos && colon < eol) {
+				std::string_view key(in.data() + line, colon - line);
+				size_t v = colon + 1;
+				while(v < eol && in[v] == ' ') { v++; }
+				std::string_view value(in.data() + v, eol - v);
+				if(key.size() == 14 && strncasecmp(key.data(), "Content-Length", 14) == 0) {
+					contentLength = strtoull(value.data(), nullptr, 10);
+				} else if(key.size() == 10 && strncasecmp(key.data(), "Connection", 10) == 0) {
+					if(value.size() >= 5 && strncasecmp(value.data(), "close", 5) == 0) {
+						*keepAlive = false;
+					} else if(value.size() >= 10 && strncasecmp(value.data(), "keep-alive", 10) == 0) {
+						*keepAlive = true;
+					}
+				} else if(key.size() == 17 && strncasecmp(key.data(), "Transfer-Encoding", 17) == 0) {
+					/* 只压测定长响应 */
+					return -1;
+				}
+			}
+			line = eol + 2;
+		}
+		size_t total = hdrEnd + 4 - pos + contentLength;
+		if(in.size() - pos < total) { return 0; }
+		*consumed = total;
+		return status;
+	}
+
+	const Options& opt_;
+	Epoller epoller_;
+	Result* result_;
+	std::vector<Conn> conns_;
+	std::vector<int> fdIndex_;
+	struct sockaddr_in addr_;
+	unsigned totalWeight_;
+	uint64_t start_;
+	uint64_t measureFrom_;
+	uint64_t end_;
+};
+
+bool ParseMix(const char* arg, Options& opt) {
+	opt.mix.clear();
+	std::string spec(arg);
+	size_t pos = 0;
+	while(pos < spec.size()) {
+		size_t comma = spec.find(',', pos);
+		if(comma == std::string::npos) { comma = spec.size(); }
+		std::string item = spec.substr(pos, comma - pos);
+		pos = comma + 1;
+		if(item.empty()) { continue; }
+		unsigned weight = 1;
+		size_t colon = item.rfind(':');
+		if(colon != std::string::npos) {
+			weight = static_cast<unsigned>(atoi(item.c_str() + colon + 1));
+			item.resize(colon);
+		}
+		if(item.empty() || item[0] != '/' || weight == 0) { return false; }
+		opt.mix.push_back({ item, weight, "" });
+	}
+	return !opt.mix.empty();
+}
+
+void Usage(const char* prog) {
+	fprintf(stderr,
+			"usage: %s [options]\n"
+			"  -h host      server address (default 127.0.0.1)\n"
+			"  -p port      server port (default 1316)\n"
+			"  -c conns     connections (default 64)\n"
+			"  -t threads   worker threads (default 1)\n"
+			"  -d seconds   measured duration (default 10)\n"
+			"  -w seconds   warmup, not recorded (default 1)\n"
+			"  -P depth     pipelined requests per connection (default 1)\n"
+			"  -r rps       open loop at this total rate; omit for closed loop\n"
+			"  -i us        closed loop: expected interval for coordinated-omission correction\n"
+			"  -m mix       request mix, e.g. /index.html:8,/picture.html:2\n",
+			prog);
+}
+
+void Report(const Options& opt, const Result& total) {
+	const Histogram& h = total.latency;
+	auto ms = [](uint64_t ns) { return ns / 1e6; };
+	printf("%s loop, %d connections, %d threads, pipeline %d",
+		   opt.rate > 0 ? "open" : "closed", opt.connections, opt.threads, opt.pipeline);
+	if(opt.rate > 0) { printf(", target %.0f req/s", opt.rate); }
+	printf("\n");
+	printf("  requests    %llu in %.2fs, errors %llu, reconnects %llu\n",
+		   (unsigned long long)total.responses, opt.duration,
+		   (unsigned long long)total.errors, (unsigned long long)total.reconnects);
+	printf("  throughput  %.0f req/s, %.2f MB/s\n",
+		   total.responses / opt.duration, total.bytes / opt.duration / 1e6);
+	printf("  latency     mean %.3fms  min %.3fms  max %.3fms\n",
+		   h.Mean() / 1e6, ms(h.Min()), ms(h.Max()));
+	printf("              p50 %.3fms  p90 %.3fms  p99 %.3fms  p99.9 %.3fms\n",
+		   ms(h.Percentile(50)), ms(h.Percentile(90)),
+		   ms(h.Percentile(99)), ms(h.Percentile(99.9)));
+	if(opt.rate <= 0 && opt.intervalUS <= 0) {
+		printf("  (closed loop without -i: latencies are not corrected for coordinated omission)\n");
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	Options opt;
+	int ch;
+	while((ch = getopt(argc, argv, "h:p:c:t:d:w:P:r:i:m:")) != -1) {
+		switch(ch) {
+		case 'h': opt.host = optarg; break;
+		case 'p': opt.port = atoi(optarg); break;
+		case 'c': opt.connections = atoi(optarg); break;
+		case 't': opt.threads = atoi(optarg); break;
+		case 'd': opt.duration = atof(optarg); break;
+		case 'w': opt.warmup = atof(optarg); break;
+		case 'P': opt.pipeline = atoi(optarg); break;
+		case 'r': opt.rate = atof(optarg); break;
+		case 'i': opt.intervalUS = atof(optarg); break;
+		case 'm':
+			if(!ParseMix(optarg, opt)) { Usage(argv[0]); return 1; }
+			break;
+		default: Usage(argv[0]); return 1;
+		}
+	}
+	if(opt.connections <= 0 || opt.threads <= 0 || opt.pipeline <= 0 || opt.duration <= 0) {
+		Usage(argv[0]);
+		return 1;
+	}
+	opt.threads = std::min(opt.threads, opt.connections);
+	if(opt.mix.empty()) { opt.mix.push_back({ "/", 1, "" }); }
+	for(auto& t : opt.mix) {
+		t.request = "GET " + t.path + " HTTP/1.1\r\nHost: " + opt.host + ":"
+				  + std::to_string(opt.port) + "\r\nConnection: keep-alive\r\n\r\n";
+	}
+
+	std::vector<Result> results(opt.threads);
+	std::vector<std::thread> threads;
+	uint64_t start = NowNS();
+	for(int i = 0; i < opt.threads; i++) {
+		int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+		double rate = opt.rate * conns / opt.connections;
+		threads.emplace_back([&, i, conns, rate]() {
+			Worker worker(opt, conns, rate, start, &results[i]);
+			worker.Run();
+		});
+	}
+	for(auto& t : threads) { t.join(); }
+
+	Result total;
+	for(auto& r : results) {
+		total.latency.Merge(r.latency);
+		total.responses += r.responses;
+		total.errors += r.errors;
+		total.reconnects += r.reconnects;
+		total.bytes += r.bytes;
+	}
+	Report(opt, total);
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include "../unittest.h"
+#include "amot/common/admission.h"
+
+namespace amot {
+
+class AdmissionTest : public FUTURE_TESTBASE {
+public:
+	AdmissionOptions _options;
+
+public:
+	void caseSetUp() override {
+		_options = AdmissionOptions();
+		_options.initialLimit = 16;
+		_options.minLimit = 2;
+		_options.windowSize = 8;
+	}
+	void caseTearDown() override {}
+
+	/* 占满 n 个名额后以同样的延迟全部完成 */
+	static void RunWindow(AdmissionController& ac, size_t n, uint64_t latencyUS) {
+		size_t got = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (ac.TryAcquire()) got++;
+		}
+		for (size_t i = 0; i < got; i++) {
+			ac.Release(latencyUS);
+		}
+	}
+};
+
+TEST_F(AdmissionTest, testLimitEnforced) {
+	_options.algorithm = LimitAlgorithm::FIXED;
+	AdmissionController ac(_options);
+	for (int i = 0; i < 16; i++) {
+		ASSERT_TRUE(ac.TryAcquire());
+	}
+	ASSERT_FALSE(ac.TryAcquire());
+	ASSERT_EQ(ac.Inflight(), 16u);
+	ac.Release(100);
+	ASSERT_TRUE(ac.TryAcquire());
+	auto stats = ac.GetStats();
+	ASSERT_EQ(stats.admitted, 17u);
+	ASSERT_EQ(stats.rejectedRequests, 1u);
+}
+
+TEST_F(AdmissionTest, testAimd) {
+	_options.algorithm = LimitAlgorithm::AIMD;
+	_options.targetLatencyMS = 10;
+	AdmissionController ac(_options);
+	/* 满负荷且延迟达标，加性增加 */
+	for (int i = 0; i < 4; i++) {
+		RunWindow(ac, ac.Limit(), 1000);
+	}
+	ASSERT_GT(ac.Limit(), 16u);
+	/* 延迟超标，乘性减小 */
+	for (int i = 0; i < 10; i++) {
+		RunWindow(ac, ac.Limit(), 50000);
+	}
+	ASSERT_LT(ac.Limit(), 10u);
+	ASSERT_GE(ac.Limit(), _options.minLimit);
+}
+
+TEST_F(AdmissionTest, testGradientShrinksOnQueueing) {
+	_options.algorithm = LimitAlgorithm::GRADIENT;
+	AdmissionController ac(_options);
+	for (int i = 0; i < 10; i++) {
+		RunWindow(ac, ac.Limit(), 1000);
+	}
+	size_t grown = ac.Limit();
+	ASSERT_GT(grown, 16u);
+	ASSERT_NEAR(ac.GetStats().minLatencyUS, 1000.0, 1.0);
+
+	/* 延迟相对基线放大 10 倍：排队出现，上限收缩 */
+	for (int i = 0; i < 20; i++) {
+		RunWindow(ac, ac.Limit(), 10000);
+	}
+	ASSERT_LT(ac.Limit(), grown / 2);
+}
+
+TEST_F(AdmissionTest, testGradientZeroLatency) {
+	_options.algorithm = LimitAlgorithm::GRADIENT;
+	AdmissionController ac(_options);
+	/* 全部 0us 的窗口不能让梯度变成 NaN */
+	for (int i = 0; i < 10; i++) {
+		RunWindow(ac, ac.Limit(), 0);
+	}
+	size_t grown = ac.Limit();
+	ASSERT_GT(grown, 16u);
+	ASSERT_LE(grown, _options.maxLimit);
+	ASSERT_EQ(ac.GetStats().minLatencyUS, 1.0);
+	/* 之后出现排队仍然收缩 */
+	for (int i = 0; i < 20; i++) {
+		RunWindow(ac, ac.Limit(), 10000);
+	}
+	ASSERT_LT(ac.Limit(), grown / 2);
+}
+
+TEST_F(AdmissionTest, testGradientIdleDoesNotGrow) {
+	AdmissionController ac(_options);
+	/* 只用到少量名额时不放大上限 */
+	for (int i = 0; i < 20; i++) {
+		RunWindow(ac, 2, 1000);
+		RunWindow(ac, 2, 1000);
+		RunWindow(ac, 2, 1000);
+		RunWindow(ac, 2, 1000);
+	}
+	ASSERT_EQ(ac.Limit(), 16u);
+}
+
+TEST_F(AdmissionTest, testAcceptDecision) {
+	_options.maxQueueDepth = 100;
+	_options.maxLoopLagMS = 50;
+	_options.pauseAcceptMS = 200;
+	AdmissionController ac(_options);
+	ASSERT_EQ(ac.OnAccept(10, 1000), AdmissionController::Decision::ACCEPT);
+	ASSERT_EQ(ac.OnAccept(100, 1000), AdmissionController::Decision::REJECT);
+	ASSERT_EQ(ac.OnAccept(200, 1000), AdmissionController::Decision::PAUSE);
+	/* 暂停期内一律暂停，期满且不过载才恢复 */
+	ASSERT_EQ(ac.OnAccept(0, 1100), AdmissionController::Decision::PAUSE);
+	ASSERT_FALSE(ac.CanResumeAccept(0, 1100));
+	ASSERT_FALSE(ac.CanResumeAccept(150, 1200));
+	ASSERT_TRUE(ac.CanResumeAccept(0, 1200));
+	ASSERT_EQ(ac.OnAccept(0, 1200), AdmissionController::Decision::ACCEPT);
+
+	/* 事件循环持续变慢 */
+	for (int i = 0; i < 30; i++) {
+		ac.OnLoop(80 * 1000);
+	}
+	ASSERT_TRUE(ac.Overloaded(0));
+	ASSERT_EQ(ac.OnAccept(0, 2000), AdmissionController::Decision::REJECT);
+	auto stats = ac.GetStats();
+	ASSERT_EQ(stats.rejectedConns, 2u);
+	ASSERT_EQ(stats.pauses, 1u);
+}
+
+TEST_F(AdmissionTest, testBusyResponse) {
+	auto busy = AdmissionController::BusyResponse();
+	ASSERT_EQ(busy.substr(0, 12), "HTTP/1.1 503");
+	ASSERT_EQ(busy.substr(busy.size() - 4), "\r\n\r\n");
+}
+
+}  // namespace amot
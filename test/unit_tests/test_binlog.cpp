@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/sinks/basic_file_sink.h>
+
+#include "../unittest.h"
+#include "amot/common/binlog.h"
+
+namespace amot {
+
+class BinlogTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+static std::vector<std::string> ReadLines(const std::string &path) {
+	std::ifstream in(path);
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(in, line);) lines.push_back(line);
+	return lines;
+}
+
+TEST_F(BinlogTest, testFormat) {
+	std::string path = "/tmp/amot_test_binlog.log";
+	std::remove(path.c_str());
+	auto logger = std::make_shared<Logger>("binlog", std::make_shared<spdlog::sinks::basic_file_sink_mt>(path));
+	logger->set_pattern("%l|%v");
+	{
+		BinaryLog binlog(logger);
+		std::string name = "conn";
+		AMOT_BINLOG(binlog, spdlog::level::info, "Client[{}] in!", 7);
+		AMOT_BINLOG(binlog, spdlog::level::warn, "{} {} {:.2f} {} {} {}", name, "lit", 1.5, true, 'x', -3L);
+		AMOT_BINLOG(binlog, spdlog::level::info, "no args");
+		AMOT_BINLOG(binlog, spdlog::level::info, "{} {}", uint64_t(1) << 63, std::string_view("view"));
+		// 低于日志器级别的记录在调用点就丢弃
+		AMOT_BINLOG(binlog, spdlog::level::debug, "hidden {}", 1);
+		// 格式串错误不影响后台线程
+		AMOT_BINLOG(binlog, spdlog::level::info, "bad {:d}", "text");
+		binlog.Flush();
+		ASSERT_EQ(binlog.DroppedCount(), 0u);
+	}
+	auto lines = ReadLines(path);
+	ASSERT_EQ(lines.size(), 5u);
+	ASSERT_EQ(lines[0], "info|Client[7] in!");
+	ASSERT_EQ(lines[1], "warning|conn lit 1.50 true x -3");
+	ASSERT_EQ(lines[2], "info|no args");
+	ASSERT_EQ(lines[3], "info|9223372036854775808 view");
+	ASSERT_NE(lines[4].find("[binlog:"), std::string::npos);
+}
+
+TEST_F(BinlogTest, testOrderAcrossThreads) {
+	std::string path = "/tmp/amot_test_binlog_mt.log";
+	std::remove(path.c_str());
+	auto logger = std::make_shared<Logger>("binlog_mt", std::make_shared<spdlog::sinks::basic_file_sink_mt>(path));
+	logger->set_pattern("%v");
+	BinaryLogOptions options;
+	options.bufferSize = 1024;
+	options.overflow = LogOverflow::BLOCK;
+	BinaryLog binlog(logger, options);
+
+	// 缓冲很小，BLOCK 策略下不能丢，且同一线程内保持顺序
+	constexpr int kThreads = 4, kPerThread = 5000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < kPerThread; i++) AMOT_BINLOG(binlog, spdlog::level::info, "{} {}", t, i);
+		});
+	}
+	for (auto &thread : threads) thread.join();
+	binlog.Flush();
+
+	auto lines = ReadLines(path);
+	ASSERT_EQ(lines.size(), size_t(kThreads * kPerThread));
+	std::vector<int> next(kThreads, 0);
+	for (auto &line : lines) {
+		int t = 0, i = 0;
+		ASSERT_EQ(sscanf(line.c_str(), "%d %d", &t, &i), 2);
+		ASSERT_EQ(i, next[t]++);
+	}
+}
+
+TEST_F(BinlogTest, testDropWhenFull) {
+	auto logger = std::make_shared<Logger>("binlog_drop", std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+		"/tmp/amot_test_binlog_drop.log", true));
+	BinaryLogOptions options;
+	options.bufferSize = 256;
+	options.pollInterval = std::chrono::milliseconds(1000);
+	BinaryLog binlog(logger, options);
+	for (int i = 0; i < 1000; i++) AMOT_BINLOG(binlog, spdlog::level::info, "message {}", i);
+	binlog.Flush();
+	ASSERT_GT(binlog.DroppedCount(), 0u);
+}
+
+TEST_F(BinlogTest, testOversizedRecord) {
+	std::string path = "/tmp/amot_test_binlog_big.log";
+	auto logger = std::make_shared<Logger>("binlog_big", std::make_shared<spdlog::sinks::basic_file_sink_mt>(path, true));
+	logger->set_pattern("%v");
+	BinaryLogOptions options;
+	options.bufferSize = 256;
+	options.overflow = LogOverflow::BLOCK;
+	BinaryLog binlog(logger, options);
+	// 放不进环的记录在 BLOCK 下也不能一直等
+	AMOT_BINLOG(binlog, spdlog::level::info, "{}", std::string(200, 'x'));
+	AMOT_BINLOG(binlog, spdlog::level::info, "small {}", 1);
+	binlog.Flush();
+	ASSERT_EQ(binlog.DroppedCount(), 1u);
+	ASSERT_EQ(ReadLines(path), std::vector<std::string>{"small 1"});
+}
+
+TEST_F(BinlogTest, testFileAndReader) {
+	std::string path = "/tmp/amot_test_binlog.bin";
+	std::remove(path.c_str());
+	auto before = std::chrono::system_clock::now();
+	{
+		BinaryLog binlog(path);
+		for (int i = 0; i < 100; i++) {
+			AMOT_BINLOG(binlog, spdlog::level::info, "Client[{}] quit! {}", i, "bye");
+		}
+		AMOT_BINLOG(binlog, spdlog::level::err, "ratio {:.1f}", 0.3);
+	}
+	auto after = std::chrono::system_clock::now();
+	auto ns = [](auto time) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	};
+
+	BinlogReader reader(path);
+	ASSERT_TRUE(reader.IsOpen());
+	BinlogReader::Entry entry;
+	for (int i = 0; i < 100; i++) {
+		ASSERT_TRUE(reader.Next(entry));
+		ASSERT_EQ(entry.text, "Client[" + std::to_string(i) + "] quit! bye");
+		ASSERT_EQ(entry.level, spdlog::level::info);
+		ASSERT_NE(entry.file.find("test_binlog.cpp"), std::string::npos);
+		// 换算回的墙上时间误差远小于 1s
+		ASSERT_GT(entry.wallNs, ns(before) - 1000000000);
+		ASSERT_LT(entry.wallNs, ns(after) + 1000000000);
+	}
+	ASSERT_TRUE(reader.Next(entry));
+	ASSERT_EQ(entry.text, "ratio 0.3");
+	ASSERT_EQ(entry.level, spdlog::level::err);
+	ASSERT_FALSE(reader.Next(entry));
+}
+
+}  // namespace amot
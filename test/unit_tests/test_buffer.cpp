@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+#include "../unittest.h"
+#include "amot/common/buffer.h"
+
+namespace amot {
+
+class BufferChainTest : public FUTURE_TESTBASE {
+public:
+	int _fds[2] = {-1, -1};
+
+public:
+	void caseSetUp() override {
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, _fds), 0);
+	}
+	void caseTearDown() override {
+		close(_fds[0]);
+		close(_fds[1]);
+	}
+};
+
+TEST_F(BufferChainTest, testAppendAcrossSlices) {
+    BufferChain buf;
+    std::string data(BufferPool::kSliceSize * 2 + 100, 'a');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = 'a' + i % 26;
+    buf.Append(data);
+    ASSERT_EQ(buf.ReadableBytes(), data.size());
+    ASSERT_EQ(buf.SliceCount(), 3u);
+
+    std::string joined;
+    for (auto span : buf.Spans())
+        joined.append(span);
+    ASSERT_EQ(joined, data);
+
+    buf.Retrieve(BufferPool::kSliceSize + 1);
+    ASSERT_EQ(buf.SliceCount(), 2u);
+    ASSERT_EQ(buf.RetrieveAllToStr(), data.substr(BufferPool::kSliceSize + 1));
+    ASSERT_EQ(buf.SliceCount(), 0u);
+}
+
+TEST_F(BufferChainTest, testPrependAndRef) {
+    BufferChain buf;
+    auto body = std::make_shared<std::string>("<html>body</html>");
+    buf.AppendRef(body->data(), body->size(), body);
+    buf.Prepend("\r\n");
+    buf.Prepend("HTTP/1.1 200 OK");
+    ASSERT_EQ(buf.RetrieveAllToStr(), "HTTP/1.1 200 OK\r\n<html>body</html>");
+    ASSERT_EQ(body.use_count(), 1);
+}
+
+TEST_F(BufferChainTest, testContiguous) {
+    BufferChain buf;
+    std::string head(BufferPool::kSliceSize - 4, 'x');
+    buf.Append(head);
+    buf.Append("GET / HTTP/1.1\r\n");
+    auto view = buf.Contiguous(head.size() + 8);
+    ASSERT_EQ(view, head + "GET / HT");
+    ASSERT_EQ(buf.ReadableBytes(), head.size() + 16);
+}
+
+TEST_F(BufferChainTest, testReadWriteFd) {
+    BufferChain out;
+    std::string data(BufferPool::kSliceSize * 3 + 17, 'z');
+    out.Append(data);
+    int err = 0;
+    ASSERT_EQ(out.WriteFd(_fds[0], &err), static_cast<ssize_t>(data.size()));
+    ASSERT_TRUE(out.Empty());
+
+    BufferChain in;
+    size_t total = 0;
+    while (total < data.size()) {
+        ssize_t len = in.ReadFd(_fds[1], &err);
+        ASSERT_GT(len, 0);
+        total += len;
+    }
+    ASSERT_EQ(in.RetrieveAllToStr(), data);
+}
+
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/bytearray.h"
+#include "amot/common/endian.h"
+
+namespace amot {
+
+class ByteArrayTest : public FUTURE_TESTBASE {
+public:
+	ByteswapLevel _origin = ByteswapLevel::SCALAR;
+
+public:
+	void caseSetUp() override { _origin = getByteswapLevel(); }
+	void caseTearDown() override { setByteswapLevel(_origin); }
+
+	std::vector<ByteswapLevel> levels() const {
+		return {ByteswapLevel::SCALAR, ByteswapLevel::SSSE3, ByteswapLevel::AVX2};
+	}
+};
+
+template <class T>
+static void CheckBulk(size_t count) {
+	std::vector<T> values(count), expect(count), out(count);
+	for (size_t i = 0; i < count; i++) {
+		values[i] = static_cast<T>(0x0102030405060708ull * (i + 1));
+		expect[i] = byteswap(values[i]);
+	}
+	byteswap(values.data(), out.data(), count);
+	ASSERT_EQ(out, expect) << "width " << sizeof(T) << " count " << count;
+	byteswap(std::span<T>(values));
+	ASSERT_EQ(values, expect) << "width " << sizeof(T) << " count " << count;
+}
+
+TEST_F(ByteArrayTest, testBulkByteswap) {
+	for (auto level : levels()) {
+		setByteswapLevel(level);
+		// 覆盖向量主循环、单次 32 字节和标量尾部
+		for (size_t count : {0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 64, 100, 1000}) {
+			CheckBulk<uint16_t>(count);
+			CheckBulk<uint32_t>(count);
+			CheckBulk<uint64_t>(count);
+		}
+	}
+}
+
+TEST_F(ByteArrayTest, testBulkFloat) {
+	std::vector<double> values = {1.5, -2.25, 1e300, 0.0};
+	auto copy = values;
+	byteswap(std::span<double>(copy));
+	byteswap(std::span<double>(copy));
+	ASSERT_EQ(copy, values);
+}
+
+TEST_F(ByteArrayTest, testFixed) {
+	ByteArray ba;
+	ba.WriteBE<uint32_t>(0x01020304);
+	ba.WriteLE<uint16_t>(0x0506);
+	ba.WriteBE<int8_t>(-1);
+	ba.WriteBE<double>(3.5);
+	ba.WriteLE<float>(-0.5f);
+	ASSERT_EQ(ba.View().substr(0, 7), std::string_view("\x01\x02\x03\x04\x06\x05\xff", 7));
+
+	uint32_t u32;
+	uint16_t u16;
+	int8_t i8;
+	double d;
+	float f;
+	ASSERT_TRUE(ba.ReadBE(u32));
+	ASSERT_TRUE(ba.ReadLE(u16));
+	ASSERT_TRUE(ba.ReadBE(i8));
+	ASSERT_TRUE(ba.ReadBE(d));
+	ASSERT_TRUE(ba.ReadLE(f));
+	ASSERT_EQ(u32, 0x01020304u);
+	ASSERT_EQ(u16, 0x0506);
+	ASSERT_EQ(i8, -1);
+	ASSERT_EQ(d, 3.5);
+	ASSERT_EQ(f, -0.5f);
+	ASSERT_EQ(ba.ReadableBytes(), 0u);
+	ASSERT_FALSE(ba.ReadBE(u16));
+}
+
+TEST_F(ByteArrayTest, testArray) {
+	for (auto level : levels()) {
+		setByteswapLevel(level);
+		std::vector<uint32_t> values(37);
+		for (size_t i = 0; i < values.size(); i++) values[i] = static_cast<uint32_t>(i * 0x01010101u);
+		ByteArray ba;
+		ba.WriteArrayBE<uint32_t>(values);
+		ASSERT_EQ(ba.ReadableBytes(), values.size() * 4);
+		ASSERT_EQ(ba.View().substr(4, 4), std::string_view("\x01\x01\x01\x01", 4));
+		uint32_t first;
+		ASSERT_TRUE(ByteArray(ba.View()).ReadBE(first));
+		ASSERT_EQ(first, 0u);
+
+		std::vector<uint32_t> out(values.size());
+		ASSERT_TRUE(ba.ReadArrayBE<uint32_t>(out));
+		ASSERT_EQ(out, values);
+		ASSERT_FALSE(ba.ReadArrayBE<uint32_t>(std::span<uint32_t>(out.data(), 1)));
+	}
+}
+
+TEST_F(ByteArrayTest, testVarint) {
+	ByteArray ba;
+	std::vector<uint64_t> unsignedValues = {0, 1, 127, 128, 300, 16383, 16384, UINT32_MAX,
+											std::numeric_limits<uint64_t>::max()};
+	std::vector<int64_t> signedValues = {0, -1, 1, -64, 64, INT32_MIN, INT32_MAX,
+										 std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+	for (auto v : unsignedValues) ba.WriteVarUint64(v);
+	for (auto v : signedValues) ba.WriteVarInt64(v);
+	ba.WriteVarInt32(-3);
+	ba.WriteVarUint32(UINT32_MAX);
+
+	for (auto v : unsignedValues) {
+		uint64_t out;
+		ASSERT_TRUE(ba.ReadVarUint64(out));
+		ASSERT_EQ(out, v);
+	}
+	for (auto v : signedValues) {
+		int64_t out;
+		ASSERT_TRUE(ba.ReadVarInt64(out));
+		ASSERT_EQ(out, v);
+	}
+	int32_t i32;
+	uint32_t u32;
+	ASSERT_TRUE(ba.ReadVarInt32(i32));
+	ASSERT_EQ(i32, -3);
+	ASSERT_TRUE(ba.ReadVarUint32(u32));
+	ASSERT_EQ(u32, UINT32_MAX);
+
+	// zigzag 让小的负数也只占 1 字节
+	ByteArray small;
+	small.WriteVarInt64(-1);
+	ASSERT_EQ(small.View(), std::string_view("\x01", 1));
+	ByteArray wide;
+	wide.WriteVarUint64(300);
+	ASSERT_EQ(wide.View(), std::string_view("\xac\x02", 2));
+}
+
+TEST_F(ByteArrayTest, testVarintInvalid) {
+	// 截断
+	ByteArray truncated(std::string_view("\x80\x80", 2));
+	uint64_t out;
+	ASSERT_FALSE(truncated.ReadVarUint64(out));
+	ASSERT_EQ(truncated.ReadPosition(), 0u);
+	// 超过 64 位
+	ByteArray overflow(std::string_view("\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02", 10));
+	ASSERT_FALSE(overflow.ReadVarUint64(out));
+	// 超过 32 位的值不能按 32 位读出，读位置不变
+	ByteArray big;
+	big.WriteVarUint64(uint64_t(1) << 32);
+	uint32_t u32;
+	ASSERT_FALSE(big.ReadVarUint32(u32));
+	ASSERT_TRUE(big.ReadVarUint64(out));
+	ASSERT_EQ(out, uint64_t(1) << 32);
+}
+
+TEST_F(ByteArrayTest, testString) {
+	ByteArray ba;
+	std::string longText(1000, 'x');
+	ba.WriteString("");
+	ba.WriteString("hello");
+	ba.WriteString(longText);
+	ba.WriteString(std::string_view("a\0b", 3));
+
+	std::string s;
+	std::string_view view;
+	ASSERT_TRUE(ba.ReadString(s));
+	ASSERT_EQ(s, "");
+	ASSERT_TRUE(ba.ReadStringView(view));
+	ASSERT_EQ(view, "hello");
+	ASSERT_TRUE(ba.ReadString(s));
+	ASSERT_EQ(s, longText);
+	ASSERT_TRUE(ba.ReadString(s));
+	ASSERT_EQ(s, std::string("a\0b", 3));
+
+	// 长度超出剩余数据
+	ByteArray truncated(std::string_view("\x05" "abc", 4));
+	ASSERT_FALSE(truncated.ReadString(s));
+	ASSERT_EQ(truncated.ReadPosition(), 0u);
+}
+
+TEST_F(ByteArrayTest, testInterleavedReadWrite) {
+	// 边写边读，已读部分会被回收，数据保持正确
+	ByteArray ba;
+	uint64_t next = 0;
+	for (uint64_t i = 0; i < 10000; i++) {
+		ba.WriteBE<uint64_t>(i);
+		ba.WriteVarUint64(i);
+		if (i % 3 == 0) {
+			uint64_t fixed, var;
+			ASSERT_TRUE(ba.ReadBE(fixed));
+			ASSERT_TRUE(ba.ReadVarUint64(var));
+			ASSERT_EQ(fixed, next);
+			ASSERT_EQ(var, next);
+			next++;
+		}
+	}
+	while (ba.ReadableBytes() > 0) {
+		uint64_t fixed, var;
+		ASSERT_TRUE(ba.ReadBE(fixed));
+		ASSERT_TRUE(ba.ReadVarUint64(var));
+		ASSERT_EQ(fixed, next);
+		ASSERT_EQ(var, next);
+		next++;
+	}
+	ASSERT_EQ(next, 10000u);
+}
+}  // namespace amot
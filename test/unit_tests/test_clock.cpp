@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "../unittest.h"
+#include "amot/common/clock.h"
+#include "amot/common/util.h"
+
+namespace amot {
+
+class ClockTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+TEST_F(ClockTest, testMonotonicClock) {
+    uint64_t last = MonotonicNs();
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t now = MonotonicNs();
+        ASSERT_GE(now, last);
+        last = now;
+    }
+    uint64_t ms = MonotonicMs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_GE(MonotonicMs() - ms, 20u);
+    // 粗粒度时钟与精确时钟相差不超过一个节拍
+    ASSERT_LE(std::llabs(static_cast<long long>(CoarseMonotonicMs()) - static_cast<long long>(MonotonicMs())), 20);
+    // 墙上时间
+    long long wall = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    ASSERT_LE(std::llabs(static_cast<long long>(GetCurrentMS()) - wall), 1000);
+}
+
+TEST_F(ClockTest, testLoopClockCached) {
+    std::thread([] {
+        // 未刷新过的线程读实时时间
+        uint64_t before = MonotonicMs();
+        ASSERT_GE(LoopClock::NowMs(), before);
+
+        uint64_t now = LoopClock::Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_EQ(LoopClock::NowMs(), now);
+        ASSERT_GE(LoopClock::Update(), now + 20);
+    }).join();
+}
+
+TEST_F(ClockTest, testTscClock) {
+    if (!TscClock::Available()) {
+        ASSERT_EQ(TscClock::TicksPerNs(), 0);
+        return;
+    }
+    ASSERT_GT(TscClock::TicksPerNs(), 0.1);
+    for (int i = 0; i < 5; ++i) {
+        int64_t diff = static_cast<int64_t>(TscClock::NowNs()) - static_cast<int64_t>(MonotonicNs());
+        // 校准误差在毫秒以内
+        ASSERT_LT(std::llabs(diff), 1000000) << diff;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../unittest.h"
+#include "amot/http/filecache.h"
+#include "amot/http/staticfile.h"
+
+namespace amot {
+
+class FileCacheTest : public FUTURE_TESTBASE {
+public:
+	std::string _dir;
+
+public:
+	void caseSetUp() override {
+		char tmpl[] = "/tmp/amot_filecache_XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		_dir = tmpl;
+	}
+	void caseTearDown() override { ASSERT_EQ(system(("rm -rf " + _dir).c_str()), 0); }
+
+	std::string writeFile(const std::string &name, const std::string &content, mode_t mode = 0644) {
+		std::string path = _dir + "/" + name;
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+		chmod(path.c_str(), mode);
+		return path;
+	}
+
+	// 由另一线程读，大文件 sendfile 时不会因套接字缓冲区写满而阻塞
+	static std::string drain(StaticFile &file) {
+		int fds[2];
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+		std::string response;
+		std::thread reader([&]() {
+			char buf[4096];
+			ssize_t n;
+			while ((n = read(fds[1], buf, sizeof(buf))) > 0) response.append(buf, n);
+		});
+		int err = 0;
+		size_t total = file.ToWriteBytes();
+		EXPECT_EQ(file.WriteTo(fds[0], &err), static_cast<ssize_t>(total));
+		close(fds[0]);
+		reader.join();
+		close(fds[1]);
+		return response;
+	}
+};
+
+TEST_F(FileCacheTest, testLruEviction) {
+	FileCache cache(3000, 2000);
+	auto a = cache.Get(writeFile("a.txt", std::string(1000, 'a')));
+	auto b = cache.Get(writeFile("b.txt", std::string(1000, 'b')));
+	auto c = cache.Get(writeFile("c.txt", std::string(1000, 'c')));
+	ASSERT_TRUE(a && b && c);
+	ASSERT_EQ(cache.Count(), 3u);
+	ASSERT_EQ(cache.MemoryUsage(), 3000u);
+
+	// 访问 a 后 b 成为最久未使用，载入 d 超出预算时淘汰 b
+	ASSERT_EQ(cache.Get(_dir + "/a.txt"), a);
+	auto d = cache.Get(writeFile("d.txt", std::string(1000, 'd')));
+	ASSERT_TRUE(d);
+	ASSERT_EQ(cache.Count(), 3u);
+	ASSERT_EQ(cache.MemoryUsage(), 3000u);
+	ASSERT_EQ(cache.Get(_dir + "/c.txt"), c);
+	ASSERT_EQ(cache.Get(_dir + "/d.txt"), d);
+	ASSERT_EQ(cache.Get(_dir + "/a.txt"), a);
+
+	// 被淘汰的文件仍由持有者引用，重新载入得到新对象
+	ASSERT_EQ(std::string(b->data, b->size), std::string(1000, 'b'));
+	auto b2 = cache.Get(_dir + "/b.txt");
+	ASSERT_TRUE(b2);
+	ASSERT_NE(b2, b);
+
+	// 超过单文件上限的不缓存
+	ASSERT_EQ(cache.Get(writeFile("big.txt", std::string(2001, 'x'))), nullptr);
+	ASSERT_EQ(cache.Count(), 3u);
+}
+
+TEST_F(FileCacheTest, testInotifyInvalidation) {
+	FileCache cache;
+	ASSERT_GE(cache.GetInotifyFd(), 0);
+	std::string path = writeFile("page.html", "old");
+	auto file = cache.Get(path);
+	ASSERT_TRUE(file);
+	ASSERT_EQ(cache.Get(path), file);
+
+	// 大小不变的改写也要失效
+	writeFile("page.html", "new");
+	cache.OnInotify();
+	ASSERT_EQ(cache.Count(), 0u);
+	auto fresh = cache.Get(path);
+	ASSERT_TRUE(fresh);
+	ASSERT_EQ(std::string(fresh->data, fresh->size), "new");
+
+	// 同目录下其他文件的变化不影响已缓存的文件
+	writeFile("other.html", "x");
+	cache.OnInotify();
+	ASSERT_EQ(cache.Get(path), fresh);
+
+	ASSERT_EQ(unlink(path.c_str()), 0);
+	cache.OnInotify();
+	ASSERT_EQ(cache.Count(), 0u);
+	ASSERT_EQ(cache.Get(path), nullptr);
+}
+
+TEST_F(FileCacheTest, testETagNotModified) {
+	FileCache cache(1 << 20, 1024);
+	StaticFileServer server(_dir + "/", &cache);
+	std::string small = writeFile("index.html", "<html></html>");
+	writeFile("video.mp4", std::string(4096, 'v'));
+
+	StaticFile file;
+	ASSERT_EQ(server.Open("/index.html", true, "", &file), 200);
+	auto cached = cache.Get(small);
+	ASSERT_TRUE(cached);
+	std::string response = drain(file);
+	ASSERT_NE(response.find("ETag: " + cached->etag + "\r\n"), std::string::npos);
+	ASSERT_NE(response.find("Content-type: text/html\r\n"), std::string::npos);
+
+	ASSERT_EQ(server.Open("/index.html", true, cached->etag, &file), 304);
+	response = drain(file);
+	ASSERT_EQ(response.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0u);
+	ASSERT_EQ(response.find("Content-length"), std::string::npos);
+	ASSERT_EQ(server.Open("/index.html", true, "\"stale\"", &file), 200);
+
+	// sendfile 路径的 ETag 规则与缓存一致
+	struct stat st;
+	ASSERT_EQ(stat((_dir + "/video.mp4").c_str(), &st), 0);
+	ASSERT_EQ(server.Open("/video.mp4", false, MakeETag(st.st_size, st.st_mtime), &file), 304);
+}
+
+TEST_F(FileCacheTest, testForbiddenAndNotFound) {
+	FileCache cache;
+	StaticFileServer server(_dir + "/", &cache);
+	writeFile("secret.html", "secret", 0600);
+	writeFile("big-secret.bin", std::string(cache.MaxFileSize() + 1, 's'), 0600);
+	ASSERT_EQ(mkdir((_dir + "/sub").c_str(), 0755), 0);
+
+	StaticFile file;
+	// 小文件同样要检查其他用户可读，不能从缓存里直接返回
+	ASSERT_EQ(server.Open("/secret.html", true, "", &file), 403);
+	ASSERT_EQ(cache.Count(), 0u);
+	ASSERT_EQ(drain(file).rfind("HTTP/1.1 403 Forbidden\r\n", 0), 0u);
+	ASSERT_EQ(server.Open("/big-secret.bin", true, "", &file), 403);
+	ASSERT_EQ(server.Open("/../etc/passwd", true, "", &file), 403);
+	ASSERT_EQ(server.Open("/missing.html", true, "", &file), 404);
+	ASSERT_EQ(server.Open("/sub", true, "", &file), 404);
+	ASSERT_EQ(drain(file).rfind("HTTP/1.1 404 Not Found\r\n", 0), 0u);
+
+	// 权限恢复后可以访问并进入缓存
+	ASSERT_EQ(chmod((_dir + "/secret.html").c_str(), 0644), 0);
+	cache.OnInotify();
+	ASSERT_EQ(server.Open("/secret.html", true, "", &file), 200);
+	ASSERT_EQ(cache.Count(), 1u);
+}
+
+TEST_F(FileCacheTest, testSendfileLargeFile) {
+	FileCache cache(1 << 20, 4096);
+	StaticFileServer server(_dir + "/", &cache);
+	std::string body;
+	for (int i = 0; i < 256 * 1024; i++) body += static_cast<char>('a' + i % 26);
+	writeFile("large.bin", body);
+
+	StaticFile file;
+	ASSERT_EQ(server.Open("/large.bin", false, "", &file), 200);
+	ASSERT_EQ(cache.Count(), 0u);
+	ASSERT_GT(file.ToWriteBytes(), body.size());
+	std::string response = drain(file);
+	ASSERT_EQ(file.ToWriteBytes(), 0u);
+
+	size_t headerEnd = response.find("\r\n\r\n");
+	ASSERT_NE(headerEnd, std::string::npos);
+	std::string header = response.substr(0, headerEnd + 4);
+	ASSERT_NE(header.find("Connection: close\r\n"), std::string::npos);
+	ASSERT_NE(header.find("Content-length: " + std::to_string(body.size()) + "\r\n"), std::string::npos);
+	ASSERT_EQ(response.substr(headerEnd + 4), body);
+}
+
+}  // namespace amot
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/http/httpparser.h"
+
+namespace amot {
+
+class HttpParserTest : public FUTURE_TESTBASE {
+public:
+	HttpParser _parser;
+	HttpRequestView _req;
+	HttpScanLevel _origin = HttpScanLevel::SCALAR;
+
+public:
+	void caseSetUp() override { _origin = GetHttpScanLevel(); }
+	void caseTearDown() override { SetHttpScanLevel(_origin); }
+
+	std::vector<HttpScanLevel> levels() const {
+		return {HttpScanLevel::SCALAR, HttpScanLevel::SSE42, HttpScanLevel::AVX2};
+	}
+};
+
+TEST_F(HttpParserTest, testSimpleGet) {
+    for (auto level : levels()) {
+        SetHttpScanLevel(level);
+        std::string raw =
+            "GET /index.html?a=1 HTTP/1.1\r\n"
+            "Host: localhost:1316\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+            "Accept:text/html\r\n"
+            "Connection: close\r\n"
+            "\r\n";
+        size_t consumed = 0;
+        ASSERT_EQ(_parser.Parse(raw.data(), raw.size(), &_req, &consumed),
+                  HttpParser::Status::COMPLETE);
+        ASSERT_EQ(consumed, raw.size());
+        ASSERT_EQ(_req.method, "GET");
+        ASSERT_EQ(_req.path, "/index.html");
+        ASSERT_EQ(_req.query, "a=1");
+        ASSERT_EQ(_req.minorVersion, 1);
+        ASSERT_EQ(_req.headerCount, 4u);
+        ASSERT_EQ(_req.Header("host"), "localhost:1316");
+        ASSERT_EQ(_req.Header("Accept"), "text/html");
+        ASSERT_FALSE(_req.keepAlive);
+    }
+}
+
+TEST_F(HttpParserTest, testResumeByteByByte) {
+    std::string raw =
+        "POST /login HTTP/1.1\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+        "user=amot&x";
+    size_t consumed = 0;
+    for (size_t len = 1; len < raw.size(); ++len) {
+        ASSERT_EQ(_parser.Parse(raw.data(), len, &_req, &consumed),
+                  HttpParser::Status::PARTIAL) << len;
+    }
+    ASSERT_EQ(_parser.Parse(raw.data(), raw.size(), &_req, &consumed),
+              HttpParser::Status::COMPLETE);
+    ASSERT_EQ(_req.body, "user=amot&x");
+    ASSERT_TRUE(_req.keepAlive);
+}
+
+TEST_F(HttpParserTest, testPipelined) {
+    std::string raw =
+        "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /b HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /c HTTP/1.0\r\n\r\n";
+    std::vector<std::string> paths;
+    size_t off = 0, consumed = 0;
+    while (off < raw.size()) {
+        ASSERT_EQ(_parser.Parse(raw.data() + off, raw.size() - off, &_req, &consumed),
+                  HttpParser::Status::COMPLETE);
+        paths.emplace_back(_req.path);
+        off += consumed;
+    }
+    ASSERT_EQ(paths, (std::vector<std::string>{"/a", "/b", "/c"}));
+    ASSERT_FALSE(_req.keepAlive);
+}
+
+TEST_F(HttpParserTest, testLeadingEmptyLines) {
+    for (auto level : levels()) {
+        SetHttpScanLevel(level);
+        // 客户端常在 POST 请求体之后多发一个 CRLF，下一个请求前的空行应被忽略
+        std::string raw =
+            "\r\n\r\nGET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+            "POST /b HTTP/1.1\r\nContent-Length: 2\r\n\r\nok\r\n"
+            "\n\r\nGET /c HTTP/1.1\r\n\r\n";
+        std::vector<std::string> paths;
+        size_t off = 0, consumed = 0;
+        while (off < raw.size()) {
+            ASSERT_EQ(_parser.Parse(raw.data() + off, raw.size() - off, &_req, &consumed),
+                      HttpParser::Status::COMPLETE) << off;
+            paths.emplace_back(_req.path);
+            off += consumed;
+        }
+        ASSERT_EQ(off, raw.size());
+        ASSERT_EQ(paths, (std::vector<std::string>{"/a", "/b", "/c"}));
+    }
+
+    // 逐字节到达时同样能跳过
+    std::string raw = "\r\n\r\nGET /d HTTP/1.1\r\n\r\n";
+    size_t consumed = 0;
+    for (size_t len = 1; len < raw.size(); ++len) {
+        ASSERT_EQ(_parser.Parse(raw.data(), len, &_req, &consumed),
+                  HttpParser::Status::PARTIAL) << len;
+    }
+    ASSERT_EQ(_parser.Parse(raw.data(), raw.size(), &_req, &consumed),
+              HttpParser::Status::COMPLETE);
+    ASSERT_EQ(consumed, raw.size());
+    ASSERT_EQ(_req.path, "/d");
+
+    // 只有空行时计入头部长度上限
+    HttpParser parser(64);
+    std::string blank(100, '\n');
+    ASSERT_EQ(parser.Parse(blank.data(), 32, &_req, &consumed), HttpParser::Status::PARTIAL);
+    ASSERT_EQ(parser.Parse(blank.data(), blank.size(), &_req, &consumed),
+              HttpParser::Status::ERROR);
+}
+
+TEST_F(HttpParserTest, testChunked) {
+    std::string raw =
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "7;ext=1\r\n, world\r\n"
+        "0\r\n"
+        "Trailer: x\r\n"
+        "\r\n"
+        "GET /next HTTP/1.1\r\n\r\n";
+    size_t consumed = 0;
+    for (size_t len = 1; len < 70; ++len) {
+        std::string copy = raw;
+        HttpParser parser;
+        size_t i = len;
+        HttpParser::Status status;
+        while ((status = parser.Parse(copy.data(), i, &_req, &consumed)) ==
+               HttpParser::Status::PARTIAL) {
+            i = std::min(i + len, copy.size());
+        }
+        ASSERT_EQ(status, HttpParser::Status::COMPLETE);
+        ASSERT_EQ(_req.body, "hello, world");
+        ASSERT_TRUE(_req.chunked);
+        ASSERT_EQ(copy.substr(consumed), "GET /next HTTP/1.1\r\n\r\n");
+    }
+}
+
+TEST_F(HttpParserTest, testErrors) {
+    for (auto level : levels()) {
+        SetHttpScanLevel(level);
+        std::vector<std::string> bad = {
+            "GET\r\n\r\n",
+            "GET /a HTTP/2.0\r\n\r\n",
+            "GET /a HTTP/1.1\r\nBad Name: x\r\n\r\n",
+            "GET /a HTTP/1.1\r\nName: a\x01b\r\n\r\n",
+            "GET /a HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+            "GET /a HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+        };
+        for (auto &raw : bad) {
+            HttpParser parser;
+            size_t consumed = 0;
+            ASSERT_EQ(parser.Parse(raw.data(), raw.size(), &_req, &consumed),
+                      HttpParser::Status::ERROR) << raw;
+        }
+    }
+}
+
+TEST_F(HttpParserTest, testHeaderTooLarge) {
+    HttpParser parser(64);
+    std::string raw = "GET / HTTP/1.1\r\nCookie: " + std::string(100, 'c');
+    size_t consumed = 0;
+    ASSERT_EQ(parser.Parse(raw.data(), raw.size(), &_req, &consumed),
+              HttpParser::Status::ERROR);
+}
+
+}
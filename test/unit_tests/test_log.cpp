@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/log.h"
+
+namespace amot {
+
+class LogTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+static std::vector<std::string> ReadLines(const std::string &path) {
+	std::ifstream in(path);
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(in, line);) lines.push_back(line);
+	return lines;
+}
+
+// 单例在整个进程内共享，异步开启后不能关闭，先验证同步模式
+TEST_F(LogTest, testCachedHandle) {
+	auto &first = AMOT_LOGGER("cached");
+	ASSERT_EQ(first, LoggerMgr::GetInstance()->GetLogger("cached"));
+	ASSERT_EQ(spdlog::get("cached"), first);
+}
+
+TEST_F(LogTest, testAsyncFileLogger) {
+	std::string path = "/tmp/amot_test_async.log";
+	std::remove(path.c_str());
+	auto logger = LoggerMgr::GetInstance()->GetFileLogger("async_file", path);
+	logger->set_pattern("%v");
+	AsyncLogOptions options;
+	options.queueSize = 16;
+	ASSERT_TRUE(LoggerMgr::GetInstance()->EnableAsync(options));
+	ASSERT_FALSE(LoggerMgr::GetInstance()->EnableAsync(options));
+
+	// 缓冲很小，BLOCK 策略下也不能丢消息，且同一线程内保持顺序
+	constexpr int kThreads = 4, kPerThread = 2000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < kPerThread; i++) logger->info("{} {}", t, i);
+		});
+	}
+	for (auto &thread : threads) thread.join();
+	logger->flush();
+
+	auto lines = ReadLines(path);
+	ASSERT_EQ(lines.size(), size_t(kThreads * kPerThread));
+	std::vector<int> next(kThreads, 0);
+	for (auto &line : lines) {
+		int t = 0, i = 0;
+		ASSERT_EQ(sscanf(line.c_str(), "%d %d", &t, &i), 2);
+		ASSERT_EQ(i, next[t]++);
+	}
+	ASSERT_EQ(LoggerMgr::GetInstance()->DroppedCount(), 0u);
+}
+
+TEST_F(LogTest, testDropPolicy) {
+	AsyncLogOptions options;
+	options.queueSize = 2;
+	options.overflow = LogOverflow::DROP;
+	AsyncLogBackend backend(options);
+	auto logger = std::make_shared<Logger>("drop", std::make_shared<spdlog::sinks::basic_file_sink_mt>("/tmp/amot_test_drop.log", true));
+	logger->set_pattern("%v");
+	logger->SetBackend(&backend);
+	for (int i = 0; i < 10000; i++) logger->info("{}", i);
+	logger->flush();
+	logger->SetBackend(nullptr);
+	size_t written = ReadLines("/tmp/amot_test_drop.log").size();
+	ASSERT_EQ(written + backend.DroppedCount(), 10000u);
+}
+
+TEST_F(LogTest, testBatchFileSinkAppend) {
+	std::string path = "/tmp/amot_test_batch.log";
+	std::remove(path.c_str());
+	for (int round = 0; round < 2; round++) {
+		auto logger = std::make_shared<spdlog::logger>("batch", std::make_shared<BatchFileSink>(path));
+		logger->set_pattern("%v");
+		for (int i = 0; i < 100; i++) logger->info("{} {}", round, i);
+		logger->flush();
+		// flush 返回时已写入文件
+		ASSERT_EQ(ReadLines(path).size(), size_t(100 * (round + 1)));
+	}
+	// 再次打开不截断
+	auto lines = ReadLines(path);
+	ASSERT_EQ(lines.front(), "0 0");
+	ASSERT_EQ(lines.back(), "1 99");
+}
+
+TEST_F(LogTest, testBatchFileSinkInterval) {
+	std::string path = "/tmp/amot_test_batch_interval.log";
+	std::remove(path.c_str());
+	FileSinkOptions options;
+	options.flushInterval = std::chrono::milliseconds(10);
+	auto logger = std::make_shared<spdlog::logger>("interval", std::make_shared<BatchFileSink>(path, options));
+	logger->set_pattern("%v");
+	logger->info("hello");
+	// 缓冲未写满，由 I/O 线程按时间写出
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (ReadLines(path).empty() && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	ASSERT_EQ(ReadLines(path), std::vector<std::string>{"hello"});
+}
+
+TEST_F(LogTest, testBatchFileSinkRotate) {
+	std::string path = "/tmp/amot_test_rotate.log";
+	auto rotated = [&](size_t i) { return spdlog::sinks::rotating_file_sink_mt::calc_filename(path, i); };
+	for (size_t i = 0; i <= 3; i++) std::remove(rotated(i).c_str());
+	FileSinkOptions options;
+	options.bufferSize = 256;
+	options.maxFileSize = 1024;
+	options.maxFiles = 2;
+	options.fsync = FsyncPolicy::EVERY_BATCH;
+	auto sink = std::make_shared<BatchFileSink>(path, options);
+	auto logger = std::make_shared<spdlog::logger>("rotate", sink);
+	logger->set_pattern("%v");
+	constexpr int kCount = 1000;
+	for (int i = 0; i < kCount; i++) logger->info("line {:04d}", i);
+	logger->flush();
+
+	ASSERT_GT(sink->RotationCount(), 2u);
+	ASSERT_EQ(sink->ErrorCount(), 0u);
+	ASSERT_EQ(sink->BytesWritten(), size_t(kCount * 10));
+	ASSERT_FALSE(spdlog::details::os::path_exists(rotated(3)));
+	// 保留下来的文件都不超过上限，且内容按顺序衔接
+	std::vector<std::string> lines;
+	for (size_t i = 2; i != size_t(-1); i--) {
+		struct stat st;
+		ASSERT_EQ(stat(rotated(i).c_str(), &st), 0);
+		ASSERT_LE(size_t(st.st_size), options.maxFileSize);
+		for (auto &line : ReadLines(rotated(i))) lines.push_back(line);
+	}
+	ASSERT_EQ(lines.back(), "line 0999");
+	for (size_t i = 1; i < lines.size(); i++) {
+		ASSERT_EQ(atoi(lines[i].c_str() + 5), atoi(lines[i - 1].c_str() + 5) + 1);
+	}
+}
+}  // namespace amot
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/clock.h"
+#include "amot/common/metrics.h"
+#include "amot/http/httpmetrics.h"
+#include "amot/http/responsequeue.h"
+#include "amot/http/staticfile.h"
+
+namespace amot {
+
+class MetricsTest : public FUTURE_TESTBASE {
+public:
+	std::unique_ptr<MetricsRegistry> _registry;
+
+public:
+	void caseSetUp() override { _registry = std::make_unique<MetricsRegistry>(); }
+	void caseTearDown() override { _registry.reset(); }
+};
+
+TEST_F(MetricsTest, testCounterAcrossThreads) {
+	Counter &counter = _registry->GetCounter("hits_total", "Hits.");
+	Gauge &gauge = _registry->GetGauge("inflight", "In flight.");
+	ASSERT_EQ(&counter, &_registry->GetCounter("hits_total", "Hits."));
+
+	// 线程数多于分片数，共享分片时结果仍然准确
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 24; t++) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < 10000; i++) {
+				counter.Inc();
+				gauge.Inc();
+			}
+			for (int i = 0; i < 4000; i++) gauge.Dec();
+		});
+	}
+	for (auto &thread : threads) thread.join();
+	ASSERT_EQ(counter.Value(), 240000u);
+	ASSERT_EQ(gauge.Value(), 24 * 6000);
+}
+
+TEST_F(MetricsTest, testHistogramBuckets) {
+	LatencyHistogram &hist = _registry->GetHistogram("latency_seconds", "Latency.", {}, {0.001, 0.01, 0.1});
+	hist.Record(500000);      // 0.5ms
+	hist.Record(999000);      // 所在 HDR 桶的上界不超过 1ms
+	hist.Record(5000000);     // 5ms
+	hist.Record(2000000000);  // 2s
+	std::vector<uint64_t> buckets;
+	uint64_t count;
+	double sum;
+	hist.Collect(&buckets, &count, &sum);
+	ASSERT_EQ(buckets, (std::vector<uint64_t>{2, 3, 3, 4}));
+	ASSERT_EQ(count, 4u);
+	ASSERT_NEAR(sum, 2.006499, 1e-9);
+}
+
+TEST_F(MetricsTest, testSnapshotWhileWriting) {
+	Counter &counter = _registry->GetCounter("events_total", "Events.");
+	LatencyHistogram &hist = _registry->GetHistogram("work_seconds", "Work.");
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> writers;
+	for (int t = 0; t < 4; t++) {
+		writers.emplace_back([&]() {
+			while (!stop.load(std::memory_order_relaxed)) {
+				counter.Inc();
+				hist.Record(1000);
+			}
+		});
+	}
+	// 快照期间写入不停，读到的计数单调不减，直方图的累计桶与总数一致
+	double last = 0;
+	for (int i = 0; i < 50; i++) {
+		MetricsSnapshot snapshot = _registry->Snapshot();
+		const auto *events = snapshot.Find("events_total");
+		const auto *work = snapshot.Find("work_seconds");
+		ASSERT_NE(events, nullptr);
+		ASSERT_NE(work, nullptr);
+		ASSERT_GE(events->value, last);
+		last = events->value;
+		ASSERT_EQ(work->buckets.back(), work->count);
+	}
+	stop = true;
+	for (auto &thread : writers) thread.join();
+	ASSERT_EQ(_registry->Snapshot().Find("events_total")->value, static_cast<double>(counter.Value()));
+}
+
+TEST_F(MetricsTest, testPrometheusText) {
+	_registry->GetCounter("requests_total", "Requests.", {{"route", "/a\"b"}}).Inc(3);
+	_registry->AddGaugeCallback("temperature", "Line one\nline two.", {}, [] { return 36.5; });
+	_registry->GetHistogram("handle_seconds", "Handle.", {{"route", "/"}}, {0.5, 1}).Record(750000000);
+	std::string text = _registry->Prometheus();
+	const char *expect =
+		"# HELP handle_seconds Handle.\n"
+		"# TYPE handle_seconds histogram\n"
+		"handle_seconds_bucket{route=\"/\",le=\"0.5\"} 0\n"
+		"handle_seconds_bucket{route=\"/\",le=\"1\"} 1\n"
+		"handle_seconds_bucket{route=\"/\",le=\"+Inf\"} 1\n"
+		"handle_seconds_sum{route=\"/\"} 0.75\n"
+		"handle_seconds_count{route=\"/\"} 1\n"
+		"# HELP requests_total Requests.\n"
+		"# TYPE requests_total counter\n"
+		"requests_total{route=\"/a\\\"b\"} 3\n"
+		"# HELP temperature Line one\\nline two.\n"
+		"# TYPE temperature gauge\n"
+		"temperature 36.5\n";
+	ASSERT_EQ(text, expect);
+}
+
+TEST_F(MetricsTest, testHttpRoutes) {
+	HttpMetrics metrics(_registry.get(), 2);
+	metrics.OnAccept();
+	metrics.OnRead(100);
+	metrics.OnWrite(250);
+	metrics.OnRequest("/index.html", 200, 1000);
+	metrics.OnRequest("/index.html", 304, 1000);
+	metrics.OnRequest("/a.css", 200, 1000);
+	// 超过路由上限的都归入 other
+	metrics.OnRequest("/b.js", 200, 1000);
+	metrics.OnRequest("/c.js", 404, 1000);
+
+	MetricsSnapshot snapshot = _registry->Snapshot();
+	ASSERT_EQ(snapshot.Find("amot_http_connections_total")->value, 1);
+	ASSERT_EQ(snapshot.Find("amot_http_received_bytes_total")->value, 100);
+	ASSERT_EQ(snapshot.Find("amot_http_sent_bytes_total")->value, 250);
+	auto requests = [&](const char *route, const char *code) {
+		const auto *series = snapshot.Find("amot_http_requests_total", {{"route", route}, {"code", code}});
+		return series ? series->value : -1;
+	};
+	ASSERT_EQ(requests("/index.html", "2xx"), 1);
+	ASSERT_EQ(requests("/index.html", "3xx"), 1);
+	ASSERT_EQ(requests("/a.css", "2xx"), 1);
+	ASSERT_EQ(requests("other", "2xx"), 1);
+	ASSERT_EQ(requests("other", "4xx"), 1);
+	ASSERT_EQ(requests("/b.js", "2xx"), -1);
+	ASSERT_EQ(snapshot.Find("amot_http_request_duration_seconds", {{"route", "other"}})->count, 2u);
+}
+
+TEST_F(MetricsTest, testRouteOf) {
+	HttpMetrics metrics(_registry.get());
+	// 文件路径不直接作为标签
+	ASSERT_EQ(metrics.RouteOf("/index.html", 200), "/");
+	ASSERT_EQ(metrics.RouteOf("/css/a.css", 304), "/css");
+	ASSERT_EQ(metrics.RouteOf("/css/sub/b.css", 200), "/css");
+	ASSERT_EQ(metrics.RouteOf("/missing.html", 404), "unmatched");
+	ASSERT_EQ(metrics.RouteOf("/metrics", 200), "/metrics");
+
+	metrics.SetRoutes({"/api", "/api/v2", "/static/"});
+	ASSERT_EQ(metrics.RouteOf("/api", 200), "/api");
+	ASSERT_EQ(metrics.RouteOf("/api/users", 200), "/api");
+	ASSERT_EQ(metrics.RouteOf("/api/v2/users", 200), "/api/v2");
+	ASSERT_EQ(metrics.RouteOf("/apix/a", 200), "/apix");
+	ASSERT_EQ(metrics.RouteOf("/static/a.js", 200), "/static/");
+}
+
+TEST_F(MetricsTest, testLatencyUntilWritten) {
+	HttpMetrics metrics(_registry.get());
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+	ResponseQueue queue;
+	queue.SetMetrics(&metrics);
+	BufferChain first, second;
+	first.Append(std::string_view("first"));
+	second.Append(std::string_view("second"));
+	uint64_t start = MonotonicNs() - 5000000;
+	queue.Push(std::move(first));
+	queue.Track(metrics.RouteOf("/index.html", 200), 200, start);
+	queue.Push(std::move(second));
+	queue.Track(metrics.RouteOf("/missing.html", 404), 404, start);
+	// 写出之前不记录
+	ASSERT_EQ(_registry->Snapshot().Find("amot_http_requests_total", {{"route", "/"}, {"code", "2xx"}}), nullptr);
+
+	int err = 0;
+	ASSERT_EQ(queue.Flush(fds[0], &err), 11);
+	MetricsSnapshot snapshot = _registry->Snapshot();
+	ASSERT_EQ(snapshot.Find("amot_http_requests_total", {{"route", "/"}, {"code", "2xx"}})->value, 1);
+	ASSERT_EQ(snapshot.Find("amot_http_requests_total", {{"route", "unmatched"}, {"code", "4xx"}})->value, 1);
+	// 耗时从解析出请求算起
+	ASSERT_GE(snapshot.Find("amot_http_request_duration_seconds", {{"route", "/"}})->sum, 0.005);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST_F(MetricsTest, testMetricsEndpoint) {
+	HttpMetrics metrics(_registry.get());
+	StaticFileServer server("/nonexistent/", nullptr);
+	server.SetMetrics(&metrics);
+
+	StaticFile missing;
+	ASSERT_EQ(server.Open("/missing.html", true, "", &missing), 404);
+	// 连接在响应写完时记录
+	ASSERT_EQ(_registry->Snapshot().Find("amot_http_requests_total", {{"route", "unmatched"}, {"code", "4xx"}}), nullptr);
+	metrics.OnRequest(metrics.RouteOf("/missing.html", 404), 404, 1000);
+
+	StaticFile file;
+	ASSERT_EQ(server.Open("/metrics", false, "", &file), 200);
+	int fds[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+	int err = 0;
+	size_t total = file.ToWriteBytes();
+	ASSERT_EQ(file.WriteTo(fds[0], &err), static_cast<ssize_t>(total));
+	close(fds[0]);
+	std::string response;
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(fds[1], buf, sizeof(buf))) > 0) response.append(buf, n);
+	close(fds[1]);
+
+	ASSERT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+	ASSERT_NE(response.find("Content-type: text/plain; version=0.0.4"), std::string::npos);
+	ASSERT_NE(response.find("amot_http_requests_total{route=\"unmatched\",code=\"4xx\"} 1\n"), std::string::npos);
+	ASSERT_NE(response.find("# TYPE amot_http_request_duration_seconds histogram\n"), std::string::npos);
+}
+
+}  // namespace amot
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/priority.h"
+#include "amot/common/threadPool.h"
+#include "amot/coroutine/executor.h"
+#include "amot/coroutine/scheduler.h"
+#include "amot/coroutine/task.h"
+
+namespace amot {
+
+class PriorityTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+static std::string Drain(PriorityLanes<char> &lanes) {
+	std::string out;
+	char c;
+	while (lanes.pop(c)) out.push_back(c);
+	return out;
+}
+
+static void Fill(PriorityLanes<char> &lanes, int n) {
+	for (int i = 0; i < n; i++) {
+		lanes.push('b', Priority::BATCH);
+		lanes.push('n', Priority::NORMAL);
+		lanes.push('l', Priority::LATENCY);
+	}
+}
+
+TEST_F(PriorityTest, testStrictLanes) {
+	PriorityOptions options;
+	options.strict = true;
+	options.starvation = std::chrono::milliseconds(0);
+	PriorityLanes<char> lanes(options);
+	Fill(lanes, 3);
+	ASSERT_EQ(lanes.size(), 9u);
+	ASSERT_EQ(lanes.size(Priority::NORMAL), 3u);
+	ASSERT_EQ(Drain(lanes), "lllnnnbbb");
+	ASSERT_TRUE(lanes.empty());
+}
+
+TEST_F(PriorityTest, testWeightedLanes) {
+	PriorityOptions options;
+	options.weights[0] = 2;
+	options.weights[1] = 1;
+	options.weights[2] = 1;
+	options.starvation = std::chrono::milliseconds(0);
+	PriorityLanes<char> lanes(options);
+	Fill(lanes, 4);
+	// 每轮 2 个 latency、1 个 normal、1 个 batch，空队列让出额度
+	ASSERT_EQ(Drain(lanes), "llnbllnbnbnb");
+}
+
+TEST_F(PriorityTest, testStarvation) {
+	PriorityOptions options;
+	options.strict = true;
+	options.starvation = std::chrono::milliseconds(20);
+	PriorityLanes<char> lanes(options);
+	lanes.push('b', Priority::BATCH);
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	lanes.push('l', Priority::LATENCY);
+	lanes.push('l', Priority::LATENCY);
+	// batch 已等待超时，先于 latency 取出
+	ASSERT_EQ(Drain(lanes), "bll");
+}
+
+TEST_F(PriorityTest, testLooperExecutor) {
+	PriorityOptions options;
+	options.strict = true;
+	LooperExecutor looper(options);
+	std::promise<void> gate;
+	auto blocked = gate.get_future().share();
+	looper.execute([blocked]() { blocked.wait(); });
+
+	std::mutex lock;
+	std::string order;
+	std::promise<void> done;
+	auto record = [&](char c) {
+		return [&, c]() {
+			std::scoped_lock guard(lock);
+			order.push_back(c);
+			if (order.size() == 6) done.set_value();
+		};
+	};
+	looper.execute(record('b'), Priority::BATCH);
+	looper.execute(record('n'));
+	looper.execute(record('l'), Priority::LATENCY);
+	looper.execute(record('b'), Priority::BATCH);
+	looper.execute(record('n'));
+	looper.execute(record('l'), Priority::LATENCY);
+	gate.set_value();
+	done.get_future().get();
+	ASSERT_EQ(order, "llnnbb");
+}
+
+TEST_F(PriorityTest, testThreadPoolLanes) {
+	ThreadPool::Options options;
+	options.threadNum = 1;
+	options.lanes.strict = true;
+	ThreadPool pool(options);
+	std::promise<void> gate;
+	auto blocked = gate.get_future().share();
+	pool.scheduleById([blocked]() { blocked.wait(); });
+
+	std::string order;
+	std::vector<std::future<void>> futures;
+	const Priority priorities[] = {Priority::BATCH, Priority::NORMAL, Priority::LATENCY};
+	const char names[] = {'b', 'n', 'l'};
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			char c = names[j];
+			futures.push_back(pool.submit([&order, c]() { order.push_back(c); }, -1, priorities[j]));
+		}
+	}
+	gate.set_value();
+	for (auto &future : futures) future.get();
+	ASSERT_EQ(order, "lllnnnbbb");
+}
+
+Task<std::thread::id, LatencyExecutor> Resume() {
+	co_await std::chrono::milliseconds(1);
+	co_return std::this_thread::get_id();
+}
+
+TEST_F(PriorityTest, testPriorityExecutor) {
+	std::promise<std::thread::id> looper;
+	SharedLooperExecutor::instance().execute([&looper]() {
+		looper.set_value(std::this_thread::get_id());
+	});
+	auto task = Resume();
+	// 恢复经由共享 LooperExecutor 的 latency 通道
+	ASSERT_EQ(task.get_result(), looper.get_future().get());
+}
+
+TEST_F(PriorityTest, testExecutorStats) {
+	LooperExecutor looper({}, true);
+	std::promise<void> done;
+	for (int i = 0; i < 5; i++) looper.execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+	looper.execute([&done] { done.set_value(); });
+	done.get_future().wait();
+	looper.shutdown();
+	while (looper.stats().executed < 6) std::this_thread::yield();
+	ExecutorStats stats = looper.stats();
+	ASSERT_EQ(stats.executed, 6u);
+	ASSERT_GE(stats.busyNs, 5u * 1000000);
+	Histogram run;
+	looper.merge_run_time(run);
+	ASSERT_EQ(run.Count(), 6u);
+
+	Scheduler scheduler(true);
+	std::promise<void> fired;
+	scheduler.execute([&fired] { fired.set_value(); }, 5);
+	fired.get_future().wait();
+	while (scheduler.stats().executed < 1) std::this_thread::yield();
+	ASSERT_GE(scheduler.stats().parks, 1u);
+	Histogram wait;
+	scheduler.merge_wait_time(wait);
+	ASSERT_EQ(wait.Count(), 1u);
+}
+
+}
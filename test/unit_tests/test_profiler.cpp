@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/profiler.h"
+#include "amot/common/util.h"
+
+// 非 static 且导出符号(ENABLE_EXPORTS)，采样结果中才有函数名
+__attribute__((noinline)) uint64_t ProfilerTestBusyLoop(std::chrono::milliseconds cpu) {
+	volatile uint64_t x = 0;
+	auto deadline = std::chrono::steady_clock::now() + cpu;
+	while (std::chrono::steady_clock::now() < deadline) {
+		for (int i = 0; i < 10000; i++) x = x + i;
+	}
+	return x;
+}
+
+__attribute__((noinline)) std::string ProfilerTestBacktraceHelper() {
+	return amot::BacktraceToString(64, 2, "  ");
+}
+
+namespace amot {
+
+class ProfilerTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override { ProfilerMgr::GetInstance()->Reset(); }
+	void caseTearDown() override { ProfilerMgr::GetInstance()->Stop(); }
+};
+
+TEST_F(ProfilerTest, testBacktrace) {
+	std::vector<std::string> bt;
+	Backtrace(bt);
+	ASSERT_FALSE(bt.empty());
+	std::string text = ProfilerTestBacktraceHelper();
+	// 默认跳过 Backtrace 与 BacktraceToString 自身，第一帧为调用者
+	ASSERT_EQ(text.find("  ProfilerTestBacktraceHelper"), 0u) << text;
+	ASSERT_NE(text.find("testBacktrace"), std::string::npos) << text;
+}
+
+TEST_F(ProfilerTest, testSampling) {
+	auto profiler = ProfilerMgr::GetInstance();
+	ProfilerOptions options;
+	options.frequency = 1000;
+	options.perThread = true;
+	options.scanInterval = std::chrono::milliseconds(50);
+	ASSERT_TRUE(profiler->Start(options));
+	ASSERT_FALSE(profiler->Start(options));
+	ASSERT_TRUE(profiler->Running());
+
+	// 启动之后才创建的线程由重新扫描加入
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	std::thread worker([]() { ProfilerTestBusyLoop(std::chrono::milliseconds(400)); });
+	ProfilerTestBusyLoop(std::chrono::milliseconds(200));
+	worker.join();
+	profiler->Stop();
+	ASSERT_FALSE(profiler->Running());
+
+	std::string folded = profiler->Folded();
+	ASSERT_GT(profiler->SampleCount(), 20u) << folded;
+	ASSERT_NE(folded.find("ProfilerTestBusyLoop"), std::string::npos) << folded;
+	// 每行为 "帧;帧;... 次数"，根为线程名
+	size_t lines = 0, busyThreads = 0;
+	std::string line;
+	for (size_t pos = 0, end; (end = folded.find('\n', pos)) != std::string::npos; pos = end + 1) {
+		line = folded.substr(pos, end - pos);
+		size_t space = line.rfind(' ');
+		ASSERT_NE(space, std::string::npos);
+		ASSERT_GT(std::stoull(line.substr(space + 1)), 0u);
+		ASSERT_EQ(line.find(' '), space) << line;
+		if (line.find("ProfilerTestBusyLoop") != std::string::npos) busyThreads++;
+		lines++;
+	}
+	ASSERT_EQ(lines, size_t(std::count(folded.begin(), folded.end(), '\n')));
+
+	// 停止后不再计数，可以再次启动
+	uint64_t samples = profiler->SampleCount();
+	ProfilerTestBusyLoop(std::chrono::milliseconds(50));
+	ASSERT_EQ(profiler->SampleCount(), samples);
+	ASSERT_TRUE(profiler->Start(options));
+	profiler->Stop();
+	ASSERT_TRUE(profiler->DumpFolded("/tmp/amot_test_profile.folded"));
+}
+}  // namespace amot
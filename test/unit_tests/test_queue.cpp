@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/mpmcqueue.h"
+#include "amot/common/queue.h"
+
+namespace amot {
+
+class QueueTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+template <typename Q>
+static void BoundedBackpressure(Q &queue) {
+	size_t cap = queue.capacity();
+	for (size_t i = 0; i < cap; i++) {
+		EXPECT_TRUE(queue.push(std::make_unique<int>(i)));
+	}
+	// 满时 try_push 失败且不移动参数
+	auto extra = std::make_unique<int>(-1);
+	EXPECT_FALSE(queue.try_push(std::move(extra)));
+	ASSERT_NE(extra, nullptr);
+
+	std::atomic<bool> pushed{false};
+	std::thread producer([&]() {
+		queue.push(std::move(extra));
+		pushed = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_FALSE(pushed.load());
+
+	std::unique_ptr<int> item;
+	ASSERT_TRUE(queue.pop(item));
+	EXPECT_EQ(*item, 0);
+	producer.join();
+	EXPECT_TRUE(pushed.load());
+	EXPECT_EQ(queue.size(), cap);
+
+	std::vector<std::unique_ptr<int>> out;
+	EXPECT_EQ(queue.drain_to(out, 3), 3u);
+	EXPECT_EQ(queue.drain_to(out, 100), cap - 3);
+	ASSERT_EQ(out.size(), cap);
+	EXPECT_EQ(*out.front(), 1);
+	EXPECT_EQ(*out.back(), -1);
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(QueueTest, testBoundedQueue) {
+	Queue<std::unique_ptr<int>> queue(4);
+	BoundedBackpressure(queue);
+}
+
+TEST_F(QueueTest, testMpmcQueue) {
+	MpmcQueue<std::unique_ptr<int>> queue(4);
+	BoundedBackpressure(queue);
+}
+
+template <typename Q>
+static void StopWakesWaiters(Q &queue) {
+	int value = 0;
+	std::thread consumer([&]() { EXPECT_FALSE(queue.pop(value)); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	queue.stop();
+	consumer.join();
+	EXPECT_FALSE(queue.push(1));
+}
+
+TEST_F(QueueTest, testStop) {
+	Queue<int> queue(2);
+	StopWakesWaiters(queue);
+	MpmcQueue<int> mpmc(2);
+	StopWakesWaiters(mpmc);
+}
+
+// 多生产者多消费者，每个元素恰好被取出一次
+template <typename Q>
+static void Concurrent(Q &queue) {
+	constexpr int kProducers = 3, kConsumers = 3, kPerProducer = 20000;
+	std::vector<std::atomic<int>> seen(kProducers * kPerProducer);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < kProducers; p++) {
+		threads.emplace_back([&, p]() {
+			for (int i = 0; i < kPerProducer; i++) queue.push(p * kPerProducer + i);
+		});
+	}
+	std::atomic<int> consumed{0};
+	for (int c = 0; c < kConsumers; c++) {
+		threads.emplace_back([&]() {
+			int value;
+			while (queue.pop(value)) {
+				seen[value].fetch_add(1);
+				consumed.fetch_add(1);
+			}
+		});
+	}
+	while (consumed.load() < kProducers * kPerProducer) std::this_thread::yield();
+	queue.stop();
+	for (auto &t : threads) t.join();
+	for (auto &s : seen) ASSERT_EQ(s.load(), 1);
+}
+
+TEST_F(QueueTest, testConcurrent) {
+	Queue<int> queue(64);
+	Concurrent(queue);
+	MpmcQueue<int> mpmc(64);
+	Concurrent(mpmc);
+}
+}  // namespace amot
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <future>
+#include <string>
+
+#include "../unittest.h"
+#include "amot/common/threadPool.h"
+#include "amot/coroutine/reactor.h"
+
+namespace amot {
+
+class ReactorTest : public FUTURE_TESTBASE {
+public:
+	int _fds[2] = {-1, -1};
+
+public:
+	void caseSetUp() override {
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, _fds), 0);
+	}
+	void caseTearDown() override {
+		close(_fds[0]);
+		close(_fds[1]);
+	}
+};
+
+/* 读满 n 字节后回显 */
+Reactor::ConnTask Echo(int fd, size_t n, std::promise<std::string> *done) {
+	auto *reactor = Reactor::current();
+	reactor->add_fd(fd);
+	std::string data;
+	char buf[64];
+	while (data.size() < n) {
+		ssize_t len = ::read(fd, buf, sizeof(buf));
+		if (len > 0) {
+			data.append(buf, len);
+			continue;
+		}
+		if (len < 0 && errno == EAGAIN) {
+			if (!co_await reactor->readable(fd)) break;
+			continue;
+		}
+		break;
+	}
+	size_t off = 0;
+	while (off < data.size()) {
+		ssize_t len = ::write(fd, data.data() + off, data.size() - off);
+		if (len > 0) {
+			off += len;
+		} else if (!co_await reactor->writable(fd)) {
+			break;
+		}
+	}
+	reactor->remove_fd(fd);
+	done->set_value(data);
+}
+
+TEST_F(ReactorTest, testReadWrite) {
+	Reactor reactor;
+	reactor.start();
+	std::promise<std::string> done;
+	int fd = _fds[0];
+	reactor.spawn([fd, &done]() { return Echo(fd, 10, &done); });
+
+	ASSERT_EQ(::write(_fds[1], "hello", 5), 5);
+	usleep(10 * 1000);
+	ASSERT_EQ(::write(_fds[1], "world", 5), 5);
+	ASSERT_EQ(done.get_future().get(), "helloworld");
+
+	char buf[16] = {0};
+	fcntl(_fds[1], F_SETFL, 0);
+	ASSERT_EQ(::read(_fds[1], buf, 10), 10);
+	ASSERT_EQ(std::string(buf), "helloworld");
+	reactor.stop();
+	reactor.join();
+}
+
+Reactor::ConnTask WaitTimeout(int fd, std::promise<bool> *done) {
+	auto *reactor = Reactor::current();
+	reactor->add_fd(fd);
+	bool ready = co_await reactor->readable(fd, 50);
+	reactor->remove_fd(fd);
+	done->set_value(ready);
+}
+
+TEST_F(ReactorTest, testReadTimeout) {
+	Reactor reactor;
+	reactor.start();
+	std::promise<bool> done;
+	int fd = _fds[0];
+	auto start = std::chrono::steady_clock::now();
+	reactor.spawn([fd, &done]() { return WaitTimeout(fd, &done); });
+	ASSERT_FALSE(done.get_future().get());
+	ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+	reactor.stop();
+	reactor.join();
+}
+
+Reactor::ConnTask Offload(ThreadPool &pool, std::promise<bool> *done) {
+	auto *reactor = Reactor::current();
+	auto loop_thread = std::this_thread::get_id();
+	auto worker = co_await offload(pool, []() { return std::this_thread::get_id(); });
+	// 计算在线程池上完成，之后回到 Reactor 线程
+	done->set_value(worker != loop_thread && std::this_thread::get_id() == loop_thread
+					&& Reactor::current() == reactor);
+}
+
+TEST_F(ReactorTest, testOffload) {
+	ThreadPool pool(2);
+	Reactor reactor;
+	reactor.start();
+	std::promise<bool> done;
+	reactor.spawn([&pool, &done]() { return Offload(pool, &done); });
+	ASSERT_TRUE(done.get_future().get());
+	reactor.stop();
+	reactor.join();
+}
+
+/* 已停止的线程池：拒绝所有任务 */
+struct StoppedPool {
+	enum ERROR_TYPE { ERROR_NONE, ERROR_POOL_HAS_STOP };
+	ERROR_TYPE scheduleById(std::function<void()>) { return ERROR_POOL_HAS_STOP; }
+};
+
+Reactor::ConnTask OffloadRejected(StoppedPool &pool, std::promise<bool> *done) {
+	bool rejected = false;
+	try {
+		co_await offload(pool, []() { return 1; });
+	} catch (const OffloadRejectedException &) {
+		rejected = true;
+	}
+	done->set_value(rejected);
+}
+
+TEST_F(ReactorTest, testOffloadRejected) {
+	StoppedPool pool;
+	Reactor reactor;
+	reactor.start();
+	std::promise<bool> done;
+	reactor.spawn([&pool, &done]() { return OffloadRejected(pool, &done); });
+	auto future = done.get_future();
+	// 任务被拒绝时协程必须恢复，而不是永远挂起
+	ASSERT_EQ(future.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+	ASSERT_TRUE(future.get());
+	reactor.stop();
+	reactor.join();
+}
+
+/* 读空后离开等待，期间对端写入；之后的 readable 必须立即就绪 */
+Reactor::ConnTask MissedEdge(ThreadPool &pool, int fd, int peer, std::promise<std::string> *done) {
+	auto *reactor = Reactor::current();
+	reactor->add_fd(fd);
+	char buf[64];
+	while (::read(fd, buf, sizeof(buf)) > 0) {}
+	co_await offload(pool, [peer]() {
+		ssize_t n = ::write(peer, "late", 4);
+		(void)n;
+		// 让边沿在没有等待者时到达 Reactor
+		usleep(20 * 1000);
+	});
+	std::string data;
+	if (co_await reactor->readable(fd, 500)) {
+		ssize_t len = ::read(fd, buf, sizeof(buf));
+		if (len > 0) data.assign(buf, len);
+	}
+	reactor->remove_fd(fd);
+	done->set_value(data);
+}
+
+TEST_F(ReactorTest, testEdgeWhileNotWaiting) {
+	ThreadPool pool(1);
+	Reactor reactor;
+	reactor.start();
+	std::promise<std::string> done;
+	int fd = _fds[0], peer = _fds[1];
+	auto start = std::chrono::steady_clock::now();
+	reactor.spawn([&pool, fd, peer, &done]() { return MissedEdge(pool, fd, peer, &done); });
+	ASSERT_EQ(done.get_future().get(), "late");
+	ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+	reactor.stop();
+	reactor.join();
+}
+
+TEST_F(ReactorTest, testExecutorBindsCurrentReactor) {
+	Reactor reactor;
+	reactor.start();
+	std::promise<Reactor *> bound;
+	reactor.execute([&bound]() {
+		ReactorExecutor executor;
+		bound.set_value(executor.reactor());
+	});
+	ASSERT_EQ(bound.get_future().get(), &reactor);
+	ASSERT_EQ(ReactorExecutor().reactor(), nullptr);
+	reactor.stop();
+	reactor.join();
+}
+
+}  // namespace amot
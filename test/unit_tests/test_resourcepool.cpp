@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include <optional>
+
+#include "../unittest.h"
+#include "amot/coroutine/task.h"
+#include "amot/coroutine/resourcepool.h"
+
+namespace amot {
+
+/**
+ * @brief 模拟后端连接
+ */
+struct MockConn {
+	explicit MockConn(int id) : id(id) {}
+	int id;
+	bool alive = true;
+	int queries = 0;
+};
+
+/**
+ * @brief 模拟后端：按序号创建连接，可设置为拒绝连接
+ */
+struct MockBackend {
+	int next_id = 0;
+	bool refuse = false;
+
+	std::unique_ptr<MockConn> connect() {
+		if (refuse) return nullptr;
+		return std::make_unique<MockConn>(next_id++);
+	}
+};
+
+using PoolTask = Task<void, NoopExecutor>;
+
+PoolTask Borrow(ResourcePool<MockConn> &pool, std::optional<Lease<MockConn>> &out) {
+	out.emplace(co_await pool.acquire());
+	out.value()->queries++;
+}
+
+PoolTask BorrowCatch(ResourcePool<MockConn> &pool, std::optional<Lease<MockConn>> &out, bool &failed) {
+	try {
+		out.emplace(co_await pool.acquire());
+	} catch (std::exception &e) {
+		failed = true;
+	}
+}
+
+/**
+ * @brief 在 try_take 失败之后、进入等待队列之前归还 held，模拟并发归还
+ */
+struct ReturnBeforeQueue : public AcquireAwaiter<MockConn> {
+	ReturnBeforeQueue(ResourcePool<MockConn> *pool, std::optional<Lease<MockConn>> *held)
+		: AcquireAwaiter<MockConn>(pool), _held(held) {}
+
+protected:
+	void after_suspend() override {
+		_held->reset();
+		AcquireAwaiter<MockConn>::after_suspend();
+	}
+
+private:
+	std::optional<Lease<MockConn>> *_held;
+};
+
+PoolTask BorrowRacing(ResourcePool<MockConn> &pool, std::optional<Lease<MockConn>> &held,
+					  std::optional<Lease<MockConn>> &out) {
+	out.emplace(co_await ReturnBeforeQueue(&pool, &held));
+}
+
+class ResourcePoolTest : public FUTURE_TESTBASE {
+public:
+	MockBackend _backend;
+	ResourcePoolOptions _options;
+
+	std::unique_ptr<ResourcePool<MockConn>> make_pool() {
+		return std::make_unique<ResourcePool<MockConn>>(
+			_options,
+			[this] { return _backend.connect(); },
+			[](MockConn &conn) { return conn.alive; });
+	}
+
+public:
+	void caseSetUp() override {
+		_backend = MockBackend();
+		_options = ResourcePoolOptions();
+	}
+	void caseTearDown() override {}
+};
+
+TEST_F(ResourcePoolTest, testLeaseReturnsToPool) {
+	_options.max_size = 2;
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> lease;
+	auto t1 = Borrow(*pool, lease);
+	t1.get_result();
+	ASSERT_TRUE(lease.has_value());
+	ASSERT_EQ(lease.value()->id, 0);
+	ASSERT_EQ(pool->stats().idle, 0u);
+	lease.reset();
+	ASSERT_EQ(pool->stats().idle, 1u);
+
+	auto t2 = Borrow(*pool, lease);
+	t2.get_result();
+	ASSERT_EQ(lease.value()->id, 0);
+	ASSERT_EQ(lease.value()->queries, 2);
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.created, 1u);
+	ASSERT_EQ(stats.acquired, 2u);
+	ASSERT_EQ(stats.waited, 0u);
+}
+
+TEST_F(ResourcePoolTest, testWaiterGetsReleasedResource) {
+	_options.max_size = 1;
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> first, second;
+	auto t1 = Borrow(*pool, first);
+	auto t2 = Borrow(*pool, second);
+	ASSERT_TRUE(first.has_value());
+	ASSERT_FALSE(second.has_value());
+	ASSERT_EQ(pool->stats().waiting, 1u);
+
+	first.reset();
+	t2.get_result();
+	ASSERT_TRUE(second.has_value());
+	ASSERT_EQ(second.value()->id, 0);
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.waiting, 0u);
+	ASSERT_EQ(stats.waited, 1u);
+	ASSERT_EQ(stats.total, 1u);
+}
+
+TEST_F(ResourcePoolTest, testInvalidateReplacesResource) {
+	_options.max_size = 1;
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> first, second;
+	auto t1 = Borrow(*pool, first);
+	auto t2 = Borrow(*pool, second);
+	first.value().invalidate();
+	first.reset();
+	t2.get_result();
+	ASSERT_EQ(second.value()->id, 1);
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.created, 2u);
+	ASSERT_EQ(stats.destroyed, 1u);
+	ASSERT_EQ(stats.total, 1u);
+}
+
+TEST_F(ResourcePoolTest, testHealthCheckOnBorrow) {
+	_options.validate_after = std::chrono::milliseconds(0);
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> lease;
+	auto t1 = Borrow(*pool, lease);
+	MockConn *conn = lease.value().get();
+	lease.reset();
+	conn->alive = false;
+
+	auto t2 = Borrow(*pool, lease);
+	t2.get_result();
+	ASSERT_EQ(lease.value()->id, 1);
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.health_check_failed, 1u);
+	ASSERT_EQ(stats.total, 1u);
+}
+
+TEST_F(ResourcePoolTest, testHealthCheckBeforeQueueing) {
+	_options.max_size = 1;
+	_options.validate_after = std::chrono::milliseconds(0);
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> held, lease;
+	auto t1 = Borrow(*pool, held);
+	held.value()->alive = false;
+
+	// 池已满，挂起时才归还一个坏连接，不能不经检查直接交给等待者
+	auto t2 = BorrowRacing(*pool, held, lease);
+	t2.get_result();
+	ASSERT_FALSE(held.has_value());
+	ASSERT_EQ(lease.value()->id, 1);
+	ASSERT_TRUE(lease.value()->alive);
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.health_check_failed, 1u);
+	ASSERT_EQ(stats.destroyed, 1u);
+	ASSERT_EQ(stats.total, 1u);
+	ASSERT_EQ(stats.waiting, 0u);
+}
+
+TEST_F(ResourcePoolTest, testMaintainEvictsIdleAndKeepsMin) {
+	_options.min_size = 1;
+	_options.max_size = 4;
+	_options.idle_timeout = std::chrono::milliseconds(0);
+	auto pool = make_pool();
+	pool->maintain();
+	ASSERT_EQ(pool->stats().idle, 1u);
+
+	std::optional<Lease<MockConn>> a, b, c;
+	auto ta = Borrow(*pool, a);
+	auto tb = Borrow(*pool, b);
+	auto tc = Borrow(*pool, c);
+	ASSERT_EQ(pool->stats().total, 3u);
+	a.reset();
+	b.reset();
+	c.reset();
+	ASSERT_EQ(pool->stats().idle, 3u);
+
+	pool->maintain();
+	auto stats = pool->stats();
+	ASSERT_EQ(stats.total, 1u);
+	ASSERT_EQ(stats.idle, 1u);
+	ASSERT_EQ(stats.destroyed, 2u);
+}
+
+TEST_F(ResourcePoolTest, testCloseWakesWaiters) {
+	_options.max_size = 1;
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> first, second;
+	bool failed = false;
+	auto t1 = Borrow(*pool, first);
+	auto t2 = BorrowCatch(*pool, second, failed);
+	ASSERT_FALSE(failed);
+	pool->close();
+	ASSERT_TRUE(failed);
+	ASSERT_FALSE(second.has_value());
+	first.reset();
+	ASSERT_EQ(pool->stats().total, 0u);
+}
+
+TEST_F(ResourcePoolTest, testCreateFailure) {
+	_backend.refuse = true;
+	auto pool = make_pool();
+	std::optional<Lease<MockConn>> lease;
+	bool failed = false;
+	auto t = BorrowCatch(*pool, lease, failed);
+	t.get_result();
+	ASSERT_TRUE(failed);
+	ASSERT_EQ(pool->stats().total, 0u);
+
+	_backend.refuse = false;
+	failed = false;
+	auto t2 = BorrowCatch(*pool, lease, failed);
+	t2.get_result();
+	ASSERT_FALSE(failed);
+	ASSERT_TRUE(lease.has_value());
+}
+
+}  // namespace amot
@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "../unittest.h"
+#include "amot/http/httpmetrics.h"
+#include "amot/http/responsequeue.h"
+
+namespace amot {
+
+class ResponseQueueTest : public FUTURE_TESTBASE {
+public:
+	int _fds[2] = {-1, -1};
+	std::string _path;
+	std::string _content;
+
+public:
+	void caseSetUp() override {
+		WriteStats::Global().Reset();
+		WriteStats::Global().trackSegments = false;
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, _fds), 0);
+
+		char tmpl[] = "/tmp/amot_responsequeue_XXXXXX";
+		int fd = mkstemp(tmpl);
+		ASSERT_GE(fd, 0);
+		_path = tmpl;
+		for (int i = 0; i < 512 * 1024; i++) _content += static_cast<char>('a' + i % 26);
+		ASSERT_EQ(write(fd, _content.data(), _content.size()), static_cast<ssize_t>(_content.size()));
+		close(fd);
+	}
+	void caseTearDown() override {
+		for (int fd : _fds) {
+			if (fd >= 0) close(fd);
+		}
+		unlink(_path.c_str());
+		WriteStats::Global().Reset();
+		WriteStats::Global().trackSegments = false;
+	}
+
+	int openFile() { return open(_path.c_str(), O_RDONLY | O_CLOEXEC); }
+
+	static BufferChain chain(std::string_view text) {
+		BufferChain buf;
+		buf.Append(text);
+		return buf;
+	}
+
+	// 非阻塞读出对端已收到的全部数据
+	static std::string drain(int fd) {
+		std::string out;
+		char buf[65536];
+		ssize_t n;
+		while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) out.append(buf, n);
+		return out;
+	}
+
+	// 写端非阻塞，发送缓冲区尽量小，便于构造部分写与 EAGAIN
+	void makeWriterSmall() {
+		ASSERT_EQ(fcntl(_fds[0], F_SETFL, fcntl(_fds[0], F_GETFL) | O_NONBLOCK), 0);
+		int size = 4096;
+		ASSERT_EQ(setsockopt(_fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)), 0);
+		ASSERT_EQ(setsockopt(_fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)), 0);
+	}
+};
+
+TEST_F(ResponseQueueTest, testCoalesceIntoOneWritev) {
+	ResponseQueue queue(FlushPolicy::END_OF_LOOP);
+	queue.Push(chain("HTTP/1.1 200 OK\r\n\r\none"));
+	queue.Push(chain("HTTP/1.1 200 OK\r\n\r\ntwo"));
+	queue.Push(chain("HTTP/1.1 200 OK\r\n\r\nthree"));
+	ASSERT_FALSE(queue.NeedFlushNow());
+	const std::string expect = "HTTP/1.1 200 OK\r\n\r\none"
+							   "HTTP/1.1 200 OK\r\n\r\ntwo"
+							   "HTTP/1.1 200 OK\r\n\r\nthree";
+	ASSERT_EQ(queue.ToWriteBytes(), expect.size());
+
+	int err = 0;
+	ASSERT_EQ(queue.Flush(_fds[0], &err), static_cast<ssize_t>(expect.size()));
+	ASSERT_EQ(queue.ToWriteBytes(), 0u);
+	ASSERT_EQ(queue.PendingResponses(), 0u);
+	ASSERT_EQ(drain(_fds[1]), expect);
+
+	auto &stats = WriteStats::Global();
+	ASSERT_EQ(stats.responses.load(), 3u);
+	ASSERT_EQ(stats.writeCalls.load(), 1u);
+	ASSERT_EQ(stats.bytes.load(), expect.size());
+	ASSERT_DOUBLE_EQ(stats.WritesPerResponse(), 1.0 / 3);
+	// 未开启 trackSegments 时按写调用数估算
+	ASSERT_DOUBLE_EQ(stats.PacketsPerResponse(), 1.0 / 3);
+	ASSERT_EQ(queue.Flush(_fds[0], &err), 0);
+}
+
+TEST_F(ResponseQueueTest, testHeaderThenSendfile) {
+	ResponseQueue queue;
+	int fd = openFile();
+	ASSERT_GE(fd, 0);
+	queue.Push(chain("first"));
+	queue.PushFile(chain("header\r\n\r\n"), fd, 100, 1000);
+	queue.Push(chain("last"));
+	ASSERT_EQ(queue.PendingResponses(), 3u);
+
+	int err = 0;
+	const std::string expect = "first" + std::string("header\r\n\r\n") + _content.substr(100, 1000) + "last";
+	ASSERT_EQ(queue.Flush(_fds[0], &err), static_cast<ssize_t>(expect.size()));
+	ASSERT_EQ(drain(_fds[1]), expect);
+	// 文件段前的内存段合并为一次 writev，随后 sendfile，最后一次 writev
+	ASSERT_EQ(WriteStats::Global().writeCalls.load(), 3u);
+	ASSERT_EQ(WriteStats::Global().responses.load(), 3u);
+	// 发送完成后由队列关闭文件
+	ASSERT_EQ(fcntl(fd, F_GETFD), -1);
+	ASSERT_EQ(errno, EBADF);
+}
+
+TEST_F(ResponseQueueTest, testPartialWriteAndResume) {
+	makeWriterSmall();
+	ResponseQueue queue;
+	std::string big(200 * 1024, 'x');
+	for (size_t i = 0; i < big.size(); i++) big[i] = static_cast<char>('A' + i % 23);
+	queue.Push(chain(big.substr(0, 70000)));
+	queue.Push(chain(big.substr(70000)));
+	queue.PushFile(chain("file-header\r\n\r\n"), openFile(), 0, _content.size());
+	queue.Push(chain("tail"));
+	const std::string expect = big + "file-header\r\n\r\n" + _content + "tail";
+	ASSERT_EQ(queue.ToWriteBytes(), expect.size());
+
+	// 每次写到 EAGAIN 为止，读走一部分后继续，已写部分不重复、不丢失
+	std::string received;
+	size_t written = 0;
+	int partial = 0;
+	while (queue.ToWriteBytes() > 0) {
+		int err = 0;
+		ssize_t n = queue.Flush(_fds[0], &err);
+		if (n < 0) {
+			ASSERT_EQ(err, EAGAIN);
+		} else {
+			written += n;
+			if (queue.ToWriteBytes() > 0) partial++;
+		}
+		ASSERT_EQ(queue.ToWriteBytes(), expect.size() - written);
+		received += drain(_fds[1]);
+	}
+	received += drain(_fds[1]);
+	ASSERT_GT(partial, 0);
+	ASSERT_EQ(written, expect.size());
+	ASSERT_EQ(received.size(), expect.size());
+	ASSERT_TRUE(received == expect);
+	ASSERT_EQ(WriteStats::Global().bytes.load(), expect.size());
+	ASSERT_EQ(WriteStats::Global().responses.load(), 4u);
+	ASSERT_GT(WriteStats::Global().writeCalls.load(), static_cast<uint64_t>(partial));
+}
+
+TEST_F(ResponseQueueTest, testTrackAfterLastByte) {
+	makeWriterSmall();
+	MetricsRegistry registry;
+	HttpMetrics metrics(&registry);
+	ResponseQueue queue;
+	queue.SetMetrics(&metrics);
+	queue.Push(chain(std::string(100 * 1024, 'a')));
+	queue.Track("/", 200, 0);
+	// 第一次只能写出一部分，请求还不算完成
+	int err = 0;
+	ASSERT_GT(queue.Flush(_fds[0], &err), 0);
+	ASSERT_GT(queue.ToWriteBytes(), 0u);
+	auto done = [&]() {
+		const auto *series = registry.Snapshot().Find("amot_http_requests_total", {{"route", "/"}, {"code", "2xx"}});
+		return series ? series->value : 0;
+	};
+	ASSERT_EQ(done(), 0);
+	while (queue.ToWriteBytes() > 0) {
+		drain(_fds[1]);
+		queue.Flush(_fds[0], &err);
+	}
+	ASSERT_EQ(done(), 1);
+}
+
+TEST_F(ResponseQueueTest, testEagainWithoutProgress) {
+	makeWriterSmall();
+	// 先把发送缓冲区填满
+	std::string fill(512, 'f');
+	while (send(_fds[0], fill.data(), fill.size(), MSG_DONTWAIT) > 0) {
+	}
+	ASSERT_EQ(errno, EAGAIN);
+
+	ResponseQueue queue;
+	queue.Push(chain("pending"));
+	int err = 0;
+	ASSERT_EQ(queue.Flush(_fds[0], &err), -1);
+	ASSERT_EQ(err, EAGAIN);
+	ASSERT_EQ(queue.ToWriteBytes(), 7u);
+	ASSERT_EQ(queue.PendingResponses(), 1u);
+
+	std::string received;
+	while (queue.ToWriteBytes() > 0) {
+		received += drain(_fds[1]);
+		queue.Flush(_fds[0], &err);
+	}
+	received += drain(_fds[1]);
+	ASSERT_EQ(received.substr(received.size() - 7), "pending");
+}
+
+TEST_F(ResponseQueueTest, testCorkOverTcp) {
+	int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(listenFd, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	ASSERT_EQ(bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+	ASSERT_EQ(listen(listenFd, 1), 0);
+	socklen_t len = sizeof(addr);
+	ASSERT_EQ(getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &len), 0);
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_EQ(connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+	int server = accept(listenFd, nullptr, nullptr);
+	ASSERT_GE(server, 0);
+	close(listenFd);
+
+	WriteStats::Global().trackSegments = true;
+	ResponseQueue queue(FlushPolicy::CORK);
+	queue.Push(chain("HTTP/1.1 200 OK\r\n\r\nsmall"));
+	queue.PushFile(chain("HTTP/1.1 200 OK\r\n\r\n"), openFile(), 0, 300);
+	queue.Push(chain("HTTP/1.1 404 Not Found\r\n\r\n"));
+	size_t total = queue.ToWriteBytes();
+
+	int err = 0;
+	ASSERT_EQ(queue.Flush(server, &err), static_cast<ssize_t>(total));
+	// 写出结束后关闭 cork，尾部数据立即发出
+	int cork = -1;
+	len = sizeof(cork);
+	ASSERT_EQ(getsockopt(server, IPPROTO_TCP, TCP_CORK, &cork, &len), 0);
+	ASSERT_EQ(cork, 0);
+
+	std::string received;
+	char buf[4096];
+	while (received.size() < total) {
+		ssize_t n = read(client, buf, sizeof(buf));
+		ASSERT_GT(n, 0);
+		received.append(buf, n);
+	}
+	ASSERT_EQ(received, "HTTP/1.1 200 OK\r\n\r\nsmall" + std::string("HTTP/1.1 200 OK\r\n\r\n") + _content.substr(0, 300) +
+							"HTTP/1.1 404 Not Found\r\n\r\n");
+
+	// 三个响应、三次写调用，在 cork 下合成一个 TCP 段
+	auto &stats = WriteStats::Global();
+	ASSERT_EQ(stats.writeCalls.load(), 3u);
+	ASSERT_EQ(stats.segments.load(), 1u);
+	ASSERT_DOUBLE_EQ(stats.PacketsPerResponse(), 1.0 / 3);
+	close(client);
+	close(server);
+}
+
+}  // namespace amot
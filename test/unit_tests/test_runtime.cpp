@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/spscqueue.h"
+#include "amot/coroutine/runtime.h"
+
+namespace amot {
+
+class RuntimeTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override {}
+	void caseTearDown() override {}
+};
+
+TEST_F(RuntimeTest, testSpscQueue) {
+	SpscQueue<int> queue(3);
+	ASSERT_EQ(queue.capacity(), 4u);
+	for (int i = 0; i < 4; i++) {
+		ASSERT_TRUE(queue.try_push(int(i)));
+	}
+	ASSERT_FALSE(queue.try_push(4));
+	int value = -1;
+	ASSERT_TRUE(queue.try_pop(value));
+	ASSERT_EQ(value, 0);
+	ASSERT_TRUE(queue.try_push(4));
+	for (int i = 1; i <= 4; i++) {
+		ASSERT_TRUE(queue.try_pop(value));
+		ASSERT_EQ(value, i);
+	}
+	ASSERT_TRUE(queue.empty());
+
+	// 跨线程按序传递
+	SpscQueue<int> pipe(64);
+	const int total = 100000;
+	std::thread producer([&pipe]() {
+		for (int i = 0; i < total; i++) {
+			while (!pipe.try_push(int(i))) std::this_thread::yield();
+		}
+	});
+	int expect = 0;
+	while (expect < total) {
+		if (pipe.try_pop(value)) {
+			ASSERT_EQ(value, expect);
+			expect++;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+}
+
+TEST_F(RuntimeTest, testSubmitToCore) {
+	Runtime runtime(3, false);
+	ASSERT_EQ(Runtime::current_core(), -1);
+	for (size_t core = 0; core < runtime.size(); core++) {
+		std::promise<int> where;
+		runtime.submit_to(core, [&where]() { where.set_value(Runtime::current_core()); });
+		ASSERT_EQ(where.get_future().get(), int(core));
+	}
+}
+
+TEST_F(RuntimeTest, testCrossCoreOrdering) {
+	// 队列容量很小，迫使消息经过溢出队列，仍应保持 FIFO
+	Runtime runtime(2, false, 8);
+	CoreLocal<std::vector<int>> received(runtime);
+	const int total = 20000;
+	std::promise<void> done;
+	runtime.submit_to(0, [&]() {
+		for (int i = 0; i < total; i++) {
+			runtime.submit_to(1, [&, i]() {
+				received.local().push_back(i);
+				if (i == total - 1) done.set_value();
+			});
+		}
+	});
+	done.get_future().get();
+	runtime.stop();
+	runtime.join();
+	auto &values = received.on(1);
+	ASSERT_EQ(values.size(), size_t(total));
+	for (int i = 0; i < total; i++) {
+		ASSERT_EQ(values[i], i);
+	}
+	ASSERT_TRUE(received.on(0).empty());
+}
+
+TEST_F(RuntimeTest, testPingPong) {
+	Runtime runtime(2, false);
+	std::atomic<int> rounds{0};
+	std::promise<void> done;
+	std::function<void(size_t)> ping = [&](size_t core) {
+		if (++rounds == 10000) {
+			done.set_value();
+			return;
+		}
+		runtime.submit_to(1 - core, [&, core]() { ping(1 - core); });
+	};
+	runtime.submit_to(0, [&]() { ping(0); });
+	done.get_future().get();
+	ASSERT_EQ(rounds.load(), 10000);
+}
+
+Reactor::ConnTask CallOther(Runtime &runtime, std::promise<bool> *done) {
+	int self = Runtime::current_core();
+	int remote = co_await runtime.call_on(1, []() { return Runtime::current_core(); });
+	co_await runtime.call_on(1, []() {});
+	// 结果在核 1 上算出，协程回到自己所在的核继续执行
+	done->set_value(self == 0 && remote == 1 && Runtime::current_core() == 0);
+}
+
+TEST_F(RuntimeTest, testCallOn) {
+	Runtime runtime(2, false);
+	std::promise<bool> done;
+	runtime.spawn_on(0, [&runtime, &done]() { return CallOther(runtime, &done); });
+	ASSERT_TRUE(done.get_future().get());
+}
+
+}  // namespace amot
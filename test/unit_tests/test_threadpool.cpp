@@ -2,7 +2,12 @@
 #include <exception>
 
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
@@ -52,4 +57,360 @@ TEST_F(ThreadPoolTest, testScheduleWithId) {
     ASSERT_TRUE(_tp->getCurrentId() == -1);
 }
 
+/* 伪造的 sysfs：2 个节点，每节点 2 个物理核 x 2 超线程，兄弟为 i 与 i+4，每节点一个 L3 */
+static std::string MakeFakeSysfs() {
+    namespace fs = std::filesystem;
+    std::string root = (fs::temp_directory_path() / "amot_fake_sysfs").string();
+    fs::remove_all(root);
+    auto write = [](const std::string &path, const std::string &value) {
+        fs::create_directories(fs::path(path).parent_path());
+        std::ofstream(path) << value << "\n";
+    };
+    for (int i = 0; i < 8; i++) {
+        std::string cpu = root + "/cpu/cpu" + std::to_string(i);
+        int node = (i % 4) / 2;
+        write(cpu + "/topology/physical_package_id", std::to_string(node));
+        write(cpu + "/topology/core_id", std::to_string(i % 4));
+        write(cpu + "/cache/index0/type", "Data");
+        write(cpu + "/cache/index0/level", "1");
+        write(cpu + "/cache/index0/shared_cpu_list",
+              std::to_string(i % 4) + "," + std::to_string(i % 4 + 4));
+        write(cpu + "/cache/index1/type", "Instruction");
+        write(cpu + "/cache/index1/level", "1");
+        write(cpu + "/cache/index1/shared_cpu_list", "0");
+        write(cpu + "/cache/index2/type", "Unified");
+        write(cpu + "/cache/index2/level", "3");
+        write(cpu + "/cache/index2/shared_cpu_list", node == 0 ? "0-1,4-5" : "2-3,6-7");
+    }
+    write(root + "/node/node0/cpulist", "0-1,4-5");
+    write(root + "/node/node1/cpulist", "2-3,6-7");
+    return root;
+}
+
+static std::vector<uint32_t> Flatten(const std::vector<std::vector<uint32_t>> &sets) {
+    std::vector<uint32_t> ret;
+    for (auto &set : sets)
+        ret.insert(ret.end(), set.begin(), set.end());
+    return ret;
+}
+
+TEST_F(ThreadPoolTest, testTopologyPlacement) {
+    std::string root = MakeFakeSysfs();
+    auto topology = Topology::discover(root, {0, 1, 2, 3, 4, 5, 6, 7});
+    std::filesystem::remove_all(root);
+    ASSERT_EQ(topology.cpus().size(), 8u);
+    ASSERT_EQ(topology.coreCount(), 4u);
+    ASSERT_EQ(topology.nodes(), (std::vector<int32_t>{0, 1}));
+    ASSERT_EQ(topology.distance(0, 4), 1);
+    ASSERT_EQ(topology.distance(0, 5), 2);
+    ASSERT_EQ(topology.distance(0, 2), 4);
+
+    using V = std::vector<uint32_t>;
+    ASSERT_EQ(Flatten(topology.placement(PlacementPolicy::LINEAR, 8)),
+              (V{0, 1, 2, 3, 4, 5, 6, 7}));
+    ASSERT_EQ(Flatten(topology.placement(PlacementPolicy::COMPACT, 8)),
+              (V{0, 4, 1, 5, 2, 6, 3, 7}));
+    ASSERT_EQ(Flatten(topology.placement(PlacementPolicy::SCATTER, 8)),
+              (V{0, 2, 1, 3, 4, 6, 5, 7}));
+    ASSERT_EQ(Flatten(topology.placement(PlacementPolicy::PHYSICAL_CORE, 6)),
+              (V{0, 1, 2, 3, 0, 1}));
+    auto numa = topology.placement(PlacementPolicy::NUMA_NODE, 4);
+    ASSERT_EQ(numa[1], (V{0, 1, 4, 5}));
+    ASSERT_EQ(numa[2], (V{2, 3, 6, 7}));
+    ASSERT_EQ(Flatten(topology.onNode(1).placement(PlacementPolicy::COMPACT, 4)),
+              (V{2, 6, 3, 7}));
+    ASSERT_TRUE(Flatten(topology.placement(PlacementPolicy::NONE, 4)).empty());
+}
+
+TEST_F(ThreadPoolTest, testPlacementPool) {
+    _tp = std::make_shared<ThreadPool>(4, true, PlacementPolicy::COMPACT);
+    for (auto i = 0; i < _tp->getThreadNum(); ++i) {
+        ASSERT_EQ(_tp->getWorkerCpus(i).size(), 1u);
+        ASSERT_GE(_tp->getWorkerNode(i), 0);
+        ASSERT_EQ(_tp->getStealOrder(i)[0], i);
+        ASSERT_EQ(_tp->getStealOrder(i).size(), 4u);
+    }
+    std::atomic<int> done(0);
+    for (int i = 0; i < 100; i++)
+        _tp->scheduleById([&done]() { done++; });
+    while (done.load() != 100)
+        std::this_thread::yield();
+
+    // 工作线程自己首次写入所分配的内存
+    std::atomic<bool> touched(false);
+    _tp->scheduleById(
+        [this, &touched]() {
+            int32_t id = _tp->getCurrentId();
+            void *p = _tp->allocateLocal(id, 1 << 16);
+            ASSERT_NE(p, nullptr);
+            memset(p, 1, 1 << 16);
+            ThreadPool::deallocateLocal(p, 1 << 16);
+            touched = true;
+        },
+        1);
+    while (!touched.load())
+        std::this_thread::yield();
+
+    auto pools = ThreadPool::createPerNode(2);
+    ASSERT_EQ(pools.size(), Topology::get().nodes().size());
+}
+
+TEST_F(ThreadPoolTest, testWorkStealDeque) {
+    WorkStealDeque<int *> deque(4);
+    std::vector<int> values(100000);
+    std::atomic<size_t> taken(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; i++) {
+        thieves.emplace_back([&]() {
+            int *p = nullptr;
+            while (!done.load() || !deque.empty()) {
+                if (deque.steal(p)) {
+                    (*p)++;
+                    taken++;
+                }
+            }
+        });
+    }
+    // 所有者一边 push(触发扩容)一边 pop，每个元素恰好被取走一次
+    int *p = nullptr;
+    for (size_t i = 0; i < values.size(); i++) {
+        deque.push(&values[i]);
+        if (i % 3 == 0 && deque.pop(p)) {
+            (*p)++;
+            taken++;
+        }
+    }
+    while (deque.pop(p)) {
+        (*p)++;
+        taken++;
+    }
+    done = true;
+    for (auto &thief : thieves)
+        thief.join();
+    ASSERT_EQ(taken.load(), values.size());
+    for (int v : values)
+        ASSERT_EQ(v, 1);
+}
+
+TEST_F(ThreadPoolTest, testWorkStealFanout) {
+    _tp = std::make_shared<ThreadPool>(4, true);
+    std::atomic<int> done(0);
+    std::function<void(int)> spawn = [&](int depth) {
+        done++;
+        if (depth == 0)
+            return;
+        ASSERT_NE(_tp->getCurrentId(), -1);
+        _tp->scheduleById([&, depth]() { spawn(depth - 1); });
+        _tp->scheduleById([&, depth]() { spawn(depth - 1); });
+    };
+    _tp->scheduleById([&]() { spawn(12); });
+    while (done.load() != (1 << 13) - 1)
+        std::this_thread::yield();
+    ASSERT_EQ(_tp->getItemCount(), 0u);
+}
+
+TEST_F(ThreadPoolTest, testSubmitFuture) {
+    _tp = std::make_shared<ThreadPool>(2);
+    auto f1 = _tp->submit([]() { return 42; });
+    auto f2 = _tp->submit([this]() { return _tp->getCurrentId(); }, 1);
+    auto f3 = _tp->submit([]() { throw std::runtime_error("boom"); });
+    ASSERT_EQ(f1.get(), 42);
+    ASSERT_EQ(f2.get(), 1);
+    ASSERT_THROW(f3.get(), std::runtime_error);
+}
+
+TEST_F(ThreadPoolTest, testNestedSubmitWithoutSteal) {
+    // 不开启窃取时，worker 内部投递的任务也必须能被其它 worker 取到
+    _tp = std::make_shared<ThreadPool>(4);
+    auto outer = _tp->submit([this]() {
+        auto inner = _tp->submit([]() { return 7; });
+        if (inner.wait_for(std::chrono::seconds(2)) != std::future_status::ready)
+            return -1;
+        return inner.get();
+    });
+    ASSERT_EQ(outer.get(), 7);
+
+    // 从共享队列成批取出的任务不能困在取走它的 worker 的本地队列里
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    for (int i = 0; i < 4; i++)
+        _tp->scheduleById([opened]() { opened.wait(); });
+    std::promise<int> value;
+    std::future<int> dependency = value.get_future();
+    auto waiter = _tp->submit([&dependency]() {
+        return dependency.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    });
+    _tp->scheduleById([&value]() { value.set_value(1); });
+    for (int i = 0; i < 6; i++)
+        _tp->scheduleById([]() {});
+    gate.set_value();
+    ASSERT_TRUE(waiter.get());
+}
+
+TEST_F(ThreadPoolTest, testSubmitBulk) {
+    _tp = std::make_shared<ThreadPool>(4, true);
+    std::atomic<int> sum(0);
+    std::vector<std::function<void()>> fns;
+    for (int i = 1; i <= 1000; i++)
+        fns.emplace_back([&sum, i]() { sum += i; });
+    ASSERT_EQ(_tp->submitBulk(fns), ThreadPool::ERROR_NONE);
+    while (sum.load() != 500500)
+        std::this_thread::yield();
+
+    std::vector<std::function<void()>> bad(2);
+    ASSERT_EQ(_tp->submitBulk(bad), ThreadPool::ERROR_POOL_ITEM_IS_NULL);
+}
+
+TEST_F(ThreadPoolTest, testParallelFor) {
+    _tp = std::make_shared<ThreadPool>(4, true);
+    std::vector<int> data(100000, 0);
+    _tp->parallelFor<size_t>(0, data.size(), 64, [&data](size_t i) { data[i] += int(i % 7); });
+    for (size_t i = 0; i < data.size(); i++)
+        ASSERT_EQ(data[i], int(i % 7));
+
+    // 在工作线程内嵌套调用不会死锁
+    auto nested = _tp->submit([this]() {
+        std::atomic<long long> total(0);
+        _tp->parallelFor(0, 1000, 1, [&total](int i) { total += i; });
+        return total.load();
+    });
+    ASSERT_EQ(nested.get(), 499500);
+
+    ASSERT_THROW(_tp->parallelFor(0, 100, 1,
+                                  [](int i) {
+                                      if (i == 50)
+                                          throw std::runtime_error("bad index");
+                                  }),
+                 std::runtime_error);
+}
+
+TEST_F(ThreadPoolTest, testElasticGrowAndRetire) {
+    ThreadPool::Options options;
+    options.threadNum = 1;
+    options.maxThreadNum = 4;
+    options.enableWorkSteal = true;
+    options.idleTimeout = std::chrono::milliseconds(50);
+    options.growDelay = std::chrono::microseconds(0);
+    options.backlogThreshold = 1;
+    _tp = std::make_shared<ThreadPool>(options);
+    ASSERT_EQ(_tp->getThreadNum(), 1);
+    ASSERT_EQ(_tp->getMaxThreadNum(), 4);
+    ASSERT_EQ(_tp->getActiveThreadNum(), 1);
+
+    // 任务全部阻塞，积压持续存在，线程数应涨到上限
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::atomic<int> done(0);
+    for (int i = 0; i < 8; i++) {
+        _tp->scheduleById([gate, &done]() {
+            gate.wait();
+            done++;
+        });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (_tp->getActiveThreadNum() < 4 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_EQ(_tp->getActiveThreadNum(), 4);
+
+    release.set_value();
+    while (done.load() != 8)
+        std::this_thread::yield();
+    // 空闲超时后额外线程退出，核心线程保留
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (_tp->getActiveThreadNum() > 1 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(_tp->getActiveThreadNum(), 1);
+
+    // 退出的槽位可以再次启用
+    auto result = _tp->submit([]() { return 7; });
+    ASSERT_EQ(result.get(), 7);
+}
+
+TEST_F(ThreadPoolTest, testElasticGrowWhenWorkerBlocks) {
+    ThreadPool::Options options;
+    options.threadNum = 1;
+    options.maxThreadNum = 2;
+    options.enableWorkSteal = true;
+    options.growDelay = std::chrono::microseconds(0);
+    options.backlogThreshold = 1;
+    // 空闲的工作线程长时间处于查找状态，提交方看到有人在找就不扩容
+    options.spinRounds = 0;
+    options.yieldRounds = 200000;
+    _tp = std::make_shared<ThreadPool>(options);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // 第一个任务阻塞到第二个执行为止，只有取到任务的工作线程能发现积压并扩容
+    std::promise<void> ran;
+    std::shared_future<void> second = ran.get_future().share();
+    std::atomic<int> unblocked(-1);
+    std::vector<std::function<void()>> fns;
+    fns.emplace_back([second, &unblocked]() {
+        unblocked = second.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    });
+    fns.emplace_back([&ran]() { ran.set_value(); });
+    _tp->submitBulk(fns);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (unblocked.load() < 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_EQ(unblocked.load(), 1);
+    ASSERT_EQ(_tp->getActiveThreadNum(), 2);
+}
+
+TEST_F(ThreadPoolTest, testNoSpinIdle) {
+    ThreadPool::Options options;
+    options.threadNum = 2;
+    options.spinRounds = 0;
+    options.yieldRounds = 0;
+    _tp = std::make_shared<ThreadPool>(options);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(_tp->submit([i]() { return i * 2; }).get(), i * 2);
+    }
+}
+
+TEST_F(ThreadPoolTest, testStats) {
+    ThreadPool::Options options;
+    options.threadNum = 2;
+    options.enableWorkSteal = true;
+    options.recordTimings = true;
+    _tp = std::make_shared<ThreadPool>(options);
+    std::vector<std::function<void()>> fns(20, []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    _tp->submitBulk(fns);
+    // 最后一个任务完成后工作线程才写入计数，等待其可见
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (_tp->getStats().executed < 20 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    ExecutorStats stats = _tp->getStats();
+    ASSERT_EQ(stats.executed, 20u);
+    ASSERT_EQ(_tp->getWorkerStats(0).snapshot().executed +
+                  _tp->getWorkerStats(1).snapshot().executed,
+              20u);
+    ASSERT_GE(stats.busyNs, 20u * 1000000);
+    ASSERT_GE(stats.stealAttempts, stats.stealHits);
+    ASSERT_GE(stats.parks, stats.unparks);
+
+    Histogram wait, run;
+    _tp->mergeWaitTime(wait);
+    _tp->mergeRunTime(run);
+    ASSERT_EQ(run.Count(), 20u);
+    ASSERT_GE(run.Min(), 1000000u);
+    ASSERT_EQ(wait.Count(), 20u);
+}
+
+TEST_F(ThreadPoolTest, testStatsWithoutTimings) {
+    _tp = std::make_shared<ThreadPool>(1);
+    ASSERT_EQ(_tp->submit([]() { return 1; }).get(), 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (_tp->getStats().executed < 1 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    ASSERT_EQ(_tp->getStats().executed, 1u);
+    ASSERT_EQ(_tp->getStats().busyNs, 0u);
+    Histogram run;
+    _tp->mergeRunTime(run);
+    ASSERT_EQ(run.Count(), 0u);
+}
+
 }
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "../unittest.h"
+#include "amot/common/timingwheel.h"
+
+namespace amot {
+
+class TimingWheelTest : public FUTURE_TESTBASE {
+public:
+	std::vector<int> _expired;
+
+public:
+	void caseSetUp() override { _expired.clear(); }
+	void caseTearDown() override {}
+};
+
+TEST_F(TimingWheelTest, testExpire) {
+    TimingWheel wheel(1024, 1000, 100, 16);
+    wheel.Add(3, 10000);
+    wheel.Add(4, 10050);
+    ASSERT_EQ(wheel.Size(), 2u);
+    ASSERT_EQ(wheel.GetNextTick(10050), 50);
+
+    ASSERT_EQ(wheel.Tick(10900, _expired), 0u);
+    ASSERT_EQ(wheel.Tick(11000, _expired), 1u);
+    ASSERT_EQ(_expired, std::vector<int>{3});
+    ASSERT_EQ(wheel.Tick(11100, _expired), 1u);
+    ASSERT_EQ(_expired, (std::vector<int>{3, 4}));
+    ASSERT_EQ(wheel.Size(), 0u);
+    ASSERT_EQ(wheel.GetNextTick(11100), -1);
+}
+
+TEST_F(TimingWheelTest, testTouchDefersExpiry) {
+    TimingWheel wheel(1024, 1000, 100, 16);
+    wheel.Add(5, 0);
+    for (uint64_t now = 100; now <= 3000; now += 100) {
+        wheel.Touch(5, now);
+        ASSERT_EQ(wheel.Tick(now, _expired), 0u) << now;
+    }
+    ASSERT_EQ(wheel.Tick(3900, _expired), 0u);
+    ASSERT_EQ(wheel.Tick(4000, _expired), 1u);
+    ASSERT_EQ(_expired, std::vector<int>{5});
+}
+
+TEST_F(TimingWheelTest, testRemoveAndReuse) {
+    TimingWheel wheel(1024, 500, 100, 8);
+    wheel.Add(7, 0);
+    wheel.Remove(7);
+    wheel.Add(7, 300);
+    ASSERT_EQ(wheel.Tick(600, _expired), 0u);
+    ASSERT_EQ(wheel.Tick(800, _expired), 1u);
+    ASSERT_EQ(_expired, std::vector<int>{7});
+}
+
+TEST_F(TimingWheelTest, testRemoveFromWorker) {
+    TimingWheel wheel(1024, 500, 100, 8);
+    for (int fd = 0; fd < 1000; ++fd)
+        wheel.Add(fd, 0);
+    // Connections closed by pool threads leave the wheel while it ticks.
+    std::thread worker([&] {
+        for (int fd = 0; fd < 1000; ++fd)
+            wheel.Remove(fd);
+    });
+    for (uint64_t now = 100; now < 500; now += 100)
+        wheel.Tick(now, _expired);
+    worker.join();
+    ASSERT_EQ(wheel.Size(), 0u);
+    ASSERT_EQ(wheel.GetNextTick(500), -1);
+    ASSERT_EQ(wheel.Tick(1000, _expired), 0u);
+    ASSERT_TRUE(_expired.empty());
+}
+
+TEST_F(TimingWheelTest, testTimeoutLongerThanWheel) {
+    TimingWheel wheel(1024, 5000, 100, 8);
+    for (int fd = 0; fd < 100; ++fd)
+        wheel.Add(fd, 0);
+    for (uint64_t now = 100; now < 5000; now += 100)
+        ASSERT_EQ(wheel.Tick(now, _expired), 0u) << now;
+    ASSERT_EQ(wheel.Tick(5000, _expired), 100u);
+    // Long pause: everything due is collected in one batch.
+    for (int fd = 0; fd < 10; ++fd)
+        wheel.Add(fd, 6000);
+    ASSERT_EQ(wheel.Tick(60000, _expired), 10u);
+}
+
+}
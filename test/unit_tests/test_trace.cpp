@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "../unittest.h"
+#include "amot/coroutine/channel.h"
+#include "amot/coroutine/executor.h"
+#include "amot/coroutine/task.h"
+#include "amot/coroutine/trace.h"
+
+namespace amot {
+
+using namespace std::chrono_literals;
+
+class TraceTest : public FUTURE_TESTBASE {
+public:
+	void caseSetUp() override { Tracer::instance().clear(); }
+	void caseTearDown() override {}
+};
+
+static size_t Count(const std::string &text, const std::string &pattern) {
+	size_t n = 0;
+	for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) n++;
+	return n;
+}
+
+static Task<void, LooperExecutor> Producer(Channel<int> &channel) {
+	for (int i = 0; i < 3; i++) {
+		co_await channel.write(i);
+		co_await 1ms;
+	}
+}
+
+static Task<int, LooperExecutor> Consumer(Channel<int> &channel) {
+	int sum = 0;
+	for (int i = 0; i < 3; i++) {
+		sum += co_await channel.read();
+	}
+	co_return sum;
+}
+
+TEST_F(TraceTest, testChromeTrace) {
+	Channel<int> channel;
+	auto consumer = Consumer(channel);
+	auto producer = Producer(channel);
+	ASSERT_EQ(consumer.get_result(), 3);
+	producer.get_result();
+
+	// get_result 在结果写入后即返回，complete 在随后的 final_suspend 中记录
+	std::string json;
+	auto deadline = std::chrono::steady_clock::now() + 1s;
+	do {
+		std::stringstream out;
+		Tracer::instance().dump_chrome_json(out);
+		json = out.str();
+	} while (Count(json, "\"ph\":\"e\"") < 2 && std::chrono::steady_clock::now() < deadline);
+	ASSERT_EQ(json.rfind("{\"traceEvents\":[", 0), 0u);
+	// 两个协程各有一条从创建到结束的异步轨道
+	ASSERT_EQ(Count(json, "\"ph\":\"b\""), 2u);
+	ASSERT_EQ(Count(json, "\"ph\":\"e\""), 2u);
+	// 每次恢复都对应一次挂起或结束，切片成对
+	ASSERT_GT(Count(json, "\"ph\":\"B\""), 2u);
+	ASSERT_EQ(Count(json, "\"ph\":\"B\""), Count(json, "\"ph\":\"E\""));
+	ASSERT_EQ(Count(json, "\"ph\":\"s\""), Count(json, "\"ph\":\"f\""));
+	ASSERT_GT(Count(json, "channel read") + Count(json, "channel write"), 0u);
+	ASSERT_EQ(Count(json, "timer fire"), 3u);
+}
+
+TEST_F(TraceTest, testDisabled) {
+	Tracer::instance().set_enabled(false);
+	Channel<int> channel(3);
+	auto producer = Producer(channel);
+	producer.get_result();
+	Tracer::instance().set_enabled(true);
+
+	std::stringstream out;
+	Tracer::instance().dump_chrome_json(out);
+	ASSERT_EQ(Count(out.str(), "\"ph\":\"b\""), 0u);
+}
+}  // namespace amot